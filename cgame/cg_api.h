@@ -194,6 +194,7 @@ struct cgImportAPI_t
 	void		(*R_AddDecal) (refDecal_t *decal, const colorb &color, const float materialTime);
 	void		(*R_AddEntity) (refEntity_t *ent);
 	void		(*R_AddPoly) (refPoly_t *poly);
+	void		(*R_AddParticles) (const refParticle_t *particles, const int numParticles);
 	void		(*R_AddLight) (vec3_t org, float intensity, float r, float g, float b);
 	void		(*R_AddLightStyle) (int style, float r, float g, float b);
 
@@ -245,6 +246,12 @@ struct cgImportAPI_t
 	uint32		(*Sys_Cycles) ();
 	double		(*Sys_MSPerCycle) ();
 
+	int			(*Job_NumThreads) ();
+	void		(*Job_Run) (jobFunc_t func, void *arg, const int numJobs);
+
+	int			(*Prof_Begin) (const char *name);
+	void		(*Prof_End) (const int event);
+
 	Script		*(*Lua_CreateLuaState) (const char *fileName);
 	Script		*(*Lua_ScriptFromState) (lua_State *state);
 	void		(*Lua_RegisterFunctions) (Script *state, const ScriptFunctionTable *list);
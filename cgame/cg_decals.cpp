@@ -177,10 +177,21 @@ void CG_ClearDecals ()
 
 /*
 ===============
-CG_AddDecals
+CG_SimulateDecal
+
+Fades a decal and works out its color. num is its position in the decal list,
+anything past cg_decalMax dies. Decals with a think function pending may only
+be run on the main thread.
 ===============
 */
-void CG_AddDecals ()
+enum EDecalResult
+{
+	DECAL_DEAD,
+	DECAL_HIDDEN,
+	DECAL_VISIBLE
+};
+
+static EDecalResult CG_SimulateDecal (cgDecal_t *decal, const int num, colorb &outColor)
 {
 	float		lifeTime, finalTime;
 	float		fade;
@@ -188,119 +199,248 @@ void CG_AddDecals ()
 	uint32		flags;
 	vec4_t		color;
 	vec3_t		temp;
-	colorb		outColor;
-	int			num;
+	EDecalResult result = DECAL_HIDDEN;
+
+	if (decal->colorVel[3] > DECAL_INSTANT) {
+		// Determine how long this decal shall live for
+		if (decal->flags & DF_FIXED_LIFE)
+			lifeTime = decal->lifeTime;
+		else if (decal->flags & DF_USE_BURNLIFE)
+			lifeTime = decal->lifeTime + cg_decalBurnLife->floatVal;
+		else
+			lifeTime = decal->lifeTime + cg_decalLife->floatVal;
+
+		// Start fading
+		finalTime = decal->time + (lifeTime * 1000);
+		if ((float)cg.refreshTime > finalTime)  {
+			// Finished the life, fade for cg_decalFadeTime
+			if (cg_decalFadeTime->floatVal) {
+				lifeTime = cg_decalFadeTime->floatVal;
+
+				// final alpha * ((fade time - time since death) / fade time)
+				color[3] = decal->colorVel[3] * ((lifeTime - (((float)cg.refreshTime - finalTime) * 0.001f)) / lifeTime);
+			}
+			else
+				color[3] = 0.0f;
+		}
+		else {
+			// Not done living, fade between start/final alpha
+			fade = (lifeTime - (((float)cg.refreshTime - decal->time) * 0.001f)) / lifeTime;
+			color[3] = (fade * decal->color[3]) + ((1.0f - fade) * decal->colorVel[3]);
+		}
+	}
+	else {
+		color[3] = decal->color[3];
+	}
 
-	if (!cg_decals->intVal)
-		return;
+	// Faded out
+	if (color[3] <= 0.0001f || num > cg_decalMax->intVal)
+		return DECAL_DEAD;
 
-	// Add to list
-	num = 0;
-	TLinkedList<cgDecal_t*>::Node *next = null;
-	for (var d = decalList.Head(); d != null; d = next)
-	{
-		next = d->Next;
-		num++;
+	if (color[3] > 1.0f)
+		color[3] = 1.0f;
 
-		var decal = d->Value;
+	// Small decal lod
+	if (cg_decalLOD->intVal && decal->size < 12) {
+		Vec3Subtract (cg.refDef.viewOrigin, decal->refDecal.poly.origin, temp);
+		if (DotProduct(temp, temp)/15000 > 100*decal->size)
+			goto nextDecal;
+	}
 
-		if (decal->colorVel[3] > DECAL_INSTANT) {
-			// Determine how long this decal shall live for
-			if (decal->flags & DF_FIXED_LIFE)
-				lifeTime = decal->lifeTime;
-			else if (decal->flags & DF_USE_BURNLIFE)
-				lifeTime = decal->lifeTime + cg_decalBurnLife->floatVal;
-			else
-				lifeTime = decal->lifeTime + cg_decalLife->floatVal;
-
-			// Start fading
-			finalTime = decal->time + (lifeTime * 1000);
-			if ((float)cg.refreshTime > finalTime)  {
-				// Finished the life, fade for cg_decalFadeTime
-				if (cg_decalFadeTime->floatVal) {
-					lifeTime = cg_decalFadeTime->floatVal;
-
-					// final alpha * ((fade time - time since death) / fade time)
-					color[3] = decal->colorVel[3] * ((lifeTime - (((float)cg.refreshTime - finalTime) * 0.001f)) / lifeTime);
-				}
+	// ColorVel calcs
+	if (decal->color[3] > DECAL_INSTANT) {
+		for (i=0 ; i<3 ; i++) {
+			if (decal->color[i] != decal->colorVel[i]) {
+				if (decal->color[i] > decal->colorVel[i])
+					color[i] = decal->color[i] - ((decal->color[i] - decal->colorVel[i]) * (decal->color[3] - color[3]));
 				else
-					color[3] = 0.0f;
+					color[i] = decal->color[i] + ((decal->colorVel[i] - decal->color[i]) * (decal->color[3] - color[3]));
 			}
 			else {
-				// Not done living, fade between start/final alpha
-				fade = (lifeTime - (((float)cg.refreshTime - decal->time) * 0.001f)) / lifeTime;
-				color[3] = (fade * decal->color[3]) + ((1.0f - fade) * decal->colorVel[3]);
+				color[i] = decal->color[i];
 			}
+
+			color[i] = clamp (color[i], 0, 255);
 		}
-		else {
-			color[3] = decal->color[3];
-		}
+	}
+	else {
+		Vec3Copy (decal->color, color);
+	}
+
+	// Adjust ramp to desired initial and final alpha settings
+	color[3] = (color[3] * decal->color[3]) + ((1 - color[3]) * decal->colorVel[3]);
+
+	if (decal->flags & DF_ALPHACOLOR)
+		Vec3Scale (color, color[3], color);
+
+	// Think func
+	flags = decal->flags;
+	if (decal->think && decal->thinkNext) {
+		decal->thinkNext = false;
+		decal->think (decal, color, &type, &flags);
+	}
+
+	if (color[3] <= 0.0f)
+		goto nextDecal;
+
+	// Render it
+	outColor[0] = color[0];
+	outColor[1] = color[1];
+	outColor[2] = color[2];
+	outColor[3] = color[3] * 255;
+	result = DECAL_VISIBLE;
+nextDecal:
+	// Kill if instant
+	if (decal->colorVel[3] <= DECAL_INSTANT) {
+		decal->color[3] = 0.0;
+		decal->colorVel[3] = 0.0;
+	}
+
+	return result;
+}
+
+/*
+=============================================================================
+
+	DECAL JOBS
+
+	Same split as the particle jobs: chunks of decals are faded on the job
+	threads, and the main thread frees the dead ones, hands the visible ones
+	to the renderer and runs the thinkers, all in chunk order.
+=============================================================================
+*/
+
+#define DECAL_CHUNK_SIZE	256
+
+struct decalChunk_t
+{
+	int				first;
+	int				num;
+
+	cgDecal_t		*visible[DECAL_CHUNK_SIZE];
+	colorb			visibleColors[DECAL_CHUNK_SIZE];
+	int				numVisible;
+
+	cgDecal_t		*dead[DECAL_CHUNK_SIZE];
+	int				numDead;
 
-		// Faded out
-		if (color[3] <= 0.0001f || num > cg_decalMax->intVal) {
-			CG_FreeDecal (decal);
+	cgDecal_t		*thinkers[DECAL_CHUNK_SIZE];
+	int				thinkerNums[DECAL_CHUNK_SIZE];	// place in the decal list, for cg_decalMax
+	int				numThinkers;
+};
+
+static cgDecal_t	**cg_decalArray;
+static decalChunk_t	*cg_decalChunks;
+static int			cg_decalArraySize;
+
+/*
+===============
+CG_DecalJob
+===============
+*/
+static void CG_DecalJob (void *arg, const int jobNum)
+{
+	decalChunk_t	*chunk = &cg_decalChunks[jobNum];
+	cgDecal_t		*decal;
+	colorb			outColor;
+
+	chunk->numVisible = 0;
+	chunk->numDead = 0;
+	chunk->numThinkers = 0;
+
+	for (int i=chunk->first ; i<chunk->first+chunk->num ; i++) {
+		decal = cg_decalArray[i];
+
+		if (decal->think && decal->thinkNext) {
+			chunk->thinkerNums[chunk->numThinkers] = i+1;
+			chunk->thinkers[chunk->numThinkers++] = decal;
 			continue;
 		}
 
-		if (color[3] > 1.0f)
-			color[3] = 1.0f;
+		switch (CG_SimulateDecal (decal, i+1, outColor)) {
+		case DECAL_DEAD:
+			chunk->dead[chunk->numDead++] = decal;
+			break;
 
-		// Small decal lod
-		if (cg_decalLOD->intVal && decal->size < 12) {
-			Vec3Subtract (cg.refDef.viewOrigin, decal->refDecal.poly.origin, temp);
-			if (DotProduct(temp, temp)/15000 > 100*decal->size)
-				goto nextDecal;
+		case DECAL_VISIBLE:
+			chunk->visibleColors[chunk->numVisible] = outColor;
+			chunk->visible[chunk->numVisible++] = decal;
+			break;
 		}
+	}
+}
 
-		// ColorVel calcs
-		if (decal->color[3] > DECAL_INSTANT) {
-			for (i=0 ; i<3 ; i++) {
-				if (decal->color[i] != decal->colorVel[i]) {
-					if (decal->color[i] > decal->colorVel[i])
-						color[i] = decal->color[i] - ((decal->color[i] - decal->colorVel[i]) * (decal->color[3] - color[3]));
-					else
-						color[i] = decal->color[i] + ((decal->colorVel[i] - decal->color[i]) * (decal->color[3] - color[3]));
-				}
-				else {
-					color[i] = decal->color[i];
-				}
-
-				color[i] = clamp (color[i], 0, 255);
-			}
-		}
-		else {
-			Vec3Copy (decal->color, color);
-		}
 
-		// Adjust ramp to desired initial and final alpha settings
-		color[3] = (color[3] * decal->color[3]) + ((1 - color[3]) * decal->colorVel[3]);
+/*
+===============
+CG_AddDecals
+===============
+*/
+void CG_AddDecals ()
+{
+	decalChunk_t	*chunk;
+	cgDecal_t		*decal;
+	colorb			outColor;
+	int				numDecals, numChunks;
+	int				i, j;
+
+	if (!cg_decals->intVal)
+		return;
 
-		if (decal->flags & DF_ALPHACOLOR)
-			Vec3Scale (color, color[3], color);
+	numDecals = decalList.Count();
+	if (!numDecals)
+		return;
 
-		// Think func
-		flags = decal->flags;
-		if (decal->think && decal->thinkNext) {
-			decal->thinkNext = false;
-			decal->think (decal, color, &type, &flags);
-		}
+	numChunks = (numDecals + DECAL_CHUNK_SIZE - 1) / DECAL_CHUNK_SIZE;
+	if (numDecals > cg_decalArraySize) {
+		delete[] cg_decalArray;
+		delete[] cg_decalChunks;
 
-		if (color[3] <= 0.0f)
-			goto nextDecal;
+		cg_decalArraySize = numChunks * DECAL_CHUNK_SIZE;
+		cg_decalArray = new cgDecal_t*[cg_decalArraySize];
+		cg_decalChunks = new decalChunk_t[numChunks];
+	}
 
-		// Render it
-		outColor[0] = color[0];
-		outColor[1] = color[1];
-		outColor[2] = color[2];
-		outColor[3] = color[3] * 255;
+	i = 0;
+	for (var d = decalList.Head(); d != null; d = d->Next)
+		cg_decalArray[i++] = d->Value;
 
-		cgi.R_AddDecal(&decal->refDecal, outColor, 0);
+	for (i=0 ; i<numChunks ; i++) {
+		cg_decalChunks[i].first = i * DECAL_CHUNK_SIZE;
+		cg_decalChunks[i].num = min(DECAL_CHUNK_SIZE, numDecals - cg_decalChunks[i].first);
+	}
 
-nextDecal:
-		// Kill if instant
-		if (decal->colorVel[3] <= DECAL_INSTANT) {
-			decal->color[3] = 0.0;
-			decal->colorVel[3] = 0.0;
+	// Fade
+	if (cg_effectJobs->intVal)
+		cgi.Job_Run (CG_DecalJob, NULL, numChunks);
+	else {
+		for (i=0 ; i<numChunks ; i++)
+			CG_DecalJob (NULL, i);
+	}
+
+	// Merge in chunk order
+	for (i=0, chunk=cg_decalChunks ; i<numChunks ; i++, chunk++) {
+		for (j=0 ; j<chunk->numVisible ; j++)
+			cgi.R_AddDecal (&chunk->visible[j]->refDecal, chunk->visibleColors[j], 0);
+
+		for (j=0 ; j<chunk->numThinkers ; j++) {
+			decal = chunk->thinkers[j];
+
+			switch (CG_SimulateDecal (decal, chunk->thinkerNums[j], outColor)) {
+			case DECAL_DEAD:
+				chunk->dead[chunk->numDead++] = decal;
+				break;
+
+			case DECAL_VISIBLE:
+				cgi.R_AddDecal (&decal->refDecal, outColor, 0);
+				break;
+			}
 		}
 	}
+
+	// Dead decals never reached the renderer, so they can go straight away
+	for (i=0, chunk=cg_decalChunks ; i<numChunks ; i++, chunk++) {
+		for (j=0 ; j<chunk->numDead ; j++)
+			CG_FreeDecal (chunk->dead[j]);
+	}
 }
@@ -396,6 +396,7 @@ struct cgParticle_t
 	float					nextLightingTime;
 
 	// Passed to refresh
+	refParticle_t			outParticle;
 	refPoly_t				outPoly;
 	colorb					outColor[4];
 	vec2_t					outCoords[4];
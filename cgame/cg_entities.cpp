@@ -1396,8 +1396,14 @@ void CG_AddEntities ()
 	CG_AddLocalEnts ();
 	CG_AddDLights ();
 	CG_AddLightStyles ();
-	CG_AddParticles ();
-	CG_AddDecals ();
+	{
+		qProfile_Scope Prof("CG_AddParticles");
+		CG_AddParticles ();
+	}
+	{
+		qProfile_Scope Prof("CG_AddDecals");
+		CG_AddDecals ();
+	}
 }
 
 
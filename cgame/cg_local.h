@@ -116,6 +116,23 @@ struct cgDownloadInfo_t {
 	float		bytesDown;
 };
 
+// Frame profiler zone, closed when it goes out of scope
+class qProfile_Scope
+{
+protected:
+	int Event;
+
+public:
+	qProfile_Scope(const char *Name)
+		: Event(cgi.Prof_Begin(Name))
+	{
+	}
+	~qProfile_Scope()
+	{
+		cgi.Prof_End(Event);
+	}
+};
+
 // ==========================================================================
 
 struct cgState_t {
@@ -378,7 +395,9 @@ extern cVar_t	*cg_decalLife;
 extern cVar_t	*cg_decalLOD;
 extern cVar_t	*cg_decalMax;
 extern cVar_t	*cg_mapEffects;
+extern cVar_t	*cg_mapEffectMax;
 extern cVar_t	*cl_add_particles;
+extern cVar_t	*cg_effectJobs;
 extern cVar_t	*cg_particleCulling;
 extern cVar_t	*cg_particleGore;
 extern cVar_t	*cg_particleMax;
@@ -36,7 +36,9 @@ cVar_t	*cg_decalLife;
 cVar_t	*cg_decalLOD;
 cVar_t	*cg_decalMax;
 cVar_t	*cg_mapEffects;
+cVar_t	*cg_mapEffectMax;
 cVar_t	*cl_add_particles;
+cVar_t	*cg_effectJobs;
 cVar_t	*cg_particleCulling;
 cVar_t	*cg_particleGore;
 cVar_t	*cg_particleMax;
@@ -351,7 +353,9 @@ static void CG_RegisterMain ()
 	cg_decalLOD				= cgi.Cvar_Register ("cg_decalLOD",				"1",			CVAR_ARCHIVE);
 	cg_decalMax				= cgi.Cvar_Register ("cg_decalMax",				"4096",			CVAR_ARCHIVE);
 	cg_mapEffects			= cgi.Cvar_Register ("cg_mapEffects",			"1",			CVAR_ARCHIVE);
+	cg_mapEffectMax			= cgi.Cvar_Register ("cg_mapEffectMax",			"1024",			CVAR_ARCHIVE);
 	cl_add_particles		= cgi.Cvar_Register ("cl_particles",			"1",			0);
+	cg_effectJobs			= cgi.Cvar_Register ("cg_effectJobs",			"1",			CVAR_ARCHIVE);
 	cg_particleCulling		= cgi.Cvar_Register ("cg_particleCulling",		"1",			CVAR_ARCHIVE);
 	cg_particleGore			= cgi.Cvar_Register ("cg_particleGore",			"3",			CVAR_ARCHIVE);
 	cg_particleMax			= cgi.Cvar_Register ("cg_particleMax",			"8192",			CVAR_ARCHIVE);
@@ -59,6 +59,7 @@ struct mapEffect_t
 	vec3_t		outVertices[4];
 
 	int			visFrame;
+	int			headNode;	// -1 unless it touched too many leafs to bucket by cluster
 };
 
 // <org0 org1 org2> <vel0 vel1 vel2> <accel0 accel1 accel2>
@@ -159,7 +160,7 @@ struct pvs_t
 
 				if (j == i)
 				{
-					if (numClusters == 128) {
+					if (numClusters == ArrayCount(clusterNums)) {
 						// Assume we missed some leafs, and mark by headNode
 						numClusters = -1;
 						headNode = topnode;
@@ -173,14 +174,20 @@ struct pvs_t
 	}
 };
 
-struct mapEffectGroup_t
-{
-	pvs_t					pvs;
-	TList<mapEffect_t*>		effects;
-};
-
 static TList<mapEffect_t*> cg_mapEffectList;
-static TList<mapEffectGroup_t*> cg_mapEffectGroups;
+
+// Effects are bucketed by the clusters they sit in at load time. Only the
+// buckets of clusters in the current fat PVS are walked, and that set is only
+// updated when the clusters around the view change.
+static TList<mapEffect_t*>	*cg_mfxClusterEffects;
+static bool			*cg_mfxClusterActive;
+static int			cg_mfxNumClusters;
+static TList<int>	cg_mfxUsedClusters;		// Clusters with at least one effect
+static TList<int>	cg_mfxActiveClusters;	// Used clusters that are in the fat PVS
+
+// Effects that could not be bucketed, visibility checked by headnode
+static TList<mapEffect_t*> cg_mfxHeadnodeEffects;
+static TList<mapEffect_t*> cg_mfxActiveHeadnodeEffects;
 
 static char			cg_mfxFileName[MAX_QPATH];
 static char			cg_mfxMapName[MAX_QPATH];
@@ -248,11 +255,31 @@ bool CheckMFXCulling (mapEffect_t *mfx)
 	return !mfx->lastVisible;
 }
 
-static byte		sv_fatPVS[65536/8];	// 32767 is Q2BSP_MAX_LEAFS
-void SV_FatPVS (vec3_t org)
+/*
+=============================================================================
+
+	VISIBILITY
+
+=============================================================================
+*/
+
+static byte		cg_mfxFatPVS[65536/8];	// 32767 is Q2BSP_MAX_LEAFS
+static int		cg_mfxViewClusters[64];
+static int		cg_mfxNumViewClusters = -1;
+
+/*
+==================
+CG_MFXFatPVS
+
+Rebuilds the fat PVS around the view, but only when the set of clusters it is
+made from changed since the last call. Returns true if it was rebuilt.
+==================
+*/
+static bool CG_MFXFatPVS (vec3_t org)
 {
 	int		leafs[64];
-	int		i, j, count;
+	int		clusters[64];
+	int		i, j, count, numClusters;
 	int		longs;
 	byte	*src;
 	vec3_t	mins, maxs;
@@ -264,138 +291,202 @@ void SV_FatPVS (vec3_t org)
 
 	count = cgi.CM_BoxLeafnums (mins, maxs, leafs, 64, NULL);
 	if (count < 1)
-		Com_Error (ERR_FATAL, "SV_FatPVS: count < 1");
-	longs = (cgi.CM_NumClusters()+31)>>5;
+		Com_Error (ERR_FATAL, "CG_MFXFatPVS: count < 1");
 
-	// convert leafs to clusters
-	for (i=0 ; i<count ; i++)
+	// Convert leafs to unique clusters
+	numClusters = 0;
+	for (i=0 ; i<count ; i++) {
 		leafs[i] = cgi.CM_LeafCluster(leafs[i]);
-
-	memcpy (sv_fatPVS, cgi.CM_ClusterPVS(leafs[0]), longs<<2);
-	// or in all the other leaf bits
-	for (i=1 ; i<count ; i++) {
-		for (j=0 ; j<i ; j++)
-			if (leafs[i] == leafs[j])
+		for (j=0 ; j<numClusters ; j++)
+			if (clusters[j] == leafs[i])
 				break;
-		if (j != i)
-			continue;		// already have the cluster we want
-		src = cgi.CM_ClusterPVS(leafs[i]);
+		if (j == numClusters)
+			clusters[numClusters++] = leafs[i];
+	}
+
+	// Same clusters as last time, the cached bits are still good
+	if (numClusters == cg_mfxNumViewClusters && !memcmp (clusters, cg_mfxViewClusters, sizeof(int) * numClusters))
+		return false;
+
+	memcpy (cg_mfxViewClusters, clusters, sizeof(int) * numClusters);
+	cg_mfxNumViewClusters = numClusters;
+
+	longs = (cgi.CM_NumClusters()+31)>>5;
+	memcpy (cg_mfxFatPVS, cgi.CM_ClusterPVS(clusters[0]), longs<<2);
+
+	// Or in all the other cluster bits
+	for (i=1 ; i<numClusters ; i++) {
+		src = cgi.CM_ClusterPVS(clusters[i]);
 		for (j=0 ; j<longs ; j++)
-			((long *)sv_fatPVS)[j] |= ((long *)src)[j];
+			((uint32 *)cg_mfxFatPVS)[j] |= ((uint32 *)src)[j];
+	}
+
+	return true;
+}
+
+
+/*
+==================
+CG_MFXUpdateActive
+
+Activates the buckets of clusters that came into the fat PVS and drops the
+ones that left it.
+==================
+*/
+static void CG_MFXUpdateActive ()
+{
+	int		cluster;
+	bool	visible, bChanged;
+
+	bChanged = false;
+	for (uint32 i=0 ; i<cg_mfxUsedClusters.Count() ; i++) {
+		cluster = cg_mfxUsedClusters[i];
+		visible = (cg_mfxFatPVS[cluster >> 3] & BIT(cluster&7)) != 0;
+		if (visible == cg_mfxClusterActive[cluster])
+			continue;
+
+		cg_mfxClusterActive[cluster] = visible;
+		bChanged = true;
+	}
+
+	if (bChanged) {
+		cg_mfxActiveClusters.Clear();
+		for (uint32 i=0 ; i<cg_mfxUsedClusters.Count() ; i++) {
+			if (cg_mfxClusterActive[cg_mfxUsedClusters[i]])
+				cg_mfxActiveClusters.Add(cg_mfxUsedClusters[i]);
+		}
+	}
+
+	cg_mfxActiveHeadnodeEffects.Clear();
+	for (uint32 i=0 ; i<cg_mfxHeadnodeEffects.Count() ; i++) {
+		if (cgi.CM_HeadnodeVisible (cg_mfxHeadnodeEffects[i]->headNode, cg_mfxFatPVS))
+			cg_mfxActiveHeadnodeEffects.Add(cg_mfxHeadnodeEffects[i]);
 	}
 }
 
-int numCulled = 0;
 
+/*
+==================
+CG_AddMapEffect
+==================
+*/
+static void CG_AddMapEffect (mapEffect_t *mfx)
+{
+	vec3_t outOrigin;
+	outOrigin[0] = mfx->origin[0];
+	outOrigin[1] = mfx->origin[1];
+	outOrigin[2] = mfx->origin[2];
+
+	// sizeVel calcs
+	float size = mfx->scale * 10;
+
+	// Add to be rendered
+	float scale;
+	scale = (outOrigin[0] - cg.refDef.viewOrigin[0]) * cg.refDef.viewAxis[0][0] +
+		(outOrigin[1] - cg.refDef.viewOrigin[1]) * cg.refDef.viewAxis[0][1] +
+		(outOrigin[2] - cg.refDef.viewOrigin[2]) * cg.refDef.viewAxis[0][2];
+
+	scale = (scale < 20) ? 1 : 1 + scale * 0.004f;
+	scale = (scale - 1) + size;
+
+	// Rendering
+	colorb outColor (
+		mfx->color[0],
+		mfx->color[1],
+		mfx->color[2],
+		mfx->color[3] * 255);
+
+	// Top left
+	Vec2Set(mfx->outCoords[0], cgMedia.particleCoords[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA][0], cgMedia.particleCoords[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA][1]);
+	Vec3Set(mfx->outVertices[0],	outOrigin[0] + cg.refDef.viewAxis[2][0]*scale + cg.refDef.viewAxis[1][0]*scale,
+		outOrigin[1] + cg.refDef.viewAxis[2][1]*scale + cg.refDef.viewAxis[1][1]*scale,
+		outOrigin[2] + cg.refDef.viewAxis[2][2]*scale + cg.refDef.viewAxis[1][2]*scale);
+
+	// Bottom left
+	Vec2Set(mfx->outCoords[1], cgMedia.particleCoords[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA][0], cgMedia.particleCoords[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA][3]);
+	Vec3Set(mfx->outVertices[1],	outOrigin[0] - cg.refDef.viewAxis[2][0]*scale + cg.refDef.viewAxis[1][0]*scale,
+		outOrigin[1] - cg.refDef.viewAxis[2][1]*scale + cg.refDef.viewAxis[1][1]*scale,
+		outOrigin[2] - cg.refDef.viewAxis[2][2]*scale + cg.refDef.viewAxis[1][2]*scale);
+
+	// Bottom right
+	Vec2Set(mfx->outCoords[2], cgMedia.particleCoords[mfx->type][2], cgMedia.particleCoords[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA][3]);
+	Vec3Set(mfx->outVertices[2],	outOrigin[0] - cg.refDef.viewAxis[2][0]*scale - cg.refDef.viewAxis[1][0]*scale,
+		outOrigin[1] - cg.refDef.viewAxis[2][1]*scale - cg.refDef.viewAxis[1][1]*scale,
+		outOrigin[2] - cg.refDef.viewAxis[2][2]*scale - cg.refDef.viewAxis[1][2]*scale);
+
+	// Top right
+	Vec2Set(mfx->outCoords[3], cgMedia.particleCoords[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA][2], cgMedia.particleCoords[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA][1]);
+	Vec3Set(mfx->outVertices[3],	outOrigin[0] + cg.refDef.viewAxis[2][0]*scale - cg.refDef.viewAxis[1][0]*scale,
+		outOrigin[1] + cg.refDef.viewAxis[2][1]*scale - cg.refDef.viewAxis[1][1]*scale,
+		outOrigin[2] + cg.refDef.viewAxis[2][2]*scale - cg.refDef.viewAxis[1][2]*scale);
+
+	// Render it
+	mfx->outColor[0] = outColor;
+	mfx->outColor[1] = outColor;
+	mfx->outColor[2] = outColor;
+	mfx->outColor[3] = outColor;
+
+	mfx->outPoly.mat = cgMedia.particleTable[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA];
+	Vec3Copy(outOrigin, mfx->outPoly.origin);
+	mfx->outPoly.radius = scale;
+
+	cgi.R_AddPoly(&mfx->outPoly);
+}
+
+
+/*
+==================
+CG_AddMapEffectList
+
+Returns false once the per-frame budget is used up.
+==================
+*/
+static bool CG_AddMapEffectList (TList<mapEffect_t*> &effects, int &budget)
+{
+	for (uint32 i=0 ; i<effects.Count() ; i++) {
+		var *mfx = effects[i];
+
+		// Effects straddling clusters sit in more than one bucket
+		if (mfx->visFrame == cg.realTime)
+			continue;
+		mfx->visFrame = cg.realTime;
+
+		if (CheckMFXCulling(mfx))
+			continue;
+
+		if (budget-- <= 0)
+			return false;
+
+		CG_AddMapEffect (mfx);
+	}
+
+	return true;
+}
+
+
+/*
+==================
+CG_AddMapFXToList
+==================
+*/
 void CG_AddMapFXToList()
 {
-	if (!cg_mapEffects->intVal)
+	if (!cg_mapEffects->intVal || !cg_mfxInitialized)
 		return;
 
-	numCulled = 0;
-	SV_FatPVS(cg.refDef.viewOrigin);
+	if (CG_MFXFatPVS(cg.refDef.viewOrigin))
+		CG_MFXUpdateActive ();
 
-	for (uint32 g = 0; g < cg_mapEffectGroups.Count(); ++g)
-	{
-		// Area
-		{
-			var &pvs = cg_mapEffectGroups[g]->pvs;
-			if (pvs.numClusters == -1) {
-				// too many leafs for individual check, go by headnode
-				if (!cgi.CM_HeadnodeVisible (pvs.headNode, sv_fatPVS))
-					continue;
-			}
-			else {
-				// check individual leafs
-				int i;
-				for (i=0 ; i < pvs.numClusters ; i++) {
-					var l = pvs.clusterNums[i];
-					if (sv_fatPVS[l >> 3] & BIT(l&7))
-						break;
-				}
-				if (i == pvs.numClusters)
-				{
-					numCulled++;
-					continue;		// not visible
-				}
-			}
-		}
+	int budget = cg_mapEffectMax->intVal;
+	if (budget <= 0)
+		budget = cg_mapEffectList.Count();
 
-		for (uint32 i = 0; i < cg_mapEffectGroups[g]->effects.Count(); ++i)
-		{
-			var *mfx = cg_mapEffectGroups[g]->effects[i];
-
-			if (mfx->visFrame == cg.realTime)
-				continue;
-
-			mfx->visFrame = cg.realTime;
-
-			vec3_t outOrigin;
-			outOrigin[0] = mfx->origin[0];
-			outOrigin[1] = mfx->origin[1];
-			outOrigin[2] = mfx->origin[2];
-
-			// sizeVel calcs
-			float size = mfx->scale * 10;
-
-			if (CheckMFXCulling(mfx))
-				continue;
-
-			float outOrient = mfx->orient;
-
-			// Add to be rendered
-			float scale;
-			scale = (outOrigin[0] - cg.refDef.viewOrigin[0]) * cg.refDef.viewAxis[0][0] +
-				(outOrigin[1] - cg.refDef.viewOrigin[1]) * cg.refDef.viewAxis[0][1] +
-				(outOrigin[2] - cg.refDef.viewOrigin[2]) * cg.refDef.viewAxis[0][2];
-
-			scale = (scale < 20) ? 1 : 1 + scale * 0.004f;
-			scale = (scale - 1) + size;
-
-			// Rendering
-			colorb outColor (
-				mfx->color[0],
-				mfx->color[1],
-				mfx->color[2],
-				mfx->color[3] * 255);
-
-			// Top left
-			Vec2Set(mfx->outCoords[0], cgMedia.particleCoords[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA][0], cgMedia.particleCoords[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA][1]);
-			Vec3Set(mfx->outVertices[0],	outOrigin[0] + cg.refDef.viewAxis[2][0]*scale + cg.refDef.viewAxis[1][0]*scale,
-				outOrigin[1] + cg.refDef.viewAxis[2][1]*scale + cg.refDef.viewAxis[1][1]*scale,
-				outOrigin[2] + cg.refDef.viewAxis[2][2]*scale + cg.refDef.viewAxis[1][2]*scale);
-
-			// Bottom left
-			Vec2Set(mfx->outCoords[1], cgMedia.particleCoords[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA][0], cgMedia.particleCoords[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA][3]);
-			Vec3Set(mfx->outVertices[1],	outOrigin[0] - cg.refDef.viewAxis[2][0]*scale + cg.refDef.viewAxis[1][0]*scale,
-				outOrigin[1] - cg.refDef.viewAxis[2][1]*scale + cg.refDef.viewAxis[1][1]*scale,
-				outOrigin[2] - cg.refDef.viewAxis[2][2]*scale + cg.refDef.viewAxis[1][2]*scale);
-
-			// Bottom right
-			Vec2Set(mfx->outCoords[2], cgMedia.particleCoords[mfx->type][2], cgMedia.particleCoords[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA][3]);
-			Vec3Set(mfx->outVertices[2],	outOrigin[0] - cg.refDef.viewAxis[2][0]*scale - cg.refDef.viewAxis[1][0]*scale,
-				outOrigin[1] - cg.refDef.viewAxis[2][1]*scale - cg.refDef.viewAxis[1][1]*scale,
-				outOrigin[2] - cg.refDef.viewAxis[2][2]*scale - cg.refDef.viewAxis[1][2]*scale);
-
-			// Top right
-			Vec2Set(mfx->outCoords[3], cgMedia.particleCoords[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA][2], cgMedia.particleCoords[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA][1]);
-			Vec3Set(mfx->outVertices[3],	outOrigin[0] + cg.refDef.viewAxis[2][0]*scale - cg.refDef.viewAxis[1][0]*scale,
-				outOrigin[1] + cg.refDef.viewAxis[2][1]*scale - cg.refDef.viewAxis[1][1]*scale,
-				outOrigin[2] + cg.refDef.viewAxis[2][2]*scale - cg.refDef.viewAxis[1][2]*scale);
-
-			// Render it
-			mfx->outColor[0] = outColor;
-			mfx->outColor[1] = outColor;
-			mfx->outColor[2] = outColor;
-			mfx->outColor[3] = outColor;
-
-			mfx->outPoly.mat = cgMedia.particleTable[(mfx->type == 0) ? MFX_WHITE : MFX_CORONA];
-			Vec3Copy(outOrigin, mfx->outPoly.origin);
-			mfx->outPoly.radius = scale;
-
-			cgi.R_AddPoly(&mfx->outPoly);
-		}
+	for (uint32 c=0 ; c<cg_mfxActiveClusters.Count() ; c++) {
+		if (!CG_AddMapEffectList (cg_mfxClusterEffects[cg_mfxActiveClusters[c]], budget))
+			return;
 	}
+
+	CG_AddMapEffectList (cg_mfxActiveHeadnodeEffects, budget);
 }
 
 /*
@@ -413,8 +504,24 @@ CG_MapFXClear
 */
 void CG_MapFXClear ()
 {
+	for (uint32 i=0 ; i<cg_mapEffectList.Count() ; i++)
+		delete cg_mapEffectList[i];
 	cg_mapEffectList.Clear();
-	cg_mapEffectGroups.Clear();
+
+	if (cg_mfxClusterEffects) {
+		delete[] cg_mfxClusterEffects;
+		delete[] cg_mfxClusterActive;
+		cg_mfxClusterEffects = NULL;
+		cg_mfxClusterActive = NULL;
+	}
+	cg_mfxNumClusters = 0;
+
+	cg_mfxUsedClusters.Clear();
+	cg_mfxActiveClusters.Clear();
+	cg_mfxHeadnodeEffects.Clear();
+	cg_mfxActiveHeadnodeEffects.Clear();
+
+	cg_mfxNumViewClusters = -1;
 	cg_mfxInitialized = false;
 }
 
@@ -452,6 +559,11 @@ void CG_MapFXLoad (char *mapName)
 
 	Com_DevPrintf (0, "...loading '%s'\n", cg_mfxFileName);
 
+	cg_mfxNumClusters = cgi.CM_NumClusters ();
+	cg_mfxClusterEffects = new TList<mapEffect_t*>[cg_mfxNumClusters];
+	cg_mfxClusterActive = new bool[cg_mfxNumClusters];
+	memset (cg_mfxClusterActive, 0, sizeof(bool) * cg_mfxNumClusters);
+
 	stageNum = 0;
 	numFx = 0;
 	mfx = NULL;
@@ -505,33 +617,22 @@ void CG_MapFXLoad (char *mapName)
 			pvs_t mfxPvs;
 			mfxPvs.BuildPVS(mfx->origin);
 
-			for (int c = 0; c < mfxPvs.numClusters; ++c)
-			{
-				if (mfxPvs.clusterNums[c] == -1)
-					continue; // non-visible
-
-				int numGrabbed = 0;
-
-				// see if a group exists with this area
-				for (uint32 i = 0; i < cg_mapEffectGroups.Count(); ++i)
+			if (mfxPvs.numClusters == -1) {
+				// Too many leafs to bucket, check by headnode
+				mfx->headNode = mfxPvs.headNode;
+				cg_mfxHeadnodeEffects.Add(mfx);
+			}
+			else {
+				mfx->headNode = -1;
+				for (int c = 0; c < mfxPvs.numClusters; ++c)
 				{
-					for (int z = 0; z < cg_mapEffectGroups[i]->pvs.numClusters; ++z)
-					{
-						if (mfxPvs.clusterNums[c] == cg_mapEffectGroups[i]->pvs.clusterNums[z])
-						{
-							cg_mapEffectGroups[i]->effects.Add(mfx);
-							numGrabbed++;
-						}
-					}
-				}
+					var cluster = mfxPvs.clusterNums[c];
+					if (cluster < 0 || cluster >= cg_mfxNumClusters)
+						continue; // non-visible
 
-				if (!numGrabbed)
-				{
-					// none found
-					var newGroup = new mapEffectGroup_t();
-					cg_mapEffectGroups.Add(newGroup);
-					newGroup->pvs = mfxPvs;
-					newGroup->effects.Add(mfx);
+					if (!cg_mfxClusterEffects[cluster].Count())
+						cg_mfxUsedClusters.Add(cluster);
+					cg_mfxClusterEffects[cluster].Add(mfx);
 				}
 			}
 		}
@@ -25,6 +25,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 static TLinkedList<cgParticle_t*>	cg_particles;
 
+// Particles pushed out of the list while CG_AddParticles still referenced
+// them, freed once the renderer is done with the frame they were added to
+static bool							cg_partDeferFree;
+static TList<cgParticle_t*>			cg_partGraveyard;
+
 /*
 =============================================================================
 
@@ -43,7 +48,16 @@ static cgParticle_t *CG_AllocParticle()
 	cgParticle_t *p;
 
 	if (cg_particles.Count() >= (uint32)cg_particleMax->intVal)
-		delete cg_particles.PopBack();
+	{
+		p = cg_particles.PopBack();
+		if (cg_partDeferFree)
+		{
+			p->node = null;
+			cg_partGraveyard.Add(p);
+		}
+		else
+			delete p;
+	}
 
 	p = new cgParticle_t();
 	p->node = cg_particles.AddToFront(p);
@@ -144,6 +158,19 @@ void CG_SpawnParticle  (float org0,						float org1,					float org2,
 }
 
 
+/*
+===============
+CG_FreeGraveyard
+===============
+*/
+static void CG_FreeGraveyard()
+{
+	for (uint32 i=0 ; i<cg_partGraveyard.Count() ; i++)
+		delete cg_partGraveyard[i];
+	cg_partGraveyard.Clear();
+}
+
+
 /*
 ===============
 CG_ClearParticles
@@ -151,6 +178,8 @@ CG_ClearParticles
 */
 void CG_ClearParticles()
 {
+	CG_FreeGraveyard();
+
 	for (var node = cg_particles.Head(); node != null; node = node->Next)
 		delete node->Value;
 
@@ -160,449 +189,368 @@ void CG_ClearParticles()
 
 /*
 ===============
-CG_AddParticles
+CG_SimulateParticle
+
+Moves, fades and thinks a particle, and builds its poly if it is visible.
+View facing quads only fill in outParticle and return PART_QUAD instead.
+Only particles with no think functions pending may be run off the main thread.
 ===============
 */
-void CG_AddParticles()
+enum EPartResult
 {
-	CG_AddMapFXToList();
-	CG_AddSustains();
+	PART_DEAD,
+	PART_HIDDEN,
+	PART_VISIBLE,
+	PART_QUAD
+};
 
-	if (!cl_add_particles->intVal)
-		return;
-
-	int partNum = 0;
-	TLinkedList<cgParticle_t*>::Node *next = null;
+static EPartResult CG_SimulateParticle (cgParticle_t *p)
+{
+	EPartResult result = PART_HIDDEN;
 
-	for (var cur = cg_particles.Head(); cur != null; cur = next)
+	float time;
+	vec4_t color;
+	if (p->colorVel[3] > PART_INSTANT)
 	{
-		next = cur->Next;
-		var p = cur->Value;
-
-		// Check if we hit our limit
-		if (++partNum > cg_particleMax->intVal)
-			break;
-
-		float time;
-		vec4_t color;
-		if (p->colorVel[3] > PART_INSTANT)
-		{
-			time = (cg.refreshTime - p->time)*0.001f;
-			color[3] = p->color[3] + time*p->colorVel[3];
-		}
-		else
-		{
-			time = 1;
-			color[3] = p->color[3];
-		}
+		time = (cg.refreshTime - p->time)*0.001f;
+		color[3] = p->color[3] + time*p->colorVel[3];
+	}
+	else
+	{
+		time = 1;
+		color[3] = p->color[3];
+	}
 
-		// Faded out
-		if (color[3] <= TINY_NUMBER)
-		{
-			CG_FreeParticle(p);
-			continue;
-		}
+	// Faded out
+	if (color[3] <= TINY_NUMBER)
+		return PART_DEAD;
 
-		if (color[3] > 1.0)
-			color[3] = 1.0f;
+	if (color[3] > 1.0)
+		color[3] = 1.0f;
 
-		// Origin
-		float timeSquared = time*time;
+	// Origin
+	float timeSquared = time*time;
 
-		vec3_t outOrigin;
-		outOrigin[0] = p->org[0] + p->vel[0]*time + p->accel[0]*timeSquared;
-		outOrigin[1] = p->org[1] + p->vel[1]*time + p->accel[1]*timeSquared;
-		outOrigin[2] = p->org[2] + p->vel[2]*time + p->accel[2]*timeSquared;
+	vec3_t outOrigin;
+	outOrigin[0] = p->org[0] + p->vel[0]*time + p->accel[0]*timeSquared;
+	outOrigin[1] = p->org[1] + p->vel[1]*time + p->accel[1]*timeSquared;
+	outOrigin[2] = p->org[2] + p->vel[2]*time + p->accel[2]*timeSquared;
 
-		if (p->flags & PF_GRAVITY)
-			outOrigin[2] -= (timeSquared * PART_GRAVITY);
+	if (p->flags & PF_GRAVITY)
+		outOrigin[2] -= (timeSquared * PART_GRAVITY);
 
-		// sizeVel calcs
-		float size;
-		if (p->colorVel[3] > PART_INSTANT && p->size != p->sizeVel)
-		{
-			if (p->size > p->sizeVel) // shrink
-				size = p->size - ((p->size - p->sizeVel) * (p->color[3] - color[3]));
-			else // grow
-				size = p->size + ((p->sizeVel - p->size) * (p->color[3] - color[3]));
-		}
-		else
-		{
-			size = p->size;
-		}
+	// sizeVel calcs
+	float size;
+	if (p->colorVel[3] > PART_INSTANT && p->size != p->sizeVel)
+	{
+		if (p->size > p->sizeVel) // shrink
+			size = p->size - ((p->size - p->sizeVel) * (p->color[3] - color[3]));
+		else // grow
+			size = p->size + ((p->sizeVel - p->size) * (p->color[3] - color[3]));
+	}
+	else
+	{
+		size = p->size;
+	}
 
-		// Skip it if it's too small
-		while (size > TINY_NUMBER)
+	// Skip it if it's too small
+	while (size > TINY_NUMBER)
+	{
+		// colorVel calcs
+		Vec3Copy(p->color, color);
+		if (p->colorVel[3] > PART_INSTANT)
 		{
-			// colorVel calcs
-			Vec3Copy(p->color, color);
-			if (p->colorVel[3] > PART_INSTANT)
+			for (int i=0 ; i<3 ; i++)
 			{
-				for (int i=0 ; i<3 ; i++)
+				if (p->color[i] != p->colorVel[i])
 				{
-					if (p->color[i] != p->colorVel[i])
-					{
-						if (p->color[i] > p->colorVel[i])
-							color[i] = p->color[i] - ((p->color[i] - p->colorVel[i]) * (p->color[3] - color[3]));
-						else
-							color[i] = p->color[i] + ((p->colorVel[i] - p->color[i]) * (p->color[3] - color[3]));
-					}
-
-					color[i] = clamp(color[i], 0, 255);
+					if (p->color[i] > p->colorVel[i])
+						color[i] = p->color[i] - ((p->color[i] - p->colorVel[i]) * (p->color[3] - color[3]));
+					else
+						color[i] = p->color[i] + ((p->colorVel[i] - p->color[i]) * (p->color[3] - color[3]));
 				}
+
+				color[i] = clamp(color[i], 0, 255);
 			}
+		}
 
-			// Think functions
-			bool bHadAThought = false;
-			float outOrient = p->orient;
+		// Think functions
+		bool bHadAThought = false;
+		float outOrient = p->orient;
 
-			if (p->bPreThinkNext && cg.refreshTime >= p->nextPreThinkTime)
-			{
-				p->bPreThinkNext = p->preThink(p, cg.refreshTime-p->lastPreThinkTime, p->nextPreThinkTime, outOrigin, p->lastPreThinkOrigin, p->angle, color, &size, &outOrient, &time);
-				p->lastPreThinkTime = cg.refreshTime;
-				Vec3Copy(outOrigin, p->lastPreThinkOrigin);
+		if (p->bPreThinkNext && cg.refreshTime >= p->nextPreThinkTime)
+		{
+			p->bPreThinkNext = p->preThink(p, cg.refreshTime-p->lastPreThinkTime, p->nextPreThinkTime, outOrigin, p->lastPreThinkOrigin, p->angle, color, &size, &outOrient, &time);
+			p->lastPreThinkTime = cg.refreshTime;
+			Vec3Copy(outOrigin, p->lastPreThinkOrigin);
 
-				bHadAThought = true;
-			}
+			bHadAThought = true;
+		}
 
-			if (p->bThinkNext && cg.refreshTime >= p->nextThinkTime)
-			{
-				p->bThinkNext = p->think(p, cg.refreshTime-p->lastThinkTime, p->nextThinkTime, outOrigin, p->lastThinkOrigin, p->angle, color, &size, &outOrient, &time);
-				p->lastThinkTime = cg.refreshTime;
-				Vec3Copy(outOrigin, p->lastThinkOrigin);
+		if (p->bThinkNext && cg.refreshTime >= p->nextThinkTime)
+		{
+			p->bThinkNext = p->think(p, cg.refreshTime-p->lastThinkTime, p->nextThinkTime, outOrigin, p->lastThinkOrigin, p->angle, color, &size, &outOrient, &time);
+			p->lastThinkTime = cg.refreshTime;
+			Vec3Copy(outOrigin, p->lastThinkOrigin);
 
-				bHadAThought = true;
-			}
+			bHadAThought = true;
+		}
 
-			if (p->bPostThinkNext && cg.refreshTime >= p->nextPostThinkTime)
-			{
-				p->bPostThinkNext = p->postThink(p, cg.refreshTime-p->lastPostThinkTime, p->nextPostThinkTime, outOrigin, p->lastPostThinkOrigin, p->angle, color, &size, &outOrient, &time);
-				p->lastPostThinkTime = cg.refreshTime;
-				Vec3Copy(outOrigin, p->lastPostThinkOrigin);
+		if (p->bPostThinkNext && cg.refreshTime >= p->nextPostThinkTime)
+		{
+			p->bPostThinkNext = p->postThink(p, cg.refreshTime-p->lastPostThinkTime, p->nextPostThinkTime, outOrigin, p->lastPostThinkOrigin, p->angle, color, &size, &outOrient, &time);
+			p->lastPostThinkTime = cg.refreshTime;
+			Vec3Copy(outOrigin, p->lastPostThinkOrigin);
 
-				bHadAThought = true;
-			}
+			bHadAThought = true;
+		}
 
-			// Check alpha and size after the think function runs
-			if (bHadAThought)
-			{
-				if (color[3] <= TINY_NUMBER)
-					break;
-				if (size <= TINY_NUMBER)
-					break;
-			}
+		// Check alpha and size after the think function runs
+		if (bHadAThought)
+		{
+			if (color[3] <= TINY_NUMBER)
+				break;
+			if (size <= TINY_NUMBER)
+				break;
+		}
 
-			bool culled = false;
+		bool culled = false;
 
-			// Culling
-			switch (p->style)
-			{
-			case PART_STYLE_ANGLED:
-			case PART_STYLE_BEAM:
-			case PART_STYLE_DIRECTION:
-				break;
+		// Culling
+		switch (p->style)
+		{
+		case PART_STYLE_ANGLED:
+		case PART_STYLE_BEAM:
+		case PART_STYLE_DIRECTION:
+			break;
 
-			default:
-				if (cg_particleCulling->intVal)
+		default:
+			if (cg_particleCulling->intVal)
+			{
+				// Kill particles behind the view
+				vec3_t temp;
+				Vec3Subtract(outOrigin, cg.refDef.viewOrigin, temp);
+				VectorNormalizeFastf(temp);
+				if (DotProduct(temp, cg.refDef.viewAxis[0]) < 0)
+					culled = true;
+
+				// Lessen fillrate consumption
+				if (!(p->flags & PF_NOCLOSECULL))
 				{
-					// Kill particles behind the view
-					vec3_t temp;
-					Vec3Subtract(outOrigin, cg.refDef.viewOrigin, temp);
-					VectorNormalizeFastf(temp);
-					if (DotProduct(temp, cg.refDef.viewAxis[0]) < 0)
+					float dist = Vec3DistSquared(cg.refDef.viewOrigin, outOrigin);
+					if (dist <= 5*5)
 						culled = true;
-
-					// Lessen fillrate consumption
-					if (!(p->flags & PF_NOCLOSECULL))
-					{
-						float dist = Vec3DistSquared(cg.refDef.viewOrigin, outOrigin);
-						if (dist <= 5*5)
-							culled = true;
-					}
 				}
-				break;
 			}
+			break;
+		}
 
-			if (culled)
-				break;
+		if (culled)
+			break;
 
-			// Alpha*color
-			if (p->flags & PF_ALPHACOLOR)
-				Vec3Scale(color, color[3], color);
+		// Alpha*color
+		if (p->flags & PF_ALPHACOLOR)
+			Vec3Scale(color, color[3], color);
 
-			// Add to be rendered
-			float scale;
-			if (p->flags & PF_SCALED)
-			{
-				scale = (outOrigin[0] - cg.refDef.viewOrigin[0]) * cg.refDef.viewAxis[0][0] +
-						(outOrigin[1] - cg.refDef.viewOrigin[1]) * cg.refDef.viewAxis[0][1] +
-						(outOrigin[2] - cg.refDef.viewOrigin[2]) * cg.refDef.viewAxis[0][2];
+		// Add to be rendered
+		float scale;
+		if (p->flags & PF_SCALED)
+		{
+			scale = (outOrigin[0] - cg.refDef.viewOrigin[0]) * cg.refDef.viewAxis[0][0] +
+					(outOrigin[1] - cg.refDef.viewOrigin[1]) * cg.refDef.viewAxis[0][1] +
+					(outOrigin[2] - cg.refDef.viewOrigin[2]) * cg.refDef.viewAxis[0][2];
 
-				scale = (scale < 20) ? 1 : 1 + scale * 0.004f;
-				scale = (scale - 1) + size;
-			}
-			else
-			{
-				scale = size;
-			}
+			scale = (scale < 20) ? 1 : 1 + scale * 0.004f;
+			scale = (scale - 1) + size;
+		}
+		else
+		{
+			scale = size;
+		}
 
-			// Rendering
-			colorb outColor (
-				color[0],
-				color[1],
-				color[2],
-				color[3] * 255);
+		// Rendering
+		colorb outColor (
+			color[0],
+			color[1],
+			color[2],
+			color[3] * 255);
 
-			switch(p->style)
+		switch(p->style)
+		{
+		case PART_STYLE_ANGLED:
 			{
-			case PART_STYLE_ANGLED:
-				{
-					vec3_t a_upVec, a_rtVec;
-
-					Angles_Vectors(p->angle, NULL, a_rtVec, a_upVec); 
-
-					if (outOrient)
-					{
-						float c, s;
-
-						Q_SinCosf(DEG2RAD(outOrient), &c, &s);
-						c *= scale;
-						s *= scale;
-
-						// Top left
-						Vec2Set(p->outCoords[0], cgMedia.particleCoords[p->type][0], cgMedia.particleCoords[p->type][1]);
-						Vec3Set(p->outVertices[0],	outOrigin[0] + a_upVec[0]*s - a_rtVec[0]*c,
-													outOrigin[1] + a_upVec[1]*s - a_rtVec[1]*c,
-													outOrigin[2] + a_upVec[2]*s - a_rtVec[2]*c);
-
-						// Bottom left
-						Vec2Set(p->outCoords[1], cgMedia.particleCoords[p->type][0], cgMedia.particleCoords[p->type][3]);
-						Vec3Set(p->outVertices[1],	outOrigin[0] - a_upVec[0]*c - a_rtVec[0]*s,
-													outOrigin[1] - a_upVec[1]*c - a_rtVec[1]*s,
-													outOrigin[2] - a_upVec[2]*c - a_rtVec[2]*s);
-
-						// Bottom right
-						Vec2Set(p->outCoords[2], cgMedia.particleCoords[p->type][2], cgMedia.particleCoords[p->type][3]);
-						Vec3Set(p->outVertices[2],	outOrigin[0] - a_upVec[0]*s + a_rtVec[0]*c,
-													outOrigin[1] - a_upVec[1]*s + a_rtVec[1]*c,
-													outOrigin[2] - a_upVec[2]*s + a_rtVec[2]*c);
-
-						// Top right
-						Vec2Set(p->outCoords[3], cgMedia.particleCoords[p->type][2], cgMedia.particleCoords[p->type][1]);
-						Vec3Set(p->outVertices[3],	outOrigin[0] + a_upVec[0]*c + a_rtVec[0]*s,
-													outOrigin[1] + a_upVec[1]*c + a_rtVec[1]*s,
-													outOrigin[2] + a_upVec[2]*c + a_rtVec[2]*s);
-					}
-					else
-					{
-						// Top left
-						Vec2Set(p->outCoords[0], cgMedia.particleCoords[p->type][0], cgMedia.particleCoords[p->type][1]);
-						Vec3Set(p->outVertices[0],	outOrigin[0] + a_upVec[0]*scale - a_rtVec[0]*scale,
-													outOrigin[1] + a_upVec[1]*scale - a_rtVec[1]*scale,
-													outOrigin[2] + a_upVec[2]*scale - a_rtVec[2]*scale);
-
-						// Bottom left
-						Vec2Set(p->outCoords[1], cgMedia.particleCoords[p->type][0], cgMedia.particleCoords[p->type][3]);
-						Vec3Set(p->outVertices[1],	outOrigin[0] - a_upVec[0]*scale - a_rtVec[0]*scale,
-													outOrigin[1] - a_upVec[1]*scale - a_rtVec[1]*scale,
-													outOrigin[2] - a_upVec[2]*scale - a_rtVec[2]*scale);
-
-						// Bottom right
-						Vec2Set(p->outCoords[2], cgMedia.particleCoords[p->type][2], cgMedia.particleCoords[p->type][3]);
-						Vec3Set(p->outVertices[2],	outOrigin[0] - a_upVec[0]*scale + a_rtVec[0]*scale,
-													outOrigin[1] - a_upVec[1]*scale + a_rtVec[1]*scale,
-													outOrigin[2] - a_upVec[2]*scale + a_rtVec[2]*scale);
-
-						// Top right
-						Vec2Set(p->outCoords[3], cgMedia.particleCoords[p->type][2], cgMedia.particleCoords[p->type][1]);
-						Vec3Set(p->outVertices[3],	outOrigin[0] + a_upVec[0]*scale + a_rtVec[0]*scale,
-													outOrigin[1] + a_upVec[1]*scale + a_rtVec[1]*scale,
-													outOrigin[2] + a_upVec[2]*scale + a_rtVec[2]*scale);
-					}
-
-					// Render it
-					p->outColor[0] = outColor;
-					p->outColor[1] = outColor;
-					p->outColor[2] = outColor;
-					p->outColor[3] = outColor;
-
-					p->outPoly.mat = p->mat;
-					Vec3Copy(outOrigin, p->outPoly.origin);
-					p->outPoly.radius = scale;
-
-					cgi.R_AddPoly(&p->outPoly);
-				}
-				break;
+				vec3_t a_upVec, a_rtVec;
 
-			case PART_STYLE_BEAM:
-				{
-					vec3_t point, width;
-
-					Vec3Subtract(outOrigin, cg.refDef.viewOrigin, point);
-					CrossProduct(point, p->angle, width);
-					VectorNormalizeFastf(width);
-					Vec3Scale(width, scale, width);
-
-					vec3_t delta;
-					Vec3Add(outOrigin, p->angle, delta);
-					float dist = Vec3DistFast(outOrigin, delta) / 64.0f; // FIXME: tile based off of material's height (see: sizeBase)
-
-					Vec2Set(p->outCoords[0], 0, 0);
-					Vec3Set(p->outVertices[0],	outOrigin[0] - width[0],
-												outOrigin[1] - width[1],
-												outOrigin[2] - width[2]);
-
-					Vec2Set(p->outCoords[1], 1, 0);
-					Vec3Set(p->outVertices[1],	outOrigin[0] + width[0],
-												outOrigin[1] + width[1],
-												outOrigin[2] + width[2]);
-
-					Vec3Add(point, p->angle, point);
-					CrossProduct(point, p->angle, width);
-					VectorNormalizeFastf(width);
-					Vec3Scale(width, scale, width);
-
-					Vec2Set(p->outCoords[2], 1, dist);
-					Vec3Set(p->outVertices[2],	delta[0] + width[0],
-												delta[1] + width[1],
-												delta[2] + width[2]);
-
-					Vec2Set(p->outCoords[3], 0, dist);
-					Vec3Set(p->outVertices[3],	delta[0] - width[0],
-												delta[1] - width[1],
-												delta[2] - width[2]);
-
-					// Render it
-					p->outColor[0] = outColor;
-					p->outColor[1] = outColor;
-					p->outColor[2] = outColor;
-					p->outColor[3] = outColor;
-
-					p->outPoly.mat = p->mat;
-					Vec3Copy(outOrigin, p->outPoly.origin);
-					p->outPoly.radius = Vec3DistFast(outOrigin, delta);
-
-					cgi.R_AddPoly(&p->outPoly);
-				}
-				break;
+				Angles_Vectors(p->angle, NULL, a_rtVec, a_upVec); 
 
-			case PART_STYLE_DIRECTION:
+				if (outOrient)
 				{
-					vec3_t delta, vdelta;
-
-					Vec3Add(p->angle, outOrigin, vdelta);
+					float c, s;
 
-					vec3_t move;
-					Vec3Subtract(outOrigin, vdelta, move);
-					VectorNormalizeFastf(move);
+					Q_SinCosf(DEG2RAD(outOrient), &c, &s);
+					c *= scale;
+					s *= scale;
 
-					vec3_t a_upVec, a_rtVec;
-					Vec3Copy(move, a_upVec);
-					Vec3Subtract(cg.refDef.viewOrigin, vdelta, delta);
-					CrossProduct(a_upVec, delta, a_rtVec);
+					// Top left
+					Vec2Set(p->outCoords[0], cgMedia.particleCoords[p->type][0], cgMedia.particleCoords[p->type][1]);
+					Vec3Set(p->outVertices[0],	outOrigin[0] + a_upVec[0]*s - a_rtVec[0]*c,
+												outOrigin[1] + a_upVec[1]*s - a_rtVec[1]*c,
+												outOrigin[2] + a_upVec[2]*s - a_rtVec[2]*c);
 
-					VectorNormalizeFastf(a_rtVec);
+					// Bottom left
+					Vec2Set(p->outCoords[1], cgMedia.particleCoords[p->type][0], cgMedia.particleCoords[p->type][3]);
+					Vec3Set(p->outVertices[1],	outOrigin[0] - a_upVec[0]*c - a_rtVec[0]*s,
+												outOrigin[1] - a_upVec[1]*c - a_rtVec[1]*s,
+												outOrigin[2] - a_upVec[2]*c - a_rtVec[2]*s);
 
-					Vec3Scale(a_rtVec, 0.75f, a_rtVec);
-					Vec3Scale(a_upVec, 0.75f * Vec3LengthFast(p->angle), a_upVec);
+					// Bottom right
+					Vec2Set(p->outCoords[2], cgMedia.particleCoords[p->type][2], cgMedia.particleCoords[p->type][3]);
+					Vec3Set(p->outVertices[2],	outOrigin[0] - a_upVec[0]*s + a_rtVec[0]*c,
+												outOrigin[1] - a_upVec[1]*s + a_rtVec[1]*c,
+												outOrigin[2] - a_upVec[2]*s + a_rtVec[2]*c);
 
+					// Top right
+					Vec2Set(p->outCoords[3], cgMedia.particleCoords[p->type][2], cgMedia.particleCoords[p->type][1]);
+					Vec3Set(p->outVertices[3],	outOrigin[0] + a_upVec[0]*c + a_rtVec[0]*s,
+												outOrigin[1] + a_upVec[1]*c + a_rtVec[1]*s,
+												outOrigin[2] + a_upVec[2]*c + a_rtVec[2]*s);
+				}
+				else
+				{
 					// Top left
 					Vec2Set(p->outCoords[0], cgMedia.particleCoords[p->type][0], cgMedia.particleCoords[p->type][1]);
-					Vec3Set(p->outVertices[0], outOrigin[0] + a_upVec[0]*scale - a_rtVec[0]*scale,
+					Vec3Set(p->outVertices[0],	outOrigin[0] + a_upVec[0]*scale - a_rtVec[0]*scale,
 												outOrigin[1] + a_upVec[1]*scale - a_rtVec[1]*scale,
 												outOrigin[2] + a_upVec[2]*scale - a_rtVec[2]*scale);
 
 					// Bottom left
 					Vec2Set(p->outCoords[1], cgMedia.particleCoords[p->type][0], cgMedia.particleCoords[p->type][3]);
-					Vec3Set(p->outVertices[1], outOrigin[0] - a_upVec[0]*scale - a_rtVec[0]*scale,
+					Vec3Set(p->outVertices[1],	outOrigin[0] - a_upVec[0]*scale - a_rtVec[0]*scale,
 												outOrigin[1] - a_upVec[1]*scale - a_rtVec[1]*scale,
 												outOrigin[2] - a_upVec[2]*scale - a_rtVec[2]*scale);
 
 					// Bottom right
 					Vec2Set(p->outCoords[2], cgMedia.particleCoords[p->type][2], cgMedia.particleCoords[p->type][3]);
-					Vec3Set(p->outVertices[2], outOrigin[0] - a_upVec[0]*scale + a_rtVec[0]*scale,
+					Vec3Set(p->outVertices[2],	outOrigin[0] - a_upVec[0]*scale + a_rtVec[0]*scale,
 												outOrigin[1] - a_upVec[1]*scale + a_rtVec[1]*scale,
 												outOrigin[2] - a_upVec[2]*scale + a_rtVec[2]*scale);
 
 					// Top right
 					Vec2Set(p->outCoords[3], cgMedia.particleCoords[p->type][2], cgMedia.particleCoords[p->type][1]);
-					Vec3Set(p->outVertices[3], outOrigin[0] + a_upVec[0]*scale + a_rtVec[0]*scale,
+					Vec3Set(p->outVertices[3],	outOrigin[0] + a_upVec[0]*scale + a_rtVec[0]*scale,
 												outOrigin[1] + a_upVec[1]*scale + a_rtVec[1]*scale,
 												outOrigin[2] + a_upVec[2]*scale + a_rtVec[2]*scale);
+				}
 
-					// Render it
-					p->outColor[0] = outColor;
-					p->outColor[1] = outColor;
-					p->outColor[2] = outColor;
-					p->outColor[3] = outColor;
+				// Render it
+				p->outColor[0] = outColor;
+				p->outColor[1] = outColor;
+				p->outColor[2] = outColor;
+				p->outColor[3] = outColor;
 
-					p->outPoly.mat = p->mat;
-					Vec3Copy(outOrigin, p->outPoly.origin);
-					p->outPoly.radius = scale;
+				p->outPoly.mat = p->mat;
+				Vec3Copy(outOrigin, p->outPoly.origin);
+				p->outPoly.radius = scale;
 
-					cgi.R_AddPoly(&p->outPoly);
-				}
-				break;
+				result = PART_VISIBLE;
+			}
+			break;
 
-			case PART_STYLE_QUAD:
-				if (outOrient)
-				{
-					float c, s;
+		case PART_STYLE_BEAM:
+			{
+				vec3_t point, width;
+
+				Vec3Subtract(outOrigin, cg.refDef.viewOrigin, point);
+				CrossProduct(point, p->angle, width);
+				VectorNormalizeFastf(width);
+				Vec3Scale(width, scale, width);
+
+				vec3_t delta;
+				Vec3Add(outOrigin, p->angle, delta);
+				float dist = Vec3DistFast(outOrigin, delta) / 64.0f; // FIXME: tile based off of material's height (see: sizeBase)
+
+				Vec2Set(p->outCoords[0], 0, 0);
+				Vec3Set(p->outVertices[0],	outOrigin[0] - width[0],
+											outOrigin[1] - width[1],
+											outOrigin[2] - width[2]);
+
+				Vec2Set(p->outCoords[1], 1, 0);
+				Vec3Set(p->outVertices[1],	outOrigin[0] + width[0],
+											outOrigin[1] + width[1],
+											outOrigin[2] + width[2]);
+
+				Vec3Add(point, p->angle, point);
+				CrossProduct(point, p->angle, width);
+				VectorNormalizeFastf(width);
+				Vec3Scale(width, scale, width);
+
+				Vec2Set(p->outCoords[2], 1, dist);
+				Vec3Set(p->outVertices[2],	delta[0] + width[0],
+											delta[1] + width[1],
+											delta[2] + width[2]);
+
+				Vec2Set(p->outCoords[3], 0, dist);
+				Vec3Set(p->outVertices[3],	delta[0] - width[0],
+											delta[1] - width[1],
+											delta[2] - width[2]);
 
-					Q_SinCosf(DEG2RAD(outOrient), &c, &s);
-					c *= scale;
-					s *= scale;
+				// Render it
+				p->outColor[0] = outColor;
+				p->outColor[1] = outColor;
+				p->outColor[2] = outColor;
+				p->outColor[3] = outColor;
 
-					// Top left
-					Vec2Set(p->outCoords[0], cgMedia.particleCoords[p->type][0], cgMedia.particleCoords[p->type][1]);
-					Vec3Set(p->outVertices[0],	outOrigin[0] + cg.refDef.viewAxis[1][0]*c + cg.refDef.viewAxis[2][0]*s,
-												outOrigin[1] + cg.refDef.viewAxis[1][1]*c + cg.refDef.viewAxis[2][1]*s,
-												outOrigin[2] + cg.refDef.viewAxis[1][2]*c + cg.refDef.viewAxis[2][2]*s);
+				p->outPoly.mat = p->mat;
+				Vec3Copy(outOrigin, p->outPoly.origin);
+				p->outPoly.radius = Vec3DistFast(outOrigin, delta);
 
-					// Bottom left
-					Vec2Set(p->outCoords[1], cgMedia.particleCoords[p->type][0], cgMedia.particleCoords[p->type][3]);
-					Vec3Set(p->outVertices[1],	outOrigin[0] - cg.refDef.viewAxis[1][0]*s + cg.refDef.viewAxis[2][0]*c,
-												outOrigin[1] - cg.refDef.viewAxis[1][1]*s + cg.refDef.viewAxis[2][1]*c,
-												outOrigin[2] - cg.refDef.viewAxis[1][2]*s + cg.refDef.viewAxis[2][2]*c);
+				result = PART_VISIBLE;
+			}
+			break;
 
-					// Bottom right
-					Vec2Set(p->outCoords[2], cgMedia.particleCoords[p->type][2], cgMedia.particleCoords[p->type][3]);
-					Vec3Set(p->outVertices[2],	outOrigin[0] - cg.refDef.viewAxis[1][0]*c - cg.refDef.viewAxis[2][0]*s,
-												outOrigin[1] - cg.refDef.viewAxis[1][1]*c - cg.refDef.viewAxis[2][1]*s,
-												outOrigin[2] - cg.refDef.viewAxis[1][2]*c - cg.refDef.viewAxis[2][2]*s);
+		case PART_STYLE_DIRECTION:
+			{
+				vec3_t delta, vdelta;
 
-					// Top right
-					Vec2Set(p->outCoords[3], cgMedia.particleCoords[p->type][2], cgMedia.particleCoords[p->type][1]);
-					Vec3Set(p->outVertices[3],	outOrigin[0] + cg.refDef.viewAxis[1][0]*s - cg.refDef.viewAxis[2][0]*c,
-												outOrigin[1] + cg.refDef.viewAxis[1][1]*s - cg.refDef.viewAxis[2][1]*c,
-												outOrigin[2] + cg.refDef.viewAxis[1][2]*s - cg.refDef.viewAxis[2][2]*c);
-				}
-				else
-				{
-					// Top left
-					Vec2Set(p->outCoords[0], cgMedia.particleCoords[p->type][0], cgMedia.particleCoords[p->type][1]);
-					Vec3Set(p->outVertices[0],	outOrigin[0] + cg.refDef.viewAxis[2][0]*scale + cg.refDef.viewAxis[1][0]*scale,
-												outOrigin[1] + cg.refDef.viewAxis[2][1]*scale + cg.refDef.viewAxis[1][1]*scale,
-												outOrigin[2] + cg.refDef.viewAxis[2][2]*scale + cg.refDef.viewAxis[1][2]*scale);
+				Vec3Add(p->angle, outOrigin, vdelta);
 
-					// Bottom left
-					Vec2Set(p->outCoords[1], cgMedia.particleCoords[p->type][0], cgMedia.particleCoords[p->type][3]);
-					Vec3Set(p->outVertices[1],	outOrigin[0] - cg.refDef.viewAxis[2][0]*scale + cg.refDef.viewAxis[1][0]*scale,
-												outOrigin[1] - cg.refDef.viewAxis[2][1]*scale + cg.refDef.viewAxis[1][1]*scale,
-												outOrigin[2] - cg.refDef.viewAxis[2][2]*scale + cg.refDef.viewAxis[1][2]*scale);
+				vec3_t move;
+				Vec3Subtract(outOrigin, vdelta, move);
+				VectorNormalizeFastf(move);
 
-					// Bottom right
-					Vec2Set(p->outCoords[2], cgMedia.particleCoords[p->type][2], cgMedia.particleCoords[p->type][3]);
-					Vec3Set(p->outVertices[2],	outOrigin[0] - cg.refDef.viewAxis[2][0]*scale - cg.refDef.viewAxis[1][0]*scale,
-												outOrigin[1] - cg.refDef.viewAxis[2][1]*scale - cg.refDef.viewAxis[1][1]*scale,
-												outOrigin[2] - cg.refDef.viewAxis[2][2]*scale - cg.refDef.viewAxis[1][2]*scale);
+				vec3_t a_upVec, a_rtVec;
+				Vec3Copy(move, a_upVec);
+				Vec3Subtract(cg.refDef.viewOrigin, vdelta, delta);
+				CrossProduct(a_upVec, delta, a_rtVec);
 
-					// Top right
-					Vec2Set(p->outCoords[3], cgMedia.particleCoords[p->type][2], cgMedia.particleCoords[p->type][1]);
-					Vec3Set(p->outVertices[3],	outOrigin[0] + cg.refDef.viewAxis[2][0]*scale - cg.refDef.viewAxis[1][0]*scale,
-												outOrigin[1] + cg.refDef.viewAxis[2][1]*scale - cg.refDef.viewAxis[1][1]*scale,
-												outOrigin[2] + cg.refDef.viewAxis[2][2]*scale - cg.refDef.viewAxis[1][2]*scale);
-				}
+				VectorNormalizeFastf(a_rtVec);
+
+				Vec3Scale(a_rtVec, 0.75f, a_rtVec);
+				Vec3Scale(a_upVec, 0.75f * Vec3LengthFast(p->angle), a_upVec);
+
+				// Top left
+				Vec2Set(p->outCoords[0], cgMedia.particleCoords[p->type][0], cgMedia.particleCoords[p->type][1]);
+				Vec3Set(p->outVertices[0], outOrigin[0] + a_upVec[0]*scale - a_rtVec[0]*scale,
+											outOrigin[1] + a_upVec[1]*scale - a_rtVec[1]*scale,
+											outOrigin[2] + a_upVec[2]*scale - a_rtVec[2]*scale);
+
+				// Bottom left
+				Vec2Set(p->outCoords[1], cgMedia.particleCoords[p->type][0], cgMedia.particleCoords[p->type][3]);
+				Vec3Set(p->outVertices[1], outOrigin[0] - a_upVec[0]*scale - a_rtVec[0]*scale,
+											outOrigin[1] - a_upVec[1]*scale - a_rtVec[1]*scale,
+											outOrigin[2] - a_upVec[2]*scale - a_rtVec[2]*scale);
+
+				// Bottom right
+				Vec2Set(p->outCoords[2], cgMedia.particleCoords[p->type][2], cgMedia.particleCoords[p->type][3]);
+				Vec3Set(p->outVertices[2], outOrigin[0] - a_upVec[0]*scale + a_rtVec[0]*scale,
+											outOrigin[1] - a_upVec[1]*scale + a_rtVec[1]*scale,
+											outOrigin[2] - a_upVec[2]*scale + a_rtVec[2]*scale);
+
+				// Top right
+				Vec2Set(p->outCoords[3], cgMedia.particleCoords[p->type][2], cgMedia.particleCoords[p->type][1]);
+				Vec3Set(p->outVertices[3], outOrigin[0] + a_upVec[0]*scale + a_rtVec[0]*scale,
+											outOrigin[1] + a_upVec[1]*scale + a_rtVec[1]*scale,
+											outOrigin[2] + a_upVec[2]*scale + a_rtVec[2]*scale);
 
 				// Render it
 				p->outColor[0] = outColor;
@@ -614,22 +562,214 @@ void CG_AddParticles()
 				Vec3Copy(outOrigin, p->outPoly.origin);
 				p->outPoly.radius = scale;
 
-				cgi.R_AddPoly(&p->outPoly);
-				break;
-
-			default:
-				assert(0);
-				break;
+				result = PART_VISIBLE;
 			}
+			break;
+
+		case PART_STYLE_QUAD:
+			// The renderer expands these in bulk
+			Vec3Copy(outOrigin, p->outParticle.origin);
+			p->outParticle.radius = scale;
+			p->outParticle.orient = outOrient;
+			p->outParticle.color = outColor;
+			p->outParticle.coords = cgMedia.particleCoords[p->type];
+			p->outParticle.mat = p->mat;
 
+			result = PART_QUAD;
+			break;
+
+		default:
+			assert(0);
 			break;
 		}
 
-		// Kill if instant
-		if (p->colorVel[3] <= PART_INSTANT)
+		break;
+	}
+
+	// Kill if instant
+	if (p->colorVel[3] <= PART_INSTANT)
+	{
+		p->color[3] = 0;
+		p->colorVel[3] = 0;
+	}
+
+	return result;
+}
+
+/*
+=============================================================================
+
+	PARTICLE JOBS
+
+	Particles with no think functions pending only touch their own data, so
+	they are simulated in fixed-size chunks on the job threads. Each chunk
+	records the polys it built, the particles that died and the particles
+	that still have to think. Those are merged on the main thread in chunk
+	order, so what the renderer gets does not depend on thread timing.
+=============================================================================
+*/
+
+#define PART_CHUNK_SIZE		256
+
+struct partChunk_t
+{
+	int				first;
+	int				num;
+
+	refPoly_t		*polys[PART_CHUNK_SIZE];
+	int				numPolys;
+
+	refParticle_t	quads[PART_CHUNK_SIZE];
+	int				numQuads;
+
+	cgParticle_t	*dead[PART_CHUNK_SIZE];
+	int				numDead;
+
+	cgParticle_t	*thinkers[PART_CHUNK_SIZE];
+	int				numThinkers;
+};
+
+static cgParticle_t	**cg_partArray;
+static partChunk_t	*cg_partChunks;
+static int			cg_partArraySize;
+
+/*
+===============
+CG_ParticleJob
+===============
+*/
+static void CG_ParticleJob (void *arg, const int jobNum)
+{
+	partChunk_t		*chunk = &cg_partChunks[jobNum];
+	cgParticle_t	*p;
+
+	chunk->numPolys = 0;
+	chunk->numQuads = 0;
+	chunk->numDead = 0;
+	chunk->numThinkers = 0;
+
+	for (int i=chunk->first ; i<chunk->first+chunk->num ; i++)
+	{
+		p = cg_partArray[i];
+
+		// Think functions can spawn effects, play sounds and trace
+		if (p->bPreThinkNext || p->bThinkNext || p->bPostThinkNext)
 		{
-			p->color[3] = 0;
-			p->colorVel[3] = 0;
+			chunk->thinkers[chunk->numThinkers++] = p;
+			continue;
+		}
+
+		switch (CG_SimulateParticle(p))
+		{
+		case PART_DEAD:
+			chunk->dead[chunk->numDead++] = p;
+			break;
+
+		case PART_VISIBLE:
+			chunk->polys[chunk->numPolys++] = &p->outPoly;
+			break;
+
+		case PART_QUAD:
+			chunk->quads[chunk->numQuads++] = p->outParticle;
+			break;
 		}
 	}
 }
+
+
+/*
+===============
+CG_AddParticles
+===============
+*/
+void CG_AddParticles()
+{
+	CG_FreeGraveyard();
+
+	CG_AddMapFXToList();
+	CG_AddSustains();
+
+	if (!cl_add_particles->intVal)
+		return;
+
+	// Gather up to our limit
+	int numParts = min((int)cg_particles.Count(), cg_particleMax->intVal);
+	if (numParts <= 0)
+		return;
+
+	int numChunks = (numParts + PART_CHUNK_SIZE - 1) / PART_CHUNK_SIZE;
+	if (numParts > cg_partArraySize)
+	{
+		delete[] cg_partArray;
+		delete[] cg_partChunks;
+
+		cg_partArraySize = numChunks * PART_CHUNK_SIZE;
+		cg_partArray = new cgParticle_t*[cg_partArraySize];
+		cg_partChunks = new partChunk_t[numChunks];
+	}
+
+	int partNum = 0;
+	for (var cur = cg_particles.Head(); cur != null && partNum < numParts; cur = cur->Next)
+		cg_partArray[partNum++] = cur->Value;
+
+	for (int i=0 ; i<numChunks ; i++)
+	{
+		cg_partChunks[i].first = i * PART_CHUNK_SIZE;
+		cg_partChunks[i].num = min(PART_CHUNK_SIZE, numParts - cg_partChunks[i].first);
+	}
+
+	// Simulate
+	if (cg_effectJobs->intVal)
+		cgi.Job_Run(CG_ParticleJob, NULL, numChunks);
+	else
+	{
+		for (int i=0 ; i<numChunks ; i++)
+			CG_ParticleJob(NULL, i);
+	}
+
+	// Merge in chunk order
+	for (int i=0 ; i<numChunks ; i++)
+	{
+		partChunk_t *chunk = &cg_partChunks[i];
+
+		for (int j=0 ; j<chunk->numDead ; j++)
+			CG_FreeParticle(chunk->dead[j]);
+		for (int j=0 ; j<chunk->numPolys ; j++)
+			cgi.R_AddPoly(chunk->polys[j]);
+		if (chunk->numQuads)
+			cgi.R_AddParticles(chunk->quads, chunk->numQuads);
+	}
+
+	// Thinkers may spawn new particles, so don't let the allocator free the
+	// ones we still hold pointers to until we're done with them
+	cg_partDeferFree = true;
+
+	for (int i=0 ; i<numChunks ; i++)
+	{
+		partChunk_t *chunk = &cg_partChunks[i];
+
+		for (int j=0 ; j<chunk->numThinkers ; j++)
+		{
+			cgParticle_t *p = chunk->thinkers[j];
+			if (!p->node)
+				continue;	// Pushed out by a newer particle
+
+			switch (CG_SimulateParticle(p))
+			{
+			case PART_DEAD:
+				CG_FreeParticle(p);
+				break;
+
+			case PART_VISIBLE:
+				cgi.R_AddPoly(&p->outPoly);
+				break;
+
+			case PART_QUAD:
+				cgi.R_AddParticles(&p->outParticle, 1);
+				break;
+			}
+		}
+	}
+
+	cg_partDeferFree = false;
+}
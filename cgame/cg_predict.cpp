@@ -23,7 +23,33 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 #include "cg_local.h"
 
-static TList<entityState_t*>	cg_solidList;
+/*
+=============================================================================
+
+	SOLID LIST
+
+	Rebuilt once per server frame. Each solid has its clip box decoded and its
+	absolute bounds computed up front, and the list is kept sorted on absMins[0]
+	so that a trace only has to look at the slice of solids its swept box can
+	touch along X, and reject the rest of those by their bounds before running
+	a real clip trace.
+=============================================================================
+*/
+
+struct cgSolid_t
+{
+	entityState_t		*ent;
+	bool				bModel;
+
+	int					headNode;	// bmodels only, boxes share the box hull
+	vec3_t				mins, maxs;	// decoded bbox, boxes only
+
+	vec3_t				absMins, absMaxs;
+};
+
+static cgSolid_t		cg_solidList[MAX_PARSE_ENTITIES];
+static int				cg_numSolids;
+static float			cg_solidMaxWidth;	// widest absMins[0]..absMaxs[0] span in the list
 
 /*
 ===================
@@ -64,61 +90,76 @@ void CG_CheckPredictionError ()
 
 /*
 ====================
-CG_BuildSolidList
+CG_SolidSortCmp
 ====================
 */
-void CG_BuildSolidList ()
+static int CG_SolidSortCmp (const void *_a, const void *_b)
 {
-	entityState_t	*ent;
-	int				num, i;
+	const cgSolid_t *a = (const cgSolid_t *)_a;
+	const cgSolid_t *b = (const cgSolid_t *)_b;
 
-	cg_solidList.Clear();
-	for (i=0 ; i<cg.frame.numEntities ; i++) {
-		num = (cg.frame.parseEntities + i) & (MAX_PARSEENTITIES_MASK);
-		ent = &cg_parseEntities[num];
+	if (a->absMins[0] < b->absMins[0])
+		return -1;
+	if (a->absMins[0] > b->absMins[0])
+		return 1;
 
-		if (ent->solid)
-			cg_solidList.Add(ent);
-	}
+	// Keep entity order on ties so trace results stay deterministic
+	return a->ent->number - b->ent->number;
 }
 
 
 /*
 ====================
-CG_ClipMoveToEntities
+CG_BuildSolidList
 ====================
 */
-static void CG_ClipMoveToEntities (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int ignoreNum, bool entities, bool bModels, cmTrace_t *out)
+void CG_BuildSolidList ()
 {
-	int				x, zd, zu;
-	cmTrace_t		trace;
-	int				headnode;
-	float			*angles;
-	entityState_t	*ent;
-	struct cmBspModel_t *cmodel;
-	vec3_t			bmins, bmaxs;
+	entityState_t		*ent;
+	cgSolid_t			*solid;
+	struct cmBspModel_t	*cmodel;
+	int					x, zd, zu;
+	int					num, i, j;
+	float				radius, v;
 
-	for (uint32 i=0 ; i<cg_solidList.Count() ; i++) {
-		ent = cg_solidList[i];
-		if (ent->number == ignoreNum)
+	cg_numSolids = 0;
+	cg_solidMaxWidth = 0;
+
+	for (i=0 ; i<cg.frame.numEntities ; i++) {
+		num = (cg.frame.parseEntities + i) & (MAX_PARSEENTITIES_MASK);
+		ent = &cg_parseEntities[num];
+
+		if (!ent->solid)
 			continue;
 
+		solid = &cg_solidList[cg_numSolids];
+		solid->ent = ent;
+
 		if (ent->solid == 31) {
 			// Special value for bmodel
-			if (!bModels)
-				continue;
-
 			cmodel = cg.modelCfgClip[ent->modelIndex];
 			if (!cmodel)
 				continue;
-			headnode = cgi.CM_InlineModelHeadNode (cmodel);
-			angles = ent->angles;
+
+			solid->bModel = true;
+			solid->headNode = cgi.CM_InlineModelHeadNode (cmodel);
+			cgi.CM_InlineModelBounds (cmodel, solid->mins, solid->maxs);
+
+			if (ent->angles[0] || ent->angles[1] || ent->angles[2]) {
+				// Expand for rotation, to the farthest corner
+				radius = RadiusFromBounds (solid->mins, solid->maxs);
+				for (j=0 ; j<3 ; j++) {
+					solid->absMins[j] = ent->origin[j] - radius;
+					solid->absMaxs[j] = ent->origin[j] + radius;
+				}
+			}
+			else {
+				Vec3Add (ent->origin, solid->mins, solid->absMins);
+				Vec3Add (ent->origin, solid->maxs, solid->absMaxs);
+			}
 		}
 		else {
 			// Encoded bbox
-			if (!entities)
-				continue;
-
 			if (cg.protocolMinorVersion >= MINOR_VERSION_R1Q2_32BIT_SOLID)
 			{
 				x = (ent->solid & 255);
@@ -132,12 +173,122 @@ static void CG_ClipMoveToEntities (vec3_t start, vec3_t mins, vec3_t maxs, vec3_
 				zu = 8 * ((ent->solid >> 10) & 63) - 32;
 			}
 
-			bmins[0] = bmins[1] = -x;
-			bmaxs[0] = bmaxs[1] = x;
-			bmins[2] = -zd;
-			bmaxs[2] = zu;
+			solid->bModel = false;
+			solid->headNode = 0;
+			solid->mins[0] = solid->mins[1] = -x;
+			solid->maxs[0] = solid->maxs[1] = x;
+			solid->mins[2] = -zd;
+			solid->maxs[2] = zu;
+
+			// Boxes don't rotate
+			Vec3Add (ent->origin, solid->mins, solid->absMins);
+			Vec3Add (ent->origin, solid->maxs, solid->absMaxs);
+		}
+
+		// Movement is clipped an epsilon away from an actual edge,
+		// so check fully even when the boxes don't quite touch
+		for (j=0 ; j<3 ; j++) {
+			solid->absMins[j] -= 1;
+			solid->absMaxs[j] += 1;
+		}
+
+		v = solid->absMaxs[0] - solid->absMins[0];
+		if (v > cg_solidMaxWidth)
+			cg_solidMaxWidth = v;
+
+		cg_numSolids++;
+	}
+
+	if (cg_numSolids > 1)
+		qsort (cg_solidList, cg_numSolids, sizeof(cg_solidList[0]), CG_SolidSortCmp);
+}
+
 
-			headnode = cgi.CM_HeadnodeForBox (bmins, bmaxs);
+/*
+====================
+CG_FirstSolidInRange
+
+Returns the first solid in the sorted list whose absMins[0] is at or past
+minX. Nothing before that can overlap a box that starts at minX + maxWidth.
+====================
+*/
+static int CG_FirstSolidInRange (const float minX)
+{
+	int		low, high, mid;
+
+	low = 0;
+	high = cg_numSolids;
+	while (low < high) {
+		mid = (low + high) >> 1;
+		if (cg_solidList[mid].absMins[0] < minX)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+
+/*
+====================
+CG_ClipMoveToEntities
+====================
+*/
+static void CG_ClipMoveToEntities (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int ignoreNum, bool entities, bool bModels, cmTrace_t *out)
+{
+	cmTrace_t		trace;
+	int				headnode;
+	float			*angles;
+	cgSolid_t		*solid;
+	entityState_t	*ent;
+	vec3_t			traceMins, traceMaxs;
+	int				i;
+
+	if (!cg_numSolids)
+		return;
+
+	// Bounds of the whole move
+	for (i=0 ; i<3 ; i++) {
+		if (end[i] > start[i]) {
+			traceMins[i] = start[i] + mins[i];
+			traceMaxs[i] = end[i] + maxs[i];
+		}
+		else {
+			traceMins[i] = end[i] + mins[i];
+			traceMaxs[i] = start[i] + maxs[i];
+		}
+	}
+
+	for (i=CG_FirstSolidInRange (traceMins[0] - cg_solidMaxWidth) ; i<cg_numSolids ; i++) {
+		solid = &cg_solidList[i];
+		if (solid->absMins[0] > traceMaxs[0])
+			break;	// Sorted, nothing further along can touch
+
+		if (solid->absMaxs[0] < traceMins[0]
+		|| solid->absMins[1] > traceMaxs[1]
+		|| solid->absMins[2] > traceMaxs[2]
+		|| solid->absMaxs[1] < traceMins[1]
+		|| solid->absMaxs[2] < traceMins[2])
+			continue;
+
+		ent = solid->ent;
+		if (ent->number == ignoreNum)
+			continue;
+
+		if (solid->bModel) {
+			if (!bModels)
+				continue;
+
+			headnode = solid->headNode;
+			angles = ent->angles;
+		}
+		else {
+			if (!entities)
+				continue;
+
+			// The box hull is shared, so it has to be set up again per trace
+			headnode = cgi.CM_HeadnodeForBox (solid->mins, solid->maxs);
 			angles = vec3Origin;	// Boxes don't rotate
 		}
 
@@ -224,24 +375,26 @@ CG_PMPointContents
 */
 int CG_PMPointContents (vec3_t point)
 {
-	entityState_t	*ent;
-	int				i, num;
-	struct cmBspModel_t *cmodel;
-	int				contents;
+	cgSolid_t	*solid;
+	int			contents;
+	int			i;
 
 	contents = cgi.CM_PointContents (point, 0);
 
-	for (i=0 ; i<cg.frame.numEntities ; i++) {
-		num = (cg.frame.parseEntities + i)&(MAX_PARSEENTITIES_MASK);
-		ent = &cg_parseEntities[num];
-		if (ent->solid != 31) // Special value for bmodel
-			continue;
-
-		cmodel = cg.modelCfgClip[ent->modelIndex];
-		if (!cmodel)
+	for (i=CG_FirstSolidInRange (point[0] - cg_solidMaxWidth) ; i<cg_numSolids ; i++) {
+		solid = &cg_solidList[i];
+		if (solid->absMins[0] > point[0])
+			break;
+
+		if (!solid->bModel
+		|| solid->absMaxs[0] < point[0]
+		|| solid->absMins[1] > point[1]
+		|| solid->absMins[2] > point[2]
+		|| solid->absMaxs[1] < point[1]
+		|| solid->absMaxs[2] < point[2])
 			continue;
 
-		contents |= cgi.CM_TransformedPointContents (point, cgi.CM_InlineModelHeadNode (cmodel), ent->origin, ent->angles);
+		contents |= cgi.CM_TransformedPointContents (point, solid->headNode, solid->ent->origin, solid->ent->angles);
 	}
 
 	return contents;
@@ -31,6 +31,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 #define MAX_REF_DLIGHTS		32
 #define MAX_REF_ENTITIES	2048 // NOTE: Affects refMeshBuffer->sortValue
 #define MAX_REF_POLYS		8192
+#define MAX_REF_PARTICLES	8192
 
 #define MAX_LENTS			(MAX_REF_ENTITIES/2)	// leave breathing room for normal entities
 #define MAX_PARTICLES		8192
@@ -293,6 +294,19 @@ struct refPoly_t
 	float					matTime;
 };
 
+// Compact view facing quad, expanded by the renderer when it's batched
+struct refParticle_t
+{
+	vec3_t					origin;
+	float					radius;			// Half the width of the quad
+	float					orient;			// Roll around the view axis, in degrees
+
+	colorb					color;
+	const float				*coords;		// s1, t1, s2, t2
+
+	struct refMaterial_t	*mat;
+};
+
 struct refDecal_t
 {
 	// Rendering data
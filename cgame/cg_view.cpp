@@ -554,7 +554,10 @@ void V_RenderView (int realTime, float netFrameTime, float refreshFrameTime, flo
 	}
 
 	// Predict all unacknowledged movements
-	CG_PredictMovement ();
+	{
+		qProfile_Scope Prof("CG_PredictMovement");
+		CG_PredictMovement ();
+	}
 
 	// Watch for gender bending if desired
 	CG_FixUpGender ();
@@ -574,7 +577,10 @@ void V_RenderView (int realTime, float netFrameTime, float refreshFrameTime, flo
 		V_CalcViewValues ();
 
 		// Add in entities and effects
-		CG_AddEntities ();
+		{
+			qProfile_Scope Prof("CG_AddEntities");
+			CG_AddEntities ();
+		}
 
 		// View bob for next frame
 		CG_CalcViewBob ();
@@ -631,7 +637,10 @@ void V_RenderView (int realTime, float netFrameTime, float refreshFrameTime, flo
 	CG_RunDLights ();
 
 	// Render screen stuff
-	SCR_Draw ();
+	{
+		qProfile_Scope Prof("CG_DrawScreen");
+		SCR_Draw ();
+	}
 
 	// Increment frame counter
 	cg.frameCount++;
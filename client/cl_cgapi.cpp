@@ -737,6 +737,7 @@ void CL_CGameAPI_Init()
 	cgi.R_AddDecal					= R_AddDecal;
 	cgi.R_AddEntity					= R_AddEntity;
 	cgi.R_AddPoly					= R_AddPoly;
+	cgi.R_AddParticles				= R_AddParticles;
 	cgi.R_AddLight					= R_AddLight;
 	cgi.R_AddLightStyle				= R_AddLightStyle;
 
@@ -788,6 +789,12 @@ void CL_CGameAPI_Init()
 	cgi.Sys_Cycles					= Sys_Cycles;
 	cgi.Sys_MSPerCycle				= Sys_MSPerCycle;
 
+	cgi.Job_NumThreads				= Job_NumThreads;
+	cgi.Job_Run						= Job_Run;
+
+	cgi.Prof_Begin					= Prof_Begin;
+	cgi.Prof_End					= Prof_End;
+
 	cgi.Lua_CreateLuaState			= Lua_CreateLuaState;
 	cgi.Lua_ScriptFromState			= Lua_ScriptFromState;
 	cgi.Lua_RegisterFunctions		= Lua_RegisterFunctions;
@@ -844,6 +851,9 @@ void CL_CGameAPI_Shutdown ()
 	CGI_Com_DevPrintf (0, "cgame->Shutdown()\n");
 	cge->Shutdown ();
 
+	// Recorded zone names live in the module
+	Prof_Clear ();
+
 	CGI_Com_DevPrintf (0, "UnloadLibrary()\n");
 	Sys_UnloadLibrary (LIB_CGAME);
 	cls.mapLoaded = false;
@@ -693,6 +693,9 @@ void CL_SoundMediaInit ()
 {
 	int		i;
 
+	// Load the map's sounds together, the registrations below find them ready
+	Snd_PrefetchSounds ();
+
 	// Register local sounds
 	clMedia.talkSfx = Snd_RegisterSound ("misc/talk.wav");
 	for (i=1 ; i<MAX_CS_SOUNDS ; i++) {
@@ -936,7 +939,10 @@ static void CL_RefreshInputs ()
 	Cbuf_Execute ();
 
 	// Process packets from server
-	CL_ReadPackets ();
+	{
+		qProfile_Scope Prof("CL_ReadPackets");
+		CL_ReadPackets ();
+	}
 
 	// Update usercmd state
 	CL_RefreshCmd ();
@@ -1061,7 +1067,10 @@ void __fastcall CL_Frame(int msec)
 		}
 
 		// Update the screen
-		SCR_UpdateScreen();
+		{
+			qProfile_Scope Prof("SCR_UpdateScreen");
+			SCR_UpdateScreen();
+		}
 
 		// Advance local effects for next frame
 		CIN_RunCinematic();
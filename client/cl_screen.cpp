@@ -24,6 +24,108 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 #include "cl_local.h"
 
+/*
+=============================================================================
+
+	PROFILER GRAPH
+
+=============================================================================
+*/
+
+#define PROF_GRAPH_BARWIDTH		2
+#define PROF_GRAPH_HEIGHT		100
+#define PROF_GRAPH_MSHEIGHT		4		// Pixels per millisecond
+
+static const colorb scr_profColors[8] = {
+	colorb(255, 64, 64, 224),
+	colorb(64, 255, 64, 224),
+	colorb(64, 128, 255, 224),
+	colorb(255, 255, 64, 224),
+	colorb(255, 64, 255, 224),
+	colorb(64, 255, 255, 224),
+	colorb(255, 160, 64, 224),
+	colorb(160, 96, 255, 224)
+};
+
+/*
+================
+SCR_DrawProfile
+
+Stacked graph of the recorded frames, one bar per frame. com_profile 2 stacks
+the top level zones, every step above that goes one level deeper.
+================
+*/
+static void SCR_DrawProfile ()
+{
+	if (com_profile->intVal < 2 || !Prof_Active ())
+		return;
+
+	const int depth = com_profile->intVal - 2;
+	const double msPerCycle = Sys_MSPerCycle ();
+	const float bottom = cls.refConfig.vidHeight - 8;
+	const float left = 8;
+
+	// Background and 60/30 fps lines
+	R_DrawFill (left, bottom - PROF_GRAPH_HEIGHT, (PROF_MAX_FRAMES-1) * PROF_GRAPH_BARWIDTH, PROF_GRAPH_HEIGHT, colorb(0, 0, 0, 128));
+	R_DrawFill (left, bottom - 16.6f*PROF_GRAPH_MSHEIGHT, (PROF_MAX_FRAMES-1) * PROF_GRAPH_BARWIDTH, 1, Q_BColorGreen);
+	R_DrawFill (left, bottom - 33.3f*PROF_GRAPH_MSHEIGHT, (PROF_MAX_FRAMES-1) * PROF_GRAPH_BARWIDTH, 1, Q_BColorYellow);
+
+	// Oldest frame on the left
+	for (int age=PROF_MAX_FRAMES-1 ; age>=1 ; age--)
+	{
+		const profFrame_t *frame = Prof_GetFrame (age);
+		if (!frame)
+			continue;
+
+		const float x = left + (PROF_MAX_FRAMES-1-age) * PROF_GRAPH_BARWIDTH;
+
+		// Whole frame in grey, so untracked time shows
+		float h = min ((uint32)(frame->end - frame->start) * msPerCycle * PROF_GRAPH_MSHEIGHT, (double)PROF_GRAPH_HEIGHT);
+		R_DrawFill (x, bottom - h, PROF_GRAPH_BARWIDTH, h, Q_BColorMdGrey);
+
+		float y = bottom;
+		for (int i=0 ; i<frame->numEvents && y > bottom - PROF_GRAPH_HEIGHT ; i++)
+		{
+			const profEvent_t *ev = &frame->events[i];
+			if (ev->depth != depth)
+				continue;
+
+			h = (uint32)(ev->end - ev->start) * msPerCycle * PROF_GRAPH_MSHEIGHT;
+			h = min (h, y - (bottom - PROF_GRAPH_HEIGHT));
+			if (h < 1)
+				continue;
+
+			y -= h;
+			R_DrawFill (x, y, PROF_GRAPH_BARWIDTH, h, scr_profColors[Com_HashGeneric (ev->name, 8)]);
+		}
+	}
+
+	// Legend for the newest frame
+	const profFrame_t *frame = Prof_GetFrame (1);
+	if (!frame)
+		return;
+
+	vec2_t charSize;
+	R_GetFontDimensions (NULL, 0, 0, 0, charSize);
+
+	float y = bottom - PROF_GRAPH_HEIGHT - charSize[1];
+	for (int i=frame->numEvents-1 ; i>=0 ; i--)
+	{
+		const profEvent_t *ev = &frame->events[i];
+		if (ev->depth != depth)
+			continue;
+
+		R_DrawFill (left, y, charSize[0], charSize[1], scr_profColors[Com_HashGeneric (ev->name, 8)]);
+		R_DrawString (NULL, left + charSize[0]*2, y, 0, 0, FS_SHADOW,
+			Q_VarArgs ("%-24s %6.2fms", ev->name, (uint32)(ev->end - ev->start) * msPerCycle),
+			Q_BColorWhite);
+
+		y -= charSize[1];
+		if (y < 0)
+			break;
+	}
+}
+
 /*
 =============================================================================
 
@@ -139,6 +241,7 @@ void SCR_UpdateScreen()
 			GUI_Refresh();
 		}
 
+		SCR_DrawProfile();
 		CL_DrawConsole();
 	}
 
@@ -0,0 +1,194 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+//
+// snd_cache.cpp
+// Converted DMA samples kept between runs
+//
+
+#include "snd_local.h"
+
+// A disk cache (see common.h) keyed on the sound file name plus the output
+// format, see Snd_SoundCacheKey. A hit reads its payload straight into the
+// sound being loaded.
+
+#define SNDCACHE_FILE			"soundcache.pca"
+#define SNDCACHE_TEMP			"soundcache.tmp"
+#define SNDCACHE_MAGIC			(('C'<<24)+('D'<<16)+('N'<<8)+'S')
+#define SNDCACHE_VERSION		2
+
+#define MAX_SNDCACHE_ENTRIES	4096
+#define MAX_SNDCACHE_PAYLOAD	(16<<20)		// Largest single entry
+
+static bool				snd_cacheActive;
+static diskCache_t		snd_cache;
+
+static conCmd_t			*cmd_soundCacheStats;
+
+/*
+=================
+Snd_SoundCacheKey
+
+Everything about the converted samples that doesn't come from the file.
+=================
+*/
+uint32 Snd_SoundCacheKey (const int speed, const int width, const bool bFilter)
+{
+	return (uint32)speed | ((uint32)width << 24) | ((uint32)bFilter << 28);
+}
+
+
+/*
+=================
+Snd_SoundCacheActive
+=================
+*/
+bool Snd_SoundCacheActive ()
+{
+	return snd_cacheActive;
+}
+
+
+/*
+=================
+Snd_FindSoundCache
+
+Reads the samples stored for this sound file and key into out, if there are
+exactly outLen of them and the file hasn't changed since.
+=================
+*/
+bool Snd_FindSoundCache (const char *name, const uint32 key, const uint32 sourceLen, const uint32 sourceHash, byte *out, const uint32 outLen)
+{
+	diskCacheEntry_t	*entry;
+
+	if (!snd_cacheActive)
+		return false;
+
+	entry = DiskCache_Find (&snd_cache, name, key, sourceLen, sourceHash);
+	if (!entry)
+		return false;
+
+	if (entry->rawLen != outLen) {
+		snd_cache.stale++;
+		return false;
+	}
+
+	return DiskCache_Read (&snd_cache, entry, out);
+}
+
+
+/*
+=================
+Snd_StoreSoundCache
+
+Keeps a copy of data, to be written at the next flush.
+=================
+*/
+void Snd_StoreSoundCache (const char *name, const uint32 key, const uint32 sourceLen, const uint32 sourceHash, const byte *data, const uint32 length)
+{
+	byte	*copy;
+
+	if (!snd_cacheActive || !length || length > MAX_SNDCACHE_PAYLOAD)
+		return;
+
+	copy = (byte *)Mem_PoolAlloc (length, cl_soundSysPool, 0);
+	memcpy (copy, data, length);
+	DiskCache_Store (&snd_cache, name, key, sourceLen, sourceHash, copy, length);
+}
+
+/*
+===============================================================================
+
+	CONSOLE COMMANDS
+
+===============================================================================
+*/
+
+/*
+=================
+Snd_SoundCacheStats_f
+=================
+*/
+static void Snd_SoundCacheStats_f ()
+{
+	DiskCache_PrintStats (&snd_cache, "Sound cache");
+}
+
+/*
+===============================================================================
+
+	INIT / SHUTDOWN
+
+===============================================================================
+*/
+
+/*
+=================
+Snd_SoundCacheInit
+=================
+*/
+void Snd_SoundCacheInit ()
+{
+	snd_cache.fileName = SNDCACHE_FILE;
+	snd_cache.tempName = SNDCACHE_TEMP;
+	snd_cache.magic = SNDCACHE_MAGIC;
+	snd_cache.version = SNDCACHE_VERSION;
+	snd_cache.setupKey = 0;
+	snd_cache.maxEntries = MAX_SNDCACHE_ENTRIES;
+	snd_cache.maxPayload = MAX_SNDCACHE_PAYLOAD;
+	snd_cache.maxPending = 0;
+	snd_cache.budget = 0;
+	snd_cache.bCompress = false;
+	snd_cache.pool = cl_soundSysPool;
+	DiskCache_Open (&snd_cache);
+
+	snd_cacheActive = true;
+	cmd_soundCacheStats = Cmd_AddCommand ("soundcache_stats", 0, Snd_SoundCacheStats_f, "Prints sound cache usage and hit rate");
+}
+
+
+/*
+=================
+Snd_SoundCacheFlush
+
+Saves anything new, called at the end of registration.
+=================
+*/
+void Snd_SoundCacheFlush ()
+{
+	if (snd_cacheActive)
+		DiskCache_Write (&snd_cache);
+}
+
+
+/*
+=================
+Snd_SoundCacheShutdown
+=================
+*/
+void Snd_SoundCacheShutdown ()
+{
+	if (!snd_cacheActive)
+		return;
+	snd_cacheActive = false;
+
+	Cmd_RemoveCommand (cmd_soundCacheStats);
+
+	DiskCache_Close (&snd_cache);
+}
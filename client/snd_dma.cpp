@@ -24,58 +24,120 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 #include "snd_local.h"
 
-struct sfxSamplePair_t {
-	int				left;
-	int				right;
+// The mixer's side of a channel, only changed through the command queue
+struct mixChannel_t {
+	sfxCache_t		*sc;			// NULL when free
+	int				leftVol;		// 0-255 volume
+	int				rightVol;		// 0-255 volume
+	int				position;		// sample position in sc
+	int				endTime;		// end time in mixer paintsamples
+	bool			autoSound;		// loops, in phase with the paint time
+	bool			bPlayer;		// the player's own sound
 };
 
-audioDMA_t				snd_audioDMA;
+// A channel that is playing this paint
+struct mixVoice_t {
+	mixChannel_t	*ch;
+	int				priority;		// loudest side, boosted for the player's own sounds
+	bool			bMixed;			// false if virtualized: tracked but not mixed
+};
 
-// Audio channels
-static channel_t		snd_dmaOutChannels[MAX_CHANNELS];
+// What the mixer takes from cvars, posted by the game thread when it changes
+struct mixSettings_t {
+	float			volume;
+	int				mixAhead;		// sample pairs to keep painted past the play cursor
+	int				maxVoices;
+	int				sleepMS;		// between passes on the audio thread
+	bool			testSound;
+};
 
-// Raw sampling
-#define MAX_RAW_SAMPLES	8192
-static int				snd_dmaRawEnd;
-static sfxSamplePair_t	snd_dmaRawSamples[MAX_RAW_SAMPLES];
+enum ESndCommand
+{
+	SNDCMD_START,
+	SNDCMD_STOP,
+	SNDCMD_SPATIALIZE,
+	SNDCMD_STOPALL,
+	SNDCMD_SETTINGS,
+	SNDCMD_SYNC,
+	SNDCMD_STREAM,
+	SNDCMD_RESETSTATS,
+};
 
-// Buffer painting
-#define SND_PBUFFER		2048
-static sfxSamplePair_t	snd_dmaPaintBuffer[SND_PBUFFER];
-static int				snd_dmaScaleTable[32][256];
-static int				*snd_dmaMixPointer;
-static int				snd_dmaLinearCount;
-static sint16			*snd_dmaBufferOutput;
+struct sndCommand_t {
+	ESndCommand		type;
+	int				chanNum;
+	sfxCache_t		*sc;
+	int				leftVol;
+	int				rightVol;
+	bool			autoSound;
+	bool			bPlayer;
+	mixSettings_t	settings;
+	sndStream_t		*stream;
+};
+
+// Written by the mixer, read by snd_mixstats
+struct mixStats_t {
+	uint32			passes;
+	uint32			underruns;
+	uint32			underrunSamples;
+	uint32			noBuffer;		// passes the device gave no buffer to paint
+	int				minQueued;		// fewest sample pairs left to play before a pass
+	double			queuedTotal;
+	double			mixMS;
+	double			maxMixMS;
+	int				numMixed;		// voices in the last paint
+	int				numVirtual;
+};
+
+audioDMA_t				snd_audioDMA;
 
-static int				snd_dmaSoundTime;	// sample PAIRS
-int						snd_dmaPaintedTime;	// sample PAIRS
+// Game thread channels, for picking and spatializing
+static channel_t		snd_dmaOutChannels[MAX_CHANNELS];
+static mixSettings_t	snd_dmaSettings;	// as last posted
+static long				snd_dmaEpoch;		// mixer epoch the channels belong to
+static uint32			snd_dmaUnderruns;	// reported so far
+int						snd_dmaPaintedTime;	// sample PAIRS, the mixer's as of this frame
+
+// Raw sampling, written by the game thread ahead of the mixer. A full ring
+// holds up the writer rather than losing what hasn't played yet.
+#define SND_RAW_WAIT_MS	50
+static sndStream_t		*snd_dmaRawStream;
+static sndStream_t		*snd_dmaFileStream;	// as last posted
+
+// Single producer command queue, game thread to mixer
+#define SND_MAX_COMMANDS	1024
+static sndCommand_t		snd_cmdQueue[SND_MAX_COMMANDS];
+static volatile long	snd_cmdWrite;		// only moved by the game thread
+static volatile long	snd_cmdRead;		// only moved by the mixer
+static long				snd_cmdStaged;		// written past snd_cmdWrite, not yet published
+static int				snd_cmdMaxWaiting;	// most commands waiting at a commit, for snd_mixstats
+
+// Mixer, owned by the audio thread (or the game thread without one)
+#define SND_PBUFFER		2048
+static mixChannel_t		snd_mixChannels[MAX_CHANNELS];
+static sfxMixPair_t		snd_dmaPaintBuffer[SND_PBUFFER];
+static mixVoice_t		snd_dmaVoices[MAX_CHANNELS];
+static mixSettings_t	snd_mixSettings;
+static mixStats_t		snd_mixStats;
+static sndStream_t		*snd_mixFileStream;
+bool					snd_dmaSSE2;
+
+static int				snd_mixSoundTime;	// sample PAIRS
+static volatile long	snd_mixPaintedTime;	// sample PAIRS
+static volatile long	snd_mixEpoch;		// bumped when the paint time is chopped back
+static int				snd_mixBuffers;
+static int				snd_mixOldSamplePos;
+
+// Audio thread
+static sysThread_t		*snd_mixThread;
+static sysSemaphore_t	*snd_mixSync;		// posted when the mixer reaches a SNDCMD_SYNC
+static sysSemaphore_t	*snd_deviceLock;	// held while the mixer uses the device
+static volatile bool	snd_mixQuit;
 
 // Orientation
 static vec3_t			snd_dmaOrigin;
 static vec3_t			snd_dmaRightVec;
 
-/*
-================
-DMASnd_ScaleTableInit
-================
-*/
-static void DMASnd_ScaleTableInit (float volume)
-{
-	int		i, j;
-	int		scale;
-
-	if (volume == 0.0f) {
-		memset (snd_dmaScaleTable, 0, sizeof(snd_dmaScaleTable));
-		return;
-	}
-
-	for (i=0 ; i<32 ; i++) {
-		scale = i * 8 * 256 * volume;
-		for (j=0 ; j<256 ; j++)
-			snd_dmaScaleTable[i][j] = ((signed char)j) * scale;
-	}
-}
-
 /*
 ===============================================================================
 
@@ -86,24 +148,17 @@ static void DMASnd_ScaleTableInit (float volume)
 
 /*
 =================
-DMASnd_SpatializeOrigin
+DMASnd_OriginVolumes
 
-Used for spatializing channels and autosounds
+Distance and stereo scaled volumes for an origin, before occlusion.
 =================
 */
-static void DMASnd_SpatializeOrigin (vec3_t origin, float masterVol, float distMult, int &leftVol, int &rightVol)
+static void DMASnd_OriginVolumes (const vec3_t origin, const float masterVol, const float distMult, float &leftVol, float &rightVol)
 {
 	float		dot, dist;
-	float		leftScale, rightScale, scale;
+	float		leftScale, rightScale;
 	vec3_t		sourceVec;
 
-	if (Com_ClientState () != CA_ACTIVE)
-	{
-		leftVol = 255;
-		rightVol = 255;
-		return;
-	}
-
 	// Calculate stereo seperation and distance attenuation
 	Vec3Subtract (origin, snd_dmaOrigin, sourceVec);
 
@@ -127,11 +182,71 @@ static void DMASnd_SpatializeOrigin (vec3_t origin, float masterVol, float distM
 	}
 
 	// Add in distance effect
-	scale = (1.0 - dist) * rightScale;
-	rightVol = Q_rint (masterVol * scale);
+	rightVol = masterVol * ((1.0f - dist) * rightScale);
+	leftVol = masterVol * ((1.0f - dist) * leftScale);
+}
+
+
+#ifdef SND_SSE2
+/*
+=================
+DMASnd_OriginVolumes4
+
+DMASnd_OriginVolumes for four origins, split into x, y and z.
+=================
+*/
+static void DMASnd_OriginVolumes4 (const float *x, const float *y, const float *z, const float masterVol, const float distMult, float *leftVol, float *rightVol)
+{
+	const __m128 zero = _mm_setzero_ps ();
+	const __m128 one = _mm_set1_ps (1.0f);
+	const __m128 half = _mm_set1_ps (0.5f);
+
+	__m128 dx = _mm_sub_ps (_mm_loadu_ps (x), _mm_set1_ps (snd_dmaOrigin[0]));
+	__m128 dy = _mm_sub_ps (_mm_loadu_ps (y), _mm_set1_ps (snd_dmaOrigin[1]));
+	__m128 dz = _mm_sub_ps (_mm_loadu_ps (z), _mm_set1_ps (snd_dmaOrigin[2]));
+
+	// Zero length leaves a zero vector, as VectorNormalizef does
+	__m128 length = _mm_sqrt_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (dx, dx), _mm_mul_ps (dy, dy)), _mm_mul_ps (dz, dz)));
+	__m128 invLength = _mm_and_ps (_mm_div_ps (one, length), _mm_cmpgt_ps (length, zero));
+
+	__m128 dist = _mm_max_ps (_mm_sub_ps (length, _mm_set1_ps (SOUND_FULLVOLUME)), zero);
+	dist = _mm_mul_ps (dist, _mm_set1_ps (distMult));
+	__m128 vol = _mm_mul_ps (_mm_set1_ps (masterVol), _mm_sub_ps (one, dist));
+
+	if (snd_audioDMA.channels == 1 || !distMult)
+	{
+		// No attenuation = no spatialization
+		_mm_storeu_ps (rightVol, vol);
+		_mm_storeu_ps (leftVol, vol);
+		return;
+	}
+
+	__m128 dot = _mm_add_ps (_mm_add_ps (
+		_mm_mul_ps (dx, _mm_set1_ps (snd_dmaRightVec[0])),
+		_mm_mul_ps (dy, _mm_set1_ps (snd_dmaRightVec[1]))),
+		_mm_mul_ps (dz, _mm_set1_ps (snd_dmaRightVec[2])));
+	dot = _mm_mul_ps (dot, invLength);
+
+	_mm_storeu_ps (rightVol, _mm_mul_ps (vol, _mm_mul_ps (half, _mm_add_ps (one, dot))));
+	_mm_storeu_ps (leftVol, _mm_mul_ps (vol, _mm_mul_ps (half, _mm_sub_ps (one, dot))));
+}
+#endif // SND_SSE2
+
+
+/*
+=================
+DMASnd_OccludeOrigin
+
+Rounds the volumes from DMASnd_OriginVolumes, muffled if the origin is out
+of sight.
+=================
+*/
+static void DMASnd_OccludeOrigin (vec3_t origin, const float leftScaled, const float rightScaled, int &leftVol, int &rightVol)
+{
+	float		scale;
 
-	scale = (1.0 - dist) * leftScale;
-	leftVol = Q_rint (masterVol * scale);
+	rightVol = Q_rint (rightScaled);
+	leftVol = Q_rint (leftScaled);
 
 	// Add in an occlusion effect
 	cmTrace_t tr = CM_Trace(origin, snd_dmaOrigin, 1, CONTENTS_SOLID);
@@ -150,6 +265,81 @@ static void DMASnd_SpatializeOrigin (vec3_t origin, float masterVol, float distM
 }
 
 
+/*
+=================
+DMASnd_SpatializeOrigin
+
+Used for spatializing channels
+=================
+*/
+static void DMASnd_SpatializeOrigin (vec3_t origin, float masterVol, float distMult, int &leftVol, int &rightVol)
+{
+	float		leftScaled, rightScaled;
+
+	if (Com_ClientState () != CA_ACTIVE)
+	{
+		leftVol = 255;
+		rightVol = 255;
+		return;
+	}
+
+	DMASnd_OriginVolumes (origin, masterVol, distMult, leftScaled, rightScaled);
+	DMASnd_OccludeOrigin (origin, leftScaled, rightScaled, leftVol, rightVol);
+}
+
+
+/*
+=================
+DMASnd_SpatializeLoop
+
+Averages the volumes of every entity in a loop sound group. The distance
+and stereo scales are done four origins at a time where SSE2 is available,
+the occlusion traces one at a time.
+=================
+*/
+static float	snd_loopLeft[MAX_PARSE_ENTITIES];
+static float	snd_loopRight[MAX_PARSE_ENTITIES];
+static void DMASnd_SpatializeLoop (const loopSoundList_t *list, const loopSound_t *loop, int &leftTotal, int &rightTotal)
+{
+	const float	*x = &list->originX[loop->firstEnt];
+	const float	*y = &list->originY[loop->firstEnt];
+	const float	*z = &list->originZ[loop->firstEnt];
+	vec3_t		origin;
+	int			left, right;
+	int			i;
+
+	i = 0;
+#ifdef SND_SSE2
+	if (snd_dmaSSE2) {
+		for ( ; i+4<=loop->numEnts ; i+=4)
+			DMASnd_OriginVolumes4 (&x[i], &y[i], &z[i], 255.0f, SOUND_LOOPATTENUATE, &snd_loopLeft[i], &snd_loopRight[i]);
+	}
+#endif
+	for ( ; i<loop->numEnts ; i++) {
+		Vec3Set (origin, x[i], y[i], z[i]);
+		DMASnd_OriginVolumes (origin, 255.0f, SOUND_LOOPATTENUATE, snd_loopLeft[i], snd_loopRight[i]);
+	}
+
+	// Find the total contribution of all sounds of this type
+	leftTotal = rightTotal = 0;
+	for (i=0 ; i<loop->numEnts ; i++) {
+		Vec3Set (origin, x[i], y[i], z[i]);
+		DMASnd_OccludeOrigin (origin, snd_loopLeft[i], snd_loopRight[i], left, right);
+
+		leftTotal += left;
+		rightTotal += right;
+	}
+
+	// Average out the result
+	if (loop->numEnts > 1)
+	{
+		float Avg = 1.0f / (float)loop->numEnts;
+		leftTotal *= Avg;
+		rightTotal *= Avg;
+	}
+}
+
+
 /*
 =================
 DMASnd_SpatializeChannel
@@ -179,6 +369,154 @@ static void DMASnd_SpatializeChannel (channel_t *ch)
 	DMASnd_SpatializeOrigin (origin, ch->masterVol, ch->distMult, ch->leftVol, ch->rightVol);
 }
 
+/*
+===============================================================================
+
+	COMMAND QUEUE
+
+	The game thread stages commands past snd_cmdWrite and publishes them
+	together at the end of DMASnd_Update, so the mixer never sees part of a
+	frame, like an autosound that is stopped but not yet restarted.
+
+===============================================================================
+*/
+
+static void DMASnd_RunCommands ();
+static void DMASnd_Sync ();
+
+/*
+=================
+DMASnd_CommitCommands
+
+Publishes the staged commands to the mixer.
+=================
+*/
+static void DMASnd_CommitCommands ()
+{
+	int		numWaiting;
+
+	if (!snd_cmdStaged)
+		return;
+
+	numWaiting = snd_cmdWrite + snd_cmdStaged - snd_cmdRead;
+	if (numWaiting > snd_cmdMaxWaiting)
+		snd_cmdMaxWaiting = numWaiting;
+
+	// Full barrier, the commands land before the index moves
+	Sys_AtomicAdd (&snd_cmdWrite, snd_cmdStaged);
+	snd_cmdStaged = 0;
+}
+
+
+/*
+=================
+DMASnd_NewCommand
+
+Stages a command. When the queue is full, what is staged so far goes out
+early and the mixer is given time to catch up.
+=================
+*/
+static sndCommand_t *DMASnd_NewCommand (const ESndCommand type)
+{
+	sndCommand_t	*cmd;
+
+	while (snd_cmdWrite + snd_cmdStaged - snd_cmdRead >= SND_MAX_COMMANDS) {
+		DMASnd_CommitCommands ();
+		if (snd_mixThread)
+			Sys_Sleep (1);
+		else
+			DMASnd_RunCommands ();
+	}
+
+	cmd = &snd_cmdQueue[(snd_cmdWrite + snd_cmdStaged) & (SND_MAX_COMMANDS-1)];
+	snd_cmdStaged++;
+
+	cmd->type = type;
+	return cmd;
+}
+
+
+/*
+=================
+DMASnd_PostStart
+
+Starts a game channel's sound on the mixer, at its current paint time.
+=================
+*/
+static void DMASnd_PostStart (channel_t *ch, sfxCache_t *sc)
+{
+	sndCommand_t *cmd = DMASnd_NewCommand (SNDCMD_START);
+
+	cmd->chanNum = ch - snd_dmaOutChannels;
+	cmd->sc = sc;
+	cmd->leftVol = ch->leftVol;
+	cmd->rightVol = ch->rightVol;
+	cmd->autoSound = ch->autoSound;
+	cmd->bPlayer = (ch->psType == PSND_LOCAL || ch->entNum == cl.playerNum+1);
+}
+
+
+/*
+=================
+DMASnd_PostStop
+=================
+*/
+static void DMASnd_PostStop (channel_t *ch)
+{
+	DMASnd_NewCommand (SNDCMD_STOP)->chanNum = ch - snd_dmaOutChannels;
+}
+
+
+/*
+=================
+DMASnd_PostSpatialize
+=================
+*/
+static void DMASnd_PostSpatialize (channel_t *ch)
+{
+	sndCommand_t *cmd = DMASnd_NewCommand (SNDCMD_SPATIALIZE);
+
+	cmd->chanNum = ch - snd_dmaOutChannels;
+	cmd->leftVol = ch->leftVol;
+	cmd->rightVol = ch->rightVol;
+}
+
+
+/*
+=================
+DMASnd_CurrentSettings / DMASnd_PostSettings
+
+Hands the cvars the mixer uses over to it when they change.
+=================
+*/
+static void DMASnd_CurrentSettings (mixSettings_t &settings)
+{
+	memset (&settings, 0, sizeof(settings));
+
+	// Don't play sounds while the screen is disabled
+	if (cls.disableScreen || !snd_isActive)
+		settings.volume = 0.0f;
+	else
+		settings.volume = s_volume->floatVal;
+
+	settings.mixAhead = s_mixahead->floatVal * snd_audioDMA.speed;
+	settings.maxVoices = clamp (s_maxVoices->intVal, 1, MAX_CHANNELS);
+	settings.sleepMS = clamp ((int)(s_mixahead->floatVal * 250), 1, 20);	// a quarter of the window
+	settings.testSound = (s_testsound->intVal != 0);
+}
+
+static void DMASnd_PostSettings ()
+{
+	mixSettings_t	settings;
+
+	DMASnd_CurrentSettings (settings);
+	if (!memcmp (&settings, &snd_dmaSettings, sizeof(settings)))
+		return;
+
+	snd_dmaSettings = settings;
+	DMASnd_NewCommand (SNDCMD_SETTINGS)->settings = settings;
+}
+
 /*
 ===============================================================================
 
@@ -242,11 +580,11 @@ static channel_t *DMASnd_PickChannel (int entNum, EEntSndChannel entChannel)
 ===============
 DMASnd_IssuePlaysound
 
-Take the next playsound and begin it on the channel. This is never
+Take the playsounds that are due and begin them on channels. This is never
 called directly by Snd_Play*, but only by the update loop.
 ===============
 */
-static void DMASnd_IssuePlaysounds (int endTime)
+static void DMASnd_IssuePlaysounds ()
 {
 	channel_t	*ch;
 	sfxCache_t	*sc;
@@ -256,11 +594,8 @@ static void DMASnd_IssuePlaysounds (int endTime)
 		ps = snd_pendingPlays.next;
 		if (ps == &snd_pendingPlays)
 			break;	// No more pending sounds
-		if (ps->beginTime > snd_dmaPaintedTime) {
-			if (ps->beginTime < endTime)
-				endTime = ps->beginTime;	// Stop here
-			break;
-		}
+		if (ps->beginTime > snd_dmaPaintedTime)
+			break;	// Not due until a later frame
 
 		if (s_show->intVal)
 			Com_Printf (0, "Issue %i\n", ps->beginTime);
@@ -289,7 +624,15 @@ static void DMASnd_IssuePlaysounds (int endTime)
 
 		ch->position = 0;
 		sc = Snd_LoadSound (ch->sfx);
+		if (!sc || sc->length <= 0) {
+			// The mixer may still be playing what was picked over
+			DMASnd_PostStop (ch);
+			ch->sfx = NULL;
+			Snd_FreePlaysound (ps);
+			continue;
+		}
 		ch->endTime = snd_dmaPaintedTime + sc->length;
+		DMASnd_PostStart (ch, sc);
 
 		// Free the playsound
 		Snd_FreePlaysound (ps);
@@ -307,6 +650,8 @@ static void DMASnd_IssuePlaysounds (int endTime)
 /*
 ==================
 DMASnd_ClearBuffer
+
+Mixer only.
 ==================
 */
 static void DMASnd_ClearBuffer ()
@@ -314,7 +659,6 @@ static void DMASnd_ClearBuffer ()
 	int		clear;
 
 	// Clear the buffers
-	snd_dmaRawEnd = 0;
 	if (snd_audioDMA.sampleBits == 8)
 		clear = 0x80;
 	else
@@ -336,9 +680,47 @@ void DMASnd_StopAllSounds ()
 {
 	// Clear all the channels
 	memset (snd_dmaOutChannels, 0, sizeof(snd_dmaOutChannels));
+	if (snd_dmaRawStream)
+		Snd_StreamReset (snd_dmaRawStream);
 
-	// Clear the buffers
-	DMASnd_ClearBuffer ();
+	// The mixer clears its own, and the buffers
+	DMASnd_NewCommand (SNDCMD_STOPALL);
+	DMASnd_CommitCommands ();
+}
+
+
+/*
+==================
+DMASnd_ReleaseSounds
+
+Stops the channels and pending playsounds using sounds that are about to be
+freed, either all of them or the ones not touched this registration, and
+waits until the mixer has let go of their sample data.
+==================
+*/
+void DMASnd_ReleaseSounds (const bool bAll)
+{
+	channel_t	*ch;
+	playSound_t	*ps, *next;
+	int			i;
+
+	for (i=0, ch=snd_dmaOutChannels ; i<MAX_CHANNELS ; ch++, i++) {
+		if (!ch->sfx)
+			continue;
+		if (!bAll && ch->sfx->touchFrame == snd_registrationFrame)
+			continue;
+
+		DMASnd_PostStop (ch);
+		memset (ch, 0, sizeof(channel_t));
+	}
+
+	for (ps=snd_pendingPlays.next ; ps != &snd_pendingPlays ; ps=next) {
+		next = ps->next;
+		if (bAll || ps->sfx->touchFrame != snd_registrationFrame)
+			Snd_FreePlaysound (ps);
+	}
+
+	DMASnd_Sync ();
 }
 
 /*
@@ -359,72 +741,26 @@ started, stopped, and merged together as the entities are sent to the client
 */
 static void DMASnd_AddLoopSounds ()
 {
-	int				left, right;
-	int				leftTotal, rightTotal;
-	channel_t		*ch;
-	sfx_t			*sfx;
-	sfxCache_t		*sc;
-	entityState_t	*ent;
-	vec3_t			origin, velocity;
-	bool			bDone[MAX_PARSE_ENTITIES];
+	int						leftTotal, rightTotal;
+	channel_t				*ch;
+	sfxCache_t				*sc;
+	const loopSoundList_t	*list;
+	const loopSound_t		*loop;
 
 	if (cl_paused->intVal || Com_ClientState () != CA_ACTIVE || !cls.soundPrepped)
 		return;
 
-	memset(&bDone, false, sizeof(bool)*MAX_PARSE_ENTITIES);
-
-	// Add sounds
-	for (int i=0 ; i<cl.frame.numEntities ; i++)
+	// Add sounds, one channel for each sound however many entities carry it
+	list = Snd_GatherLoopSounds (true);
+	for (int i=0 ; i<list->numSounds ; i++)
 	{
-		int entIdx = (cl.frame.parseEntities + i)&(MAX_PARSEENTITIES_MASK);
-		ent = &cl_parseEntities[entIdx];
-		if (!ent->sound || bDone[entIdx])
-			continue;
+		loop = &list->sounds[i];
 
-		if (!cl.soundCfgStrings[ent->sound] && cl.configStrings[CS_SOUNDS+ent->sound][0])
-			cl.soundCfgStrings[ent->sound] = Snd_RegisterSound (cl.configStrings[CS_SOUNDS+ent->sound]);
-
-		sfx = cl.soundCfgStrings[ent->sound];
-		if (!sfx)
-			continue;	// Bad sound effect
-
-		sc = sfx->cache;
-		if (!sc)
+		sc = loop->sfx->cache;
+		if (sc->length <= 0)
 			continue;
 
-		// Get the entity sound origin
-		CL_CGModule_GetEntitySoundOrigin (ent->number, origin, velocity);
-
-		// Find the total contribution of all sounds of this type
-		DMASnd_SpatializeOrigin (origin, 255.0f, SOUND_LOOPATTENUATE, leftTotal, rightTotal);
-		bDone[entIdx] = true;
-
-		int NumCombined = 1;
-		for (int j=i+1 ; j<cl.frame.numEntities ; j++)
-		{
-			int otherIdx = (cl.frame.parseEntities + j)&(MAX_PARSEENTITIES_MASK);
-			entityState_t *other = &cl_parseEntities[otherIdx];
-
-			if (other->sound != ent->sound || bDone[otherIdx])
-				continue;
-
-			CL_CGModule_GetEntitySoundOrigin (other->number, origin, velocity);
-			DMASnd_SpatializeOrigin (origin, 255.0f, SOUND_LOOPATTENUATE, left, right);
-			bDone[otherIdx] = true;
-
-			leftTotal += left;
-			rightTotal += right;
-			NumCombined++;
-		}
-
-		// Average out the result
-		if (NumCombined > 1)
-		{
-			float Avg = 1.0f / (float)NumCombined;
-			leftTotal *= Avg;
-			rightTotal *= Avg;
-		}
-
+		DMASnd_SpatializeLoop (list, loop, leftTotal, rightTotal);
 		if (leftTotal == 0 && rightTotal == 0)
 			continue;	// Not audible
 
@@ -442,179 +778,355 @@ static void DMASnd_AddLoopSounds ()
 		ch->leftVol = leftTotal;
 		ch->rightVol = rightTotal;
 		ch->autoSound = true;	// Remove next frame
-		ch->sfx = sfx;
+		ch->sfx = loop->sfx;
 		ch->position = snd_dmaPaintedTime % sc->length;
 		ch->endTime = snd_dmaPaintedTime + sc->length - ch->position;
+		DMASnd_PostStart (ch, sc);
 	}
 }
 
 
+/*
+===============================================================================
+
+	MIXING KERNELS
+
+	The mix is accumulated in float, in 16-bit sample units. The SSE2 paths
+	do the same multiply and add per sample as the scalar loops, so both give
+	the same mix.
+
+===============================================================================
+*/
+
+#ifdef SND_SSE2
 /*
 ================
-DMASnd_PaintChannelFrom8
+DMASnd_MixPairs8
+
+Adds eight sign extended samples into eight stereo pairs at out.
 ================
 */
-static void DMASnd_PaintChannelFrom8 (channel_t *ch, sfxCache_t *sc, int count, int offset)
+static inline void DMASnd_MixPairs8 (float *out, const __m128i samples, const __m128 gains)
 {
-	int		data;
-	int		*lScale, *rScale;
-	byte	*sfx;
-	int		i;
-	sfxSamplePair_t	*samp;
+	const __m128 lo = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpacklo_epi16 (samples, samples), 16));
+	const __m128 hi = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpackhi_epi16 (samples, samples), 16));
 
-	// Clamp
-	if (ch->leftVol > 255)
-		ch->leftVol = 255;
-	if (ch->rightVol > 255)
-		ch->rightVol = 255;
+	_mm_storeu_ps (out+0, _mm_add_ps (_mm_loadu_ps (out+0), _mm_mul_ps (_mm_unpacklo_ps (lo, lo), gains)));
+	_mm_storeu_ps (out+4, _mm_add_ps (_mm_loadu_ps (out+4), _mm_mul_ps (_mm_unpackhi_ps (lo, lo), gains)));
+	_mm_storeu_ps (out+8, _mm_add_ps (_mm_loadu_ps (out+8), _mm_mul_ps (_mm_unpacklo_ps (hi, hi), gains)));
+	_mm_storeu_ps (out+12, _mm_add_ps (_mm_loadu_ps (out+12), _mm_mul_ps (_mm_unpackhi_ps (hi, hi), gains)));
+}
+#endif
 
-	// Left/right scale
-	lScale = snd_dmaScaleTable[ch->leftVol >> 3];
-	rScale = snd_dmaScaleTable[ch->rightVol >> 3];
-	sfx = (byte *)sc->data + ch->position;
 
-	samp = &snd_dmaPaintBuffer[offset];
-	for (i=0 ; i<count ; i++, samp++) {
-		data = sfx[i];
-		samp->left += lScale[data];
-		samp->right += rScale[data];
+/*
+================
+DMASnd_MixMono8
+================
+*/
+static void DMASnd_MixMono8 (float *out, const signed char *in, const int count, const float leftGain, const float rightGain)
+{
+	int		i = 0;
+
+#ifdef SND_SSE2
+	if (snd_dmaSSE2) {
+		const __m128 gains = _mm_setr_ps (leftGain, rightGain, leftGain, rightGain);
+		for ( ; i+8<=count ; i+=8) {
+			// Bytes to the high half of each word, then back down with the sign
+			__m128i samples = _mm_loadl_epi64 ((const __m128i *)(in + i));
+			samples = _mm_srai_epi16 (_mm_unpacklo_epi8 (samples, samples), 8);
+			DMASnd_MixPairs8 (out + i*2, samples, gains);
+		}
+	}
+#endif
+
+	for ( ; i<count ; i++) {
+		const float sample = in[i];
+		out[i*2+0] += sample * leftGain;
+		out[i*2+1] += sample * rightGain;
 	}
-	
-	ch->position += count;
 }
 
 
 /*
 ================
-DMASnd_PaintChannelFrom16
+DMASnd_MixMono16
 ================
 */
-static void DMASnd_PaintChannelFrom16 (channel_t *ch, sfxCache_t *sc, int count, int offset, float volume)
+static void DMASnd_MixMono16 (float *out, const sint16 *in, const int count, const float leftGain, const float rightGain)
 {
-	int				data, i;
-	int				left, right;
-	int				leftVol, rightVol;
-	signed short	*sfx;
-	sfxSamplePair_t	*samp;
+	int		i = 0;
 
-	leftVol = ch->leftVol * volume * 256;
-	rightVol = ch->rightVol * volume * 256;
-	sfx = (signed short *)sc->data + ch->position;
-
-	samp = &snd_dmaPaintBuffer[offset];
-	for (i=0 ; i<count ; i++, samp++) {
-		data = sfx[i];
-		left = (data * leftVol)>>8;
-		right = (data * rightVol)>>8;
-		samp->left += left;
-		samp->right += right;
+#ifdef SND_SSE2
+	if (snd_dmaSSE2) {
+		const __m128 gains = _mm_setr_ps (leftGain, rightGain, leftGain, rightGain);
+		for ( ; i+8<=count ; i+=8)
+			DMASnd_MixPairs8 (out + i*2, _mm_loadu_si128 ((const __m128i *)(in + i)), gains);
 	}
+#endif
 
-	ch->position += count;
+	for ( ; i<count ; i++) {
+		const float sample = in[i];
+		out[i*2+0] += sample * leftGain;
+		out[i*2+1] += sample * rightGain;
+	}
 }
 
 
 /*
-===================
-DMASnd_TransferPaintBuffer
-===================
-*/
+================
+DMASnd_ClipSample / DMASnd_ClipSamples
+
+Converts mixed values to 16-bit samples the way Q_ftol does, and saturates
+them. Both paths have to agree or the output depends on buffer position.
+================
+*/
+static inline sint16 DMASnd_ClipSample (const float value)
+{
+	if (value >= 32767.0f)
+		return 32767;
+	if (value <= -32768.0f)
+		return -32768;
+	return (sint16)Q_ftol (value);
+}
+
+static void DMASnd_ClipSamples (sint16 *out, const float *in, const int count)
+{
+	int		i = 0;
+
+#ifdef SND_SSE2
+	if (snd_dmaSSE2) {
+		const __m128 high = _mm_set1_ps (32767.0f);
+		const __m128 low = _mm_set1_ps (-32768.0f);
+		for ( ; i+8<=count ; i+=8) {
+			const __m128 a = _mm_min_ps (_mm_max_ps (_mm_loadu_ps (in + i), low), high);
+			const __m128 b = _mm_min_ps (_mm_max_ps (_mm_loadu_ps (in + i + 4), low), high);
+#ifdef id386
+			// Q_ftol is fistp, which rounds to nearest
+			const __m128i lo = _mm_cvtps_epi32 (a);
+			const __m128i hi = _mm_cvtps_epi32 (b);
+#else
+			// Q_ftol is a cast, which truncates
+			const __m128i lo = _mm_cvttps_epi32 (a);
+			const __m128i hi = _mm_cvttps_epi32 (b);
+#endif
+			_mm_storeu_si128 ((__m128i *)(out + i), _mm_packs_epi32 (lo, hi));
+		}
+	}
+#endif
+
+	for ( ; i<count ; i++)
+		out[i] = DMASnd_ClipSample (in[i]);
+}
+
+
+/*
+================
+DMASnd_MixVoice
+
+Mixes count samples of a voice from its current position. Gains carry the
+16-bit sample scale, so 8-bit data is scaled up by 256.
+================
+*/
+static void DMASnd_MixVoice (float *out, const mixChannel_t *ch, const int count, const float volume)
+{
+	const sfxCache_t *sc = ch->sc;
+
+	if (sc->width == 1) {
+		DMASnd_MixMono8 (out, (const signed char *)sc->data + ch->position, count, ch->leftVol * volume, ch->rightVol * volume);
+	}
+	else {
+		const float scale = volume * (1.0f/256.0f);
+		DMASnd_MixMono16 (out, (const sint16 *)sc->data + ch->position, count, ch->leftVol * scale, ch->rightVol * scale);
+	}
+}
+
+/*
+===============================================================================
+
+	VOICE PAINTING
+
+===============================================================================
+*/
+
+/*
+================
+DMASnd_SortVoices
+================
+*/
+static int DMASnd_SortVoices (const void *a, const void *b)
+{
+	return ((const mixVoice_t *)b)->priority - ((const mixVoice_t *)a)->priority;
+}
+
+
+/*
+================
+DMASnd_GatherVoices
+
+Builds the voice list for a paint. When more voices are audible than
+s_maxVoices allows, the quietest ones are virtualized: their positions keep
+advancing, but they are not mixed.
+================
+*/
+static int DMASnd_GatherVoices (float volume)
+{
+	mixChannel_t	*ch;
+	mixVoice_t		*voice;
+	int				numVoices, numAudible;
+	int				i;
+
+	numVoices = 0;
+	numAudible = 0;
+	for (i=0, ch=snd_mixChannels ; i<MAX_CHANNELS ; ch++, i++) {
+		if (!ch->sc)
+			continue;
+
+		// Clamp
+		if (ch->leftVol > 255)
+			ch->leftVol = 255;
+		if (ch->rightVol > 255)
+			ch->rightVol = 255;
+
+		voice = &snd_dmaVoices[numVoices++];
+		voice->ch = ch;
+		voice->priority = (volume > 0.0f) ? max (ch->leftVol, ch->rightVol) : 0;
+		if (voice->priority && ch->bPlayer)
+			voice->priority += 256;	// Never drop the player's own sounds first
+		voice->bMixed = (voice->priority > 0);
+		if (voice->bMixed)
+			numAudible++;
+	}
+
+	// Over budget, keep the loudest
+	if (numAudible > snd_mixSettings.maxVoices) {
+		qsort (snd_dmaVoices, numVoices, sizeof(mixVoice_t), DMASnd_SortVoices);
+		for (i=snd_mixSettings.maxVoices ; i<numAudible ; i++)
+			snd_dmaVoices[i].bMixed = false;
+		numAudible = snd_mixSettings.maxVoices;
+	}
+
+	snd_mixStats.numMixed = numAudible;
+	snd_mixStats.numVirtual = numVoices - numAudible;
+	return numVoices;
+}
+
+
+/*
+================
+DMASnd_PaintVoice
+
+Advances a voice to endTime, mixing it unless it is virtual, and handles
+looping and stopping at the end of its sample.
+================
+*/
+static void DMASnd_PaintVoice (const mixVoice_t *voice, int endTime, float volume)
+{
+	mixChannel_t	*ch = voice->ch;
+	sfxCache_t		*sc = ch->sc;
+	int				lTime, count;
+
+	lTime = snd_mixPaintedTime;
+	while (lTime < endTime && ch->sc) {
+		// Max painting is to the end of the buffer
+		count = endTime - lTime;
+
+		// Might be stopped by running out of data
+		if (ch->endTime - lTime < count)
+			count = ch->endTime - lTime;
+
+		if (count > 0) {
+			if (voice->bMixed)
+				DMASnd_MixVoice (&snd_dmaPaintBuffer[lTime - snd_mixPaintedTime].left, ch, count, volume);
+
+			ch->position += count;
+			lTime += count;
+		}
+
+		// If at end of loop, restart
+		if (lTime >= ch->endTime) {
+			if (ch->autoSound) {
+				// Autolooping sounds always go back to start
+				ch->position = 0;
+				ch->endTime = lTime + sc->length;
+			}
+			else if (sc->loopStart >= 0) {
+				ch->position = sc->loopStart;
+				ch->endTime = lTime + sc->length - ch->position;
+			}
+			else {
+				// Channel just stopped
+				ch->sc = NULL;
+			}
+		}
+	}
+}
+
+
+/*
+===================
+DMASnd_TransferPaintBuffer
+===================
+*/
 static void DMASnd_TransferPaintBuffer (int endTime)
 {
 	int		count;
-	int		val;
 	int		i;
-	uint32	*pbuf;
 
-	pbuf = (uint32 *)snd_audioDMA.buffer;
-
-	if (s_testsound->intVal) {
+	if (snd_mixSettings.testSound) {
 		// Write a fixed sine wave
-		count = (endTime - snd_dmaPaintedTime);
+		count = (endTime - snd_mixPaintedTime);
 		for (i=0 ; i<count ; i++)
-			snd_dmaPaintBuffer[i].left = snd_dmaPaintBuffer[i].right = sinf((snd_dmaPaintedTime+i)*0.1)*20000*256;
+			snd_dmaPaintBuffer[i].left = snd_dmaPaintBuffer[i].right = sinf((snd_mixPaintedTime+i)*0.1f)*20000;
 	}
 
 	if (snd_audioDMA.sampleBits == 16 && snd_audioDMA.channels == 2) {
-		int		pos;
-		int		paintedTime;
-		
-		// Optimized case
-		snd_dmaMixPointer = (int *) snd_dmaPaintBuffer;
-		paintedTime = snd_dmaPaintedTime;
+		const int	halfSamples = snd_audioDMA.samples >> 1;
+		const float	*mix = &snd_dmaPaintBuffer[0].left;
+		int			paintedTime = snd_mixPaintedTime;
+		int			pos;
 
+		// Optimized case
 		while (paintedTime < endTime) {
 			// Handle recirculating buffer issues
-			pos = paintedTime & ((snd_audioDMA.samples>>1)-1);
-
-			snd_dmaBufferOutput = (sint16 *) pbuf + (pos<<1);
-			snd_dmaLinearCount = (snd_audioDMA.samples>>1) - pos;
-			if (paintedTime + snd_dmaLinearCount > endTime)
-				snd_dmaLinearCount = endTime - paintedTime;
-
-			snd_dmaLinearCount <<= 1;
+			pos = paintedTime & (halfSamples-1);
+			count = halfSamples - pos;
+			if (paintedTime + count > endTime)
+				count = endTime - paintedTime;
 
 			// Write a linear blast of samples
-			for (i=0 ; i<snd_dmaLinearCount ; i+=2) {
-				val = snd_dmaMixPointer[i]>>8;
-				if (val > 0x7fff)
-					snd_dmaBufferOutput[i] = 0x7fff;
-				else if (val < (sint16)0x8000)
-					snd_dmaBufferOutput[i] = (sint16)0x8000;
-				else
-					snd_dmaBufferOutput[i] = val;
-
-				val = snd_dmaMixPointer[i+1]>>8;
-				if (val > 0x7fff)
-					snd_dmaBufferOutput[i+1] = 0x7fff;
-				else if (val < (sint16)0x8000)
-					snd_dmaBufferOutput[i+1] = (sint16)0x8000;
-				else
-					snd_dmaBufferOutput[i+1] = val;
-			}
+			DMASnd_ClipSamples ((sint16 *)snd_audioDMA.buffer + (pos<<1), mix, count<<1);
 
-			snd_dmaMixPointer += snd_dmaLinearCount;
-			paintedTime += (snd_dmaLinearCount>>1);
+			mix += count<<1;
+			paintedTime += count;
 		}
 	}
 	else {
-		int		outMask;
-		int		outIndex;
-		int		step;
-		int		*p;
+		const float	*p;
+		int			outMask;
+		int			outIndex;
+		int			step;
 
 		// General case
-		p = (int *) snd_dmaPaintBuffer;
-		count = (endTime - snd_dmaPaintedTime) * snd_audioDMA.channels;
-		outMask = snd_audioDMA.samples - 1; 
-		outIndex = snd_dmaPaintedTime * snd_audioDMA.channels & outMask;
+		p = &snd_dmaPaintBuffer[0].left;
+		count = (endTime - snd_mixPaintedTime) * snd_audioDMA.channels;
+		outMask = snd_audioDMA.samples - 1;
+		outIndex = snd_mixPaintedTime * snd_audioDMA.channels & outMask;
 		step = 3 - snd_audioDMA.channels;
 
 		if (snd_audioDMA.sampleBits == 16) {
-			sint16 *out = (sint16 *) pbuf;
+			sint16 *out = (sint16 *) snd_audioDMA.buffer;
 			while (count--) {
-				val = *p >> 8;
+				out[outIndex] = DMASnd_ClipSample (*p);
 				p += step;
-
-				if (val > 0x7fff)
-					val = 0x7fff;
-				else if (val < (sint16)0x8000)
-					val = (sint16)0x8000;
-				out[outIndex] = val;
 				outIndex = (outIndex + 1) & outMask;
 			}
 		}
 		else if (snd_audioDMA.sampleBits == 8) {
-			byte	*out = (byte *) pbuf;
+			byte	*out = (byte *) snd_audioDMA.buffer;
 			while (count--) {
-				val = *p >> 8;
+				out[outIndex] = (DMASnd_ClipSample (*p)>>8) + 128;
 				p += step;
-
-				if (val > 0x7fff)
-					val = 0x7fff;
-				else if (val < (sint16)0x8000)
-					val = (sint16)0x8000;
-				out[outIndex] = (val>>8) + 128;
 				outIndex = (outIndex + 1) & outMask;
 			}
 		}
@@ -627,95 +1139,32 @@ static void DMASnd_TransferPaintBuffer (int endTime)
 DMASnd_PaintChannels
 ================
 */
-static void DMASnd_PaintChannels (int endTime, float volume)
+static void DMASnd_PaintChannels (int endTime)
 {
-	channel_t	*ch;
-	sfxCache_t	*sc;
-	int			lTime, count;
+	const float	volume = snd_mixSettings.volume;
+	int			numVoices;
 	int			newEnd, i;
 
-	while (snd_dmaPaintedTime < endTime) {
+	while (snd_mixPaintedTime < endTime) {
 		// If snd_dmaPaintBuffer is smaller than DMA buffer
 		newEnd = endTime;
-		if (endTime - snd_dmaPaintedTime > SND_PBUFFER)
-			newEnd = snd_dmaPaintedTime + SND_PBUFFER;
+		if (endTime - snd_mixPaintedTime > SND_PBUFFER)
+			newEnd = snd_mixPaintedTime + SND_PBUFFER;
 
-		// Start any playsounds
-		DMASnd_IssuePlaysounds (newEnd);
-
-		// Clear the paint buffer
-		if (snd_dmaRawEnd < snd_dmaPaintedTime) {
-			memset (snd_dmaPaintBuffer, 0, (newEnd - snd_dmaPaintedTime) * sizeof(sfxSamplePair_t));
-		}
-		else {
-			// Copy from the streaming sound source
-			int		stop, s;
-
-			stop = (newEnd < snd_dmaRawEnd) ? newEnd : snd_dmaRawEnd;
-
-			for (i=snd_dmaPaintedTime ; i<stop ; i++) {
-				s = i & (MAX_RAW_SAMPLES-1);
-				snd_dmaPaintBuffer[i-snd_dmaPaintedTime].left = snd_dmaRawSamples[s].left * volume;
-				snd_dmaPaintBuffer[i-snd_dmaPaintedTime].right = snd_dmaRawSamples[s].right * volume;
-			}
-
-			for ( ; i<newEnd ; i++) {
-				snd_dmaPaintBuffer[i-snd_dmaPaintedTime].left = 0;
-				snd_dmaPaintBuffer[i-snd_dmaPaintedTime].right = 0;
-			}
-		}
+		// Clear the paint buffer, then mix in the streamed sources
+		memset (snd_dmaPaintBuffer, 0, (newEnd - snd_mixPaintedTime) * sizeof(sfxMixPair_t));
+		Snd_StreamRead (snd_dmaRawStream, snd_dmaPaintBuffer, newEnd - snd_mixPaintedTime, volume);
+		if (snd_mixFileStream)
+			Snd_StreamRead (snd_mixFileStream, snd_dmaPaintBuffer, newEnd - snd_mixPaintedTime, volume);
 
 		// Paint in the channels
-		for (i=0, ch=snd_dmaOutChannels ; i<MAX_CHANNELS ; ch++, i++) {
-			lTime = snd_dmaPaintedTime;
-		
-			while (lTime < newEnd) {
-				if (!ch->sfx || (!ch->leftVol && !ch->rightVol))
-					break;
-
-				// Max painting is to the end of the buffer
-				count = newEnd - lTime;
-
-				// Might be stopped by running out of data
-				if (ch->endTime - lTime < count)
-					count = ch->endTime - lTime;
-		
-				sc = Snd_LoadSound (ch->sfx);
-				if (!sc)
-					break;
-
-				if (count > 0 && ch->sfx) {	
-					if (sc->width == 1)
-						DMASnd_PaintChannelFrom8 (ch, sc, count, lTime - snd_dmaPaintedTime);
-					else
-						DMASnd_PaintChannelFrom16 (ch, sc, count, lTime - snd_dmaPaintedTime, volume);
-	
-					lTime += count;
-				}
-
-				// If at end of loop, restart
-				if (lTime >= ch->endTime) {
-					if (ch->autoSound) {
-						// Autolooping sounds always go back to start
-						ch->position = 0;
-						ch->endTime = lTime + sc->length;
-					}
-					else if (sc->loopStart >= 0) {
-						ch->position = sc->loopStart;
-						ch->endTime = lTime + sc->length - ch->position;
-					}
-					else {
-						// Channel just stopped
-						ch->sfx = NULL;
-					}
-				}
-			}
-															  
-		}
+		numVoices = DMASnd_GatherVoices (volume);
+		for (i=0 ; i<numVoices ; i++)
+			DMASnd_PaintVoice (&snd_dmaVoices[i], newEnd, volume);
 
 		// Transfer out according to DMA format
 		DMASnd_TransferPaintBuffer (newEnd);
-		snd_dmaPaintedTime = newEnd;
+		snd_mixPaintedTime = newEnd;
 	}
 }
 
@@ -729,85 +1178,298 @@ Cinematic streaming and voice over network
 */
 void DMASnd_RawSamples (int samples, int rate, int width, int channels, byte *data)
 {
-	int		i;
-	int		src, dst;
-	float	scale;
-
-	if (snd_dmaRawEnd < snd_dmaPaintedTime)
-		snd_dmaRawEnd = snd_dmaPaintedTime;
-	scale = (float)rate / snd_audioDMA.speed;
-
-	switch (channels) {
-	case 1:
-		switch (width) {
-		case 1:
-			for (i=0 ; ; i++) {
-				src = i*scale;
-				if (src >= samples)
-					break;
-				dst = snd_dmaRawEnd & (MAX_RAW_SAMPLES-1);
-				snd_dmaRawEnd++;
-				snd_dmaRawSamples[dst].left = (((byte *)data)[src]-128) << 16;
-				snd_dmaRawSamples[dst].right = (((byte *)data)[src]-128) << 16;
-			}
+	// Without an audio thread the mixer can't make room while we wait
+	Snd_StreamWrite (snd_dmaRawStream, data, samples, rate, width, channels, snd_mixThread ? SND_RAW_WAIT_MS : 0);
+}
+
+
+/*
+============
+DMASnd_RawStop
+
+The cinematic is done, the raw stream running dry now isn't a gap.
+============
+*/
+void DMASnd_RawStop ()
+{
+	Snd_StreamEnd (snd_dmaRawStream);
+}
+
+
+/*
+============
+DMASnd_StreamFile
+
+Plays a WAV file as it's read, in place of any other.
+============
+*/
+bool DMASnd_StreamFile (char *name, const bool bLoop)
+{
+	sndStream_t	*stream;
+
+	DMASnd_StopStream ();
+
+	stream = Snd_OpenFileStream (name, snd_audioDMA.speed, bLoop);
+	if (!stream)
+		return false;
+
+	DMASnd_NewCommand (SNDCMD_STREAM)->stream = stream;
+	DMASnd_CommitCommands ();
+
+	snd_dmaFileStream = stream;
+	return true;
+}
+
+
+/*
+============
+DMASnd_StopStream
+============
+*/
+void DMASnd_StopStream ()
+{
+	if (!snd_dmaFileStream)
+		return;
+
+	// Closed once the mixer has let go of it
+	DMASnd_NewCommand (SNDCMD_STREAM)->stream = NULL;
+	DMASnd_Sync ();
+
+	Snd_CloseStream (snd_dmaFileStream);
+	snd_dmaFileStream = NULL;
+}
+
+
+/*
+===============================================================================
+
+	MIXER
+
+	Runs on the audio thread, or from DMASnd_Update on the game thread when
+	s_mixThread is off or the thread could not be started. Only the mixer
+	touches the mixer channels, the paint buffer and the DMA buffer.
+
+===============================================================================
+*/
+
+/*
+=================
+DMASnd_RunCommands
+
+Applies everything the game thread has published.
+=================
+*/
+static void DMASnd_RunCommands ()
+{
+	const sndCommand_t	*cmd;
+	mixChannel_t		*ch;
+	long				read, write;
+
+	// Full barrier, the commands are read after the index
+	write = Sys_AtomicAdd (&snd_cmdWrite, 0);
+	for (read=snd_cmdRead ; read != write ; read++) {
+		cmd = &snd_cmdQueue[read & (SND_MAX_COMMANDS-1)];
+
+		switch (cmd->type) {
+		case SNDCMD_START:
+			ch = &snd_mixChannels[cmd->chanNum];
+			ch->sc = cmd->sc;
+			ch->leftVol = cmd->leftVol;
+			ch->rightVol = cmd->rightVol;
+			ch->autoSound = cmd->autoSound;
+			ch->bPlayer = cmd->bPlayer;
+
+			// Autosounds are restarted every frame, keep them in phase with the paint time
+			ch->position = ch->autoSound ? snd_mixPaintedTime % ch->sc->length : 0;
+			ch->endTime = snd_mixPaintedTime + ch->sc->length - ch->position;
 			break;
 
-		case 2:
-			for (i=0 ; ; i++) {
-				src = i*scale;
-				if (src >= samples)
-					break;
-				dst = snd_dmaRawEnd & (MAX_RAW_SAMPLES-1);
-				snd_dmaRawEnd++;
-				snd_dmaRawSamples[dst].left = LittleShort(((sint16 *)data)[src]) << 8;
-				snd_dmaRawSamples[dst].right = LittleShort(((sint16 *)data)[src]) << 8;
-			}
+		case SNDCMD_STOP:
+			snd_mixChannels[cmd->chanNum].sc = NULL;
 			break;
-		}
-		break;
 
-	case 2:
-		switch (width) {
-		case 1:
-			for (i=0 ; ; i++) {
-				src = i*scale;
-				if (src >= samples)
-					break;
-				dst = snd_dmaRawEnd & (MAX_RAW_SAMPLES-1);
-				snd_dmaRawEnd++;
-				snd_dmaRawSamples[dst].left = ((char *)data)[src*2] << 16;
-				snd_dmaRawSamples[dst].right = ((char *)data)[src*2+1] << 16;
-			}
+		case SNDCMD_SPATIALIZE:
+			ch = &snd_mixChannels[cmd->chanNum];
+			ch->leftVol = cmd->leftVol;
+			ch->rightVol = cmd->rightVol;
 			break;
 
-		case 2:
-			if (scale == 1.0) {
-				for (i=0 ; i<samples ; i++) {
-					dst = snd_dmaRawEnd & (MAX_RAW_SAMPLES-1);
-					snd_dmaRawEnd++;
-					snd_dmaRawSamples[dst].left = LittleShort(((sint16 *)data)[i*2]) << 8;
-					snd_dmaRawSamples[dst].right = LittleShort(((sint16 *)data)[i*2+1]) << 8;
-				}
-			}
-			else {
-				for (i=0 ; ; i++) {
-					src = i*scale;
-					if (src >= samples)
-						break;
-
-					dst = snd_dmaRawEnd & (MAX_RAW_SAMPLES-1);
-					snd_dmaRawEnd++;
-					snd_dmaRawSamples[dst].left = LittleShort(((sint16 *)data)[src*2]) << 8;
-					snd_dmaRawSamples[dst].right = LittleShort(((sint16 *)data)[src*2+1]) << 8;
-				}
-			}
+		case SNDCMD_STOPALL:
+			memset (snd_mixChannels, 0, sizeof(snd_mixChannels));
+			Snd_StreamFlush (snd_dmaRawStream);
+			DMASnd_ClearBuffer ();
+			break;
+
+		case SNDCMD_SETTINGS:
+			snd_mixSettings = cmd->settings;
+			break;
+
+		case SNDCMD_SYNC:
+			if (snd_mixThread)
+				Sys_SemaphorePost (snd_mixSync);
+			break;
+
+		case SNDCMD_STREAM:
+			snd_mixFileStream = cmd->stream;
+			break;
+
+		case SNDCMD_RESETSTATS:
+			memset (&snd_mixStats, 0, sizeof(snd_mixStats));
+			snd_mixStats.minQueued = -1;
 			break;
 		}
-		break;
 	}
+
+	Sys_AtomicAdd (&snd_cmdRead, write - snd_cmdRead);
 }
 
 
+/*
+=================
+DMASnd_MixAhead
+
+One mixer pass: applies the queued commands, then paints from the play
+cursor up to s_mixahead ahead of it.
+=================
+*/
+static void DMASnd_MixAhead ()
+{
+	uint32		startCycles;
+	int			endTime, samples;
+	int			samplePos, fullSamples;
+	int			queued;
+	double		mixMS;
+
+	startCycles = Sys_Cycles ();
+	DMASnd_RunCommands ();
+
+	SndImp_BeginPainting ();
+	if (!snd_audioDMA.buffer) {
+		snd_mixStats.noBuffer++;
+		return;
+	}
+
+	// Update DMA time
+	fullSamples = snd_audioDMA.samples / snd_audioDMA.channels;
+
+	/*
+	** It is possible to miscount buffers if it has wrapped twice between
+	** passes. Oh well
+	*/
+	samplePos = SndImp_GetDMAPos ();
+	if (samplePos < snd_mixOldSamplePos) {
+		snd_mixBuffers++;	// Buffer wrapped
+
+		if (snd_mixPaintedTime > 0x40000000) {
+			// Time to chop things off to avoid 32 bit limits, the game thread drops its channels on the new epoch
+			snd_mixBuffers = 0;
+			snd_mixPaintedTime = fullSamples;
+			memset (snd_mixChannels, 0, sizeof(snd_mixChannels));
+			Sys_AtomicAdd (&snd_mixEpoch, 1);
+		}
+	}
+
+	snd_mixOldSamplePos = samplePos;
+	snd_mixSoundTime = snd_mixBuffers*fullSamples + samplePos/snd_audioDMA.channels;
+
+	// Check to make sure that the play cursor hasn't overtaken the mix
+	queued = snd_mixPaintedTime - snd_mixSoundTime;
+	if (queued < 0) {
+		if (snd_mixStats.passes) {
+			snd_mixStats.underruns++;
+			snd_mixStats.underrunSamples -= queued;
+		}
+		snd_mixPaintedTime = snd_mixSoundTime;
+		queued = 0;
+	}
+	if (snd_mixStats.minQueued < 0 || queued < snd_mixStats.minQueued)
+		snd_mixStats.minQueued = queued;
+	snd_mixStats.queuedTotal += queued;
+
+	// Mix ahead of current position
+	endTime = snd_mixSoundTime + snd_mixSettings.mixAhead;
+
+	// Mix to an even submission block size
+	endTime = (endTime + snd_audioDMA.submissionChunk-1) & ~(snd_audioDMA.submissionChunk-1);
+	samples = snd_audioDMA.samples >> (snd_audioDMA.channels-1);
+	if (endTime - snd_mixSoundTime > samples)
+		endTime = snd_mixSoundTime + samples;
+
+	DMASnd_PaintChannels (endTime);
+	SndImp_Submit ();
+
+	mixMS = (Sys_Cycles () - startCycles) * Sys_MSPerCycle ();
+	snd_mixStats.passes++;
+	snd_mixStats.mixMS += mixMS;
+	if (mixMS > snd_mixStats.maxMixMS)
+		snd_mixStats.maxMixMS = mixMS;
+}
+
+
+/*
+=================
+DMASnd_LockDevice / DMASnd_UnlockDevice
+
+Held by the audio thread around each pass, and by the platform code while
+it recreates the device buffers.
+=================
+*/
+void DMASnd_LockDevice ()
+{
+	if (snd_deviceLock)
+		Sys_SemaphoreWait (snd_deviceLock);
+}
+
+void DMASnd_UnlockDevice ()
+{
+	if (snd_deviceLock)
+		Sys_SemaphorePost (snd_deviceLock);
+}
+
+
+/*
+=================
+DMASnd_MixThread
+=================
+*/
+static void DMASnd_MixThread (void *arg)
+{
+	while (!snd_mixQuit) {
+		DMASnd_LockDevice ();
+		DMASnd_MixAhead ();
+		DMASnd_UnlockDevice ();
+
+		Sys_Sleep (snd_mixSettings.sleepMS);
+	}
+}
+
+
+/*
+=================
+DMASnd_Sync
+
+Publishes everything staged and returns once the mixer has applied it.
+=================
+*/
+static void DMASnd_Sync ()
+{
+	DMASnd_NewCommand (SNDCMD_SYNC);
+	DMASnd_CommitCommands ();
+
+	if (snd_mixThread)
+		Sys_SemaphoreWait (snd_mixSync);
+	else
+		DMASnd_RunCommands ();
+}
+
+/*
+===============================================================================
+
+	UPDATE
+
+===============================================================================
+*/
+
 /*
 ============
 DMASnd_Update
@@ -818,13 +1480,9 @@ Called once each time through the main loop
 void DMASnd_Update (refDef_t *rd)
 {
 	int			total, i;
-	uint32		endTime, samples;
+	int			oldLeft, oldRight;
 	channel_t	*ch;
-	int			samplePos;
-	static int	oldSamplePos;
-	static int	buffers;
-	int			fullSamples;
-	float		tempVol;
+	sfxCache_t	*sc;
 
 	if (rd)
 	{
@@ -837,23 +1495,19 @@ void DMASnd_Update (refDef_t *rd)
 		Vec3Clear (snd_dmaRightVec);
 	}
 
-	// Don't play sounds while the screen is disabled
-	if (cls.disableScreen || !snd_isActive || s_volume->floatVal == 0.0f)
+	// Catch up with the mixer, whose channels are gone if it chopped its time back
+	if (snd_dmaEpoch != snd_mixEpoch)
 	{
-		DMASnd_ClearBuffer ();
-		tempVol = 0.0f;
+		snd_dmaEpoch = snd_mixEpoch;
+		memset (snd_dmaOutChannels, 0, sizeof(snd_dmaOutChannels));
 	}
-	else
-	{
-		tempVol = s_volume->floatVal;
+	snd_dmaPaintedTime = snd_mixPaintedTime;
 
-		// Rebuild scale tables if volume is modified
-		if (s_volume->modified)
-		{
-			s_volume->modified = false;
-			DMASnd_ScaleTableInit (s_volume->floatVal);
-		}
-	}
+	DMASnd_PostSettings ();
+
+	// Let go of a stream that has played out
+	if (snd_dmaFileStream && Snd_StreamFinished (snd_dmaFileStream))
+		DMASnd_StopStream ();
 
 	// Update spatialization for dynamic sounds
 	for (i=0, ch=snd_dmaOutChannels ; i<MAX_CHANNELS ; ch++, i++)
@@ -864,19 +1518,43 @@ void DMASnd_Update (refDef_t *rd)
 		if (ch->autoSound)
 		{
 			// Autosounds are regenerated fresh each frame
+			DMASnd_PostStop (ch);
 			memset (ch, 0, sizeof(channel_t));
 			continue;
 		}
 
+		// Follow the mixer through the end of the sound, or its loops
+		if (ch->endTime <= snd_dmaPaintedTime)
+		{
+			sc = ch->sfx->cache;
+			if (!sc || sc->loopStart < 0 || sc->loopStart >= sc->length)
+			{
+				memset (ch, 0, sizeof(channel_t));
+				continue;
+			}
+
+			while (ch->endTime <= snd_dmaPaintedTime)
+				ch->endTime += sc->length - sc->loopStart;
+		}
+
 		// Respatialize channel
+		oldLeft = ch->leftVol;
+		oldRight = ch->rightVol;
 		DMASnd_SpatializeChannel (ch);
 		if (!ch->leftVol && !ch->rightVol)
 		{
+			DMASnd_PostStop (ch);
 			memset (ch, 0, sizeof(channel_t));
 			continue;
 		}
+
+		if (ch->leftVol != oldLeft || ch->rightVol != oldRight)
+			DMASnd_PostSpatialize (ch);
 	}
 
+	// Start any playsounds
+	DMASnd_IssuePlaysounds ();
+
 	// Add loopsounds
 	DMASnd_AddLoopSounds ();
 
@@ -893,58 +1571,672 @@ void DMASnd_Update (refDef_t *rd)
 			}
 		}
 
-		Com_Printf (0, "----(%i)---- painted: %i\n", total, snd_dmaPaintedTime);
+		Com_Printf (0, "----(%i)---- painted: %i mixed: %i virtual: %i\n", total, snd_dmaPaintedTime, snd_mixStats.numMixed, snd_mixStats.numVirtual);
 	}
 
-	// Mix some sound
-	SndImp_BeginPainting ();
-	if (snd_audioDMA.buffer)
+	// Hand the frame over to the mixer
+	DMASnd_CommitCommands ();
+	if (!snd_mixThread)
+		DMASnd_MixAhead ();
+
+	if (snd_dmaUnderruns != snd_mixStats.underruns)
 	{
-		// Update DMA time
-		fullSamples = snd_audioDMA.samples / snd_audioDMA.channels;
-
-		/*
-		** It is possible to miscount buffers if it has wrapped twice between
-		** calls to Snd_Update. Oh well
-		*/
-		samplePos = SndImp_GetDMAPos ();
-		if (samplePos < oldSamplePos)
-		{
-			buffers++;	// Buffer wrapped
-			
-			if (snd_dmaPaintedTime > 0x40000000)
-			{
-				// Time to chop things off to avoid 32 bit limits
-				buffers = 0;
-				snd_dmaPaintedTime = fullSamples;
-				DMASnd_StopAllSounds ();
+		snd_dmaUnderruns = snd_mixStats.underruns;
+		Com_DevPrintf (PRNT_WARNING, "Snd_Update: underrun (%u so far)\n", snd_dmaUnderruns);
+	}
+}
+
+/*
+===============================================================================
+
+	MIXER STATS
+
+===============================================================================
+*/
+
+/*
+================
+DMASnd_MixStats_f
+================
+*/
+static void DMASnd_MixStats_f ()
+{
+	const mixStats_t	&stats = snd_mixStats;
+	const double		msPerSample = 1000.0 / snd_audioDMA.speed;
+
+	// The mixer clears its own on its next pass
+	if (Cmd_Argc () > 1 && !Q_stricmp (Cmd_Argv (1), "reset"))
+	{
+		DMASnd_NewCommand (SNDCMD_RESETSTATS);
+		DMASnd_CommitCommands ();
+		snd_cmdMaxWaiting = 0;
+		snd_dmaUnderruns = 0;
+		return;
+	}
+
+	Com_Printf (0, "Mixing on the %s thread, %.1fms ahead (s_mixahead), %u passes\n", snd_mixThread ? "audio" : "game", snd_dmaSettings.mixAhead * msPerSample, stats.passes);
+	if (!stats.passes)
+		return;
+
+	Com_Printf (0, "pass time: %.3fms avg, %.3fms max\n", stats.mixMS / stats.passes, stats.maxMixMS);
+	Com_Printf (0, "queued before a pass: %.1fms avg, %.1fms min\n", stats.queuedTotal / stats.passes * msPerSample, stats.minQueued * msPerSample);
+	Com_Printf (0, "underruns: %u, %.1fms of audio\n", stats.underruns, stats.underrunSamples * msPerSample);
+	Com_Printf (0, "voices: %i mixed, %i virtual\n", stats.numMixed, stats.numVirtual);
+	Com_Printf (0, "commands: at most %i of %i queued\n", snd_cmdMaxWaiting, SND_MAX_COMMANDS);
+	if (stats.noBuffer)
+		Com_Printf (0, "passes without a buffer: %u\n", stats.noBuffer);
+
+	// Streams count their own, the producer side isn't the mixer's to reset
+	if (snd_dmaRawStream) {
+		uint32	underruns, blocked, dropped;
+
+		Snd_StreamStats (snd_dmaRawStream, underruns, blocked, dropped);
+		Com_Printf (0, "raw stream: %u gaps, %u producer waits, %u pairs dropped\n", underruns, blocked, dropped);
+		if (snd_dmaFileStream) {
+			Snd_StreamStats (snd_dmaFileStream, underruns, blocked, dropped);
+			Com_Printf (0, "file stream: %u gaps, %u producer waits\n", underruns, blocked);
+		}
+	}
+}
+
+/*
+==============================================================================
+
+	MIXER BENCH
+
+==============================================================================
+*/
+
+/*
+================
+DMASnd_BenchPass
+
+Mixes the first numMixed voices over numSamples pairs in paint buffer sized
+blocks and clips them to out, advancing the rest without mixing.
+================
+*/
+static double DMASnd_BenchMS (const uint32 startCycles)
+{
+	return (Sys_Cycles() - startCycles) * Sys_MSPerCycle();
+}
+
+static void DMASnd_BenchPass (mixChannel_t *channels, const int numVoices, const int numMixed, sfxMixPair_t *mix, sint16 *out, const int numSamples, double &mixMS, double &clipMS)
+{
+	int		count, painted, n;
+	int		done, v;
+	uint32	start;
+
+	mixMS = clipMS = 0;
+	for (v=0 ; v<numVoices ; v++)
+		channels[v].position = (v * 997) % channels[v].sc->length;
+
+	for (done=0 ; done<numSamples ; done+=count) {
+		count = numSamples - done;
+		if (count > SND_PBUFFER)
+			count = SND_PBUFFER;
+		memset (mix, 0, count * sizeof(sfxMixPair_t));
+
+		start = Sys_Cycles ();
+		for (v=0 ; v<numVoices ; v++) {
+			mixChannel_t *ch = &channels[v];
+			sfxCache_t *sc = ch->sc;
+
+			for (painted=0 ; painted<count ; painted+=n) {
+				n = count - painted;
+				if (n > sc->length - ch->position)
+					n = sc->length - ch->position;
+
+				if (v < numMixed)
+					DMASnd_MixVoice (&mix[painted].left, ch, n, 0.7f);
+
+				ch->position += n;
+				if (ch->position >= sc->length)
+					ch->position = 0;
 			}
 		}
+		mixMS += DMASnd_BenchMS (start);
 
-		oldSamplePos = samplePos;
-		snd_dmaSoundTime = buffers*fullSamples + samplePos/snd_audioDMA.channels;
+		start = Sys_Cycles ();
+		DMASnd_ClipSamples (out + done*2, &mix[0].left, count*2);
+		clipMS += DMASnd_BenchMS (start);
+	}
+}
 
-		// Check to make sure that we haven't overshot
-		if (snd_dmaPaintedTime < snd_dmaSoundTime)
-		{
-			Com_DevPrintf (PRNT_WARNING, "Snd_Update: overflow\n");
-			snd_dmaPaintedTime = snd_dmaSoundTime;
+
+/*
+================
+DMASnd_MixBench_f
+
+Mixes synthetic voices for a number of seconds of output with and without
+SSE2, then again within the s_maxVoices budget, and checks that both paths
+give the same samples.
+================
+*/
+static void DMASnd_MixBench_f ()
+{
+	const int numVoices = (Cmd_Argc () > 1) ? clamp (atoi (Cmd_Argv (1)), 1, MAX_CHANNELS) : 64;
+	const float seconds = (Cmd_Argc () > 2) ? (float)max (atof (Cmd_Argv (2)), 0.1) : 10.0f;
+	const int rate = snd_audioDMA.speed ? snd_audioDMA.speed : 22050;
+	const int numSamples = (int)(rate * seconds);
+	const int budget = min (clamp (s_maxVoices->intVal, 1, MAX_CHANNELS), numVoices);
+	int		v, i;
+
+	// A second of noise per voice, every fourth one 8-bit, at varied gains
+	mixChannel_t *channels = (mixChannel_t *)Mem_PoolAlloc (sizeof(mixChannel_t) * numVoices, cl_soundSysPool, 0);
+	uint32 seed = 0x1234567;
+	for (v=0 ; v<numVoices ; v++) {
+		const int width = ((v & 3) == 3) ? 1 : 2;
+		sfxCache_t *sc = channels[v].sc = (sfxCache_t *)Mem_PoolAlloc (sizeof(sfxCache_t) + rate * width, cl_soundSysPool, 0);
+		sc->length = rate;
+		sc->loopStart = 0;
+		sc->speed = rate;
+		sc->width = width;
+		for (i=0 ; i<rate*width ; i++) {
+			seed = seed * 1664525 + 1013904223;
+			sc->data[i] = (byte)(seed >> 24);
+		}
+
+		channels[v].leftVol = (v * 37 + 16) & 255;
+		channels[v].rightVol = (v * 91 + 64) & 255;
+	}
+
+	sfxMixPair_t *mix = (sfxMixPair_t *)Mem_PoolAlloc (sizeof(sfxMixPair_t) * SND_PBUFFER, cl_soundSysPool, 0);
+	sint16 *out[2];
+	out[0] = (sint16 *)Mem_PoolAlloc (sizeof(sint16) * numSamples * 2, cl_soundSysPool, 0);
+	out[1] = (sint16 *)Mem_PoolAlloc (sizeof(sint16) * numSamples * 2, cl_soundSysPool, 0);
+
+	const bool bHadSSE2 = snd_dmaSSE2;
+	if (!bHadSSE2)
+		Com_Printf (0, "SSE2 is not available, both columns are scalar\n");
+
+	double mixMS[2], clipMS[2];
+	for (int sse=0 ; sse<2 ; sse++) {
+		snd_dmaSSE2 = sse ? bHadSSE2 : false;
+		DMASnd_BenchPass (channels, numVoices, numVoices, mix, out[sse], numSamples, mixMS[sse], clipMS[sse]);
+	}
+
+	int numDiffer = 0, maxDiff = 0;
+	for (i=0 ; i<numSamples*2 ; i++) {
+		const int diff = abs (out[0][i] - out[1][i]);
+		if (diff) {
+			numDiffer++;
+			maxDiff = max (maxDiff, diff);
+		}
+	}
+
+	// Only as many voices as the budget allows, the rest advance as virtual
+	double budgetMixMS, budgetClipMS;
+	DMASnd_BenchPass (channels, numVoices, budget, mix, out[0], numSamples, budgetMixMS, budgetClipMS);
+	snd_dmaSSE2 = bHadSSE2;
+
+	Com_Printf (0, "Mixing %i voices for %.1fs at %iHz (ms, scalar/SSE2):\n", numVoices, seconds, rate);
+	Com_Printf (0, "mix   %8.2f/%-8.2f\n", mixMS[0], mixMS[1]);
+	Com_Printf (0, "clip  %8.2f/%-8.2f\n", clipMS[0], clipMS[1]);
+	Com_Printf (0, "budget of %i voices: %.2f mix, %.2f clip\n", budget, budgetMixMS, budgetClipMS);
+	Com_Printf (0, "%.2f%% of realtime, exact: ", (mixMS[1] + clipMS[1]) / (seconds * 10.0f));
+	if (numDiffer)
+		Com_Printf (0, "NO (%i samples off by up to %i)\n", numDiffer, maxDiff);
+	else
+		Com_Printf (0, "yes\n");
+
+	Mem_Free (out[1]);
+	Mem_Free (out[0]);
+	Mem_Free (mix);
+	for (v=0 ; v<numVoices ; v++)
+		Mem_Free (channels[v].sc);
+	Mem_Free (channels);
+}
+
+/*
+==============================================================================
+
+	STREAM TEST
+
+==============================================================================
+*/
+
+#define STREAMTEST_FILE		"streamtest.wav"
+#define STREAMTEST_PAKFILE	"sound/misc/talk.wav"	// in pak0.pak
+#define STREAMTEST_BLOCK	1024		// pairs painted at a time
+#define STREAMTEST_SINK		4096		// pairs in the memory device, a power of two
+
+struct streamTest_t {
+	const char		*label;
+	const float		*ref;			// the source, as stereo frames
+	int				numFrames;
+	double			step;			// source frames per output pair
+	bool			bLoop;
+	int				numPairs;		// output expected
+	float			tolerance;		// after clipping
+
+	int				received;
+	int				mismatches;
+	int				firstMismatch;
+	float			maxError;
+};
+
+// The mixer's state while the test has it
+struct streamTestSave_t {
+	audioDMA_t		dma;
+	mixChannel_t	channels[MAX_CHANNELS];
+	mixSettings_t	settings;
+	long			paintedTime;
+	sndStream_t		*rawStream;
+};
+
+static sint16			snd_testSink[STREAMTEST_SINK*2];
+
+/*
+================
+DMASnd_StreamTestPattern
+
+Left counts up and right counts down, wrapping every 32768 frames.
+================
+*/
+static inline sint16 DMASnd_StreamTestPattern (const int frame)
+{
+	return (sint16)((frame & 32767) - 16384);
+}
+
+
+/*
+================
+DMASnd_WriteStreamTestFile
+================
+*/
+static bool DMASnd_WriteStreamTestFile (const int rate, const int numFrames)
+{
+	fileHandle_t	fileNum;
+	sint16			block[1024*2];
+	byte			header[44];
+	int				i, n, v;
+
+	FS_OpenFile (STREAMTEST_FILE, &fileNum, FS_MODE_WRITE_BINARY);
+	if (!fileNum)
+		return false;
+
+	memset (header, 0, sizeof(header));
+	memcpy (header, "RIFF", 4);
+	*(int *)(header+4) = LittleLong (36 + numFrames*4);
+	memcpy (header+8, "WAVEfmt ", 8);
+	*(int *)(header+16) = LittleLong (16);
+	*(sint16 *)(header+20) = LittleShort (1);			// PCM
+	*(sint16 *)(header+22) = LittleShort (2);			// channels
+	*(int *)(header+24) = LittleLong (rate);
+	*(int *)(header+28) = LittleLong (rate*4);			// bytes per second
+	*(sint16 *)(header+32) = LittleShort (4);			// block align
+	*(sint16 *)(header+34) = LittleShort (16);			// bits
+	memcpy (header+36, "data", 4);
+	*(int *)(header+40) = LittleLong (numFrames*4);
+	FS_Write (header, sizeof(header), fileNum);
+
+	for (i=0 ; i<numFrames ; i+=n) {
+		n = min (numFrames - i, 1024);
+		for (v=0 ; v<n ; v++) {
+			block[v*2] = LittleShort (DMASnd_StreamTestPattern (i+v));
+			block[v*2+1] = LittleShort (-1 - DMASnd_StreamTestPattern (i+v));
+		}
+		FS_Write (block, n*4, fileNum);
+	}
+
+	FS_CloseFile (fileNum);
+	return true;
+}
+
+
+/*
+================
+DMASnd_LoadStreamTestRef
+
+Loads a WAV whole and decodes it to stereo frames, to check the stream of
+it against.
+================
+*/
+static float *DMASnd_LoadStreamTestRef (char *name, int &numFrames, int &rate)
+{
+	wavInfo_t	info;
+	byte		*buffer, *data;
+	float		*ref;
+	int			fileLen, frameSize;
+	int			i, c, sample;
+
+	fileLen = FS_LoadFile (name, (void **)&buffer, false);
+	if (!buffer)
+		return NULL;
+
+	info = Snd_GetWavinfo (name, buffer, fileLen);
+	if (!info.rate || (info.width != 1 && info.width != 2) || (info.channels != 1 && info.channels != 2) || info.dataOfs <= 0 || info.dataOfs > fileLen) {
+		FS_FreeFile (buffer);
+		return NULL;
+	}
+
+	frameSize = info.width * info.channels;
+	numFrames = min (info.samples * info.width, fileLen - info.dataOfs) / frameSize;
+	rate = info.rate;
+	data = buffer + info.dataOfs;
+
+	ref = (float *)Mem_PoolAlloc (sizeof(float) * max (numFrames, 1) * 2, cl_soundSysPool, 0);
+	for (i=0 ; i<numFrames ; i++) {
+		for (c=0 ; c<2 ; c++) {
+			const int index = i * info.channels + (info.channels == 2 ? c : 0);
+			if (info.width == 2)
+				sample = LittleShort (((sint16 *)data)[index]);
+			else
+				sample = ((int)data[index] - 128) << 8;
+			ref[i*2+c] = (float)sample;
 		}
+	}
+
+	FS_FreeFile (buffer);
+	return ref;
+}
+
+
+/*
+================
+DMASnd_BeginStreamTest
+
+Takes the mixer off the device and points it at the memory sink, with no
+channels or file stream playing and an empty raw stream of its own.
+================
+*/
+static void DMASnd_BeginStreamTest (streamTestSave_t &save)
+{
+	DMASnd_LockDevice ();
+
+	// What's queued belongs to the real mix, and the device plays silence meanwhile
+	DMASnd_RunCommands ();
+	DMASnd_ClearBuffer ();
+
+	save.dma = snd_audioDMA;
+	memcpy (save.channels, snd_mixChannels, sizeof(save.channels));
+	save.settings = snd_mixSettings;
+	save.paintedTime = snd_mixPaintedTime;
+	save.rawStream = snd_dmaRawStream;
+
+	memset (snd_mixChannels, 0, sizeof(snd_mixChannels));
+	snd_mixSettings.volume = 1.0f;
+	snd_mixSettings.testSound = false;
+	snd_mixPaintedTime = 0;
+	snd_dmaRawStream = Snd_OpenStream (snd_audioDMA.speed);
+
+	DMASnd_NewCommand (SNDCMD_STREAM)->stream = NULL;
+	DMASnd_CommitCommands ();
+	DMASnd_RunCommands ();
+
+	snd_audioDMA.buffer = (byte *)snd_testSink;
+	snd_audioDMA.samples = STREAMTEST_SINK*2;
+	snd_audioDMA.channels = 2;
+	snd_audioDMA.sampleBits = 16;
+}
+
+
+/*
+================
+DMASnd_EndStreamTest
+================
+*/
+static void DMASnd_EndStreamTest (const streamTestSave_t &save)
+{
+	Snd_CloseStream (snd_dmaRawStream);
+
+	snd_audioDMA = save.dma;
+	memcpy (snd_mixChannels, save.channels, sizeof(snd_mixChannels));
+	snd_mixSettings = save.settings;
+	snd_mixPaintedTime = save.paintedTime;
+	snd_dmaRawStream = save.rawStream;
+
+	// Give the mixer back whatever file was streaming
+	DMASnd_NewCommand (SNDCMD_STREAM)->stream = snd_dmaFileStream;
+	DMASnd_CommitCommands ();
+	DMASnd_RunCommands ();
+
+	DMASnd_UnlockDevice ();
+}
 
-		// Mix ahead of current position
-		endTime = snd_dmaSoundTime + s_mixahead->floatVal * snd_audioDMA.speed;
 
-		// Mix to an even submission block size
-		endTime = (endTime + snd_audioDMA.submissionChunk-1) & ~(snd_audioDMA.submissionChunk-1);
-		samples = snd_audioDMA.samples >> (snd_audioDMA.channels-1);
-		if (endTime - snd_dmaSoundTime > samples)
-			endTime = snd_dmaSoundTime + samples;
+/*
+================
+DMASnd_StreamTestPaint
 
-		DMASnd_PaintChannels (endTime, tempVol);
-		SndImp_Submit ();
+Paints count pairs through the mixer into the sink, and checks them against
+the source interpolated the way a stream converts it.
+================
+*/
+static void DMASnd_StreamTestPaint (streamTest_t &test, const int count)
+{
+	const int	startTime = snd_mixPaintedTime;
+	const float	*a, *b;
+	const sint16 *out;
+	double		pos;
+	float		frac, error;
+	int			index, next, i;
+
+	DMASnd_PaintChannels (startTime + count);
+
+	for (i=0 ; i<count && test.received<test.numPairs ; i++, test.received++) {
+		pos = test.received * test.step;
+		index = (int)pos;
+		frac = (float)(pos - index);
+		next = index + 1;
+		if (test.bLoop) {
+			index %= test.numFrames;
+			next %= test.numFrames;
+		}
+		a = &test.ref[index*2];
+		b = &test.ref[next*2];
+
+		out = &snd_testSink[((startTime + i) & (STREAMTEST_SINK-1)) * 2];
+		error = max (fabs (out[0] - (a[0] + (b[0] - a[0]) * frac)), fabs (out[1] - (a[1] + (b[1] - a[1]) * frac)));
+		if (error > test.maxError)
+			test.maxError = error;
+		if (error > test.tolerance) {
+			if (!test.mismatches)
+				test.firstMismatch = test.received;
+			test.mismatches++;
+		}
 	}
 }
 
+
+/*
+================
+DMASnd_StreamTestReport
+================
+*/
+static void DMASnd_StreamTestReport (const streamTest_t &test, sndStream_t *stream, const int extra, const uint32 startCycles)
+{
+	uint32	underruns, blocked, dropped;
+
+	Snd_StreamStats (stream, underruns, blocked, dropped);
+	Com_Printf (0, "%-10s %i of %i pairs, max error %.2f, %u producer waits, %u gaps, %u dropped, %.1fms\n",
+		test.label, test.received, test.numPairs, test.maxError, blocked, underruns, dropped, DMASnd_BenchMS (startCycles));
+
+	if (test.received != test.numPairs || test.mismatches || extra || underruns || dropped)
+		Com_Printf (PRNT_ERROR, "...FAILED: %i pairs missing, %i extra, %i wrong (first at %i)\n", test.numPairs - test.received, extra, test.mismatches, test.firstMismatch);
+	else
+		Com_Printf (0, "...passed, no gaps\n");
+}
+
+
+/*
+================
+DMASnd_StreamTestRaw
+
+Pushes the source through the raw stream a block at a time, staying two
+blocks ahead of the mixer the way a cinematic does.
+================
+*/
+static void DMASnd_StreamTestRaw (streamTest_t &test)
+{
+	const uint32	startCycles = Sys_Cycles ();
+	sint16			block[STREAMTEST_BLOCK*2];
+	int				written, n, v;
+
+	written = 0;
+	while (test.received < test.numPairs) {
+		while (written < test.numFrames && written <= test.received + STREAMTEST_BLOCK*2) {
+			n = min (test.numFrames - written, STREAMTEST_BLOCK);
+			for (v=0 ; v<n ; v++) {
+				block[v*2] = LittleShort ((sint16)test.ref[(written+v)*2]);
+				block[v*2+1] = LittleShort ((sint16)test.ref[(written+v)*2+1]);
+			}
+			Snd_StreamWrite (snd_dmaRawStream, (byte *)block, n, snd_audioDMA.speed, 2, 2, 0);
+			written += n;
+		}
+
+		DMASnd_StreamTestPaint (test, min (test.numPairs - test.received, STREAMTEST_BLOCK));
+	}
+
+	DMASnd_StreamTestReport (test, snd_dmaRawStream, Snd_StreamQueued (snd_dmaRawStream), startCycles);
+}
+
+
+/*
+================
+DMASnd_StreamTestFile
+
+Streams a WAV file through SNDCMD_STREAM into the sink. The mixer doesn't
+wait on a stream, so the sink waits for each block to be queued instead,
+and stalls now and then so the reader has to wait for room.
+================
+*/
+static void DMASnd_StreamTestFile (streamTest_t &test, char *name)
+{
+	const uint32	startCycles = Sys_Cycles ();
+	sndStream_t		*stream;
+	int				count, idle, blocks, extra;
+
+	stream = Snd_OpenFileStream (name, snd_audioDMA.speed, test.bLoop);
+	if (!stream)
+		return;
+
+	DMASnd_NewCommand (SNDCMD_STREAM)->stream = stream;
+	DMASnd_CommitCommands ();
+	DMASnd_RunCommands ();
+
+	idle = blocks = 0;
+	while (test.received < test.numPairs) {
+		count = min (test.numPairs - test.received, STREAMTEST_BLOCK);
+		if (Snd_StreamQueued (stream) < count) {
+			if (++idle > 2000)
+				break;	// 2 seconds without a block
+			Sys_Sleep (1);
+			continue;
+		}
+
+		idle = 0;
+		DMASnd_StreamTestPaint (test, count);
+		if (!(++blocks & 15))
+			Sys_Sleep (5);
+	}
+
+	// A file that has played out leaves nothing behind
+	extra = 0;
+	if (!test.bLoop) {
+		for (idle=0 ; !Snd_StreamQueued (stream) && !Snd_StreamFinished (stream) && idle<100 ; idle++)
+			Sys_Sleep (1);
+		extra = Snd_StreamQueued (stream);
+	}
+
+	DMASnd_NewCommand (SNDCMD_STREAM)->stream = NULL;
+	DMASnd_CommitCommands ();
+	DMASnd_RunCommands ();
+
+	DMASnd_StreamTestReport (test, stream, extra, startCycles);
+	Snd_CloseStream (stream);
+}
+
+
+/*
+================
+DMASnd_StreamTest_f
+
+snd_streamtest [seconds] [pak sound]
+Writes a long WAV with a counting pattern and plays it through the mixer
+into memory: pushed through the raw stream, streamed from the file at the
+mixer's rate, and streamed from a file at another rate to be converted.
+Then loops a stock sound from a pak, which seeks within the pak. Every pair
+that reaches the sink is checked, so a gap shows as missing or shifted
+samples.
+================
+*/
+static void DMASnd_StreamTest_f ()
+{
+	const int			seconds = (Cmd_Argc () > 1) ? clamp (atoi (Cmd_Argv (1)), 1, 60) : 10;
+	const int			rates[2] = { snd_audioDMA.speed, snd_audioDMA.speed * 147 / 160 };
+	streamTestSave_t	*save;
+	streamTest_t		test;
+	char				path[MAX_OSPATH];
+	char				pakName[MAX_QPATH];
+	float				*ref;
+	int					numFrames, pass, i;
+	int					pakFrames, pakRate;
+
+	numFrames = seconds * rates[0];
+	ref = (float *)Mem_PoolAlloc (sizeof(float) * numFrames * 2, cl_soundSysPool, 0);
+	for (i=0 ; i<numFrames ; i++) {
+		ref[i*2] = DMASnd_StreamTestPattern (i);
+		ref[i*2+1] = -1 - DMASnd_StreamTestPattern (i);
+	}
+
+	save = (streamTestSave_t *)Mem_PoolAlloc (sizeof(streamTestSave_t), cl_soundSysPool, 0);
+	DMASnd_BeginStreamTest (*save);
+
+	Com_Printf (0, "Streaming %i seconds of 16-bit stereo through the mixer at %iHz (%s):\n", seconds, snd_audioDMA.speed, snd_dmaSSE2 ? "SSE2" : "scalar");
+	for (pass=0 ; pass<3 ; pass++) {
+		const int rate = rates[pass ? pass-1 : 0];
+
+		memset (&test, 0, sizeof(test));
+		test.label = (pass == 0) ? "raw" : (pass == 1) ? "file" : "converted";
+		test.ref = ref;
+		test.numFrames = seconds * rate;
+		test.step = (double)rate / snd_audioDMA.speed;
+		test.numPairs = (int)ceil ((test.numFrames - 1) / test.step);
+		test.tolerance = (rate == snd_audioDMA.speed) ? 0.0f : 1.0f;
+
+		if (!pass) {
+			DMASnd_StreamTestRaw (test);
+			continue;
+		}
+
+		if (!DMASnd_WriteStreamTestFile (rate, test.numFrames)) {
+			Com_Printf (PRNT_ERROR, "DMASnd_StreamTest_f: unable to write %s\n", STREAMTEST_FILE);
+			break;
+		}
+		DMASnd_StreamTestFile (test, STREAMTEST_FILE);
+	}
+
+	Mem_Free (ref);
+
+	// Two and a half times through, so it seeks back within the pak twice
+	Q_strncpyz (pakName, (Cmd_Argc () > 2) ? Cmd_Argv (2) : STREAMTEST_PAKFILE, sizeof(pakName));
+	ref = DMASnd_LoadStreamTestRef (pakName, pakFrames, pakRate);
+	if (ref && pakFrames > 1) {
+		memset (&test, 0, sizeof(test));
+		test.label = "pak";
+		test.ref = ref;
+		test.numFrames = pakFrames;
+		test.step = (double)pakRate / snd_audioDMA.speed;
+		test.bLoop = true;
+		test.numPairs = (int)(pakFrames * 2.5 / test.step);
+		test.tolerance = (pakRate == snd_audioDMA.speed) ? 0.0f : 1.0f;
+
+		DMASnd_StreamTestFile (test, pakName);
+	}
+	else {
+		Com_Printf (PRNT_WARNING, "pak        skipped, %s isn't a WAV that can be streamed\n", pakName);
+	}
+	if (ref)
+		Mem_Free (ref);
+
+	DMASnd_EndStreamTest (*save);
+	Mem_Free (save);
+
+	Q_snprintfz (path, sizeof(path), "%s/%s", FS_Gamedir (), STREAMTEST_FILE);
+	FS_DeleteFile (path);
+}
+
 /*
 ==============================================================================
 
@@ -953,6 +2245,28 @@ void DMASnd_Update (refDef_t *rd)
 ==============================================================================
 */
 
+static conCmd_t	*cmd_mixBench;
+static conCmd_t	*cmd_mixStats;
+static conCmd_t	*cmd_streamTest;
+
+/*
+================
+DMASnd_DetectCPU
+================
+*/
+static void DMASnd_DetectCPU ()
+{
+#ifdef SND_SSE2
+	snd_dmaSSE2 = Sys_HasSSE2 ();
+#else
+	snd_dmaSSE2 = false;
+#endif
+
+	if (snd_dmaSSE2)
+		Com_Printf (0, "...using SSE2 mixer\n");
+}
+
+
 /*
 ================
 DMASnd_Init
@@ -963,11 +2277,51 @@ bool DMASnd_Init ()
 	if (!SndImp_Init ())
 		return false;
 
-	s_volume->modified = false;
-	DMASnd_ScaleTableInit (s_volume->floatVal);
+	DMASnd_DetectCPU ();
 
-	snd_dmaSoundTime = 0;
 	snd_dmaPaintedTime = 0;
+	snd_dmaEpoch = 0;
+	snd_dmaUnderruns = 0;
+	snd_cmdWrite = snd_cmdRead = snd_cmdStaged = 0;
+	snd_cmdMaxWaiting = 0;
+
+	snd_mixSoundTime = 0;
+	snd_mixPaintedTime = 0;
+	snd_mixEpoch = 0;
+	snd_mixBuffers = 0;
+	snd_mixOldSamplePos = 0;
+	memset (snd_mixChannels, 0, sizeof(snd_mixChannels));
+	memset (&snd_mixStats, 0, sizeof(snd_mixStats));
+	snd_mixStats.minQueued = -1;
+
+	DMASnd_CurrentSettings (snd_dmaSettings);
+	snd_mixSettings = snd_dmaSettings;
+
+	snd_dmaRawStream = Snd_OpenStream (snd_audioDMA.speed);
+	snd_dmaFileStream = NULL;
+	snd_mixFileStream = NULL;
+
+	// Hand the mixer to its own thread
+	if (s_mixThread->intVal) {
+		snd_mixQuit = false;
+		snd_mixSync = Sys_CreateSemaphore ();
+		snd_deviceLock = Sys_CreateSemaphore ();
+		Sys_SemaphorePost (snd_deviceLock);
+
+		snd_mixThread = Sys_CreateThread (DMASnd_MixThread, NULL);
+		if (!snd_mixThread) {
+			Com_Printf (PRNT_WARNING, "DMASnd_Init: unable to create the audio thread\n");
+			Sys_DestroySemaphore (snd_deviceLock);
+			Sys_DestroySemaphore (snd_mixSync);
+			snd_deviceLock = NULL;
+			snd_mixSync = NULL;
+		}
+	}
+	Com_Printf (0, "...mixing on the %s thread\n", snd_mixThread ? "audio" : "game");
+
+	cmd_mixBench = Cmd_AddCommand ("snd_mixbench", 0, DMASnd_MixBench_f, "Times the mixer over synthetic voices and checks the SSE2 path against scalar");
+	cmd_mixStats = Cmd_AddCommand ("snd_mixstats", 0, DMASnd_MixStats_f, "Prints mixer pass times, underruns and latency, 'reset' clears them");
+	cmd_streamTest = Cmd_AddCommand ("snd_streamtest", 0, DMASnd_StreamTest_f, "Streams generated and pak WAVs through the mixer into memory and checks them for gaps, optionally for [seconds] [pak sound]");
 
 	return true;
 }
@@ -980,8 +2334,32 @@ DMASnd_Shutdown
 */
 void DMASnd_Shutdown ()
 {
+	Cmd_RemoveCommand (cmd_mixBench);
+	Cmd_RemoveCommand (cmd_mixStats);
+	Cmd_RemoveCommand (cmd_streamTest);
+
+	// Stop the audio thread before the device goes
+	if (snd_mixThread) {
+		snd_mixQuit = true;
+		Sys_WaitForThread (snd_mixThread);
+		snd_mixThread = NULL;
+
+		Sys_DestroySemaphore (snd_deviceLock);
+		Sys_DestroySemaphore (snd_mixSync);
+		snd_deviceLock = NULL;
+		snd_mixSync = NULL;
+	}
+
+	// Nothing reads the streams now
+	Snd_CloseStream (snd_dmaFileStream);
+	Snd_CloseStream (snd_dmaRawStream);
+	snd_dmaFileStream = NULL;
+	snd_mixFileStream = NULL;
+	snd_dmaRawStream = NULL;
+
 	SndImp_Shutdown ();
 
-	snd_dmaSoundTime = 0;
+	snd_mixSoundTime = 0;
+	snd_mixPaintedTime = 0;
 	snd_dmaPaintedTime = 0;
 }
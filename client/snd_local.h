@@ -24,6 +24,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 #include "../client/cl_local.h"
 
+// x86 builds carry SSE2 mixing kernels, used when the CPU reports SSE2 at init
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+# define SND_SSE2
+# include <emmintrin.h>
+#endif
+
 #define MAX_SFX			(MAX_CS_SOUNDS*2)
 #define MAX_CHANNELS	128
 #define MAX_PLAYSOUNDS	128
@@ -142,6 +148,11 @@ extern cVar_t	*s_khz;
 extern cVar_t	*s_mixahead;
 extern cVar_t	*s_testsound;
 extern cVar_t	*s_primary;
+extern cVar_t	*s_maxVoices;
+extern cVar_t	*s_mixThread;
+extern cVar_t	*s_loadJobs;
+extern cVar_t	*s_resampleFilter;
+extern cVar_t	*s_soundCache;
 
 extern cVar_t	*al_allowExtensions;
 extern cVar_t	*al_device;
@@ -153,13 +164,54 @@ extern cVar_t	*al_minDistance;
 extern cVar_t	*al_maxDistance;
 extern cVar_t	*al_rollOffFactor;
 
+wavInfo_t Snd_GetWavinfo (char *name, byte *wav, int wavLength);
 sfxCache_t *Snd_LoadSound (sfx_t *s);
 
 void	Snd_FreePlaysound (playSound_t *ps);
 
+// a loopSound_t groups every entity in the frame carrying the same looping sound
+struct loopSound_t {
+	sfx_t				*sfx;
+
+	int					firstEnt;			// into the loopSoundList_t entity arrays
+	int					numEnts;
+};
+
+struct loopSoundList_t {
+	int					numSounds;
+	loopSound_t			sounds[MAX_CS_SOUNDS];
+
+	int					entNums[MAX_PARSE_ENTITIES];
+	float				originX[MAX_PARSE_ENTITIES];	// split, for spatializing several at once
+	float				originY[MAX_PARSE_ENTITIES];
+	float				originZ[MAX_PARSE_ENTITIES];
+};
+
+const loopSoundList_t *Snd_GatherLoopSounds (const bool bOrigins);
+
+//
+// snd_cache.c
+//
+uint32	Snd_SoundCacheKey (const int speed, const int width, const bool bFilter);
+
+bool	Snd_SoundCacheActive ();
+bool	Snd_FindSoundCache (const char *name, const uint32 key, const uint32 sourceLen, const uint32 sourceHash, byte *out, const uint32 outLen);
+void	Snd_StoreSoundCache (const char *name, const uint32 key, const uint32 sourceLen, const uint32 sourceHash, const byte *data, const uint32 length);
+
+void	Snd_SoundCacheInit ();
+void	Snd_SoundCacheFlush ();
+void	Snd_SoundCacheShutdown ();
+
 //
 // snd_dma.c
 //
+
+// Mixed output, in 16-bit sample units
+struct sfxMixPair_t {
+	float			left;
+	float			right;
+};
+
 struct audioDMA_t {
 	int				channels;
 	int				samples;			// mono samples in buffer
@@ -172,15 +224,42 @@ struct audioDMA_t {
 
 extern audioDMA_t	snd_audioDMA;
 extern int			snd_dmaPaintedTime;
+extern bool			snd_dmaSSE2;
 
 bool	DMASnd_Init ();
 void	DMASnd_Shutdown ();
 
 void	DMASnd_StopAllSounds ();
+void	DMASnd_ReleaseSounds (const bool bAll);
 void	DMASnd_RawSamples (int samples, int rate, int width, int channels, byte *data);
+void	DMASnd_RawStop ();
+bool	DMASnd_StreamFile (char *name, const bool bLoop);
+void	DMASnd_StopStream ();
+
+void	DMASnd_LockDevice ();
+void	DMASnd_UnlockDevice ();
 
 void	DMASnd_Update (refDef_t *rd);
 
+//
+// snd_stream.c
+//
+struct sndStream_t;
+
+sndStream_t *Snd_OpenStream (const int outRate);
+sndStream_t *Snd_OpenFileStream (char *name, const int outRate, const bool bLoop);
+void	Snd_CloseStream (sndStream_t *stream);
+
+void	Snd_StreamWrite (sndStream_t *stream, const byte *data, const int samples, const int rate, const int width, const int channels, const int waitMS);
+void	Snd_StreamReset (sndStream_t *stream);
+void	Snd_StreamEnd (sndStream_t *stream);
+
+int		Snd_StreamRead (sndStream_t *stream, sfxMixPair_t *out, const int count, const float volume);
+void	Snd_StreamFlush (sndStream_t *stream);
+bool	Snd_StreamFinished (sndStream_t *stream);
+int		Snd_StreamQueued (sndStream_t *stream);
+void	Snd_StreamStats (const sndStream_t *stream, uint32 &underruns, uint32 &blocked, uint32 &dropped);
+
 //
 // snd_openal.c
 //
@@ -52,6 +52,11 @@ cVar_t	*s_testsound;
 cVar_t	*s_khz;
 cVar_t	*s_mixahead;
 cVar_t	*s_primary;
+cVar_t	*s_maxVoices;
+cVar_t	*s_mixThread;
+cVar_t	*s_loadJobs;
+cVar_t	*s_resampleFilter;
+cVar_t	*s_soundCache;
 
 cVar_t	*al_allowExtensions;
 cVar_t	*al_device;
@@ -179,7 +184,7 @@ static void _wFindChunk (char *name)
 Snd_GetWavinfo
 ============
 */
-static wavInfo_t Snd_GetWavinfo (char *name, byte *wav, int wavLength)
+wavInfo_t Snd_GetWavinfo (char *name, byte *wav, int wavLength)
 {
 	wavInfo_t	info;
 	int			i;
@@ -266,35 +271,19 @@ static wavInfo_t Snd_GetWavinfo (char *name, byte *wav, int wavLength)
 
 /*
 ================
-DMASnd_ResampleSfx
+Snd_ResampleNearest
+
+Takes the nearest earlier sample for each output sample.
 ================
 */
-static void DMASnd_ResampleSfx (sfx_t *sfx, int inRate, int inWidth, byte *data)
+static void Snd_ResampleNearest (const byte *data, const int inWidth, const float stepscale, sfxCache_t *sc)
 {
 	int		outcount;
 	int		srcsample;
-	float	stepscale;
 	int		i;
 	int		sample, samplefrac, fracstep;
-	sfxCache_t	*sc;
-	
-	sc = sfx->cache;
-	if (!sc)
-		return;
 
-	stepscale = (float)inRate / snd_audioDMA.speed;	// This is usually 0.5, 1, or 2
-
-	outcount = sc->length / stepscale;
-	sc->length = outcount;
-	if (sc->loopStart != -1)
-		sc->loopStart = sc->loopStart / stepscale;
-
-	sc->speed = snd_audioDMA.speed;
-	if (s_loadas8bit->intVal)
-		sc->width = 1;
-	else
-		sc->width = inWidth;
-	sc->stereo = 0;
+	outcount = sc->length;
 
 	// Resample / decimate to the current source rate
 	if (stepscale == 1 && inWidth == 1 && sc->width == 1) {
@@ -322,33 +311,152 @@ static void DMASnd_ResampleSfx (sfx_t *sfx, int inRate, int inWidth, byte *data)
 }
 
 
+#define SND_FILTER_TAPS		16
+#define SND_FILTER_PHASES	64
+
+/*
+================
+Snd_FilterSample
+
+Input sample i in 16-bit units. Past the end a looping sound carries on from
+its loop start, anything else is silent.
+================
+*/
+static inline float Snd_FilterSample (const byte *data, const int inWidth, const int inSamples, const int inLoopStart, int i)
+{
+	if (i < 0)
+		return 0.0f;
+	if (i >= inSamples) {
+		if (inLoopStart < 0 || inLoopStart >= inSamples)
+			return 0.0f;
+		i = inLoopStart + (i - inSamples) % (inSamples - inLoopStart);
+	}
+
+	if (inWidth == 2)
+		return (float)LittleShort (((sint16 *)data)[i]);
+	return (float)(((int)data[i] - 128) << 8);
+}
+
+
+/*
+================
+Snd_ResampleFiltered
+
+Polyphase resampler over a Blackman windowed sinc. The cutoff follows the
+lower of the two rates, so decimating doesn't fold the top end back down.
+================
+*/
+static void Snd_ResampleFiltered (const byte *data, const int inWidth, const int inSamples, const int inLoopStart, const double stepscale, sfxCache_t *sc)
+{
+	float	bank[SND_FILTER_PHASES+1][SND_FILTER_TAPS];
+	float	cutoff, x, u, window, total, sum;
+	double	pos;
+	int		first, phase, sample;
+	int		i, p, t;
+
+	// One filter per fractional position, each scaled to unity gain
+	cutoff = (stepscale > 1.0) ? (float)(1.0 / stepscale) : 1.0f;
+	for (p=0 ; p<=SND_FILTER_PHASES ; p++) {
+		total = 0.0f;
+		for (t=0 ; t<SND_FILTER_TAPS ; t++) {
+			x = (float)(t - (SND_FILTER_TAPS/2 - 1)) - (float)p / SND_FILTER_PHASES;
+			u = x / (SND_FILTER_TAPS/2);
+			window = (u <= -1.0f || u >= 1.0f) ? 0.0f : 0.42f + 0.5f*cosf (M_PI*u) + 0.08f*cosf (2.0f*M_PI*u);
+
+			x *= M_PI * cutoff;
+			bank[p][t] = (x == 0.0f) ? window : window * sinf (x) / x;
+			total += bank[p][t];
+		}
+		for (t=0 ; t<SND_FILTER_TAPS ; t++)
+			bank[p][t] /= total;
+	}
+
+	for (i=0 ; i<sc->length ; i++) {
+		pos = i * stepscale;
+		first = (int)pos;
+		phase = (int)((pos - first) * SND_FILTER_PHASES + 0.5);
+		first -= SND_FILTER_TAPS/2 - 1;
+
+		const float *filter = bank[phase];
+		sum = 0.0f;
+		if (first >= 0 && first + SND_FILTER_TAPS <= inSamples) {
+			if (inWidth == 2) {
+				for (t=0 ; t<SND_FILTER_TAPS ; t++)
+					sum += filter[t] * (float)LittleShort (((sint16 *)data)[first + t]);
+			}
+			else {
+				for (t=0 ; t<SND_FILTER_TAPS ; t++)
+					sum += filter[t] * (float)(((int)data[first + t] - 128) << 8);
+			}
+		}
+		else {
+			for (t=0 ; t<SND_FILTER_TAPS ; t++)
+				sum += filter[t] * Snd_FilterSample (data, inWidth, inSamples, inLoopStart, first + t);
+		}
+
+		sample = Q_rint (sum);
+		if (sample > 32767)
+			sample = 32767;
+		else if (sample < -32768)
+			sample = -32768;
+
+		if (sc->width == 2)
+			((sint16 *)sc->data)[i] = sample;
+		else
+			((signed char *)sc->data)[i] = sample >> 8;
+	}
+}
+
+/*
+===============================================================================
+
+	SOUND LOADING
+
+	Files are read and parsed on the calling thread, and the DMA conversion
+	is spread over the job threads when a whole batch is loaded at once.
+	Converted samples go through the sound cache, see snd_cache.cpp.
+
+===============================================================================
+*/
+
+#define MAX_LOAD_BATCH		64
+
+struct sndLoad_t {
+	sfx_t				*sfx;
+	char				loadName[MAX_QPATH];
+	byte				*buffer;
+	int					fileLen;
+	wavInfo_t			info;
+
+	uint32				cacheKey;
+	uint32				sourceHash;
+	bool				bCached;
+	bool				bFilter;
+};
+
+// Since the last Snd_BeginRegistration
+static int				snd_regLoaded;
+static int				snd_regCached;
+static double			snd_regLoadMS;
+
 /*
 ==============
-Snd_LoadSound
+Snd_OpenSound
+
+Loads and checks the file and gives the sfx its cache, filled in straight
+away unless it still needs converting for DMA.
 ==============
 */
-sfxCache_t *Snd_LoadSound (sfx_t *s)
+static bool Snd_OpenSound (sfx_t *s, sndLoad_t *load)
 {
-    char		namebuffer[MAX_QPATH];
-	byte		*data;
 	wavInfo_t	info;
-	int			len;
 	float		stepscale;
 	sfxCache_t	*sc;
-	int			fileLen;
 	char		*name;
+	int			len, outcount, width;
 
-	if (!s)
-		return NULL;
-
-	s->touchFrame = snd_registrationFrame;
-	if (s->name[0] == '*')
-		return NULL;
-
-	// See if still in memory
-	sc = s->cache;
-	if (sc)
-		return sc;
+	memset (load, 0, sizeof(sndLoad_t));
+	load->sfx = s;
 
 	// Load it in
 	if (s->trueName)
@@ -357,52 +465,173 @@ sfxCache_t *Snd_LoadSound (sfx_t *s)
 		name = s->name;
 
 	if (name[0] == '#')
-		Q_strncpyz (namebuffer, &name[1], sizeof(namebuffer));
+		Q_strncpyz (load->loadName, &name[1], sizeof(load->loadName));
 	else
-		Q_snprintfz (namebuffer, sizeof(namebuffer), "sound/%s", name);
+		Q_snprintfz (load->loadName, sizeof(load->loadName), "sound/%s", name);
 
-	fileLen = FS_LoadFile (namebuffer, (void **)&data, false);
-	if (!data || fileLen <= 0) {
-		Com_DevPrintf (0, "Snd_LoadSound: Couldn't load %s -- %s\n", namebuffer, (fileLen == -1) ? "not found" : "empty file");
-		return NULL;
+	load->fileLen = FS_LoadFile (load->loadName, (void **)&load->buffer, false);
+	if (!load->buffer || load->fileLen <= 0) {
+		Com_DevPrintf (0, "Snd_LoadSound: Couldn't load %s -- %s\n", load->loadName, (load->fileLen == -1) ? "not found" : "empty file");
+		return false;
 	}
 
 	// Get WAV info
-	info = Snd_GetWavinfo (s->name, data, fileLen);
-	if (snd_isDMA) {
-		if (info.channels != 1) {
-			Com_Printf (0, "Snd_LoadSound: %s is a stereo sample\n", s->name);
-			FS_FreeFile (data);
-			return NULL;
-		}
-		stepscale = (float)info.rate / snd_audioDMA.speed;	
-		len = (info.samples / stepscale) * info.width * info.channels;
+	info = load->info = Snd_GetWavinfo (s->name, load->buffer, load->fileLen);
+	if (!info.rate || !info.width || info.channels <= 0 || info.samples <= 0 || info.dataOfs + info.samples * info.width > load->fileLen) {
+		Com_DevPrintf (0, "Snd_LoadSound: %s is not a usable WAV file\n", load->loadName);
+		FS_FreeFile (load->buffer);
+		return false;
 	}
-	else if (snd_isAL) {
-		len = 0;
+
+	if (snd_isAL) {
+		sc = s->cache = (sfxCache_t*)Mem_PoolAlloc (sizeof(sfxCache_t), cl_soundSysPool, 0);
+		ALSnd_CreateBuffer (sc, info.width, info.channels, load->buffer + info.dataOfs, info.samples * info.width, info.rate);
+		return true;
 	}
 
-	sc = s->cache = (sfxCache_t*)Mem_PoolAlloc (len + sizeof(sfxCache_t), cl_soundSysPool, 0);
-	if (!sc) {
-		FS_FreeFile (data);
-		return NULL;
+	if (info.channels != 1) {
+		Com_Printf (0, "Snd_LoadSound: %s is a stereo sample\n", s->name);
+		FS_FreeFile (load->buffer);
+		return false;
 	}
 
-	if (snd_isDMA) {
-		sc->length = info.samples;
-		sc->loopStart = info.loopStart;
-		sc->speed = info.rate;
-		sc->width = info.width;
-		sc->stereo = info.channels;
+	stepscale = (float)info.rate / snd_audioDMA.speed;	// This is usually 0.5, 1, or 2
+	outcount = info.samples / stepscale;
+	width = s_loadas8bit->intVal ? 1 : info.width;
+	len = outcount * width;
+
+	sc = s->cache = (sfxCache_t*)Mem_PoolAlloc (len + sizeof(sfxCache_t), cl_soundSysPool, 0);
+	sc->length = outcount;
+	sc->loopStart = (info.loopStart != -1) ? (int)(info.loopStart / stepscale) : -1;
+	sc->speed = snd_audioDMA.speed;
+	sc->width = width;
+	sc->stereo = 0;
 
-		DMASnd_ResampleSfx (s, sc->speed, sc->width, data + info.dataOfs);
+	// See if an earlier run already converted it
+	load->bFilter = (s_resampleFilter->intVal != 0);
+	if (Snd_SoundCacheActive ()) {
+		load->cacheKey = Snd_SoundCacheKey (sc->speed, sc->width, load->bFilter);
+		load->sourceHash = Com_HashBlock (load->buffer, load->fileLen);
+		load->bCached = Snd_FindSoundCache (load->loadName, load->cacheKey, load->fileLen, load->sourceHash, sc->data, len);
 	}
-	else if (snd_isAL) {
-		ALSnd_CreateBuffer (sc, info.width, info.channels, data + info.dataOfs, info.samples * info.width * info.channels, info.rate);
+
+	return true;
+}
+
+
+/*
+==============
+Snd_ConvertSoundJob
+
+Resamples one opened DMA sound into its cache. Safe to run on a job thread.
+==============
+*/
+static void Snd_ConvertSoundJob (void *arg, int jobNum)
+{
+	sndLoad_t	*load = &((sndLoad_t *)arg)[jobNum];
+	sfxCache_t	*sc = load->sfx->cache;
+	byte		*data;
+
+	if (snd_isAL || load->bCached)
+		return;
+
+	data = load->buffer + load->info.dataOfs;
+	if (load->bFilter)
+		Snd_ResampleFiltered (data, load->info.width, load->info.samples, load->info.loopStart, (double)load->info.rate / sc->speed, sc);
+	else
+		Snd_ResampleNearest (data, load->info.width, (float)load->info.rate / sc->speed, sc);
+}
+
+
+/*
+==============
+Snd_CloseSound
+==============
+*/
+static void Snd_CloseSound (sndLoad_t *load)
+{
+	sfxCache_t	*sc = load->sfx->cache;
+
+	if (snd_isDMA && !load->bCached && Snd_SoundCacheActive ())
+		Snd_StoreSoundCache (load->loadName, load->cacheKey, load->fileLen, load->sourceHash, sc->data, sc->length * sc->width);
+
+	FS_FreeFile (load->buffer);
+
+	snd_regLoaded++;
+	if (load->bCached)
+		snd_regCached++;
+}
+
+
+/*
+==============
+Snd_LoadSounds
+
+Loads every sound in the list that isn't loaded yet, a batch of files at a
+time with the conversions of each batch done together.
+==============
+*/
+static void Snd_LoadSounds (sfx_t **list, const int numSfx)
+{
+	sndLoad_t	loads[MAX_LOAD_BATCH];
+	uint32		startCycles;
+	sfx_t		*s;
+	int			numLoads;
+	int			first, i;
+
+	startCycles = Sys_Cycles ();
+
+	for (first=0 ; first<numSfx ; first+=MAX_LOAD_BATCH) {
+		numLoads = 0;
+		for (i=first ; i<numSfx && i<first+MAX_LOAD_BATCH ; i++) {
+			s = list[i];
+			if (!s)
+				continue;
+
+			s->touchFrame = snd_registrationFrame;
+			if (s->name[0] == '*' || s->cache)
+				continue;
+
+			if (Snd_OpenSound (s, &loads[numLoads]))
+				numLoads++;
+		}
+
+		if (s_loadJobs->intVal) {
+			Job_Run (Snd_ConvertSoundJob, loads, numLoads);
+		}
+		else {
+			for (i=0 ; i<numLoads ; i++)
+				Snd_ConvertSoundJob (loads, i);
+		}
+
+		for (i=0 ; i<numLoads ; i++)
+			Snd_CloseSound (&loads[i]);
 	}
 
-	FS_FreeFile (data);
-	return sc;
+	snd_regLoadMS += (Sys_Cycles () - startCycles) * Sys_MSPerCycle ();
+}
+
+
+/*
+==============
+Snd_LoadSound
+==============
+*/
+sfxCache_t *Snd_LoadSound (sfx_t *s)
+{
+	if (!s)
+		return NULL;
+
+	s->touchFrame = snd_registrationFrame;
+	if (s->name[0] == '*')
+		return NULL;
+
+	// See if still in memory
+	if (s->cache)
+		return s->cache;
+
+	Snd_LoadSounds (&s, 1);
+	return s->cache;
 }
 
 /*
@@ -443,6 +672,29 @@ static void Snd_Play_f ()
 }
 
 
+/*
+================
+Snd_PlayStream_f
+================
+*/
+static void Snd_PlayStream_f ()
+{
+	char	name[MAX_QPATH];
+
+	if (Cmd_Argc () < 2) {
+		Com_Printf (0, "Usage: playstream <file> [loop]\n");
+		return;
+	}
+
+	if (!strrchr (Cmd_Argv (1), '.'))
+		Q_snprintfz (name, sizeof(name), "%s.wav", Cmd_Argv (1));
+	else
+		Q_strncpyz (name, Cmd_Argv (1), sizeof(name));
+
+	Snd_StreamFile (name, (Cmd_Argc () > 2 && !Q_stricmp (Cmd_Argv (2), "loop")));
+}
+
+
 /*
 ================
 Snd_Restart_f
@@ -656,6 +908,10 @@ Snd_BeginRegistration
 void Snd_BeginRegistration ()
 {
 	snd_registrationFrame++;
+
+	snd_regLoaded = 0;
+	snd_regCached = 0;
+	snd_regLoadMS = 0;
 }
 
 
@@ -680,18 +936,15 @@ sfx_t *Snd_RegisterSound (char *name)
 
 /*
 ===============
-Snd_RegisterSexedSound
+Snd_PlayerModel
+
+The model the client is using, for its sexed sounds.
 ===============
 */
-static struct sfx_t *Snd_RegisterSexedSound (char *base, int entNum)
+static void Snd_PlayerModel (int entNum, char *model, const size_t modelSize)
 {
-	char			model[MAX_QPATH];
-	char			sexedFilename[MAX_QPATH];
-	char			maleFilename[MAX_QPATH];
-	int				n;
-	struct sfx_t	*sfx;
-	char			*p;
-	fileHandle_t	fileNum;
+	int		n;
+	char	*p;
 
 	// Determine what model the client is using
 	model[0] = 0;
@@ -700,7 +953,7 @@ static struct sfx_t *Snd_RegisterSexedSound (char *base, int entNum)
 		p = strchr (cl.configStrings[n], '\\');
 		if (p) {
 			p += 1;
-			Q_strncpyz (model, p, sizeof(model));
+			Q_strncpyz (model, p, modelSize);
 			p = strchr (model, '/');
 			if (p)
 				*p = 0;
@@ -709,7 +962,24 @@ static struct sfx_t *Snd_RegisterSexedSound (char *base, int entNum)
 
 	// If we can't figure it out, they're male
 	if (!model[0])
-		Q_strncpyz (model, "male", sizeof(model));
+		Q_strncpyz (model, "male", modelSize);
+}
+
+
+/*
+===============
+Snd_FindSexedSound
+
+The model specific version of a '*' sound, or an alias to the male one when
+the model doesn't have it. Not loaded yet.
+===============
+*/
+static struct sfx_t *Snd_FindSexedSound (char *base, char *model)
+{
+	char			sexedFilename[MAX_QPATH];
+	char			maleFilename[MAX_QPATH];
+	struct sfx_t	*sfx;
+	fileHandle_t	fileNum;
 
 	// See if we already know of the model specific sound
 	Q_snprintfz (sexedFilename, sizeof(sexedFilename), "#players/%s/%s", model, base+1);
@@ -721,7 +991,7 @@ static struct sfx_t *Snd_RegisterSexedSound (char *base, int entNum)
 		if (fileNum) {
 			// Yes, close the file and register it
 			FS_CloseFile (fileNum);
-			sfx = Snd_RegisterSound (sexedFilename);
+			sfx = Snd_FindName (sexedFilename, true);
 		}
 		else {
 			// No, revert to the male sound
@@ -734,6 +1004,84 @@ static struct sfx_t *Snd_RegisterSexedSound (char *base, int entNum)
 }
 
 
+/*
+===============
+Snd_RegisterSexedSound
+===============
+*/
+static struct sfx_t *Snd_RegisterSexedSound (char *base, int entNum)
+{
+	char	model[MAX_QPATH];
+
+	Snd_PlayerModel (entNum, model, sizeof(model));
+	return Snd_FindSexedSound (base, model);
+}
+
+
+/*
+=====================
+Snd_PrefetchSounds
+
+Loads every sound the config strings name in one go, so the conversions run
+together on the job threads: the map's sounds, plus the sexed versions of its
+'*' sounds for each player model in use. Snd_RegisterSound then finds them
+already loaded.
+=====================
+*/
+#define MAX_SND_PREFETCH	(MAX_CS_SOUNDS*4)
+void Snd_PrefetchSounds ()
+{
+	static char	models[MAX_CS_CLIENTS][MAX_QPATH];
+	sfx_t		*list[MAX_SND_PREFETCH];
+	char		model[MAX_QPATH];
+	char		*name;
+	int			numSfx, numModels;
+	int			i, j;
+
+	if (!snd_isInitialized)
+		return;
+
+	// Map sounds
+	numSfx = 0;
+	for (i=1 ; i<MAX_CS_SOUNDS ; i++) {
+		name = cl.configStrings[CS_SOUNDS+i];
+		if (!name[0])
+			break;
+		if (name[0] != '*')
+			list[numSfx++] = Snd_FindName (name, true);
+	}
+
+	// Player models in use
+	numModels = 0;
+	for (i=1 ; i<=MAX_CS_CLIENTS ; i++) {
+		if (!cl.configStrings[CS_PLAYERSKINS+i-1][0])
+			continue;
+
+		Snd_PlayerModel (i, model, sizeof(model));
+		for (j=0 ; j<numModels ; j++) {
+			if (!Q_stricmp (models[j], model))
+				break;
+		}
+		if (j == numModels)
+			Q_strncpyz (models[numModels++], model, sizeof(models[0]));
+	}
+
+	// Their sexed sounds
+	for (i=1 ; i<MAX_CS_SOUNDS ; i++) {
+		name = cl.configStrings[CS_SOUNDS+i];
+		if (!name[0])
+			break;
+		if (name[0] != '*')
+			continue;
+
+		for (j=0 ; j<numModels && numSfx<MAX_SND_PREFETCH ; j++)
+			list[numSfx++] = Snd_FindSexedSound (name, models[j]);
+	}
+
+	Snd_LoadSounds (list, numSfx);
+}
+
+
 /*
 =====================
 Snd_EndRegistration
@@ -743,6 +1091,10 @@ void Snd_EndRegistration ()
 {
 	int		released = 0;
 
+	// The mixer has to let go of anything about to be freed
+	if (snd_isDMA)
+		DMASnd_ReleaseSounds (false);
+
 	// Free untouched sounds and make sure it is paged in
 	for (auto it = sfxList.begin(); it != sfxList.end(); ++it)
 	{
@@ -755,6 +1107,9 @@ void Snd_EndRegistration ()
 		released++;
 	}
 	Com_DevPrintf (PRNT_CONSOLE, "sounds released: %i\n", released);
+	Com_DevPrintf (PRNT_CONSOLE, "sounds loaded: %i in %.2fms, %i from the cache\n", snd_regLoaded, snd_regLoadMS, snd_regCached);
+
+	Snd_SoundCacheFlush ();
 }
 
 /*
@@ -771,6 +1126,8 @@ static conCmd_t	*cmd_play;
 static conCmd_t	*cmd_stopSound;
 static conCmd_t	*cmd_soundList;
 static conCmd_t	*cmd_soundInfo;
+static conCmd_t	*cmd_playStream;
+static conCmd_t	*cmd_stopStream;
 
 
 /*
@@ -840,6 +1197,11 @@ void Snd_Init()
 	s_show				= Cvar_Register("s_show",				"0",			CVAR_CHEAT);
 	s_testsound			= Cvar_Register("s_testsound",			"0",			0);
 	s_primary			= Cvar_Register("s_primary",			"0",			CVAR_ARCHIVE|CVAR_LATCH_AUDIO);	// win32 specific
+	s_maxVoices			= Cvar_Register("s_maxVoices",			"48",			CVAR_ARCHIVE);
+	s_mixThread			= Cvar_Register("s_mixThread",			"1",			CVAR_ARCHIVE|CVAR_LATCH_AUDIO);
+	s_loadJobs			= Cvar_Register("s_loadJobs",			"1",			CVAR_ARCHIVE);
+	s_resampleFilter	= Cvar_Register("s_resampleFilter",		"0",			CVAR_ARCHIVE|CVAR_LATCH_AUDIO);
+	s_soundCache		= Cvar_Register("s_soundCache",			"1",			CVAR_ARCHIVE|CVAR_LATCH_AUDIO);
 
 	al_allowExtensions	= Cvar_Register("al_allowExtensions",	"1",			CVAR_ARCHIVE|CVAR_LATCH_AUDIO);
 	al_device			= Cvar_Register("al_device",			"",				CVAR_ARCHIVE);
@@ -856,6 +1218,8 @@ void Snd_Init()
 	cmd_stopSound	= Cmd_AddCommand("stopsound",		0, Snd_StopAllSounds,	"Stops all currently playing sounds");
 	cmd_soundList	= Cmd_AddCommand("soundlist",		0, Snd_SoundList_f,		"Prints out a list of loaded sound files");
 	cmd_soundInfo	= Cmd_AddCommand("soundinfo",		0, Snd_SoundInfo_f,		"Prints out information on sound subsystem");
+	cmd_playStream	= Cmd_AddCommand("playstream",		0, Snd_PlayStream_f,	"Plays a WAV file as it's read from disk, 'loop' repeats it");
+	cmd_stopStream	= Cmd_AddCommand("stopstream",		0, Snd_StopStream,		"Stops the streaming WAV file");
 
 	if (!s_initSound->intVal)
 	{
@@ -885,6 +1249,10 @@ void Snd_Init()
 
 	snd_isInitialized = true;
 
+	// Converted samples only depend on the DMA format
+	if (snd_isDMA && s_soundCache->intVal)
+		Snd_SoundCacheInit();
+
 	Snd_StopAllSounds();
 
 	Com_Printf(0, "----------------------------------------\n");
@@ -911,6 +1279,8 @@ void Snd_Shutdown ()
 	Cmd_RemoveCommand(cmd_stopSound);
 	Cmd_RemoveCommand(cmd_soundList);
 	Cmd_RemoveCommand(cmd_soundInfo);
+	Cmd_RemoveCommand(cmd_playStream);
+	Cmd_RemoveCommand(cmd_stopStream);
 
 	if (!snd_isInitialized)
 		return;
@@ -920,6 +1290,7 @@ void Snd_Shutdown ()
 
 	// Free all sounds
 	Snd_FreeSounds ();
+	Snd_SoundCacheShutdown ();
 
 	// Free all memory
 	size = Mem_PoolSize (cl_soundSysPool);
@@ -947,6 +1318,10 @@ Snd_FreeSounds
 */
 void Snd_FreeSounds ()
 {
+	// The mixer has to let go of them first
+	if (snd_isDMA)
+		DMASnd_ReleaseSounds (true);
+
 	for (auto it = sfxList.begin(); it != sfxList.end(); ++it)
 	{
 		Snd_FreeSound (it->second);
@@ -1207,10 +1582,137 @@ Snd_RawStop
 */
 void Snd_RawStop (channel_t *rawChannel)
 {
-	if (!snd_isInitialized || !snd_isAL)
+	if (!snd_isInitialized)
+		return;
+
+	if (snd_isDMA)
+		DMASnd_RawStop ();
+	else if (snd_isAL)
+		ALSnd_RawStop (rawChannel);
+}
+
+
+/*
+============
+Snd_StreamFile
+
+Plays a WAV file from the game path while it's read, rather than loading it
+whole first. Only the DMA mixer streams.
+============
+*/
+bool Snd_StreamFile (char *name, const bool bLoop)
+{
+	if (!snd_isInitialized)
+		return false;
+
+	if (!snd_isDMA) {
+		Com_Printf (PRNT_WARNING, "Snd_StreamFile: streaming needs the DMA mixer (s_initSound 1)\n");
+		return false;
+	}
+
+	return DMASnd_StreamFile (name, bLoop);
+}
+
+
+/*
+============
+Snd_StopStream
+============
+*/
+void Snd_StopStream ()
+{
+	if (!snd_isInitialized || !snd_isDMA)
 		return;
 
-	ALSnd_RawStop (rawChannel);
+	DMASnd_StopStream ();
+}
+
+/*
+===============================================================================
+
+	LOOP SOUNDS
+
+	Looping entity sounds are grouped by sound index in a single pass, so
+	the mixers handle every group once however many entities share it.
+
+===============================================================================
+*/
+
+static loopSoundList_t	snd_loopSounds;
+
+/*
+============
+Snd_GatherLoopSounds
+
+Groups are in order of each sound's first entity, and list their entities
+in frame order. Origins are only looked up when bOrigins is set.
+============
+*/
+const loopSoundList_t *Snd_GatherLoopSounds (const bool bOrigins)
+{
+	int				soundGroup[MAX_CS_SOUNDS];	// -1 unseen, -2 bad sound effect
+	int				groupFill[MAX_CS_SOUNDS];
+	entityState_t	*ent;
+	loopSound_t		*loop;
+	sfx_t			*sfx;
+	vec3_t			origin, velocity;
+	int				total, slot, i;
+
+	snd_loopSounds.numSounds = 0;
+	memset (soundGroup, -1, sizeof(soundGroup));
+
+	// Count the entities on each sound
+	for (i=0 ; i<cl.frame.numEntities ; i++) {
+		ent = &cl_parseEntities[(cl.frame.parseEntities + i) & MAX_PARSEENTITIES_MASK];
+		if (!ent->sound || soundGroup[ent->sound] == -2)
+			continue;
+
+		if (soundGroup[ent->sound] == -1) {
+			if (!cl.soundCfgStrings[ent->sound] && cl.configStrings[CS_SOUNDS+ent->sound][0])
+				cl.soundCfgStrings[ent->sound] = Snd_RegisterSound (cl.configStrings[CS_SOUNDS+ent->sound]);
+
+			sfx = cl.soundCfgStrings[ent->sound];
+			if (!sfx || !sfx->cache) {
+				soundGroup[ent->sound] = -2;	// Bad sound effect
+				continue;
+			}
+
+			soundGroup[ent->sound] = snd_loopSounds.numSounds;
+			loop = &snd_loopSounds.sounds[snd_loopSounds.numSounds++];
+			loop->sfx = sfx;
+			loop->numEnts = 0;
+		}
+
+		snd_loopSounds.sounds[soundGroup[ent->sound]].numEnts++;
+	}
+
+	// Lay the groups out back to back
+	total = 0;
+	for (i=0 ; i<snd_loopSounds.numSounds ; i++) {
+		loop = &snd_loopSounds.sounds[i];
+		loop->firstEnt = total;
+		groupFill[i] = total;
+		total += loop->numEnts;
+	}
+
+	// Fill in the entities
+	for (i=0 ; i<cl.frame.numEntities ; i++) {
+		ent = &cl_parseEntities[(cl.frame.parseEntities + i) & MAX_PARSEENTITIES_MASK];
+		if (!ent->sound || soundGroup[ent->sound] < 0)
+			continue;
+
+		slot = groupFill[soundGroup[ent->sound]]++;
+		snd_loopSounds.entNums[slot] = ent->number;
+
+		if (bOrigins) {
+			CL_CGModule_GetEntitySoundOrigin (ent->number, origin, velocity);
+			snd_loopSounds.originX[slot] = origin[0];
+			snd_loopSounds.originY[slot] = origin[1];
+			snd_loopSounds.originZ[slot] = origin[2];
+		}
+	}
+
+	return &snd_loopSounds;
 }
 
 /*
@@ -613,71 +613,92 @@ static void ALSnd_RawUpdate(channel_t *rawChannel)
 /*
 ===========
 ALSnd_AddLoopSounds
+
+Keeps a source playing for each entity carrying a looping sound. Sources
+still playing from last frame are claimed per sound group, through a
+stamp on the entity number, so an update doesn't compare every entity
+against every channel.
 ===========
 */
+static int	snd_alLoopStamps[MAX_CS_EDICTS];
+static int	snd_alLoopStamp;
 static void ALSnd_AddLoopSounds()
 {
 	if (cl_paused->intVal || Com_ClientState() != CA_ACTIVE || !cls.soundPrepped)
 		return;
 
 	// Add looping entity sounds
-	for (int i=0 ; i<cl.frame.numEntities ; i++)
+	const loopSoundList_t *list = Snd_GatherLoopSounds(false);
+	for (int i=0 ; i<list->numSounds ; i++)
 	{
-		entityState_t *ent = &cl_parseEntities[((cl.frame.parseEntities + i) & MAX_PARSEENTITIES_MASK)];
-		if (!ent->sound)
-			continue;
+		const loopSound_t *loop = &list->sounds[i];
+		const int *entNums = &list->entNums[loop->firstEnt];
 
-		if (!cl.soundCfgStrings[ent->sound] && cl.configStrings[CS_SOUNDS+ent->sound][0])
-			cl.soundCfgStrings[ent->sound] = Snd_RegisterSound(cl.configStrings[CS_SOUNDS+ent->sound]);
+		// Two stamps per group: waiting for a source, and already has one
+		if (snd_alLoopStamp > 0x40000000)
+		{
+			memset(snd_alLoopStamps, 0, sizeof(snd_alLoopStamps));
+			snd_alLoopStamp = 0;
+		}
+		snd_alLoopStamp += 2;
+		const int waiting = snd_alLoopStamp - 1;
+		const int claimed = snd_alLoopStamp;
 
-		sfx_t *sfx = cl.soundCfgStrings[ent->sound];
-		if (!sfx || !sfx->cache)
-			continue;	// Bad sound effect
+		for (int j=0 ; j<loop->numEnts ; j++)
+			snd_alLoopStamps[entNums[j]] = waiting;
 
-		// Update if already active
-		int j;
+		// Update the ones already active, new ones start in step with them
 		int byteOffset = 0;
-		for (j=0 ; j<snd_audioAL.numChannels ; j++)
+		bool bHaveOffset = false;
+		for (int j=0 ; j<snd_audioAL.numChannels ; j++)
 		{
 			channel_t *ch = &snd_alOutChannels[j];
-			if (ch->sfx != sfx)
+			if (ch->sfx != loop->sfx)
 				continue;
 
-			alGetSourcei(ch->alSourceNum, AL_BYTE_OFFSET, &byteOffset);
+			if (!bHaveOffset)
+			{
+				alGetSourcei(ch->alSourceNum, AL_BYTE_OFFSET, &byteOffset);
+				bHaveOffset = true;
+			}
 
 			if (ch->alRawStream)
 				continue;
 			if (!ch->alLooping)
 				continue;
-			if (ch->alLoopEntNum != ent->number)
+			if (snd_alLoopStamps[ch->alLoopEntNum] != waiting)
 				continue;
 			if (ch->alLoopFrame + 1 != snd_audioAL.frameCount)
 				continue;
 
 			ch->alLoopFrame = snd_audioAL.frameCount;
-			break;
+			snd_alLoopStamps[ch->alLoopEntNum] = claimed;
 		}
 
-		// Already active, and simply updated
-		if (j != snd_audioAL.numChannels)
-			continue;
+		for (int j=0 ; j<loop->numEnts ; j++)
+		{
+			// Already active, and simply updated
+			if (snd_alLoopStamps[entNums[j]] != waiting)
+				continue;
+			snd_alLoopStamps[entNums[j]] = claimed;
 
-		// Pick a channel to start the effect
-		channel_t *ch = ALSnd_PickChannel(0, CHAN_AUTO);
-		if (!ch)
-			return;
+			// Pick a channel to start the effect
+			channel_t *ch = ALSnd_PickChannel(0, CHAN_AUTO);
+			if (!ch)
+				return;
 
-		ch->alLooping = true;
-		ch->alLoopEntNum = ent->number;
-		ch->alLoopFrame = snd_audioAL.frameCount;
-		ch->alRawStream = false;
-		ch->alVolume = 1;
-		ch->psType = PSND_ENTITY;
-		ch->distMult = 1.0f / ATTN_STATIC;
+			ch->alLooping = true;
+			ch->alLoopEntNum = entNums[j];
+			ch->alLoopFrame = snd_audioAL.frameCount;
+			ch->alRawStream = false;
+			ch->alVolume = 1;
+			ch->psType = PSND_ENTITY;
+			ch->distMult = 1.0f / ATTN_STATIC;
 
-		ALSnd_SpatializeChannel(ch);
-		ALSnd_StartChannel(ch, sfx);
-		alSourcei(ch->alSourceNum, AL_BYTE_OFFSET, byteOffset);
+			ALSnd_SpatializeChannel(ch);
+			ALSnd_StartChannel(ch, loop->sfx);
+			alSourcei(ch->alSourceNum, AL_BYTE_OFFSET, byteOffset);
+		}
 	}
 }
 
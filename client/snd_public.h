@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 void	Snd_Activate (const bool bActive);
 
 void	Snd_BeginRegistration ();
+void	Snd_PrefetchSounds ();
 struct	sfx_t *Snd_RegisterSound (char *sample);
 void	Snd_EndRegistration ();
 
@@ -41,6 +42,9 @@ channel_t *Snd_RawStart ();
 void	Snd_RawSamples (channel_t *rawChannel, int samples, int rate, int width, int channels, byte *data);
 void	Snd_RawStop (channel_t *rawChannel);
 
+bool	Snd_StreamFile (char *name, const bool bLoop);
+void	Snd_StopStream ();
+
 void	Snd_Update (refDef_t *rd);
 
 /*
@@ -0,0 +1,597 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+//
+// snd_stream.cpp
+// Streamed DMA sources: cinematic sound, and WAV files played as they decode
+//
+
+#include "snd_local.h"
+
+// A stream is a single producer, single consumer ring of stereo pairs at the
+// mixer's rate, in the paint buffer's 16-bit float units. The producer
+// converts and resamples into it and only moves writePos, the consumer (the
+// mixer, or snd_streamtest) only moves readPos. A producer that finds the
+// ring full waits for the consumer instead of writing over what hasn't
+// played yet.
+//
+// Pushed streams are fed by their owner through Snd_StreamWrite. File streams
+// have a thread of their own reading the WAV data a chunk at a time; the file
+// is opened on the calling thread and only touched by that thread after.
+// Streams come from the generic pool, they outlive sound registrations.
+
+#define STREAM_RING			16384		// sample pairs, a power of two
+#define STREAM_CHUNK		4096		// input frames converted at a time
+#define STREAM_HEADER		65536		// most of a WAV file read looking for its data
+#define STREAM_WAIT_MS		2
+
+struct sndStream_t {
+	sfxMixPair_t		ring[STREAM_RING];
+	volatile long		writePos;		// only moved by the producer
+	volatile long		readPos;		// only moved by the consumer
+
+	int					outRate;
+
+	// Producer. Input frames are interleaved and the first is carried over
+	// from the last chunk, so the resampler runs across chunk boundaries.
+	float				input[(STREAM_CHUNK+1)*2];
+	double				inputPos;		// of the next output, in input frames
+	bool				bPrimed;		// input[0] holds a frame
+	uint32				blocked;		// waits for room in the ring
+	uint32				dropped;		// pairs given up on after waiting
+
+	// File source
+	fileHandle_t		fileNum;
+	byte				fileBuffer[STREAM_CHUNK*4];
+	int					rate;
+	int					width;
+	int					channels;
+	int					dataLen;
+	int					dataLeft;
+	bool				bLoop;
+	sysThread_t			*thread;
+	volatile bool		bQuit;
+	volatile bool		bFinished;		// all of it is in the ring, or the writer stopped
+
+	// Consumer
+	bool				bPlaying;		// the last read was filled
+	bool				bStarved;		// ran dry while playing
+	uint32				underruns;		// ran dry and then carried on
+};
+
+/*
+===============================================================================
+
+	KERNELS
+
+===============================================================================
+*/
+
+/*
+================
+Snd_StreamDecode
+
+Converts frames of 8 or 16-bit, mono or stereo PCM to interleaved stereo
+floats in 16-bit units.
+================
+*/
+static void Snd_StreamDecode (const byte *data, const int numFrames, const int width, const int channels, float *out)
+{
+	int		i;
+
+	i = 0;
+	if (width == 2) {
+		const sint16 *in = (const sint16 *)data;
+
+#ifdef SND_SSE2
+		if (snd_dmaSSE2) {
+			// Sign extend eight samples into two sets of four
+			if (channels == 2) {
+				for ( ; i+4<=numFrames ; i+=4) {
+					__m128i s = _mm_loadu_si128 ((const __m128i *)&in[i*2]);
+					_mm_storeu_ps (&out[i*2], _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpacklo_epi16 (s, s), 16)));
+					_mm_storeu_ps (&out[i*2+4], _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpackhi_epi16 (s, s), 16)));
+				}
+			}
+			else {
+				for ( ; i+8<=numFrames ; i+=8) {
+					__m128i s = _mm_loadu_si128 ((const __m128i *)&in[i]);
+					__m128 lo = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpacklo_epi16 (s, s), 16));
+					__m128 hi = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpackhi_epi16 (s, s), 16));
+					_mm_storeu_ps (&out[i*2], _mm_unpacklo_ps (lo, lo));
+					_mm_storeu_ps (&out[i*2+4], _mm_unpackhi_ps (lo, lo));
+					_mm_storeu_ps (&out[i*2+8], _mm_unpacklo_ps (hi, hi));
+					_mm_storeu_ps (&out[i*2+12], _mm_unpackhi_ps (hi, hi));
+				}
+			}
+		}
+#endif // SND_SSE2
+
+		for ( ; i<numFrames ; i++) {
+			if (channels == 2) {
+				out[i*2] = (float)LittleShort (in[i*2]);
+				out[i*2+1] = (float)LittleShort (in[i*2+1]);
+			}
+			else {
+				out[i*2] = out[i*2+1] = (float)LittleShort (in[i]);
+			}
+		}
+	}
+	else {
+		for ( ; i<numFrames ; i++) {
+			if (channels == 2) {
+				out[i*2] = (float)(((int)data[i*2] - 128) << 8);
+				out[i*2+1] = (float)(((int)data[i*2+1] - 128) << 8);
+			}
+			else {
+				out[i*2] = out[i*2+1] = (float)(((int)data[i] - 128) << 8);
+			}
+		}
+	}
+}
+
+
+/*
+================
+Snd_StreamResample
+
+Linear interpolation from the input frames into out, until maxOut pairs are
+written or the input runs out. Returns the pairs written.
+================
+*/
+static int Snd_StreamResample (sndStream_t *stream, const int numInput, const double step, sfxMixPair_t *out, const int maxOut)
+{
+	const float	*in = stream->input;
+	double		pos = stream->inputPos;
+	const double last = numInput - 1;	// the last frame can only be interpolated towards
+	float		frac;
+	int			index, n;
+
+	n = 0;
+
+#ifdef SND_SSE2
+	if (snd_dmaSSE2) {
+		// Two pairs at a time, as (left, right, left, right)
+		for ( ; n+2<=maxOut && pos + step < last ; n+=2) {
+			const int i0 = (int)pos;
+			const int i1 = (int)(pos + step);
+			const float f0 = (float)(pos - i0);
+			const float f1 = (float)(pos + step - i1);
+
+			__m128 a = _mm_loadh_pi (_mm_loadl_pi (_mm_setzero_ps (), (const __m64 *)&in[i0*2]), (const __m64 *)&in[i1*2]);
+			__m128 b = _mm_loadh_pi (_mm_loadl_pi (_mm_setzero_ps (), (const __m64 *)&in[i0*2+2]), (const __m64 *)&in[i1*2+2]);
+			__m128 f = _mm_set_ps (f1, f1, f0, f0);
+
+			_mm_storeu_ps (&out[n].left, _mm_add_ps (a, _mm_mul_ps (_mm_sub_ps (b, a), f)));
+			pos += step * 2;
+		}
+	}
+#endif // SND_SSE2
+
+	for ( ; n<maxOut && pos < last ; n++) {
+		index = (int)pos;
+		frac = (float)(pos - index);
+
+		out[n].left = in[index*2] + (in[index*2+2] - in[index*2]) * frac;
+		out[n].right = in[index*2+1] + (in[index*2+3] - in[index*2+1]) * frac;
+		pos += step;
+	}
+
+	stream->inputPos = pos;
+	return n;
+}
+
+
+/*
+================
+Snd_StreamMix
+
+Adds count pairs from the ring at volume into out.
+================
+*/
+static void Snd_StreamMix (sfxMixPair_t *out, const sfxMixPair_t *in, const int count, const float volume)
+{
+	int		i;
+
+	i = 0;
+#ifdef SND_SSE2
+	if (snd_dmaSSE2) {
+		const __m128 vol = _mm_set1_ps (volume);
+		for ( ; i+2<=count ; i+=2)
+			_mm_storeu_ps (&out[i].left, _mm_add_ps (_mm_loadu_ps (&out[i].left), _mm_mul_ps (_mm_loadu_ps (&in[i].left), vol)));
+	}
+#endif // SND_SSE2
+
+	for ( ; i<count ; i++) {
+		out[i].left += in[i].left * volume;
+		out[i].right += in[i].right * volume;
+	}
+}
+
+/*
+===============================================================================
+
+	PRODUCER
+
+===============================================================================
+*/
+
+/*
+================
+Snd_StreamFeed
+
+Resamples the numFrames frames decoded after the carried one into the ring,
+waiting for room as it goes. A waitMS under zero waits for as long as it
+takes, or until the stream is closed; otherwise whatever doesn't fit in
+time is dropped.
+================
+*/
+static void Snd_StreamFeed (sndStream_t *stream, const int numFrames, const double step, const int waitMS)
+{
+	const int	numInput = numFrames + 1;
+	long		write, space, contiguous;
+	int			waited, written, remaining;
+
+	if (numFrames <= 0)
+		return;
+
+	// The first frame of a stream has nothing before it
+	if (!stream->bPrimed) {
+		stream->input[0] = stream->input[2];
+		stream->input[1] = stream->input[3];
+		stream->inputPos = 1.0;
+		stream->bPrimed = true;
+	}
+
+	waited = 0;
+	while (stream->inputPos < numInput - 1) {
+		write = stream->writePos;
+		space = STREAM_RING - (write - Sys_AtomicAdd (&stream->readPos, 0));
+		if (!space) {
+			if (stream->bQuit)
+				return;
+
+			if (waitMS >= 0 && waited >= waitMS) {
+				// Give up on the rest of the chunk
+				remaining = (int)ceil ((numInput - 1 - stream->inputPos) / step);
+				stream->dropped += remaining;
+				stream->inputPos += remaining * step;
+				break;
+			}
+
+			stream->blocked++;
+			Sys_Sleep (STREAM_WAIT_MS);
+			waited += STREAM_WAIT_MS;
+			continue;
+		}
+
+		contiguous = STREAM_RING - (write & (STREAM_RING-1));
+		written = Snd_StreamResample (stream, numInput, step, &stream->ring[write & (STREAM_RING-1)], (int)min (space, contiguous));
+
+		// Full barrier, the pairs land before the consumer can see them
+		Sys_AtomicAdd (&stream->writePos, written);
+	}
+
+	// Carry the last frame over to the next chunk
+	stream->inputPos -= numInput - 1;
+	stream->input[0] = stream->input[numFrames*2];
+	stream->input[1] = stream->input[numFrames*2+1];
+}
+
+
+/*
+================
+Snd_StreamWrite
+
+Converts and queues raw samples on a pushed stream.
+================
+*/
+void Snd_StreamWrite (sndStream_t *stream, const byte *data, const int samples, const int rate, const int width, const int channels, const int waitMS)
+{
+	const double	step = (double)rate / stream->outRate;
+	const int		frameSize = width * channels;
+	int				frames, i;
+
+	if ((width != 1 && width != 2) || (channels != 1 && channels != 2) || rate <= 0)
+		return;
+	stream->bFinished = false;
+
+	for (i=0 ; i<samples ; i+=frames) {
+		frames = min (samples - i, STREAM_CHUNK);
+		Snd_StreamDecode (data + i*frameSize, frames, width, channels, &stream->input[2]);
+		Snd_StreamFeed (stream, frames, step, waitMS);
+	}
+}
+
+
+/*
+================
+Snd_StreamReset
+
+Starts the producer over, as if nothing had been written. The consumer
+drops what's queued with Snd_StreamFlush.
+================
+*/
+void Snd_StreamReset (sndStream_t *stream)
+{
+	stream->bPrimed = false;
+	stream->inputPos = 0;
+	stream->bFinished = true;
+}
+
+
+/*
+================
+Snd_StreamEnd
+
+The writer of a pushed stream has nothing more for now, so running dry
+after what's queued isn't a gap.
+================
+*/
+void Snd_StreamEnd (sndStream_t *stream)
+{
+	stream->bFinished = true;
+}
+
+
+/*
+================
+Snd_StreamThread
+================
+*/
+static void Snd_StreamThread (void *arg)
+{
+	sndStream_t		*stream = (sndStream_t *)arg;
+	const double	step = (double)stream->rate / stream->outRate;
+	const int		frameSize = stream->width * stream->channels;
+	int				frames, bytes;
+
+	while (!stream->bQuit) {
+		if (stream->dataLeft < frameSize) {
+			if (!stream->bLoop)
+				break;
+
+			// Back to the start of the data. Relative, as a file in a pak
+			// is opened on the pak and FS_SEEK_SET is from the pak's start.
+			FS_Seek (stream->fileNum, -(stream->dataLen - stream->dataLeft), FS_SEEK_CUR);
+			stream->dataLeft = stream->dataLen;
+		}
+
+		frames = min (stream->dataLeft / frameSize, STREAM_CHUNK);
+		bytes = FS_Read (stream->fileBuffer, frames * frameSize, stream->fileNum);
+		frames = bytes / frameSize;
+		if (frames <= 0)
+			break;
+		stream->dataLeft -= frames * frameSize;
+
+		Snd_StreamDecode (stream->fileBuffer, frames, stream->width, stream->channels, &stream->input[2]);
+		Snd_StreamFeed (stream, frames, step, -1);
+	}
+
+	stream->bFinished = true;
+}
+
+/*
+===============================================================================
+
+	CONSUMER
+
+===============================================================================
+*/
+
+/*
+================
+Snd_StreamRead
+
+Mixes up to count pairs into out at volume, and returns how many there were.
+================
+*/
+int Snd_StreamRead (sndStream_t *stream, sfxMixPair_t *out, const int count, const float volume)
+{
+	long	read, avail;
+	int		total, n, ofs;
+
+	read = stream->readPos;
+	avail = Sys_AtomicAdd (&stream->writePos, 0) - read;
+	total = (int)min (avail, (long)count);
+
+	// Up to the end of the ring, then from the start
+	ofs = read & (STREAM_RING-1);
+	n = min (total, STREAM_RING - ofs);
+	Snd_StreamMix (out, &stream->ring[ofs], n, volume);
+	Snd_StreamMix (out + n, stream->ring, total - n, volume);
+
+	// Full barrier, the pairs are read before the producer can reuse them
+	Sys_AtomicAdd (&stream->readPos, total);
+
+	// A gap only counts once the stream carries on after it
+	if (total && stream->bStarved) {
+		stream->underruns++;
+		stream->bStarved = false;
+	}
+	if (total < count) {
+		if (stream->bPlaying && !stream->bFinished)
+			stream->bStarved = true;
+		stream->bPlaying = false;
+	}
+	else {
+		stream->bPlaying = true;
+	}
+
+	return total;
+}
+
+
+/*
+================
+Snd_StreamFlush
+
+Drops everything queued, from the consumer's side.
+================
+*/
+void Snd_StreamFlush (sndStream_t *stream)
+{
+	Sys_AtomicAdd (&stream->readPos, Sys_AtomicAdd (&stream->writePos, 0) - stream->readPos);
+	stream->bPlaying = false;
+	stream->bStarved = false;
+}
+
+
+/*
+================
+Snd_StreamFinished
+
+True once a file stream has decoded all of its data and it has all been read.
+================
+*/
+bool Snd_StreamFinished (sndStream_t *stream)
+{
+	return stream->bFinished && Sys_AtomicAdd (&stream->writePos, 0) == stream->readPos;
+}
+
+
+/*
+================
+Snd_StreamQueued
+
+Pairs waiting to be read, from the consumer's side.
+================
+*/
+int Snd_StreamQueued (sndStream_t *stream)
+{
+	return Sys_AtomicAdd (&stream->writePos, 0) - stream->readPos;
+}
+
+
+/*
+================
+Snd_StreamStats
+================
+*/
+void Snd_StreamStats (const sndStream_t *stream, uint32 &underruns, uint32 &blocked, uint32 &dropped)
+{
+	underruns = stream->underruns;
+	blocked = stream->blocked;
+	dropped = stream->dropped;
+}
+
+/*
+===============================================================================
+
+	OPEN / CLOSE
+
+===============================================================================
+*/
+
+/*
+================
+Snd_OpenStream
+
+A stream fed with Snd_StreamWrite.
+================
+*/
+sndStream_t *Snd_OpenStream (const int outRate)
+{
+	sndStream_t	*stream;
+
+	stream = (sndStream_t *)Mem_Alloc (sizeof(sndStream_t));
+	memset (stream, 0, sizeof(sndStream_t));
+	stream->outRate = outRate;
+
+	return stream;
+}
+
+
+/*
+================
+Snd_OpenFileStream
+
+Starts decoding a WAV file on its own thread. NULL if the file can't be
+streamed.
+================
+*/
+sndStream_t *Snd_OpenFileStream (char *name, const int outRate, const bool bLoop)
+{
+	sndStream_t		*stream;
+	fileHandle_t	fileNum;
+	wavInfo_t		info;
+	byte			*header;
+	int				fileLen, headerLen;
+
+	fileLen = FS_OpenFile (name, &fileNum, FS_MODE_READ_BINARY);
+	if (!fileNum) {
+		Com_Printf (PRNT_WARNING, "Snd_OpenFileStream: couldn't open %s\n", name);
+		return NULL;
+	}
+
+	// Only the header is parsed here, the data is read as it plays
+	headerLen = min (fileLen, STREAM_HEADER);
+	header = (byte *)Mem_Alloc (max (headerLen, 1));
+	headerLen = FS_Read (header, headerLen, fileNum);
+	info = Snd_GetWavinfo (name, header, headerLen);
+	Mem_Free (header);
+
+	if (!info.rate || (info.width != 1 && info.width != 2) || (info.channels != 1 && info.channels != 2) || info.dataOfs <= 0 || info.dataOfs > fileLen) {
+		Com_Printf (PRNT_WARNING, "Snd_OpenFileStream: %s is not a PCM WAV file that can be streamed\n", name);
+		FS_CloseFile (fileNum);
+		return NULL;
+	}
+
+	stream = Snd_OpenStream (outRate);
+	stream->fileNum = fileNum;
+	stream->rate = info.rate;
+	stream->width = info.width;
+	stream->channels = info.channels;
+	stream->dataLen = min (info.samples * info.width, fileLen - info.dataOfs);
+	stream->dataLeft = stream->dataLen;
+	stream->bLoop = bLoop;
+	FS_Seek (fileNum, info.dataOfs - headerLen, FS_SEEK_CUR);
+
+	stream->thread = Sys_CreateThread (Snd_StreamThread, stream);
+	if (!stream->thread) {
+		Com_Printf (PRNT_WARNING, "Snd_OpenFileStream: unable to create a thread for %s\n", name);
+		Snd_CloseStream (stream);
+		return NULL;
+	}
+
+	return stream;
+}
+
+
+/*
+================
+Snd_CloseStream
+
+Nothing can be reading from it any more.
+================
+*/
+void Snd_CloseStream (sndStream_t *stream)
+{
+	if (!stream)
+		return;
+
+	if (stream->thread) {
+		stream->bQuit = true;
+		Sys_WaitForThread (stream->thread);
+	}
+	if (stream->fileNum)
+		FS_CloseFile (stream->fileNum);
+
+	Mem_Free (stream);
+}
@@ -129,6 +129,36 @@ uint32 Com_HashGenericFast(const char *name, const int hashSize)
 	return (hashValue + (hashValue >> 5)) & (hashSize-1);
 }
 
+
+/*
+================
+Com_HashBlock
+
+FNV-1a a word at a time with a fold, since some of what's hashed runs to
+several megabytes. Safe to call from a job.
+================
+*/
+uint32 Com_HashBlock(const void *buffer, const int length)
+{
+	const byte *in = (const byte *)buffer;
+	uint32 hash = COM_FNV_SEED;
+
+	const int numWords = length >> 2;
+	for (int i=0 ; i<numWords ; i++)
+	{
+		uint32 word;
+		memcpy(&word, in + i*4, sizeof(word));
+
+		hash = Com_FNVMix(hash, word);
+		hash ^= hash >> 15;
+	}
+
+	for (int i=numWords*4 ; i<length ; i++)
+		hash = Com_FNVMix(hash, in[i]);
+
+	return hash;
+}
+
 /*
 ============================================================================
 
@@ -764,6 +794,8 @@ void Com_Init(int argc, char **argv)
 	Lua_Init();
 
 	// Init the rest of the sub-systems
+	Prof_Init ();
+	Job_Init ();
 	NET_Init ();
 	Netchan_Init ();
 
@@ -814,6 +846,8 @@ void __fastcall Com_Frame(int msec)
 	if (setjmp(abortFrame))
 		return;			// an ERR_DROP was thrown
 
+	Prof_Frame();
+
 	if (fixedtime->floatVal)
 	{
 		msec = fixedtime->floatVal;
@@ -838,12 +872,18 @@ void __fastcall Com_Frame(int msec)
 	Cbuf_Execute();
 
 	// Update server
-	SV_Frame(msec);
+	{
+		qProfile_Scope Prof("Server");
+		SV_Frame(msec);
+	}
 
 #ifndef DEDICATED_ONLY
 	// Update client
 	if (!dedicated->intVal)
+	{
+		qProfile_Scope Prof("Client");
 		CL_Frame(msec);
+	}
 #endif
 }
 
@@ -857,4 +897,5 @@ void Com_Shutdown ()
 {
 	NET_Shutdown ();
 	Lua_Shutdown();
+	Job_Shutdown ();
 }
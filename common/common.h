@@ -64,6 +64,11 @@ uint32		Com_HashFileName(const char *fileName, const int hashSize);
 uint32		Com_HashGeneric(const char *name, const int hashSize);
 uint32		Com_HashGenericFast(const char *name, const int hashSize);
 
+// FNV-1a, for cache keys and checksums
+#define COM_FNV_SEED	2166136261u
+inline uint32 Com_FNVMix(const uint32 hash, const uint32 value) { return (hash ^ value) * 16777619u; }
+uint32		Com_HashBlock(const void *buffer, const int length);
+
 // client/server interactions
 void		Com_BeginRedirect (int target, char *buffer, int bufferSize, void (*flush)(int target, char *buffer));
 void		Com_EndRedirect ();
@@ -137,6 +142,23 @@ void		Sys_FindClose ();
 
 TList<String> Sys_FindFiles (char *path, char *pattern, int fileCount, bool recurse, bool addFiles, bool addDirs);
 
+// threads
+struct sysThread_t;
+struct sysSemaphore_t;
+
+sysThread_t	*Sys_CreateThread (void (*func) (void *arg), void *arg);
+void		Sys_WaitForThread (sysThread_t *thread);
+
+sysSemaphore_t *Sys_CreateSemaphore ();
+void		Sys_DestroySemaphore (sysSemaphore_t *sem);
+void		Sys_SemaphorePost (sysSemaphore_t *sem);
+void		Sys_SemaphoreWait (sysSemaphore_t *sem);
+
+long		Sys_AtomicAdd (volatile long *value, const long amount);	// returns the new value
+void		Sys_Sleep (const int msec);
+int			Sys_NumProcessors ();
+bool		Sys_HasSSE2 ();		// for the renderer and mixer kernels
+
 // ==========================================================================
 
 char		*Sys_ConsoleInput ();
@@ -146,6 +168,167 @@ void		Sys_CreateConsole ();
 void		Sys_SetConsoleTitle (const char *buf);
 void		Sys_SetErrorText (const char *buf);
 
+/*
+==============================================================================
+
+	JOBS
+
+	A small pool of worker threads for splitting independent work into
+	numbered jobs. Job_Run hands the jobs out to the workers and the calling
+	thread, and returns once all of them are done. Jobs must not touch the
+	memory, cvar, command or console systems; write results into buffers
+	indexed by jobNum and merge them afterwards on the calling thread.
+==============================================================================
+*/
+
+void		Job_Init ();
+void		Job_Shutdown ();
+
+int			Job_NumThreads ();	// workers plus the calling thread
+void		Job_Run (jobFunc_t func, void *arg, const int numJobs);
+
+/*
+==============================================================================
+
+	DISK CACHES
+
+	Processed data kept between runs, a .pca file per cache, little endian:
+	[header]	magic, version, setup key, entry count, index offset, index hash, generation
+	[data]	entry payloads, back to back
+	[index]	one record per entry
+	An entry is keyed on a name plus a key, and checked against the length
+	and Com_HashBlock of the file it was made from. A different setup key
+	throws out the whole file.
+
+	Only the index is read at open. The file stays open, and a payload is read
+	out of it when its entry is found. Stored entries are held in memory until
+	a write puts them over the old index and a new index after them. Replaced
+	entries leave dead space behind, dropped by rewriting the file once it
+	makes up a third of it, or once the file is over budget, which evicts the
+	least recently used entries as well. Main thread only, except for
+	DiskCache_HasSource.
+==============================================================================
+*/
+
+struct diskCacheEntry_t {
+	char				name[MAX_QPATH];
+	uint32				key;
+	uint32				sourceLen;
+	uint32				sourceHash;
+
+	uint32				dataOfs;
+	uint32				dataLen;		// as stored, under rawLen when deflated
+	uint32				rawLen;
+	uint32				lastUsed;		// generation it was last stored or found in
+
+	byte				*pending;		// payload that isn't in the file yet
+};
+
+struct diskCache_t {
+	// Filled in before DiskCache_Open
+	const char			*fileName;
+	const char			*tempName;		// written while compacting
+	uint32				magic;
+	uint32				version;
+	uint32				setupKey;
+	uint32				maxEntries;		// power of two
+	uint32				maxPayload;
+	uint32				maxPending;		// written out early past this, 0 waits for a write
+	uint32				budget;			// file size that triggers eviction, 0 for none
+	bool				bCompress;		// deflate the payloads that get smaller
+	struct memPool_t	*pool;
+
+	// Managed by DiskCache_*
+	fileHandle_t		file;
+	uint32				dataEnd;		// where the index starts, and new payloads go
+	uint32				liveBytes;		// bytes of the data that are still indexed
+	uint32				pendingBytes;
+	uint32				generation;		// bumped every open
+	bool				bDirty;
+
+	diskCacheEntry_t	*entries;		// NULL when not open
+	uint32				numEntries;
+	int					*hash;			// maxEntries*2 slots, entry number + 1, 0 is empty
+
+	uint32				hits;
+	uint32				misses;
+	uint32				stale;
+	uint32				bytesRead;
+	double				readMS;
+};
+
+void		DiskCache_Open (diskCache_t *cache);
+void		DiskCache_Close (diskCache_t *cache);	// writes anything new first
+void		DiskCache_Write (diskCache_t *cache);
+void		DiskCache_Compact (diskCache_t *cache, const bool bDropMissing, uint32 &numEvicted, uint32 &numMissing);
+
+diskCacheEntry_t *DiskCache_Find (diskCache_t *cache, const char *name, const uint32 key, const uint32 sourceLen, const uint32 sourceHash);
+bool		DiskCache_Read (diskCache_t *cache, diskCacheEntry_t *entry, byte *out);	// out holds entry->rawLen
+bool		DiskCache_HasSource (const diskCache_t *cache, const char *name, const uint32 sourceLen, const uint32 sourceHash);
+void		DiskCache_Store (diskCache_t *cache, const char *name, const uint32 key, const uint32 sourceLen, const uint32 sourceHash, byte *data, const uint32 length);
+
+void		DiskCache_PrintStats (const diskCache_t *cache, const char *title);
+
+/*
+==============================================================================
+
+	PROFILER
+
+	Hierarchical scoped timers for the client, cgame and renderer. Zones are
+	opened and closed on the main thread and nest by depth. Every frame is
+	recorded into its own slot of a ring buffer, which is only read once
+	Prof_Frame has moved on from it. com_profile 1 records, 2 and up also
+	draw the stacked graph; see prof_summary and prof_trace.
+==============================================================================
+*/
+
+#define PROF_MAX_FRAMES		128
+#define PROF_MAX_EVENTS		256
+
+struct profEvent_t
+{
+	const char		*name;
+	uint32			start;		// Sys_Cycles
+	uint32			end;
+	int				depth;
+};
+
+struct profFrame_t
+{
+	uint32			start;
+	uint32			end;
+	int				numEvents;
+	profEvent_t		events[PROF_MAX_EVENTS];
+};
+
+extern cVar_t	*com_profile;
+
+void		Prof_Init ();
+void		Prof_Frame ();
+void		Prof_Clear ();
+
+bool		Prof_Active ();
+int			Prof_Begin (const char *name);	// returns -1 when not recording
+void		Prof_End (const int event);
+
+const profFrame_t *Prof_GetFrame (const int age);	// age 1 is the last completed frame
+
+class qProfile_Scope
+{
+protected:
+	int Event;
+
+public:
+	qProfile_Scope(const char *Name)
+		: Event(Prof_Begin(Name))
+	{
+	}
+	~qProfile_Scope()
+	{
+		Prof_End(Event);
+	}
+};
+
 /*
 =============================================================================
 
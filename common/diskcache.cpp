@@ -0,0 +1,859 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+//
+// diskcache.cpp
+// The file format behind the sound, model, material and image caches
+//
+
+#include "common.h"
+#include "zlib.h"
+
+struct diskCacheHeader_t {
+	uint32				magic;
+	uint32				version;
+	uint32				setupKey;
+	uint32				numEntries;
+	uint32				indexOfs;
+	uint32				indexHash;
+	uint32				generation;
+};
+
+struct diskCacheIndex_t {
+	char				name[MAX_QPATH];
+	uint32				key;
+	uint32				sourceLen;
+	uint32				sourceHash;
+	uint32				dataOfs;
+	uint32				dataLen;
+	uint32				rawLen;
+	uint32				lastUsed;
+};
+
+/*
+=============================================================================
+
+	COMPRESSION
+
+=============================================================================
+*/
+
+/*
+=================
+DiskCache_Deflate
+
+Returns the packed length, or 0 if it didn't fit in outLen.
+=================
+*/
+static uint32 DiskCache_Deflate (byte *in, const uint32 inLen, byte *out, const uint32 outLen)
+{
+	z_stream	zs;
+	int			result;
+
+	memset (&zs, 0, sizeof(zs));
+	if (deflateInit2 (&zs, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return 0;
+
+	zs.next_in = in;
+	zs.avail_in = inLen;
+	zs.next_out = out;
+	zs.avail_out = outLen;
+
+	result = deflate (&zs, Z_FINISH);
+	deflateEnd (&zs);
+
+	return (result == Z_STREAM_END) ? zs.total_out : 0;
+}
+
+
+/*
+=================
+DiskCache_Inflate
+=================
+*/
+static bool DiskCache_Inflate (byte *in, const uint32 inLen, byte *out, const uint32 outLen)
+{
+	z_stream	zs;
+	int			result;
+
+	memset (&zs, 0, sizeof(zs));
+	if (inflateInit2 (&zs, -MAX_WBITS) != Z_OK)
+		return false;
+
+	zs.next_in = in;
+	zs.avail_in = inLen;
+	zs.next_out = out;
+	zs.avail_out = outLen;
+
+	result = inflate (&zs, Z_FINISH);
+	inflateEnd (&zs);
+
+	return (result == Z_STREAM_END && zs.total_out == outLen);
+}
+
+
+struct diskCachePackJob_t {
+	diskCacheEntry_t	*entry;
+	byte				*out;
+	uint32				outLen;
+};
+
+static void DiskCache_PackJob (void *arg, int jobNum)
+{
+	diskCachePackJob_t	*job = &((diskCachePackJob_t *)arg)[jobNum];
+
+	job->outLen = DiskCache_Deflate (job->entry->pending, job->entry->rawLen, job->out, job->entry->rawLen);
+}
+
+
+/*
+=================
+DiskCache_PackPending
+
+Deflates everything waiting to be written on the job threads, keeping the raw
+payload for anything that doesn't get smaller.
+=================
+*/
+static void DiskCache_PackPending (diskCache_t *cache)
+{
+	diskCachePackJob_t	*jobs;
+	diskCacheEntry_t	*entry;
+	int					numJobs, i;
+	uint32				j;
+
+	if (!cache->bCompress || !cache->pendingBytes)
+		return;
+
+	jobs = (diskCachePackJob_t *)Mem_PoolAlloc (sizeof(diskCachePackJob_t) * cache->numEntries, cache->pool, 0);
+	numJobs = 0;
+	for (j=0 ; j<cache->numEntries ; j++) {
+		entry = &cache->entries[j];
+		if (!entry->pending)
+			continue;
+
+		jobs[numJobs].entry = entry;
+		jobs[numJobs].out = (byte *)Mem_PoolAlloc (entry->rawLen, cache->pool, 0);
+		numJobs++;
+	}
+
+	Job_Run (DiskCache_PackJob, jobs, numJobs);
+
+	for (i=0 ; i<numJobs ; i++) {
+		entry = jobs[i].entry;
+		if (jobs[i].outLen && jobs[i].outLen < entry->rawLen) {
+			Mem_Free (entry->pending);
+			entry->pending = jobs[i].out;
+			entry->dataLen = jobs[i].outLen;
+		}
+		else {
+			Mem_Free (jobs[i].out);
+		}
+	}
+
+	Mem_Free (jobs);
+}
+
+/*
+=============================================================================
+
+	LOOKUP
+
+=============================================================================
+*/
+
+/*
+=================
+DiskCache_HashSlot
+
+Returns the hash slot holding name and key, or the empty slot it belongs in.
+=================
+*/
+static int DiskCache_HashSlot (const diskCache_t *cache, const char *name, const uint32 key)
+{
+	const diskCacheEntry_t	*entry;
+	const uint32			hashSize = cache->maxEntries * 2;
+	uint32					slot;
+
+	slot = Com_HashGeneric (name, hashSize);
+	for ( ; ; slot = (slot + 1) & (hashSize-1)) {
+		if (!cache->hash[slot])
+			return slot;
+
+		entry = &cache->entries[cache->hash[slot]-1];
+		if (entry->key == key && !strcmp (entry->name, name))
+			return slot;
+	}
+}
+
+
+/*
+=================
+DiskCache_Find
+
+Returns the entry for name and key if it was made from this exact source,
+otherwise NULL, counted as a miss or as stale.
+=================
+*/
+diskCacheEntry_t *DiskCache_Find (diskCache_t *cache, const char *name, const uint32 key, const uint32 sourceLen, const uint32 sourceHash)
+{
+	diskCacheEntry_t	*entry;
+	int					slot;
+
+	if (!cache->entries)
+		return NULL;
+
+	slot = DiskCache_HashSlot (cache, name, key);
+	if (!cache->hash[slot]) {
+		cache->misses++;
+		return NULL;
+	}
+
+	entry = &cache->entries[cache->hash[slot]-1];
+	if (entry->sourceLen != sourceLen || entry->sourceHash != sourceHash) {
+		cache->stale++;
+		return NULL;
+	}
+
+	return entry;
+}
+
+
+/*
+=================
+DiskCache_Read
+
+Fills out with the payload of an entry from DiskCache_Find, inflating it if it
+was stored deflated. Counts a hit, or a miss if the entry turns out damaged.
+=================
+*/
+bool DiskCache_Read (diskCache_t *cache, diskCacheEntry_t *entry, byte *out)
+{
+	byte	*data;
+	uint32	startCycles;
+	bool	bValid;
+
+	if (entry->pending) {
+		memcpy (out, entry->pending, entry->rawLen);
+	}
+	else {
+		startCycles = Sys_Cycles ();
+
+		data = (entry->dataLen < entry->rawLen) ? (byte *)Mem_PoolAlloc (entry->dataLen, cache->pool, 0) : out;
+		FS_Seek (cache->file, entry->dataOfs, FS_SEEK_SET);
+		bValid = (FS_Read (data, entry->dataLen, cache->file) == (int)entry->dataLen);
+		if (data != out) {
+			if (bValid)
+				bValid = DiskCache_Inflate (data, entry->dataLen, out, entry->rawLen);
+			Mem_Free (data);
+		}
+
+		if (!bValid) {
+			Com_Printf (PRNT_WARNING, "DiskCache_Read: %s entry for '%s' is damaged\n", cache->fileName, entry->name);
+			cache->misses++;
+			return false;
+		}
+
+		cache->bytesRead += entry->dataLen;
+		cache->readMS += (Sys_Cycles () - startCycles) * Sys_MSPerCycle ();
+	}
+
+	// Only eviction looks at this, so only a budget makes it worth an index write
+	if (cache->budget && entry->lastUsed != cache->generation) {
+		entry->lastUsed = cache->generation;
+		cache->bDirty = true;
+	}
+
+	cache->hits++;
+	return true;
+}
+
+
+/*
+=================
+DiskCache_HasSource
+
+True if any entry was made from this exact source file, whatever its key.
+Only reads the table, so it's safe to call from a job.
+=================
+*/
+bool DiskCache_HasSource (const diskCache_t *cache, const char *name, const uint32 sourceLen, const uint32 sourceHash)
+{
+	const diskCacheEntry_t	*entry;
+	const uint32			hashSize = cache->maxEntries * 2;
+	uint32					slot;
+
+	if (!cache->entries)
+		return false;
+
+	// Every key for a name lands in the same run of slots
+	slot = Com_HashGeneric (name, hashSize);
+	for ( ; cache->hash[slot] ; slot = (slot + 1) & (hashSize-1)) {
+		entry = &cache->entries[cache->hash[slot]-1];
+		if (entry->sourceLen == sourceLen && entry->sourceHash == sourceHash && !strcmp (entry->name, name))
+			return true;
+	}
+
+	return false;
+}
+
+
+/*
+=================
+DiskCache_Store
+
+Takes ownership of data, which must come from Mem_PoolAlloc, and holds it
+until the next write.
+=================
+*/
+void DiskCache_Store (diskCache_t *cache, const char *name, const uint32 key, const uint32 sourceLen, const uint32 sourceHash, byte *data, const uint32 length)
+{
+	diskCacheEntry_t	*entry;
+	int					slot;
+
+	if (!cache->entries || !length || length > cache->maxPayload) {
+		Mem_Free (data);
+		return;
+	}
+
+	slot = DiskCache_HashSlot (cache, name, key);
+	if (cache->hash[slot]) {
+		// Replace the stale one
+		entry = &cache->entries[cache->hash[slot]-1];
+		if (entry->pending) {
+			cache->pendingBytes -= entry->rawLen;
+			Mem_Free (entry->pending);
+		}
+		else {
+			cache->liveBytes -= entry->dataLen;
+		}
+	}
+	else {
+		if (cache->numEntries >= cache->maxEntries) {
+			Mem_Free (data);
+			return;
+		}
+
+		entry = &cache->entries[cache->numEntries++];
+		cache->hash[slot] = cache->numEntries;
+		Q_strncpyz (entry->name, name, sizeof(entry->name));
+		entry->key = key;
+	}
+
+	entry->sourceLen = sourceLen;
+	entry->sourceHash = sourceHash;
+	entry->dataOfs = 0;
+	entry->dataLen = length;
+	entry->rawLen = length;
+	entry->lastUsed = cache->generation;
+	entry->pending = data;
+
+	cache->pendingBytes += length;
+	cache->bDirty = true;
+
+	// Don't let a big registration hold on to everything until it ends
+	if (cache->maxPending && cache->pendingBytes >= cache->maxPending)
+		DiskCache_Write (cache);
+}
+
+/*
+=============================================================================
+
+	FILE
+
+=============================================================================
+*/
+
+/*
+=================
+DiskCache_Clear
+=================
+*/
+static void DiskCache_Clear (diskCache_t *cache)
+{
+	uint32	i;
+
+	for (i=0 ; i<cache->numEntries ; i++) {
+		if (cache->entries[i].pending)
+			Mem_Free (cache->entries[i].pending);
+	}
+
+	if (cache->file) {
+		FS_CloseFile (cache->file);
+		cache->file = 0;
+	}
+
+	memset (cache->hash, 0, sizeof(int) * cache->maxEntries * 2);
+	cache->numEntries = 0;
+	cache->dataEnd = 0;
+	cache->liveBytes = 0;
+	cache->pendingBytes = 0;
+	cache->bDirty = false;
+}
+
+
+/*
+=================
+DiskCache_ReadIndex
+
+Opens the file and reads the index. Payloads are left on disk.
+=================
+*/
+static void DiskCache_ReadIndex (diskCache_t *cache)
+{
+	diskCacheHeader_t	header;
+	diskCacheIndex_t	*index, *in;
+	diskCacheEntry_t	*entry;
+	uint32				numEntries, indexOfs, indexLen;
+	uint32				dataOfs, dataLen, rawLen, key, i;
+	int					fileLen, slot;
+
+	fileLen = FS_OpenFile (cache->fileName, &cache->file, FS_MODE_READ_WRITE_BINARY);
+	if (!cache->file)
+		return;
+
+	if (fileLen < (int)sizeof(header)
+	|| FS_Read (&header, sizeof(header), cache->file) != sizeof(header)
+	|| LittleLong (header.magic) != cache->magic
+	|| LittleLong (header.version) != cache->version
+	|| LittleLong (header.setupKey) != cache->setupKey) {
+		Com_DevPrintf (0, "DiskCache_ReadIndex: ignoring old or invalid %s\n", cache->fileName);
+		DiskCache_Clear (cache);
+		return;
+	}
+
+	numEntries = LittleLong (header.numEntries);
+	indexOfs = LittleLong (header.indexOfs);
+	indexLen = numEntries * sizeof(diskCacheIndex_t);
+	if (numEntries > cache->maxEntries || indexOfs < sizeof(header) || indexOfs > (uint32)fileLen || indexLen > (uint32)fileLen - indexOfs) {
+		Com_Printf (PRNT_WARNING, "DiskCache_ReadIndex: %s is truncated, ignoring\n", cache->fileName);
+		DiskCache_Clear (cache);
+		return;
+	}
+
+	index = (diskCacheIndex_t *)Mem_PoolAlloc (max(indexLen, 1u), cache->pool, 0);
+	FS_Seek (cache->file, indexOfs, FS_SEEK_SET);
+	if (FS_Read (index, indexLen, cache->file) != (int)indexLen
+	|| Com_HashBlock (index, indexLen) != LittleLong (header.indexHash)) {
+		// Most likely a write that didn't finish
+		Com_Printf (PRNT_WARNING, "DiskCache_ReadIndex: %s has a damaged index, ignoring\n", cache->fileName);
+		Mem_Free (index);
+		DiskCache_Clear (cache);
+		return;
+	}
+
+	cache->dataEnd = indexOfs;
+	cache->generation = LittleLong (header.generation) + 1;
+
+	for (i=0, in=index ; i<numEntries ; i++, in++) {
+		dataOfs = LittleLong (in->dataOfs);
+		dataLen = LittleLong (in->dataLen);
+		rawLen = LittleLong (in->rawLen);
+
+		// Every payload has to sit between the header and the index
+		if (dataOfs < sizeof(header) || dataOfs > indexOfs || dataLen > indexOfs - dataOfs)
+			continue;
+		if (!dataLen || dataLen > rawLen || rawLen > cache->maxPayload)
+			continue;
+		if (!memchr (in->name, 0, sizeof(in->name)))
+			continue;
+
+		key = LittleLong (in->key);
+		slot = DiskCache_HashSlot (cache, in->name, key);
+		if (cache->hash[slot])
+			continue;
+
+		entry = &cache->entries[cache->numEntries++];
+		cache->hash[slot] = cache->numEntries;
+
+		Q_strncpyz (entry->name, in->name, sizeof(entry->name));
+		entry->key = key;
+		entry->sourceLen = LittleLong (in->sourceLen);
+		entry->sourceHash = LittleLong (in->sourceHash);
+		entry->dataOfs = dataOfs;
+		entry->dataLen = dataLen;
+		entry->rawLen = rawLen;
+		entry->lastUsed = LittleLong (in->lastUsed);
+		entry->pending = NULL;
+
+		cache->liveBytes += dataLen;
+	}
+
+	Mem_Free (index);
+}
+
+
+/*
+=================
+DiskCache_WriteIndex
+
+Writes the index at indexOfs, then the header that points at it.
+=================
+*/
+static void DiskCache_WriteIndex (diskCache_t *cache, fileHandle_t fileNum, const uint32 indexOfs)
+{
+	const diskCacheEntry_t	*entry;
+	diskCacheHeader_t		header;
+	diskCacheIndex_t		*index;
+	uint32					indexLen, i;
+
+	indexLen = cache->numEntries * sizeof(diskCacheIndex_t);
+	index = (diskCacheIndex_t *)Mem_PoolAlloc (max(indexLen, 1u), cache->pool, 0);
+
+	for (i=0 ; i<cache->numEntries ; i++) {
+		entry = &cache->entries[i];
+		assert (!entry->pending);
+
+		memset (&index[i], 0, sizeof(diskCacheIndex_t));
+		Q_strncpyz (index[i].name, entry->name, sizeof(index[i].name));
+		index[i].key = LittleLong (entry->key);
+		index[i].sourceLen = LittleLong (entry->sourceLen);
+		index[i].sourceHash = LittleLong (entry->sourceHash);
+		index[i].dataOfs = LittleLong (entry->dataOfs);
+		index[i].dataLen = LittleLong (entry->dataLen);
+		index[i].rawLen = LittleLong (entry->rawLen);
+		index[i].lastUsed = LittleLong (entry->lastUsed);
+	}
+
+	FS_Seek (fileNum, indexOfs, FS_SEEK_SET);
+	FS_Write (index, indexLen, fileNum);
+
+	header.magic = LittleLong (cache->magic);
+	header.version = LittleLong (cache->version);
+	header.setupKey = LittleLong (cache->setupKey);
+	header.numEntries = LittleLong (cache->numEntries);
+	header.indexOfs = LittleLong (indexOfs);
+	header.indexHash = LittleLong (Com_HashBlock (index, indexLen));
+	header.generation = LittleLong (cache->generation);
+	FS_Seek (fileNum, 0, FS_SEEK_SET);
+	FS_Write (&header, sizeof(header), fileNum);
+
+	Mem_Free (index);
+}
+
+
+static const diskCache_t	*dc_sortCache;
+
+static int DiskCache_AgeCmp (const void *a, const void *b)
+{
+	const uint32	ua = dc_sortCache->entries[*(const int *)a].lastUsed;
+	const uint32	ub = dc_sortCache->entries[*(const int *)b].lastUsed;
+
+	return (ua > ub) ? -1 : (ua < ub) ? 1 : 0;
+}
+
+
+/*
+=================
+DiskCache_Rewrite
+
+Copies the entries worth keeping to a new file and swaps it in. With a budget
+that's the most recently used ones that fit in three quarters of it. Nothing
+can be pending.
+=================
+*/
+static void DiskCache_Rewrite (diskCache_t *cache, const bool bDropMissing, uint32 &numEvicted, uint32 &numMissing)
+{
+	diskCacheHeader_t	header;
+	diskCacheEntry_t	entry;
+	fileHandle_t		tempFile;
+	char				path[MAX_OSPATH], tempPath[MAX_OSPATH];
+	byte				*buffer, *bKeep;
+	int					*order;
+	uint32				keepBytes, keptBytes, largest;
+	uint32				offset, numKept, i;
+
+	numEvicted = numMissing = 0;
+	if (!cache->file)
+		return;
+
+	// Pick what survives, newest first
+	order = (int *)Mem_PoolAlloc (sizeof(int) * max(cache->numEntries, 1u), cache->pool, 0);
+	bKeep = (byte *)Mem_PoolAlloc (max(cache->numEntries, 1u), cache->pool, 0);
+	for (i=0 ; i<cache->numEntries ; i++)
+		order[i] = i;
+	if (cache->budget) {
+		dc_sortCache = cache;
+		qsort (order, cache->numEntries, sizeof(int), DiskCache_AgeCmp);
+	}
+
+	keepBytes = cache->budget ? cache->budget / 4 * 3 : 0xffffffff;
+	keptBytes = 0;
+	largest = 1;
+	for (i=0 ; i<cache->numEntries ; i++) {
+		const diskCacheEntry_t *check = &cache->entries[order[i]];
+		assert (!check->pending);
+
+		bKeep[order[i]] = false;
+		if (bDropMissing && FS_FileExists (check->name) == -1) {
+			numMissing++;
+			continue;
+		}
+		if (check->dataLen > keepBytes - keptBytes) {
+			numEvicted++;
+			continue;
+		}
+
+		bKeep[order[i]] = true;
+		keptBytes += check->dataLen;
+		largest = max (largest, check->dataLen);
+	}
+	Mem_Free (order);
+
+	FS_OpenFile (cache->tempName, &tempFile, FS_MODE_WRITE_BINARY);
+	if (!tempFile) {
+		Com_Printf (PRNT_ERROR, "DiskCache_Rewrite: unable to open %s for writing\n", cache->tempName);
+		Mem_Free (bKeep);
+		return;
+	}
+
+	// Copy the survivors over in file order
+	memset (&header, 0, sizeof(header));
+	FS_Write (&header, sizeof(header), tempFile);
+
+	buffer = (byte *)Mem_PoolAlloc (largest, cache->pool, 0);
+	offset = sizeof(header);
+	numKept = 0;
+
+	memset (cache->hash, 0, sizeof(int) * cache->maxEntries * 2);
+	for (i=0 ; i<cache->numEntries ; i++) {
+		if (!bKeep[i])
+			continue;
+
+		entry = cache->entries[i];
+		FS_Seek (cache->file, entry.dataOfs, FS_SEEK_SET);
+		if (FS_Read (buffer, entry.dataLen, cache->file) != (int)entry.dataLen)
+			continue;
+		FS_Write (buffer, entry.dataLen, tempFile);
+
+		entry.dataOfs = offset;
+		offset += entry.dataLen;
+
+		cache->entries[numKept] = entry;
+		cache->hash[DiskCache_HashSlot (cache, entry.name, entry.key)] = ++numKept;
+	}
+	cache->numEntries = numKept;
+
+	Mem_Free (buffer);
+	Mem_Free (bKeep);
+
+	DiskCache_WriteIndex (cache, tempFile, offset);
+	FS_CloseFile (tempFile);
+	FS_CloseFile (cache->file);
+
+	// Swap it in
+	Q_snprintfz (path, sizeof(path), "%s/%s", FS_Gamedir (), cache->fileName);
+	Q_snprintfz (tempPath, sizeof(tempPath), "%s/%s", FS_Gamedir (), cache->tempName);
+	FS_DeleteFile (path);
+	FS_RenameFile (tempPath, path);
+
+	FS_OpenFile (cache->fileName, &cache->file, FS_MODE_READ_WRITE_BINARY);
+	if (!cache->file) {
+		Com_Printf (PRNT_ERROR, "DiskCache_Rewrite: unable to reopen %s\n", cache->fileName);
+		DiskCache_Clear (cache);
+		return;
+	}
+
+	cache->dataEnd = offset;
+	cache->liveBytes = offset - sizeof(header);
+}
+
+
+/*
+=================
+DiskCache_Write
+
+Appends anything pending and rewrites the index, compacting the file if it's
+over budget or more than a third of it is dead space.
+=================
+*/
+void DiskCache_Write (diskCache_t *cache)
+{
+	diskCacheEntry_t	*entry;
+	uint32				offset, fileLen, deadBytes, numEvicted, numMissing, i;
+
+	if (!cache->entries || !cache->bDirty)
+		return;
+
+	// Start a new file
+	if (!cache->file) {
+		FS_OpenFile (cache->fileName, &cache->file, FS_MODE_WRITE_BINARY);
+		if (cache->file) {
+			FS_CloseFile (cache->file);
+			FS_OpenFile (cache->fileName, &cache->file, FS_MODE_READ_WRITE_BINARY);
+		}
+		if (!cache->file) {
+			Com_Printf (PRNT_ERROR, "DiskCache_Write: unable to open %s for writing\n", cache->fileName);
+			DiskCache_Clear (cache);
+			return;
+		}
+
+		cache->dataEnd = sizeof(diskCacheHeader_t);
+		cache->liveBytes = 0;
+	}
+
+	DiskCache_PackPending (cache);
+
+	// New payloads go where the old index was
+	offset = cache->dataEnd;
+	FS_Seek (cache->file, offset, FS_SEEK_SET);
+	for (i=0 ; i<cache->numEntries ; i++) {
+		entry = &cache->entries[i];
+		if (!entry->pending)
+			continue;
+
+		FS_Write (entry->pending, entry->dataLen, cache->file);
+		Mem_Free (entry->pending);
+		entry->pending = NULL;
+
+		entry->dataOfs = offset;
+		offset += entry->dataLen;
+		cache->liveBytes += entry->dataLen;
+	}
+	cache->pendingBytes = 0;
+	cache->dataEnd = offset;
+
+	DiskCache_WriteIndex (cache, cache->file, offset);
+	cache->bDirty = false;
+
+	fileLen = offset + cache->numEntries * sizeof(diskCacheIndex_t);
+	deadBytes = offset - sizeof(diskCacheHeader_t) - cache->liveBytes;
+	if ((cache->budget && fileLen > cache->budget) || deadBytes > fileLen / 3) {
+		DiskCache_Rewrite (cache, false, numEvicted, numMissing);
+		Com_DevPrintf (0, "DiskCache_Write: compacted %s, evicted %u entries\n", cache->fileName, numEvicted);
+	}
+}
+
+
+/*
+=================
+DiskCache_Compact
+
+Writes anything pending, then rewrites the file without the space left by
+replaced entries, and optionally without entries whose source is gone.
+=================
+*/
+void DiskCache_Compact (diskCache_t *cache, const bool bDropMissing, uint32 &numEvicted, uint32 &numMissing)
+{
+	numEvicted = numMissing = 0;
+	if (!cache->entries)
+		return;
+
+	DiskCache_Write (cache);
+	DiskCache_Rewrite (cache, bDropMissing, numEvicted, numMissing);
+}
+
+/*
+=============================================================================
+
+	INIT / SHUTDOWN
+
+=============================================================================
+*/
+
+/*
+=================
+DiskCache_Open
+=================
+*/
+void DiskCache_Open (diskCache_t *cache)
+{
+	assert (!cache->entries);
+	assert (!(cache->maxEntries & (cache->maxEntries-1)));
+
+	cache->entries = (diskCacheEntry_t *)Mem_PoolAlloc (sizeof(diskCacheEntry_t) * cache->maxEntries, cache->pool, 0);
+	cache->hash = (int *)Mem_PoolAlloc (sizeof(int) * cache->maxEntries * 2, cache->pool, 0);
+	cache->numEntries = 0;
+	cache->file = 0;
+	cache->dataEnd = 0;
+	cache->liveBytes = 0;
+	cache->pendingBytes = 0;
+	cache->generation = 1;
+	cache->bDirty = false;
+
+	cache->hits = cache->misses = cache->stale = 0;
+	cache->bytesRead = 0;
+	cache->readMS = 0;
+
+	DiskCache_ReadIndex (cache);
+}
+
+
+/*
+=================
+DiskCache_Close
+=================
+*/
+void DiskCache_Close (diskCache_t *cache)
+{
+	if (!cache->entries)
+		return;
+
+	DiskCache_Write (cache);
+	DiskCache_Clear (cache);
+
+	Mem_Free (cache->entries);
+	Mem_Free (cache->hash);
+	cache->entries = NULL;
+	cache->hash = NULL;
+}
+
+/*
+=============================================================================
+
+	CONSOLE COMMANDS
+
+=============================================================================
+*/
+
+/*
+=================
+DiskCache_PrintStats
+
+For the *cache_stats commands.
+=================
+*/
+void DiskCache_PrintStats (const diskCache_t *cache, const char *title)
+{
+	uint32	numStored, numPending, rawBytes, fileLen, numLookups, i;
+
+	numStored = numPending = rawBytes = 0;
+	for (i=0 ; i<cache->numEntries ; i++) {
+		if (cache->entries[i].pending) {
+			numPending++;
+			continue;
+		}
+
+		numStored++;
+		rawBytes += cache->entries[i].rawLen;
+	}
+
+	fileLen = cache->file ? cache->dataEnd + numStored * sizeof(diskCacheIndex_t) : 0;
+	numLookups = cache->hits + cache->misses + cache->stale;
+
+	Com_Printf (0, "%s %s (version %i, generation %u):\n", title, cache->fileName, cache->version, cache->generation);
+	if (cache->budget)
+		Com_Printf (0, "...%u entries, %u bytes live in a %u byte file, %u MB budget\n", numStored, cache->liveBytes, fileLen, cache->budget >> 20);
+	else
+		Com_Printf (0, "...%u entries, %u bytes live in a %u byte file\n", numStored, cache->liveBytes, fileLen);
+	if (rawBytes != cache->liveBytes)
+		Com_Printf (0, "...%u bytes of payloads stored in %u (%.1f%%)\n", rawBytes, cache->liveBytes, rawBytes ? cache->liveBytes * 100.0 / rawBytes : 0.0);
+	Com_Printf (0, "...%u entries added this session, %u bytes%s\n", numPending, cache->pendingBytes, numPending ? " (unsaved)" : "");
+	Com_Printf (0, "...%u hits, %u misses, %u stale, %.1f%% hit rate\n", cache->hits, cache->misses, cache->stale, numLookups ? cache->hits * 100.0 / numLookups : 0.0);
+	Com_Printf (0, "...%u bytes read in %.2fms\n", cache->bytesRead, cache->readMS);
+}
@@ -0,0 +1,228 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+//
+// jobs.cpp
+// Worker thread pool for splitting work into independent numbered jobs
+//
+
+#include "common.h"
+
+#define MAX_JOB_WORKERS		15
+
+struct jobWorker_t
+{
+	sysThread_t			*thread;
+	sysSemaphore_t		*wake;
+};
+
+static jobWorker_t		job_workers[MAX_JOB_WORKERS];
+static int				job_numWorkers;
+static sysSemaphore_t	*job_done;
+static volatile bool	job_quit;
+static bool				job_running;
+
+// The batch currently being worked on
+static jobFunc_t		job_func;
+static void				*job_arg;
+static int				job_numJobs;
+static volatile long	job_nextJob;
+static volatile long	job_busyWorkers;
+
+static cVar_t			*sys_jobThreads;
+
+/*
+=============================================================================
+
+	WORKERS
+
+=============================================================================
+*/
+
+/*
+=================
+Job_Work
+
+Pulls jobs off the current batch until there are none left.
+=================
+*/
+static void Job_Work ()
+{
+	int		jobNum;
+
+	for ( ; ; ) {
+		jobNum = Sys_AtomicAdd (&job_nextJob, 1) - 1;
+		if (jobNum >= job_numJobs)
+			break;
+
+		job_func (job_arg, jobNum);
+	}
+}
+
+
+/*
+=================
+Job_WorkerThread
+=================
+*/
+static void Job_WorkerThread (void *arg)
+{
+	jobWorker_t	*worker = (jobWorker_t *)arg;
+
+	for ( ; ; ) {
+		Sys_SemaphoreWait (worker->wake);
+		if (job_quit)
+			break;
+
+		Job_Work ();
+
+		// Last one out lets Job_Run return
+		if (Sys_AtomicAdd (&job_busyWorkers, -1) == 0)
+			Sys_SemaphorePost (job_done);
+	}
+}
+
+/*
+=============================================================================
+
+	BATCHES
+
+=============================================================================
+*/
+
+/*
+=================
+Job_NumThreads
+=================
+*/
+int Job_NumThreads ()
+{
+	return job_numWorkers + 1;
+}
+
+
+/*
+=================
+Job_Run
+
+Runs func for every jobNum in [0, numJobs) and returns when they are all done.
+The order jobs are picked up in is undefined, so anything order-dependent has
+to be merged by jobNum afterwards.
+=================
+*/
+void Job_Run (jobFunc_t func, void *arg, const int numJobs)
+{
+	int		i;
+
+	if (numJobs <= 0)
+		return;
+
+	// Nothing to gain, or called from inside a job
+	if (!job_numWorkers || numJobs == 1 || job_running) {
+		for (i=0 ; i<numJobs ; i++)
+			func (arg, i);
+		return;
+	}
+
+	job_running = true;
+	job_func = func;
+	job_arg = arg;
+	job_numJobs = numJobs;
+	job_nextJob = 0;
+	job_busyWorkers = job_numWorkers;
+
+	for (i=0 ; i<job_numWorkers ; i++)
+		Sys_SemaphorePost (job_workers[i].wake);
+
+	// Help out
+	Job_Work ();
+
+	Sys_SemaphoreWait (job_done);
+	job_running = false;
+}
+
+/*
+=============================================================================
+
+	INIT / SHUTDOWN
+
+=============================================================================
+*/
+
+/*
+=================
+Job_Init
+=================
+*/
+void Job_Init ()
+{
+	int		numWorkers;
+
+	sys_jobThreads = Cvar_Register ("sys_jobThreads", "-1", CVAR_ARCHIVE);
+
+	// -1 picks one worker per additional processor
+	numWorkers = sys_jobThreads->intVal;
+	if (numWorkers < 0)
+		numWorkers = Sys_NumProcessors () - 1;
+	numWorkers = clamp (numWorkers, 0, MAX_JOB_WORKERS);
+
+	job_quit = false;
+	job_done = Sys_CreateSemaphore ();
+
+	for (job_numWorkers=0 ; job_numWorkers<numWorkers ; job_numWorkers++) {
+		jobWorker_t *worker = &job_workers[job_numWorkers];
+
+		worker->wake = Sys_CreateSemaphore ();
+		worker->thread = Sys_CreateThread (Job_WorkerThread, worker);
+		if (!worker->thread) {
+			Sys_DestroySemaphore (worker->wake);
+			Com_Printf (PRNT_WARNING, "Job_Init: unable to create worker thread %i\n", job_numWorkers);
+			break;
+		}
+	}
+
+	Com_Printf (0, "Job system using %i worker thread%s\n", job_numWorkers, (job_numWorkers == 1) ? "" : "s");
+}
+
+
+/*
+=================
+Job_Shutdown
+=================
+*/
+void Job_Shutdown ()
+{
+	int		i;
+
+	if (!job_done)
+		return;
+
+	job_quit = true;
+	for (i=0 ; i<job_numWorkers ; i++)
+		Sys_SemaphorePost (job_workers[i].wake);
+
+	for (i=0 ; i<job_numWorkers ; i++) {
+		Sys_WaitForThread (job_workers[i].thread);
+		Sys_DestroySemaphore (job_workers[i].wake);
+	}
+	job_numWorkers = 0;
+
+	Sys_DestroySemaphore (job_done);
+	job_done = NULL;
+}
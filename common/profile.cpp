@@ -0,0 +1,412 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+//
+// profile.cpp
+// Hierarchical frame profiler shared by the client, cgame and renderer
+//
+
+#include "common.h"
+
+#define PROF_MAX_ZONES		64		// Distinct zone names in a summary
+
+static profFrame_t		prof_frames[PROF_MAX_FRAMES];
+static uint32			prof_frameNum;		// Frames completed since recording started
+static bool				prof_recording;		// Current frame slot is being filled
+static int				prof_depth;
+
+// Trace capture
+static int				prof_traceFrames;
+static uint32			prof_traceEnd;
+static char				prof_traceName[MAX_QPATH];
+
+cVar_t					*com_profile;
+
+/*
+=============================================================================
+
+	RECORDING
+
+=============================================================================
+*/
+
+/*
+=================
+Prof_Active
+=================
+*/
+bool Prof_Active ()
+{
+	return prof_recording;
+}
+
+
+/*
+=================
+Prof_Begin
+
+Opens a zone in the current frame. Main thread only.
+=================
+*/
+int Prof_Begin (const char *name)
+{
+	if (!prof_recording)
+		return -1;
+
+	profFrame_t *frame = &prof_frames[prof_frameNum % PROF_MAX_FRAMES];
+	if (frame->numEvents >= PROF_MAX_EVENTS)
+		return -1;
+
+	profEvent_t *ev = &frame->events[frame->numEvents];
+	ev->name = name;
+	ev->depth = prof_depth++;
+	ev->start = Sys_Cycles ();
+	ev->end = ev->start;
+
+	return frame->numEvents++;
+}
+
+
+/*
+=================
+Prof_End
+=================
+*/
+void Prof_End (const int event)
+{
+	if (event < 0 || !prof_recording)
+		return;
+
+	profFrame_t *frame = &prof_frames[prof_frameNum % PROF_MAX_FRAMES];
+	if (event >= frame->numEvents)
+		return;	// Frame changed under us
+
+	frame->events[event].end = Sys_Cycles ();
+	prof_depth--;
+}
+
+
+/*
+=================
+Prof_GetFrame
+
+Age 1 is the last completed frame. Returns NULL past the recorded history.
+=================
+*/
+const profFrame_t *Prof_GetFrame (const int age)
+{
+	if (age < 1 || age >= PROF_MAX_FRAMES || (uint32)age > prof_frameNum)
+		return NULL;
+
+	return &prof_frames[(prof_frameNum - age) % PROF_MAX_FRAMES];
+}
+
+
+/*
+=================
+Prof_Clear
+
+Drops the recorded history. Zone names point into the module that opened
+them, so this has to be called before a module is unloaded.
+=================
+*/
+void Prof_Clear ()
+{
+	prof_frameNum = 0;
+	prof_depth = 0;
+	prof_frames[0].numEvents = 0;
+	prof_frames[0].start = Sys_Cycles ();
+
+	if (prof_traceFrames)
+		prof_traceEnd = prof_traceFrames;
+}
+
+/*
+=============================================================================
+
+	CHROME TRACE
+
+=============================================================================
+*/
+
+/*
+=================
+Prof_WriteTrace
+
+Writes the last numFrames frames in the Trace Event Format, which loads in
+chrome://tracing.
+=================
+*/
+static void Prof_WriteTrace (const char *name, const int numFrames)
+{
+	char	path[MAX_OSPATH];
+
+	Q_snprintfz (path, sizeof(path), "%s/profiles/%s.json", FS_Gamedir(), name);
+	FS_CreatePath (path);
+
+	FILE *f = fopen (path, "w");
+	if (!f) {
+		Com_Printf (PRNT_ERROR, "ERROR: Prof_WriteTrace: couldn't open %s\n", path);
+		return;
+	}
+
+	const profFrame_t *first = Prof_GetFrame (numFrames);
+	const double usPerCycle = Sys_MSPerCycle () * 1000.0;
+	bool bFirstEvent = true;
+
+	fprintf (f, "{\"traceEvents\":[\n");
+	for (int age=numFrames ; age>=1 ; age--) {
+		const profFrame_t *frame = Prof_GetFrame (age);
+
+		fprintf (f, "%s{\"name\":\"Frame\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}",
+			bFirstEvent ? "" : ",\n",
+			(uint32)(frame->start - first->start) * usPerCycle,
+			(uint32)(frame->end - frame->start) * usPerCycle);
+		bFirstEvent = false;
+
+		for (int i=0 ; i<frame->numEvents ; i++) {
+			const profEvent_t *ev = &frame->events[i];
+
+			fprintf (f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}",
+				ev->name,
+				(uint32)(ev->start - first->start) * usPerCycle,
+				(uint32)(ev->end - ev->start) * usPerCycle);
+		}
+	}
+	fprintf (f, "\n]}\n");
+	fclose (f);
+
+	Com_Printf (0, "Wrote %i frame trace to %s\n", numFrames, path);
+}
+
+/*
+=============================================================================
+
+	FRAME
+
+=============================================================================
+*/
+
+/*
+=================
+Prof_Frame
+
+Closes the frame being recorded and opens the next slot in the ring.
+Called at the top of Com_Frame, where no zones should be open.
+=================
+*/
+void Prof_Frame ()
+{
+	uint32 now = Sys_Cycles ();
+
+	if (prof_recording) {
+		profFrame_t *frame = &prof_frames[prof_frameNum % PROF_MAX_FRAMES];
+
+		// An ERR_DROP can leave zones open
+		for (int i=0 ; i<frame->numEvents ; i++) {
+			if (frame->events[i].end == frame->events[i].start)
+				frame->events[i].end = now;
+		}
+		frame->end = now;
+		prof_frameNum++;
+
+		if (prof_traceFrames && prof_frameNum >= prof_traceEnd) {
+			Prof_WriteTrace (prof_traceName, prof_traceFrames);
+			prof_traceFrames = 0;
+		}
+	}
+
+	// Start over when recording is switched back on
+	bool bRecord = (com_profile->intVal || prof_traceFrames);
+	if (bRecord && !prof_recording)
+		prof_frameNum = 0;
+	prof_recording = bRecord;
+	prof_depth = 0;
+
+	if (prof_recording) {
+		profFrame_t *frame = &prof_frames[prof_frameNum % PROF_MAX_FRAMES];
+		frame->start = now;
+		frame->end = now;
+		frame->numEvents = 0;
+	}
+}
+
+/*
+=============================================================================
+
+	CONSOLE FUNCTIONS
+
+=============================================================================
+*/
+
+struct profZoneStats_t
+{
+	const char		*name;
+	int				depth;
+	float			ms[PROF_MAX_FRAMES];
+};
+
+static profZoneStats_t	prof_zoneStats[PROF_MAX_ZONES];
+
+/*
+=================
+Prof_FloatSortCmp
+=================
+*/
+static int Prof_FloatSortCmp (const void *a, const void *b)
+{
+	const float fa = *(const float *)a;
+	const float fb = *(const float *)b;
+
+	return (fa < fb) ? -1 : (fa > fb) ? 1 : 0;
+}
+
+
+/*
+=================
+Prof_PrintPercentiles
+=================
+*/
+static void Prof_PrintPercentiles (const char *name, const int depth, float *ms, const int numFrames)
+{
+	qsort (ms, numFrames, sizeof(float), Prof_FloatSortCmp);
+
+	Com_Printf (0, "%*s%-*s %7.2f %7.2f %7.2f %7.2f\n",
+		depth*2, "", 24-depth*2, name,
+		ms[(numFrames-1)*50/100],
+		ms[(numFrames-1)*90/100],
+		ms[(numFrames-1)*99/100],
+		ms[numFrames-1]);
+}
+
+
+/*
+=================
+Prof_Summary_f
+
+Prints per zone frame time percentiles over the recorded history.
+=================
+*/
+static void Prof_Summary_f ()
+{
+	float	frameMs[PROF_MAX_FRAMES];
+	int		numZones = 0;
+
+	int numFrames = min (prof_frameNum, (uint32)PROF_MAX_FRAMES-1);
+	if (!numFrames) {
+		Com_Printf (0, "No frames recorded, set com_profile 1 first.\n");
+		return;
+	}
+
+	const double msPerCycle = Sys_MSPerCycle ();
+
+	for (int age=1 ; age<=numFrames ; age++) {
+		const profFrame_t *frame = Prof_GetFrame (age);
+		frameMs[age-1] = (uint32)(frame->end - frame->start) * msPerCycle;
+
+		for (int i=0 ; i<numZones ; i++)
+			prof_zoneStats[i].ms[age-1] = 0;
+
+		// Sum every zone by name, in the order they're first seen
+		for (int i=0 ; i<frame->numEvents ; i++) {
+			const profEvent_t *ev = &frame->events[i];
+
+			int z;
+			for (z=0 ; z<numZones ; z++) {
+				if (!strcmp (prof_zoneStats[z].name, ev->name))
+					break;
+			}
+			if (z == numZones) {
+				if (numZones == PROF_MAX_ZONES)
+					continue;
+
+				prof_zoneStats[z].name = ev->name;
+				prof_zoneStats[z].depth = ev->depth;
+				memset (prof_zoneStats[z].ms, 0, sizeof(prof_zoneStats[z].ms));
+				numZones++;
+			}
+
+			prof_zoneStats[z].ms[age-1] += (uint32)(ev->end - ev->start) * msPerCycle;
+		}
+	}
+
+	Com_Printf (0, "Profile over %i frames (ms):\n", numFrames);
+	Com_Printf (0, "%-24s %7s %7s %7s %7s\n", "zone", "p50", "p90", "p99", "max");
+	Prof_PrintPercentiles ("Frame", 0, frameMs, numFrames);
+	for (int i=0 ; i<numZones ; i++)
+		Prof_PrintPercentiles (prof_zoneStats[i].name, prof_zoneStats[i].depth + 1, prof_zoneStats[i].ms, numFrames);
+}
+
+
+/*
+=================
+Prof_Trace_f
+
+Records the next N frames and writes them out as a Chrome trace.
+=================
+*/
+static void Prof_Trace_f ()
+{
+	if (Cmd_Argc () < 2) {
+		Com_Printf (0, "usage: prof_trace <frames> [name]\n");
+		return;
+	}
+	if (prof_traceFrames) {
+		Com_Printf (0, "A trace is already being recorded.\n");
+		return;
+	}
+
+	int numFrames = atoi (Cmd_Argv (1));
+	if (numFrames < 1 || numFrames >= PROF_MAX_FRAMES) {
+		Com_Printf (0, "Trace length must be between 1 and %i frames.\n", PROF_MAX_FRAMES-1);
+		return;
+	}
+
+	if (Cmd_Argc () > 2)
+		Q_strncpyz (prof_traceName, Cmd_Argv (2), sizeof(prof_traceName));
+	else
+		Q_strncpyz (prof_traceName, "trace", sizeof(prof_traceName));
+
+	// Recording restarts at the next frame if it was off
+	prof_traceFrames = numFrames;
+	prof_traceEnd = (prof_recording ? prof_frameNum+1 : 0) + numFrames;
+
+	Com_Printf (0, "Recording %i frames to profiles/%s.json...\n", numFrames, prof_traceName);
+}
+
+/*
+=============================================================================
+
+	INIT
+
+=============================================================================
+*/
+
+/*
+=================
+Prof_Init
+=================
+*/
+void Prof_Init ()
+{
+	com_profile		= Cvar_Register ("com_profile",		"0",	0);
+
+	Cmd_AddCommand ("prof_summary",	0, Prof_Summary_f,	"Prints frame profiler percentiles");
+	Cmd_AddCommand ("prof_trace",	0, Prof_Trace_f,	"Records frames to a Chrome trace file");
+}
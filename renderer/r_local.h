@@ -41,6 +41,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 #include <math.h>
 
+// x86 builds carry SSE2 kernels, used when the CPU reports SSE2 at init
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+# define R_SSE2
+# include <emmintrin.h>
+#endif
+
 #include "rb_qgl.h"
 #include "rf_image.h"
 #include "rf_program.h"
@@ -181,6 +187,10 @@ struct refScene_t
 
 	TList<refPoly_t*>		polyList;
 
+	uint32					numParticles;
+	refParticle_t			particleList[MAX_REF_PARTICLES];
+	bool					bParticlesSorted;
+
 	uint32					numDLights;
 	refDLight_t				dLightList[MAX_REF_DLIGHTS];
 	uint32					dLightCullBits;
@@ -216,14 +226,20 @@ struct refStats_t
 	uint32					polyElements;
 	uint32					polyPolys;
 
+	uint32					particleElements;
+	uint32					particlePolys;
+
 	uint32					meshCount;
 	uint32					meshPasses;
+	uint32					colorCacheHits;
+	uint32					tcGenCacheHits;
 
 	uint32					stateChanges;
 
 	// Alias Models
 	uint32					aliasElements;
 	uint32					aliasPolys;
+	uint32					aliasPosesCached;
 
 	uint32					cullAlias[2];
 
@@ -249,21 +265,37 @@ struct refStats_t
 	// World model
 	uint32					worldElements;
 	uint32					worldPolys;
+	uint32					lightmapUpdates;
 
 	uint32					cullPlanar[2];
 	uint32					cullSurf[2];
 	uint32					cullVis[2];
 
+	uint32					markRebuilds;
+	uint32					markClusters;
+	uint32					markLeafs;
+	uint32					markNodes;
+
 	uint32					cullDLight[2];
 
+	uint32					occluders;
+	uint32					cullOcclusion[2];
+
+	uint32					sceneChunks;
+	uint32					sceneMismatches;
+
 	// Time to process
 	uint32					timeAddToList;
+	uint32					timeSceneJobs;
 	uint32					timeSortList;
 	uint32					timePushMesh;
 	uint32					timeDrawList;
 
 	uint32					timeMarkLeaves;
+	uint32					timeMarkLeavesPeak;
 	uint32					timeMarkLights;
+	uint32					timeLightmaps;
+	uint32					timeOcclusion;
 	uint32					timeRecurseWorld;
 	uint32					timeShadowRecurseWorld;
 };
@@ -291,6 +323,9 @@ struct refRegInfo_t
 	uint32					imagesResampled;
 	uint32					imagesSeaked;
 	uint32					imagesTouched;
+	uint32					imagesPrefetched;
+	uint32					imagesPrefetchUsed;
+	uint32					imagesCached;
 
 	// Models
 	uint32					modelsReleased;
@@ -322,6 +357,8 @@ struct refInfo_t
 	const byte				*extensionString;
 
 	int						lastValidMode;
+	bool					bNullBackend;		// No context, core GL calls are counted and dropped
+	bool					bSSE2;				// R_SSE2 kernels are usable on this CPU
 
 							// Frame information
 	float					cameraSeparation;
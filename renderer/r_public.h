@@ -187,6 +187,7 @@ void R_ClearScene();
 void R_AddDecal(refDecal_t *decal, const colorb &color, float materialTime);
 void R_AddEntity(refEntity_t *ent);
 void R_AddPoly(refPoly_t *poly);
+void R_AddParticles(const refParticle_t *particles, const int numParticles);
 void R_AddLight(vec3_t org, float intensity, float r, float g, float b);
 void R_AddLightStyle(int style, float r, float g, float b);
 
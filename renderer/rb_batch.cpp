@@ -202,3 +202,172 @@ void RB_PushMesh(refMesh_t *mesh, const meshFeatures_t meshFeatures)
 
 	rb.numVerts += mesh->numVerts;
 }
+
+
+/*
+=============
+RB_PushParticles
+
+Expands compact particles into view facing quads straight into the batch.
+Matches the corner layout CGAME used to build in refPoly_t's. The SSE2 path
+builds one particle's corners a register each, with the same operations in
+the same order as the scalar loop.
+=============
+*/
+void RB_PushParticles(const refParticle_t *particles, const int numParticles, const meshFeatures_t meshFeatures)
+{
+	qStatCycle_Scope Stat(r_times, ri.pc.timePushMesh);
+
+	// Must have quads
+	assert(numParticles > 0);
+
+	// Check for incompatibilities
+	assert(!rb.curMeshFeatures || !((rb.curMeshFeatures ^ meshFeatures) & (MF_NOCULL|MF_DEFORMVS|MF_NONBATCHED)));
+
+	rb.curMeshFeatures |= meshFeatures;
+
+	if (!ri.scn.bDrawingMeshOutlines)
+		ri.pc.meshBatcherPushes++;
+
+	// Indexes, same winding as a four vertex trifan
+	index_t *outIndex = rb.batch.indices + rb.numIndexes;
+	index_t firstVert = rb.numVerts;
+	for (int i=0 ; i<numParticles ; i++, outIndex+=6, firstVert+=4)
+	{
+		outIndex[0] = firstVert;
+		outIndex[1] = firstVert + 1;
+		outIndex[2] = firstVert + 2;
+		outIndex[3] = firstVert;
+		outIndex[4] = firstVert + 2;
+		outIndex[5] = firstVert + 3;
+	}
+	rb.numIndexes += numParticles * 6;
+	rb.inIndices = rb.batch.indices;
+
+	// Vertexes, coords and colors
+	const float *right = ri.def.viewAxis[1];
+	const float *up = ri.def.viewAxis[2];
+
+	float *outVert = rb.batch.vertices[rb.numVerts];
+	float *outCoord = rb.batch.coords[rb.numVerts];
+	colorb *outColor = rb.batch.colors + rb.numVerts;
+	int i = 0;
+
+#ifdef R_SSE2
+	if (ri.bSSE2)
+	{
+		const __m128 vRight = _mm_setr_ps(right[0], right[1], right[2], 0.0f);
+		const __m128 vUp = _mm_setr_ps(up[0], up[1], up[2], 0.0f);
+		const __m128 vRightPlusUp = _mm_add_ps(vRight, vUp);
+		const __m128 vRightMinusUp = _mm_sub_ps(vRight, vUp);
+
+		for ( ; i<numParticles ; i++, outVert+=12, outCoord+=8, outColor+=4)
+		{
+			const refParticle_t *p = &particles[i];
+
+			__m128 a, b;
+			if (p->orient)
+			{
+				float c, s;
+				Q_SinCosf(DEG2RAD(p->orient), &c, &s);
+				const __m128 vC = _mm_set1_ps(c * p->radius);
+				const __m128 vS = _mm_set1_ps(s * p->radius);
+
+				a = _mm_add_ps(_mm_mul_ps(vRight, vC), _mm_mul_ps(vUp, vS));
+				b = _mm_sub_ps(_mm_mul_ps(vUp, vC), _mm_mul_ps(vRight, vS));
+			}
+			else
+			{
+				const __m128 vRadius = _mm_set1_ps(p->radius);
+
+				a = _mm_mul_ps(vRightPlusUp, vRadius);
+				b = _mm_mul_ps(vRightMinusUp, vRadius);
+			}
+
+			// The fourth lane of origin is the radius, and is shuffled out
+			const __m128 origin = _mm_loadu_ps(p->origin);
+			const __m128 v0 = _mm_add_ps(origin, a);
+			const __m128 v1 = _mm_add_ps(origin, b);
+			const __m128 v2 = _mm_sub_ps(origin, a);
+			const __m128 v3 = _mm_sub_ps(origin, b);
+
+			_mm_storeu_ps(outVert, _mm_shuffle_ps(v0, _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(0,0,2,2)), _MM_SHUFFLE(2,0,1,0)));
+			_mm_storeu_ps(outVert + 4, _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(1,0,2,1)));
+			_mm_storeu_ps(outVert + 8, _mm_shuffle_ps(_mm_shuffle_ps(v2, v3, _MM_SHUFFLE(0,0,2,2)), v3, _MM_SHUFFLE(2,1,2,0)));
+
+			// s1 t1 s1 t2, s2 t2 s2 t1
+			const __m128 coords = _mm_loadu_ps(p->coords);
+			_mm_storeu_ps(outCoord, _mm_shuffle_ps(coords, coords, _MM_SHUFFLE(3,0,1,0)));
+			_mm_storeu_ps(outCoord + 4, _mm_shuffle_ps(coords, coords, _MM_SHUFFLE(1,2,3,2)));
+
+			_mm_storeu_si128((__m128i *)outColor, _mm_set1_epi32(*(const int *)&p->color));
+		}
+	}
+#endif // R_SSE2
+
+	for ( ; i<numParticles ; i++, outVert+=12, outCoord+=8, outColor+=4)
+	{
+		const refParticle_t *p = &particles[i];
+
+		// Corners are origin+a, origin+b, origin-a, origin-b
+		vec3_t a, b;
+		if (p->orient)
+		{
+			float c, s;
+			Q_SinCosf(DEG2RAD(p->orient), &c, &s);
+			c *= p->radius;
+			s *= p->radius;
+
+			a[0] = right[0]*c + up[0]*s;
+			a[1] = right[1]*c + up[1]*s;
+			a[2] = right[2]*c + up[2]*s;
+			b[0] = up[0]*c - right[0]*s;
+			b[1] = up[1]*c - right[1]*s;
+			b[2] = up[2]*c - right[2]*s;
+		}
+		else
+		{
+			a[0] = (right[0] + up[0]) * p->radius;
+			a[1] = (right[1] + up[1]) * p->radius;
+			a[2] = (right[2] + up[2]) * p->radius;
+			b[0] = (right[0] - up[0]) * p->radius;
+			b[1] = (right[1] - up[1]) * p->radius;
+			b[2] = (right[2] - up[2]) * p->radius;
+		}
+
+		outVert[0] = p->origin[0] + a[0];
+		outVert[1] = p->origin[1] + a[1];
+		outVert[2] = p->origin[2] + a[2];
+		outVert[3] = p->origin[0] + b[0];
+		outVert[4] = p->origin[1] + b[1];
+		outVert[5] = p->origin[2] + b[2];
+		outVert[6] = p->origin[0] - a[0];
+		outVert[7] = p->origin[1] - a[1];
+		outVert[8] = p->origin[2] - a[2];
+		outVert[9] = p->origin[0] - b[0];
+		outVert[10] = p->origin[1] - b[1];
+		outVert[11] = p->origin[2] - b[2];
+
+		outCoord[0] = p->coords[0];
+		outCoord[1] = p->coords[1];
+		outCoord[2] = p->coords[0];
+		outCoord[3] = p->coords[3];
+		outCoord[4] = p->coords[2];
+		outCoord[5] = p->coords[3];
+		outCoord[6] = p->coords[2];
+		outCoord[7] = p->coords[1];
+
+		outColor[0] = p->color;
+		outColor[1] = p->color;
+		outColor[2] = p->color;
+		outColor[3] = p->color;
+	}
+
+	rb.inVertices = rb.batch.vertices;
+	if (meshFeatures & MF_STCOORDS)
+		rb.inCoords = rb.batch.coords;
+	if (meshFeatures & MF_COLORS)
+		rb.inColors = rb.batch.colors;
+
+	rb.numVerts += numParticles * 4;
+}
@@ -151,6 +151,34 @@ static bool R_SetMode()
 }
 
 
+/*
+==================
+R_SetNullMode
+
+Picks the mode size the same way R_SetMode does, without a window.
+==================
+*/
+static void R_SetNullMode()
+{
+	int width, height;
+	if (vid_width->intVal > 0 && vid_height->intVal > 0)
+	{
+		width = vid_width->intVal;
+		height = vid_height->intVal;
+	}
+	else if (!R_GetInfoForMode(gl_mode->intVal, &width, &height))
+	{
+		R_GetInfoForMode(SAFE_MODE, &width, &height);
+	}
+
+	ri.config.vidFullScreen = false;
+	ri.config.vidWidth = width;
+	ri.config.vidHeight = height;
+	ri.config.vidBitDepth = 32;
+	ri.config.vidFrequency = 0;
+}
+
+
 /*
 ===============
 ExtensionFound
@@ -1135,18 +1163,30 @@ bool RB_BackendInit()
 	ri.cDepthBits = 0;
 	ri.cStencilBits = 0;
 
-	// Initialize OS-specific parts of OpenGL
-	if (!GLimp_Init())
+	// Headless, skip the window and context entirely
+	ri.bNullBackend = (r_nullBackend->intVal != 0);
+	QGL_EnableNull(ri.bNullBackend);
+
+	if (ri.bNullBackend)
 	{
-		Com_Printf(PRNT_ERROR, "...unable to init gl implementation\n");
-		return false;
+		Com_Printf(0, "...using the null backend\n");
+		R_SetNullMode();
 	}
-
-	// Create the window and set up the context
-	if (!R_SetMode())
+	else
 	{
-		Com_Printf(PRNT_ERROR, "...could not set video mode\n");
-		return false;
+		// Initialize OS-specific parts of OpenGL
+		if (!GLimp_Init())
+		{
+			Com_Printf(PRNT_ERROR, "...unable to init gl implementation\n");
+			return false;
+		}
+
+		// Create the window and set up the context
+		if (!R_SetMode())
+		{
+			Com_Printf(PRNT_ERROR, "...could not set video mode\n");
+			return false;
+		}
 	}
 
 	// Vendor string
@@ -1309,7 +1349,8 @@ void RB_BackendShutdown(const bool bFull)
 	RB_RenderShutdown();
 
 	// Shutdown OS specific OpenGL stuff like contexts, etc
-	GLimp_Shutdown(bFull);
+	if (!ri.bNullBackend)
+		GLimp_Shutdown(bFull);
 
 	Com_Printf(0, "----------------------------------------\n");
 }
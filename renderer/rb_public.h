@@ -222,6 +222,7 @@ inline bool RB_InvalidMesh(const refMesh_t *Mesh)
 }
 
 void RB_PushMesh(refMesh_t *mesh, const meshFeatures_t meshFeatures);
+void RB_PushParticles(const refParticle_t *particles, const int numParticles, const meshFeatures_t meshFeatures);
 
 //
 // rb_init.cpp
@@ -21,6 +21,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 // rb_qgl.cpp
 //
 
+// The core pointers below are initialized from the real gl* symbols
+#define QGL_NO_REMAP
+
 #ifdef WIN32
 
 # include "rb_local.h"
@@ -222,3 +225,220 @@ void		(APIENTRYP qglTexSubImage3D) (GLenum target, GLint level, GLint xoffset, G
 
 // GL_EXT_stencil_two_side
 void		(APIENTRYP qglActiveStencilFaceEXT) (GLenum face);
+
+/*
+=============================================================================
+
+	CORE
+
+=============================================================================
+*/
+
+#define QGL_FUNC(kind, ret, name, params) ret (APIENTRYP qgl##name) params = gl##name;
+QGL_CORE_FUNCS
+#undef QGL_FUNC
+
+/*
+=============================================================================
+
+	NULL BACKEND
+
+	Stands in for the driver when there's no context at all, so the whole CPU
+	side of the renderer can run (and be timed) on a headless box. Nothing is
+	drawn; draw calls, state changes and texture uploads are only counted.
+=============================================================================
+*/
+
+qglNullStats_t	qgl_nullStats;
+
+#define QGL_COUNT_NONE
+#define QGL_COUNT_STATE		qgl_nullStats.stateChanges++;
+#define QGL_COUNT_DRAW		qgl_nullStats.drawCalls++;
+
+#define QGL_FUNC(kind, ret, name, params) static ret APIENTRY nullgl##name params;
+QGL_CORE_FUNCS
+#undef QGL_FUNC
+
+// Everything that doesn't need a return value or special handling
+#define QGL_NULL_STUB(kind, name, params) static void APIENTRY nullgl##name params { QGL_COUNT_##kind }
+
+QGL_NULL_STUB(STATE, AlphaFunc, (GLenum func, GLclampf ref))
+QGL_NULL_STUB(NONE, ArrayElement, (GLint i))
+QGL_NULL_STUB(DRAW, Begin, (GLenum mode))
+QGL_NULL_STUB(STATE, BindTexture, (GLenum target, GLuint texture))
+QGL_NULL_STUB(STATE, BlendFunc, (GLenum sfactor, GLenum dfactor))
+QGL_NULL_STUB(NONE, Clear, (GLbitfield mask))
+QGL_NULL_STUB(NONE, ClearColor, (GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha))
+QGL_NULL_STUB(NONE, ClearStencil, (GLint s))
+QGL_NULL_STUB(STATE, ClipPlane, (GLenum plane, const GLdouble *equation))
+QGL_NULL_STUB(NONE, Color3f, (GLfloat red, GLfloat green, GLfloat blue))
+QGL_NULL_STUB(NONE, Color3fv, (const GLfloat *v))
+QGL_NULL_STUB(NONE, Color4f, (GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha))
+QGL_NULL_STUB(NONE, Color4ub, (GLubyte red, GLubyte green, GLubyte blue, GLubyte alpha))
+QGL_NULL_STUB(NONE, Color4ubv, (const GLubyte *v))
+QGL_NULL_STUB(STATE, ColorMask, (GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha))
+QGL_NULL_STUB(NONE, ColorPointer, (GLint size, GLenum type, GLsizei stride, const GLvoid *pointer))
+QGL_NULL_STUB(STATE, CullFace, (GLenum mode))
+QGL_NULL_STUB(NONE, DeleteTextures, (GLsizei n, const GLuint *textures))
+QGL_NULL_STUB(STATE, DepthFunc, (GLenum func))
+QGL_NULL_STUB(STATE, DepthMask, (GLboolean flag))
+QGL_NULL_STUB(STATE, DepthRange, (GLclampd zNear, GLclampd zFar))
+QGL_NULL_STUB(STATE, Disable, (GLenum cap))
+QGL_NULL_STUB(STATE, DisableClientState, (GLenum array))
+QGL_NULL_STUB(DRAW, DrawArrays, (GLenum mode, GLint first, GLsizei count))
+QGL_NULL_STUB(NONE, DrawBuffer, (GLenum mode))
+QGL_NULL_STUB(DRAW, DrawElements, (GLenum mode, GLsizei count, GLenum type, const GLvoid *indices))
+QGL_NULL_STUB(STATE, Enable, (GLenum cap))
+QGL_NULL_STUB(STATE, EnableClientState, (GLenum array))
+QGL_NULL_STUB(NONE, End, ())
+QGL_NULL_STUB(NONE, Finish, ())
+QGL_NULL_STUB(STATE, FrontFace, (GLenum mode))
+QGL_NULL_STUB(NONE, LineWidth, (GLfloat width))
+QGL_NULL_STUB(NONE, LoadIdentity, ())
+QGL_NULL_STUB(NONE, LoadMatrixf, (const GLfloat *m))
+QGL_NULL_STUB(NONE, MatrixMode, (GLenum mode))
+QGL_NULL_STUB(NONE, NormalPointer, (GLenum type, GLsizei stride, const GLvoid *pointer))
+QGL_NULL_STUB(NONE, Ortho, (GLdouble left, GLdouble right, GLdouble bottom, GLdouble top, GLdouble zNear, GLdouble zFar))
+QGL_NULL_STUB(NONE, PointSize, (GLfloat size))
+QGL_NULL_STUB(STATE, PolygonMode, (GLenum face, GLenum mode))
+QGL_NULL_STUB(STATE, PolygonOffset, (GLfloat factor, GLfloat units))
+QGL_NULL_STUB(NONE, PopAttrib, ())
+QGL_NULL_STUB(NONE, PopMatrix, ())
+QGL_NULL_STUB(NONE, PushAttrib, (GLbitfield mask))
+QGL_NULL_STUB(NONE, PushMatrix, ())
+QGL_NULL_STUB(NONE, RasterPos3f, (GLfloat x, GLfloat y, GLfloat z))
+QGL_NULL_STUB(NONE, ReadBuffer, (GLenum mode))
+QGL_NULL_STUB(NONE, Rotatef, (GLfloat angle, GLfloat x, GLfloat y, GLfloat z))
+QGL_NULL_STUB(STATE, Scissor, (GLint x, GLint y, GLsizei width, GLsizei height))
+QGL_NULL_STUB(STATE, ShadeModel, (GLenum mode))
+QGL_NULL_STUB(STATE, StencilFunc, (GLenum func, GLint ref, GLuint mask))
+QGL_NULL_STUB(STATE, StencilMask, (GLuint mask))
+QGL_NULL_STUB(STATE, StencilOp, (GLenum fail, GLenum zfail, GLenum zpass))
+QGL_NULL_STUB(NONE, TexCoord2f, (GLfloat s, GLfloat t))
+QGL_NULL_STUB(NONE, TexCoordPointer, (GLint size, GLenum type, GLsizei stride, const GLvoid *pointer))
+QGL_NULL_STUB(STATE, TexEnvf, (GLenum target, GLenum pname, GLfloat param))
+QGL_NULL_STUB(STATE, TexEnvi, (GLenum target, GLenum pname, GLint param))
+QGL_NULL_STUB(STATE, TexGenfv, (GLenum coord, GLenum pname, const GLfloat *params))
+QGL_NULL_STUB(STATE, TexGeni, (GLenum coord, GLenum pname, GLint param))
+QGL_NULL_STUB(STATE, TexParameterf, (GLenum target, GLenum pname, GLfloat param))
+QGL_NULL_STUB(STATE, TexParameteri, (GLenum target, GLenum pname, GLint param))
+QGL_NULL_STUB(NONE, Vertex2f, (GLfloat x, GLfloat y))
+QGL_NULL_STUB(NONE, Vertex3f, (GLfloat x, GLfloat y, GLfloat z))
+QGL_NULL_STUB(NONE, Vertex3fv, (const GLfloat *v))
+QGL_NULL_STUB(NONE, VertexPointer, (GLint size, GLenum type, GLsizei stride, const GLvoid *pointer))
+QGL_NULL_STUB(NONE, Viewport, (GLint x, GLint y, GLsizei width, GLsizei height))
+
+#undef QGL_NULL_STUB
+
+/*
+=============
+QGL_NullPixelSize
+=============
+*/
+static int QGL_NullPixelSize(GLenum format, GLenum type)
+{
+	int components;
+	switch(format)
+	{
+	case GL_RGBA:
+	case GL_BGRA_EXT:			components = 4;	break;
+	case GL_RGB:
+	case GL_BGR_EXT:			components = 3;	break;
+	case GL_LUMINANCE_ALPHA:	components = 2;	break;
+	default:					components = 1;	break;
+	}
+
+	switch(type)
+	{
+	case GL_FLOAT:
+	case GL_UNSIGNED_INT:
+	case GL_INT:				return components * 4;
+	case GL_UNSIGNED_SHORT:
+	case GL_SHORT:				return components * 2;
+	default:					return components;
+	}
+}
+
+static GLenum APIENTRY nullglGetError()
+{
+	return GL_NO_ERROR;
+}
+
+static void APIENTRY nullglGetIntegerv(GLenum pname, GLint *params)
+{
+	switch(pname)
+	{
+	case GL_MAX_TEXTURE_SIZE:
+		*params = 2048;
+		break;
+	case GL_MAX_TEXTURE_UNITS:
+		*params = 1;
+		break;
+	default:
+		*params = 0;
+		break;
+	}
+}
+
+static const GLubyte *APIENTRY nullglGetString(GLenum name)
+{
+	switch(name)
+	{
+	case GL_VENDOR:		return (const GLubyte *)"Null";
+	case GL_RENDERER:	return (const GLubyte *)"Null backend";
+	case GL_VERSION:	return (const GLubyte *)"1.1";
+	default:			return (const GLubyte *)"";
+	}
+}
+
+static void APIENTRY nullglReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid *pixels)
+{
+	// Depth reads come back as the far plane, so flares stay hidden
+	if (format == GL_DEPTH_COMPONENT && type == GL_FLOAT)
+	{
+		for (int i=0 ; i<width*height ; i++)
+			((GLfloat *)pixels)[i] = 1.0f;
+		return;
+	}
+
+	memset(pixels, 0, width * height * QGL_NullPixelSize(format, type));
+}
+
+static void APIENTRY nullglTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid *pixels)
+{
+	qgl_nullStats.texUploads++;
+	if (pixels)
+		qgl_nullStats.uploadBytes += width * height * QGL_NullPixelSize(format, type);
+}
+
+static void APIENTRY nullglTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid *pixels)
+{
+	qgl_nullStats.texUploads++;
+	qgl_nullStats.uploadBytes += width * height * QGL_NullPixelSize(format, type);
+}
+
+
+/*
+=============
+QGL_EnableNull
+
+Points the core entry points at the stubs, or back at the driver.
+=============
+*/
+void QGL_EnableNull(const bool bEnable)
+{
+	memset(&qgl_nullStats, 0, sizeof(qgl_nullStats));
+
+	if (bEnable)
+	{
+#define QGL_FUNC(kind, ret, name, params) qgl##name = nullgl##name;
+		QGL_CORE_FUNCS
+#undef QGL_FUNC
+	}
+	else
+	{
+#define QGL_FUNC(kind, ret, name, params) qgl##name = gl##name;
+		QGL_CORE_FUNCS
+#undef QGL_FUNC
+	}
+}
@@ -250,4 +250,176 @@ extern void		(APIENTRYP qglTexSubImage3D) (GLenum target, GLint level, GLint xof
 // GL_EXT_stencil_two_side
 extern void		(APIENTRYP qglActiveStencilFaceEXT) (GLenum face);
 
+//
+// core
+//
+// Every core entry point the renderer uses goes through a pointer, so the
+// null backend can swap them all out for counting stubs. The gl* names are
+// remapped onto the pointers everywhere but rb_qgl.cpp.
+//
+
+#define QGL_CORE_FUNCS \
+	QGL_FUNC(STATE, void, AlphaFunc, (GLenum func, GLclampf ref)) \
+	QGL_FUNC(NONE, void, ArrayElement, (GLint i)) \
+	QGL_FUNC(DRAW, void, Begin, (GLenum mode)) \
+	QGL_FUNC(STATE, void, BindTexture, (GLenum target, GLuint texture)) \
+	QGL_FUNC(STATE, void, BlendFunc, (GLenum sfactor, GLenum dfactor)) \
+	QGL_FUNC(NONE, void, Clear, (GLbitfield mask)) \
+	QGL_FUNC(NONE, void, ClearColor, (GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha)) \
+	QGL_FUNC(NONE, void, ClearStencil, (GLint s)) \
+	QGL_FUNC(STATE, void, ClipPlane, (GLenum plane, const GLdouble *equation)) \
+	QGL_FUNC(NONE, void, Color3f, (GLfloat red, GLfloat green, GLfloat blue)) \
+	QGL_FUNC(NONE, void, Color3fv, (const GLfloat *v)) \
+	QGL_FUNC(NONE, void, Color4f, (GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)) \
+	QGL_FUNC(NONE, void, Color4ub, (GLubyte red, GLubyte green, GLubyte blue, GLubyte alpha)) \
+	QGL_FUNC(NONE, void, Color4ubv, (const GLubyte *v)) \
+	QGL_FUNC(STATE, void, ColorMask, (GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)) \
+	QGL_FUNC(NONE, void, ColorPointer, (GLint size, GLenum type, GLsizei stride, const GLvoid *pointer)) \
+	QGL_FUNC(STATE, void, CullFace, (GLenum mode)) \
+	QGL_FUNC(NONE, void, DeleteTextures, (GLsizei n, const GLuint *textures)) \
+	QGL_FUNC(STATE, void, DepthFunc, (GLenum func)) \
+	QGL_FUNC(STATE, void, DepthMask, (GLboolean flag)) \
+	QGL_FUNC(STATE, void, DepthRange, (GLclampd zNear, GLclampd zFar)) \
+	QGL_FUNC(STATE, void, Disable, (GLenum cap)) \
+	QGL_FUNC(STATE, void, DisableClientState, (GLenum array)) \
+	QGL_FUNC(DRAW, void, DrawArrays, (GLenum mode, GLint first, GLsizei count)) \
+	QGL_FUNC(NONE, void, DrawBuffer, (GLenum mode)) \
+	QGL_FUNC(DRAW, void, DrawElements, (GLenum mode, GLsizei count, GLenum type, const GLvoid *indices)) \
+	QGL_FUNC(STATE, void, Enable, (GLenum cap)) \
+	QGL_FUNC(STATE, void, EnableClientState, (GLenum array)) \
+	QGL_FUNC(NONE, void, End, ()) \
+	QGL_FUNC(NONE, void, Finish, ()) \
+	QGL_FUNC(STATE, void, FrontFace, (GLenum mode)) \
+	QGL_FUNC(CUSTOM, GLenum, GetError, ()) \
+	QGL_FUNC(CUSTOM, void, GetIntegerv, (GLenum pname, GLint *params)) \
+	QGL_FUNC(CUSTOM, const GLubyte *, GetString, (GLenum name)) \
+	QGL_FUNC(NONE, void, LineWidth, (GLfloat width)) \
+	QGL_FUNC(NONE, void, LoadIdentity, ()) \
+	QGL_FUNC(NONE, void, LoadMatrixf, (const GLfloat *m)) \
+	QGL_FUNC(NONE, void, MatrixMode, (GLenum mode)) \
+	QGL_FUNC(NONE, void, NormalPointer, (GLenum type, GLsizei stride, const GLvoid *pointer)) \
+	QGL_FUNC(NONE, void, Ortho, (GLdouble left, GLdouble right, GLdouble bottom, GLdouble top, GLdouble zNear, GLdouble zFar)) \
+	QGL_FUNC(NONE, void, PointSize, (GLfloat size)) \
+	QGL_FUNC(STATE, void, PolygonMode, (GLenum face, GLenum mode)) \
+	QGL_FUNC(STATE, void, PolygonOffset, (GLfloat factor, GLfloat units)) \
+	QGL_FUNC(NONE, void, PopAttrib, ()) \
+	QGL_FUNC(NONE, void, PopMatrix, ()) \
+	QGL_FUNC(NONE, void, PushAttrib, (GLbitfield mask)) \
+	QGL_FUNC(NONE, void, PushMatrix, ()) \
+	QGL_FUNC(NONE, void, RasterPos3f, (GLfloat x, GLfloat y, GLfloat z)) \
+	QGL_FUNC(NONE, void, ReadBuffer, (GLenum mode)) \
+	QGL_FUNC(CUSTOM, void, ReadPixels, (GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid *pixels)) \
+	QGL_FUNC(NONE, void, Rotatef, (GLfloat angle, GLfloat x, GLfloat y, GLfloat z)) \
+	QGL_FUNC(STATE, void, Scissor, (GLint x, GLint y, GLsizei width, GLsizei height)) \
+	QGL_FUNC(STATE, void, ShadeModel, (GLenum mode)) \
+	QGL_FUNC(STATE, void, StencilFunc, (GLenum func, GLint ref, GLuint mask)) \
+	QGL_FUNC(STATE, void, StencilMask, (GLuint mask)) \
+	QGL_FUNC(STATE, void, StencilOp, (GLenum fail, GLenum zfail, GLenum zpass)) \
+	QGL_FUNC(NONE, void, TexCoord2f, (GLfloat s, GLfloat t)) \
+	QGL_FUNC(NONE, void, TexCoordPointer, (GLint size, GLenum type, GLsizei stride, const GLvoid *pointer)) \
+	QGL_FUNC(STATE, void, TexEnvf, (GLenum target, GLenum pname, GLfloat param)) \
+	QGL_FUNC(STATE, void, TexEnvi, (GLenum target, GLenum pname, GLint param)) \
+	QGL_FUNC(STATE, void, TexGenfv, (GLenum coord, GLenum pname, const GLfloat *params)) \
+	QGL_FUNC(STATE, void, TexGeni, (GLenum coord, GLenum pname, GLint param)) \
+	QGL_FUNC(CUSTOM, void, TexImage2D, (GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid *pixels)) \
+	QGL_FUNC(STATE, void, TexParameterf, (GLenum target, GLenum pname, GLfloat param)) \
+	QGL_FUNC(STATE, void, TexParameteri, (GLenum target, GLenum pname, GLint param)) \
+	QGL_FUNC(CUSTOM, void, TexSubImage2D, (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid *pixels)) \
+	QGL_FUNC(NONE, void, Vertex2f, (GLfloat x, GLfloat y)) \
+	QGL_FUNC(NONE, void, Vertex3f, (GLfloat x, GLfloat y, GLfloat z)) \
+	QGL_FUNC(NONE, void, Vertex3fv, (const GLfloat *v)) \
+	QGL_FUNC(NONE, void, VertexPointer, (GLint size, GLenum type, GLsizei stride, const GLvoid *pointer)) \
+	QGL_FUNC(NONE, void, Viewport, (GLint x, GLint y, GLsizei width, GLsizei height))
+
+#define QGL_FUNC(kind, ret, name, params) extern ret (APIENTRYP qgl##name) params;
+QGL_CORE_FUNCS
+#undef QGL_FUNC
+
+#ifndef QGL_NO_REMAP
+# define glAlphaFunc		qglAlphaFunc
+# define glArrayElement	qglArrayElement
+# define glBegin		qglBegin
+# define glBindTexture		qglBindTexture
+# define glBlendFunc		qglBlendFunc
+# define glClear		qglClear
+# define glClearColor		qglClearColor
+# define glClearStencil	qglClearStencil
+# define glClipPlane		qglClipPlane
+# define glColor3f		qglColor3f
+# define glColor3fv		qglColor3fv
+# define glColor4f		qglColor4f
+# define glColor4ub		qglColor4ub
+# define glColor4ubv		qglColor4ubv
+# define glColorMask		qglColorMask
+# define glColorPointer	qglColorPointer
+# define glCullFace		qglCullFace
+# define glDeleteTextures	qglDeleteTextures
+# define glDepthFunc		qglDepthFunc
+# define glDepthMask		qglDepthMask
+# define glDepthRange		qglDepthRange
+# define glDisable		qglDisable
+# define glDisableClientState	qglDisableClientState
+# define glDrawArrays		qglDrawArrays
+# define glDrawBuffer		qglDrawBuffer
+# define glDrawElements	qglDrawElements
+# define glEnable		qglEnable
+# define glEnableClientState	qglEnableClientState
+# define glEnd		qglEnd
+# define glFinish		qglFinish
+# define glFrontFace		qglFrontFace
+# define glGetError		qglGetError
+# define glGetIntegerv		qglGetIntegerv
+# define glGetString		qglGetString
+# define glLineWidth		qglLineWidth
+# define glLoadIdentity	qglLoadIdentity
+# define glLoadMatrixf		qglLoadMatrixf
+# define glMatrixMode		qglMatrixMode
+# define glNormalPointer	qglNormalPointer
+# define glOrtho		qglOrtho
+# define glPointSize		qglPointSize
+# define glPolygonMode		qglPolygonMode
+# define glPolygonOffset	qglPolygonOffset
+# define glPopAttrib		qglPopAttrib
+# define glPopMatrix		qglPopMatrix
+# define glPushAttrib		qglPushAttrib
+# define glPushMatrix		qglPushMatrix
+# define glRasterPos3f		qglRasterPos3f
+# define glReadBuffer		qglReadBuffer
+# define glReadPixels		qglReadPixels
+# define glRotatef		qglRotatef
+# define glScissor		qglScissor
+# define glShadeModel		qglShadeModel
+# define glStencilFunc		qglStencilFunc
+# define glStencilMask		qglStencilMask
+# define glStencilOp		qglStencilOp
+# define glTexCoord2f		qglTexCoord2f
+# define glTexCoordPointer	qglTexCoordPointer
+# define glTexEnvf		qglTexEnvf
+# define glTexEnvi		qglTexEnvi
+# define glTexGenfv		qglTexGenfv
+# define glTexGeni		qglTexGeni
+# define glTexImage2D		qglTexImage2D
+# define glTexParameterf	qglTexParameterf
+# define glTexParameteri	qglTexParameteri
+# define glTexSubImage2D	qglTexSubImage2D
+# define glVertex2f		qglVertex2f
+# define glVertex3f		qglVertex3f
+# define glVertex3fv		qglVertex3fv
+# define glVertexPointer	qglVertexPointer
+# define glViewport		qglViewport
+#endif
+
+// Null backend
+struct qglNullStats_t
+{
+	uint32				drawCalls;
+	uint32				stateChanges;
+	uint32				texUploads;
+	uint32				uploadBytes;
+};
+
+extern qglNullStats_t	qgl_nullStats;
+
+void		QGL_EnableNull(const bool bEnable);
+
 #endif // __RB_QGL_H__
@@ -46,6 +46,24 @@ static bool				rb_bColorArrayEnabled;
 static float			rb_matTime;
 static stateBit_t		rb_stateBits;
 
+// Bumped for every mesh buffer, colour and texcoord arrays generated under
+// the same serial are reused by later passes
+static uint32			rb_meshSerial;
+
+static struct rbColorCache_t
+{
+	uint32				meshSerial;
+	int					numColors;
+	rgbGen_t			rgbGen;
+	alphaGen_t			alphaGen;
+} rb_colorCache;
+
+static struct rbTCGenCache_t
+{
+	uint32				meshSerial;
+	EMatPass_TCGen		tcGen;
+} rb_tcGenCache[MAX_TEXUNITS];
+
 // Static data
 static matPass_t		rb_dLightPass;
 static matPass_t		rb_shadowPass;
@@ -64,6 +82,42 @@ float					rb_sawtoothTable[FTABLE_SIZE];
 float					rb_inverseSawtoothTable[FTABLE_SIZE];
 float					rb_noiseTable[FTABLE_SIZE];
 
+static const float r_warpSinTable[] =
+{
+	0.000000f,	0.098165f,	0.196270f,	0.294259f,	0.392069f,	0.489643f,	0.586920f,	0.683850f,
+	0.780360f,	0.876405f,	0.971920f,	1.066850f,	1.161140f,	1.254725f,	1.347560f,	1.439580f,
+	1.530735f,	1.620965f,	1.710220f,	1.798445f,	1.885585f,	1.971595f,	2.056410f,	2.139990f,
+	2.222280f,	2.303235f,	2.382795f,	2.460925f,	2.537575f,	2.612690f,	2.686235f,	2.758160f,
+	2.828425f,	2.896990f,	2.963805f,	3.028835f,	3.092040f,	3.153385f,	3.212830f,	3.270340f,
+	3.325880f,	3.379415f,	3.430915f,	3.480350f,	3.527685f,	3.572895f,	3.615955f,	3.656840f,
+	3.695520f,	3.731970f,	3.766175f,	3.798115f,	3.827760f,	3.855105f,	3.880125f,	3.902810f,
+	3.923140f,	3.941110f,	3.956705f,	3.969920f,	3.980740f,	3.989160f,	3.995180f,	3.998795f,
+	4.000000f,	3.998795f,	3.995180f,	3.989160f,	3.980740f,	3.969920f,	3.956705f,	3.941110f,
+	3.923140f,	3.902810f,	3.880125f,	3.855105f,	3.827760f,	3.798115f,	3.766175f,	3.731970f,
+	3.695520f,	3.656840f,	3.615955f,	3.572895f,	3.527685f,	3.480350f,	3.430915f,	3.379415f,
+	3.325880f,	3.270340f,	3.212830f,	3.153385f,	3.092040f,	3.028835f,	2.963805f,	2.896990f,
+	2.828425f,	2.758160f,	2.686235f,	2.612690f,	2.537575f,	2.460925f,	2.382795f,	2.303235f,
+	2.222280f,	2.139990f,	2.056410f,	1.971595f,	1.885585f,	1.798445f,	1.710220f,	1.620965f,
+	1.530735f,	1.439580f,	1.347560f,	1.254725f,	1.161140f,	1.066850f,	0.971920f,	0.876405f,
+	0.780360f,	0.683850f,	0.586920f,	0.489643f,	0.392069f,	0.294259f,	0.196270f,	0.098165f,
+	0.000000f,	-0.098165f,	-0.196270f,	-0.294259f,	-0.392069f,	-0.489643f,	-0.586920f,	-0.683850f,
+	-0.780360f,	-0.876405f,	-0.971920f,	-1.066850f,	-1.161140f,	-1.254725f,	-1.347560f,	-1.439580f,
+	-1.530735f,	-1.620965f,	-1.710220f,	-1.798445f,	-1.885585f,	-1.971595f,	-2.056410f,	-2.139990f,
+	-2.222280f,	-2.303235f,	-2.382795f,	-2.460925f,	-2.537575f,	-2.612690f,	-2.686235f,	-2.758160f,
+	-2.828425f,	-2.896990f,	-2.963805f,	-3.028835f,	-3.092040f,	-3.153385f,	-3.212830f,	-3.270340f,
+	-3.325880f,	-3.379415f,	-3.430915f,	-3.480350f,	-3.527685f,	-3.572895f,	-3.615955f,	 -3.656840f,
+	-3.695520f,	-3.731970f,	-3.766175f,	-3.798115f,	-3.827760f,	-3.855105f,	-3.880125f,	-3.902810f,
+	-3.923140f,	-3.941110f,	-3.956705f,	-3.969920f,	-3.980740f,	-3.989160f,	-3.995180f,	-3.998795f,
+	-4.000000f,	-3.998795f,	-3.995180f,	-3.989160f,	-3.980740f,	-3.969920f,	-3.956705f,	-3.941110f,
+	-3.923140f,	-3.902810f,	-3.880125f,	-3.855105f,	-3.827760f,	-3.798115f,	-3.766175f,	-3.731970f,
+	-3.695520f,	-3.656840f,	-3.615955f,	-3.572895f,	-3.527685f,	-3.480350f,	-3.430915f,	-3.379415f,
+	-3.325880f,	-3.270340f,	-3.212830f,	-3.153385f,	-3.092040f,	-3.028835f,	-2.963805f,	-2.896990f,
+	-2.828425f,	-2.758160f,	-2.686235f,	-2.612690f,	-2.537575f,	-2.460925f,	-2.382795f,	-2.303235f,
+	-2.222280f,	-2.139990f,	-2.056410f,	-1.971595f,	-1.885585f,	-1.798445f,	-1.710220f,	-1.620965f,
+	-1.530735f,	-1.439580f,	-1.347560f,	-1.254725f,	-1.161140f,	-1.066850f,	-0.971920f,	-0.876405f,
+	-0.780360f,	-0.683850f,	-0.586920f,	-0.489643f,	-0.392069f,	 -0.294259f,-0.196270f,	-0.098165f
+};
+
 /*
 ==============
 RB_FastSin
@@ -98,6 +152,443 @@ inline float *RB_TableForFunc(const EMatTableFunc func)
 }
 
 
+/*
+===============================================================================
+
+	VERTEX KERNELS
+
+	The per-vertex loops behind the deforms, tcGens and colour generation.
+	Each one has the original scalar loop, and an SSE2 path that takes four
+	vertices at a time and leaves the remainder to the scalar loop. The SSE2
+	paths do the same operations in the same order, so r_deformbench can hold
+	them to the scalar results.
+
+===============================================================================
+*/
+
+#ifdef R_SSE2
+/*
+==============
+RB_EvaluateTable4
+
+Four FTABLE_EVALUATE lookups, truncating and wrapping the same way.
+==============
+*/
+static inline __m128 RB_EvaluateTable4(const float *table, const __m128 x)
+{
+	const __m128i index = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps((float)FTABLE_SIZE))), _mm_set1_epi32(FTABLE_SIZE-1));
+
+	int i[4];
+	_mm_storeu_si128((__m128i *)i, index);
+	return _mm_setr_ps(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+}
+
+
+/*
+==============
+RB_LoadVec3x4 / RB_StoreVec3x4
+
+Swizzles four packed vec3_t's to and from a register per component.
+==============
+*/
+static inline void RB_LoadVec3x4(const float *in, __m128 &x, __m128 &y, __m128 &z)
+{
+	const __m128 a = _mm_loadu_ps(in);		// x0 y0 z0 x1
+	const __m128 b = _mm_loadu_ps(in + 4);	// y1 z1 x2 y2
+	const __m128 c = _mm_loadu_ps(in + 8);	// z2 x3 y3 z3
+
+	x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1,1,2,2)), _MM_SHUFFLE(2,0,3,0));
+	y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0,0,1,1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0));
+	z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1,1,2,2)), c, _MM_SHUFFLE(3,0,2,0));
+}
+
+static inline void RB_StoreVec3x4(float *out, const __m128 x, const __m128 y, const __m128 z)
+{
+	const __m128 xyLow = _mm_unpacklo_ps(x, y);		// x0 y0 x1 y1
+	const __m128 xyHigh = _mm_unpackhi_ps(x, y);	// x2 y2 x3 y3
+
+	_mm_storeu_ps(out, _mm_shuffle_ps(xyLow, _mm_shuffle_ps(z, x, _MM_SHUFFLE(1,1,0,0)), _MM_SHUFFLE(2,0,1,0)));
+	_mm_storeu_ps(out + 4, _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1,1,1,1)), xyHigh, _MM_SHUFFLE(1,0,2,0)));
+	_mm_storeu_ps(out + 8, _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3,3,2,2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(2,0,2,0)));
+}
+
+
+/*
+==============
+RB_RSqrt4
+
+Q_RSqrtf on four values, bit trick and Newton step included.
+==============
+*/
+static inline __m128 RB_RSqrt4(const __m128 number)
+{
+	const __m128 y = _mm_castsi128_ps(_mm_sub_epi32(_mm_set1_epi32(0x5f3759df), _mm_srai_epi32(_mm_castps_si128(number), 1)));
+	const __m128 r = _mm_mul_ps(y, _mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(number, _mm_set1_ps(0.5f)), y), y)));
+
+	return _mm_andnot_ps(_mm_cmpeq_ps(number, _mm_setzero_ps()), r);
+}
+#endif // R_SSE2
+
+
+/*
+==============
+RB_DeformWave
+
+Pushes each vertex along its normal by a wave keyed off its position.
+==============
+*/
+static void RB_DeformWave(vec3_t *verts, const vec3_t *normals, const int numVerts, const float *table, const float spread, const float now, const float amplitude, const float base)
+{
+	int i = 0;
+
+#ifdef R_SSE2
+	if (ri.bSSE2)
+	{
+		const __m128 vSpread = _mm_set1_ps(spread);
+		const __m128 vNow = _mm_set1_ps(now);
+		const __m128 vAmplitude = _mm_set1_ps(amplitude);
+		const __m128 vBase = _mm_set1_ps(base);
+
+		for ( ; i+4<=numVerts ; i+=4)
+		{
+			__m128 x, y, z, nx, ny, nz;
+			RB_LoadVec3x4(verts[i], x, y, z);
+			RB_LoadVec3x4(normals[i], nx, ny, nz);
+
+			__m128 deflect = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_add_ps(x, y), z), vSpread), vNow);
+			deflect = _mm_add_ps(_mm_mul_ps(RB_EvaluateTable4(table, deflect), vAmplitude), vBase);
+
+			RB_StoreVec3x4(verts[i],
+				_mm_add_ps(x, _mm_mul_ps(nx, deflect)),
+				_mm_add_ps(y, _mm_mul_ps(ny, deflect)),
+				_mm_add_ps(z, _mm_mul_ps(nz, deflect)));
+		}
+	}
+#endif // R_SSE2
+
+	for ( ; i<numVerts ; i++)
+	{
+		float deflect = (verts[i][0] + verts[i][1] + verts[i][2]) * spread + now;
+		deflect = FTABLE_EVALUATE(table, deflect) * amplitude + base;
+
+		// Deflect vertex along its normal by wave amount
+		Vec3MA(verts[i], deflect, normals[i], verts[i]);
+	}
+}
+
+
+/*
+==============
+RB_DeformNormals
+
+Wobbles the normals with a sine keyed off their z, and renormalizes.
+==============
+*/
+static void RB_DeformNormals(vec3_t *normals, const int numVerts, const float amplitude, const float phase)
+{
+	int i = 0;
+
+#ifdef R_SSE2
+	if (ri.bSSE2)
+	{
+		const __m128 vAmplitude = _mm_set1_ps(amplitude);
+		const __m128 vPhase = _mm_set1_ps(phase);
+		const __m128 vQuarter = _mm_set1_ps(0.25f);
+
+		for ( ; i+4<=numVerts ; i+=4)
+		{
+			__m128 x, y, z;
+			RB_LoadVec3x4(normals[i], x, y, z);
+
+			const __m128 t = _mm_mul_ps(z, vPhase);
+			x = _mm_mul_ps(x, _mm_mul_ps(vAmplitude, RB_EvaluateTable4(rb_sinTable, t)));
+			y = _mm_mul_ps(y, _mm_mul_ps(vAmplitude, RB_EvaluateTable4(rb_sinTable, _mm_add_ps(t, vQuarter))));
+
+			const __m128 invLength = RB_RSqrt4(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+			RB_StoreVec3x4(normals[i], _mm_mul_ps(x, invLength), _mm_mul_ps(y, invLength), _mm_mul_ps(z, invLength));
+		}
+	}
+#endif // R_SSE2
+
+	for ( ; i<numVerts ; i++)
+	{
+		const float t = normals[i][2] * phase;
+
+		normals[i][0] *= amplitude * RB_FastSin(t);
+		normals[i][1] *= amplitude * RB_FastSin(t + 0.25);
+
+		VectorNormalizeFastf(normals[i]);
+	}
+}
+
+
+/*
+==============
+RB_DeformAlongNormals
+
+Pushes every vertex the same distance along its normal. Both arrays are
+walked as plain floats, so there's no swizzling.
+==============
+*/
+static void RB_DeformAlongNormals(vec3_t *verts, const vec3_t *normals, const int numVerts, const float deflect)
+{
+	int i = 0;
+
+#ifdef R_SSE2
+	if (ri.bSSE2)
+	{
+		float *out = verts[0];
+		const float *in = normals[0];
+		const __m128 vDeflect = _mm_set1_ps(deflect);
+
+		for ( ; i+4<=numVerts ; i+=4, out+=12, in+=12)
+		{
+			_mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), _mm_mul_ps(_mm_loadu_ps(in), vDeflect)));
+			_mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4), _mm_mul_ps(_mm_loadu_ps(in + 4), vDeflect)));
+			_mm_storeu_ps(out + 8, _mm_add_ps(_mm_loadu_ps(out + 8), _mm_mul_ps(_mm_loadu_ps(in + 8), vDeflect)));
+		}
+	}
+#endif // R_SSE2
+
+	for ( ; i<numVerts ; i++)
+		Vec3MA(verts[i], deflect, normals[i], verts[i]);
+}
+
+
+/*
+==============
+RB_DeformMove
+
+Offsets every vertex by the same vector, already scaled by the wave.
+==============
+*/
+static void RB_DeformMove(vec3_t *verts, const int numVerts, const vec3_t move)
+{
+	int i = 0;
+
+#ifdef R_SSE2
+	if (ri.bSSE2)
+	{
+		// Four vertices span three registers, and the offset rotates through them
+		float *out = verts[0];
+		const __m128 vMove0 = _mm_setr_ps(move[0], move[1], move[2], move[0]);
+		const __m128 vMove1 = _mm_setr_ps(move[1], move[2], move[0], move[1]);
+		const __m128 vMove2 = _mm_setr_ps(move[2], move[0], move[1], move[2]);
+
+		for ( ; i+4<=numVerts ; i+=4, out+=12)
+		{
+			_mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), vMove0));
+			_mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4), vMove1));
+			_mm_storeu_ps(out + 8, _mm_add_ps(_mm_loadu_ps(out + 8), vMove2));
+		}
+	}
+#endif // R_SSE2
+
+	for ( ; i<numVerts ; i++)
+		Vec3Add(verts[i], move, verts[i]);
+}
+
+
+/*
+==============
+RB_TCGenEnvironment
+
+Sphere map coordinates from the reflected view vector at each vertex. The
+view origin has to be in the same space as the vertices.
+==============
+*/
+static void RB_TCGenEnvironment(vec2_t *outCoords, const vec3_t *verts, const vec3_t *normals, const int numVerts, const vec3_t viewOrigin)
+{
+	int i = 0;
+
+#ifdef R_SSE2
+	if (ri.bSSE2)
+	{
+		const __m128 vOriginX = _mm_set1_ps(viewOrigin[0]);
+		const __m128 vOriginY = _mm_set1_ps(viewOrigin[1]);
+		const __m128 vOriginZ = _mm_set1_ps(viewOrigin[2]);
+		const __m128 vHalf = _mm_set1_ps(0.5f);
+
+		for ( ; i+4<=numVerts ; i+=4)
+		{
+			__m128 px, py, pz, nx, ny, nz;
+			RB_LoadVec3x4(verts[i], px, py, pz);
+			RB_LoadVec3x4(normals[i], nx, ny, nz);
+
+			px = _mm_sub_ps(vOriginX, px);
+			py = _mm_sub_ps(vOriginY, py);
+			pz = _mm_sub_ps(vOriginZ, pz);
+
+			const __m128 invLength = RB_RSqrt4(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py)), _mm_mul_ps(pz, pz)));
+			px = _mm_mul_ps(px, invLength);
+			py = _mm_mul_ps(py, invLength);
+			pz = _mm_mul_ps(pz, invLength);
+
+			__m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, px), _mm_mul_ps(ny, py)), _mm_mul_ps(nz, pz));
+			depth = _mm_add_ps(depth, depth);
+
+			const __m128 s = _mm_add_ps(vHalf, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ny, depth), py), vHalf));
+			const __m128 t = _mm_sub_ps(vHalf, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(nz, depth), pz), vHalf));
+
+			_mm_storeu_ps(outCoords[i], _mm_unpacklo_ps(s, t));
+			_mm_storeu_ps(outCoords[i+2], _mm_unpackhi_ps(s, t));
+		}
+	}
+#endif // R_SSE2
+
+	for ( ; i<numVerts ; i++)
+	{
+		vec3_t projection;
+		Vec3Subtract(viewOrigin, verts[i], projection);
+		VectorNormalizeFastf(projection);
+
+		float depth = DotProduct(normals[i], projection);
+		depth += depth;
+
+		outCoords[i][0] = 0.5 + (normals[i][1] * depth - projection[1]) * 0.5;
+		outCoords[i][1] = 0.5 - (normals[i][2] * depth - projection[2]) * 0.5;
+	}
+}
+
+
+/*
+==============
+RB_TCGenWarp
+
+The Quake2 water warp. The table index is worked out in double and rounded
+the way Q_ftol does it, so the SSE2 path lands on the same entries.
+==============
+*/
+static void RB_TCGenWarp(vec2_t *outCoords, const vec2_t *inCoords, const int numVerts, const float time)
+{
+	int i = 0;
+
+#ifdef R_SSE2
+	if (ri.bSSE2)
+	{
+		const __m128 vEight = _mm_set1_ps(8.0f);
+		const __m128 vTime = _mm_set1_ps(time);
+		const __m128 vWarpScale = _mm_set1_ps(1.0f/64);
+		const __m128d vIndexScale = _mm_set1_pd(256.0f / (M_PI * 2.0f));
+
+		// Two vertices at a time, as s0 t0 s1 t1
+		for ( ; i+2<=numVerts ; i+=2)
+		{
+			const __m128 st = _mm_loadu_ps(inCoords[i]);
+			const __m128 a = _mm_add_ps(_mm_mul_ps(st, vEight), vTime);
+			const __m128d low = _mm_mul_pd(_mm_cvtps_pd(a), vIndexScale);
+			const __m128d high = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(a, a)), vIndexScale);
+
+#ifdef id386
+			// Q_ftol takes a float, and fistp rounds to nearest
+			__m128i index = _mm_cvtps_epi32(_mm_movelh_ps(_mm_cvtpd_ps(low), _mm_cvtpd_ps(high)));
+#else
+			__m128i index = _mm_unpacklo_epi64(_mm_cvttpd_epi32(low), _mm_cvttpd_epi32(high));
+#endif
+			// s is warped by t and the other way around
+			index = _mm_and_si128(_mm_shuffle_epi32(index, _MM_SHUFFLE(2,3,0,1)), _mm_set1_epi32(255));
+
+			int k[4];
+			_mm_storeu_si128((__m128i *)k, index);
+			const __m128 warp = _mm_setr_ps(r_warpSinTable[k[0]], r_warpSinTable[k[1]], r_warpSinTable[k[2]], r_warpSinTable[k[3]]);
+
+			_mm_storeu_ps(outCoords[i], _mm_add_ps(st, _mm_mul_ps(warp, vWarpScale)));
+		}
+	}
+#endif // R_SSE2
+
+	for ( ; i<numVerts ; i++)
+	{
+		outCoords[i][0] = inCoords[i][0] + (r_warpSinTable[Q_ftol (((inCoords[i][1]*8.0f + time) * (256.0f / (M_PI * 2.0f)))) & 255] * (1.0/64));
+		outCoords[i][1] = inCoords[i][1] + (r_warpSinTable[Q_ftol (((inCoords[i][0]*8.0f + time) * (256.0f / (M_PI * 2.0f)))) & 255] * (1.0/64));
+	}
+}
+
+
+/*
+==============
+RB_PackColor
+==============
+*/
+static inline uint32 RB_PackColor(const byte r, const byte g, const byte b, const byte a)
+{
+	const colorb color(r, g, b, a);
+	return *(const uint32 *)&color[0];
+}
+
+
+/*
+==============
+RB_FillColors
+
+Sets the masked channels of every color to the same value, leaving the rest.
+==============
+*/
+static void RB_FillColors(colorb *outColors, const int numColors, const uint32 value, const uint32 mask)
+{
+	uint32 *out = (uint32 *)outColors;
+	const uint32 keep = ~mask;
+	const uint32 fill = value & mask;
+	int i = 0;
+
+#ifdef R_SSE2
+	if (ri.bSSE2)
+	{
+		const __m128i vKeep = _mm_set1_epi32((int)keep);
+		const __m128i vFill = _mm_set1_epi32((int)fill);
+
+		for ( ; i+4<=numColors ; i+=4)
+		{
+			const __m128i c = _mm_loadu_si128((const __m128i *)(out + i));
+			_mm_storeu_si128((__m128i *)(out + i), _mm_or_si128(_mm_and_si128(c, vKeep), vFill));
+		}
+	}
+#endif // R_SSE2
+
+	for ( ; i<numColors ; i++)
+		out[i] = (out[i] & keep) | fill;
+}
+
+
+/*
+==============
+RB_CopyColors
+
+Copies the masked channels from the vertex colors, shifting each byte down
+and then xor'ing it (255 ^ x is 255 - x for the "one minus" gens).
+==============
+*/
+static void RB_CopyColors(colorb *outColors, const colorb *inColors, const int numColors, const int shift, const uint32 invert, const uint32 mask)
+{
+	uint32 *out = (uint32 *)outColors;
+	const uint32 *in = (const uint32 *)inColors;
+	const uint32 keep = ~mask;
+	const uint32 byteMask = (0xFFu >> shift) * 0x01010101u;
+	int i = 0;
+
+#ifdef R_SSE2
+	if (ri.bSSE2)
+	{
+		const __m128i vKeep = _mm_set1_epi32((int)keep);
+		const __m128i vMask = _mm_set1_epi32((int)mask);
+		const __m128i vByteMask = _mm_set1_epi32((int)byteMask);
+		const __m128i vInvert = _mm_set1_epi32((int)invert);
+		const __m128i vShift = _mm_cvtsi32_si128(shift);
+
+		for ( ; i+4<=numColors ; i+=4)
+		{
+			__m128i c = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i *)(in + i)), vShift), vByteMask);
+			c = _mm_and_si128(_mm_xor_si128(c, vInvert), vMask);
+			_mm_storeu_si128((__m128i *)(out + i), _mm_or_si128(_mm_and_si128(_mm_loadu_si128((const __m128i *)(out + i)), vKeep), c));
+		}
+	}
+#endif // R_SSE2
+
+	for ( ; i<numColors ; i++)
+		out[i] = (out[i] & keep) | ((((in[i] >> shift) & byteMask) ^ invert) & mask);
+}
+
+
 /*
 =============
 RB_LockArrays
@@ -333,6 +824,37 @@ static void RB_SetupColorFog(const matPass_t *pass, int numColors)
 }
 
 
+/*
+=============
+RB_SameColorGen
+
+The colour array only depends on the rgbGen and alphaGen of a pass (time,
+entity and vertices are fixed for the mesh buffer), so passes that agree on
+those can share it.
+=============
+*/
+static inline bool RB_SameMaterialFunc(const materialFunc_t &a, const materialFunc_t &b)
+{
+	return (a.type == b.type
+		&& a.args[0] == b.args[0] && a.args[1] == b.args[1]
+		&& a.args[2] == b.args[2] && a.args[3] == b.args[3]);
+}
+
+static bool RB_SameColorGen(const matPass_t *pass)
+{
+	const rgbGen_t &rgbGen = rb_colorCache.rgbGen;
+	const alphaGen_t &alphaGen = rb_colorCache.alphaGen;
+
+	return (pass->rgbGen.type == rgbGen.type
+		&& pass->rgbGen.fArgs[0] == rgbGen.fArgs[0] && pass->rgbGen.fArgs[1] == rgbGen.fArgs[1] && pass->rgbGen.fArgs[2] == rgbGen.fArgs[2]
+		&& pass->rgbGen.bArgs[0] == rgbGen.bArgs[0] && pass->rgbGen.bArgs[1] == rgbGen.bArgs[1] && pass->rgbGen.bArgs[2] == rgbGen.bArgs[2]
+		&& RB_SameMaterialFunc(pass->rgbGen.func, rgbGen.func)
+		&& pass->alphaGen.type == alphaGen.type
+		&& pass->alphaGen.args[0] == alphaGen.args[0] && pass->alphaGen.args[1] == alphaGen.args[1]
+		&& RB_SameMaterialFunc(pass->alphaGen.func, alphaGen.func));
+}
+
+
 /*
 =============
 RB_SetupColor
@@ -343,7 +865,7 @@ static void RB_SetupColor(const matPass_t *pass)
 	const materialFunc_t *rgbGenFunc, *alphaGenFunc;
 	int		r, g, b;
 	float	*table, c, a;
-	byte	*bArray, *inArray;
+	byte	*bArray;
 	int		numColors, i;
 	vec3_t	t, v;
 
@@ -360,41 +882,35 @@ static void RB_SetupColor(const matPass_t *pass)
 		numColors = rb.numVerts;
 	}
 
+	// Reuse the last pass's colors if they came out of the same gens
+	if (!rb.curColorFog
+	&& rb_colorCache.meshSerial == rb_meshSerial
+	&& rb_colorCache.numColors >= numColors
+	&& RB_SameColorGen(pass))
+	{
+		ri.pc.colorCacheHits++;
+		RB_SetColor(rb.outColorArray, numColors);
+		return;
+	}
+
+	const uint32 rgbMask = RB_PackColor(255, 255, 255, 0);
+	const uint32 alphaMask = RB_PackColor(0, 0, 0, 255);
+	const int intensityShift = (intensity->intVal > 0) ? min(intensity->intVal / 2, 8) : 0;
+
 	// Color generation
-	bArray = rb.outColorArray[0];
-	inArray = rb.inColors[0];
 	switch (pass->rgbGen.type)
 	{
 	case RGB_GEN_UNKNOWN:
 	case RGB_GEN_IDENTITY:
-		for (i=0 ; i<numColors ; i++, bArray+=4)
-		{
-			bArray[0] = 255;
-			bArray[1] = 255;
-			bArray[2] = 255;
-		}
+		RB_FillColors(rb.outColorArray, numColors, RB_PackColor(255, 255, 255, 0), rgbMask);
 		break;
 
 	case RGB_GEN_IDENTITY_LIGHTING:
-		for (i=0 ; i<numColors ; i++, bArray+=4)
-		{
-			bArray[0] = ri.identityLighting;
-			bArray[1] = ri.identityLighting;
-			bArray[2] = ri.identityLighting;
-		}
+		RB_FillColors(rb.outColorArray, numColors, RB_PackColor(ri.identityLighting, ri.identityLighting, ri.identityLighting, 0), rgbMask);
 		break;
 
 	case RGB_GEN_CONST:
-		r = pass->rgbGen.bArgs[0];
-		g = pass->rgbGen.bArgs[1];
-		b = pass->rgbGen.bArgs[2];
-
-		for (i=0 ; i<numColors ; i++, bArray+=4)
-		{
-			bArray[0] = r;
-			bArray[1] = g;
-			bArray[2] = b;
-		}
+		RB_FillColors(rb.outColorArray, numColors, RB_PackColor(pass->rgbGen.bArgs[0], pass->rgbGen.bArgs[1], pass->rgbGen.bArgs[2], 0), rgbMask);
 		break;
 
 	case RGB_GEN_COLORWAVE:
@@ -405,80 +921,36 @@ static void RB_SetupColor(const matPass_t *pass)
 		a = pass->rgbGen.fArgs[1] * c; g = FloatToByte (bound (0, a, 1));
 		a = pass->rgbGen.fArgs[2] * c; b = FloatToByte (bound (0, a, 1));
 
-		for (i=0 ; i<numColors ; i++, bArray+=4)
-		{
-			bArray[0] = r;
-			bArray[1] = g;
-			bArray[2] = b;
-		}
+		RB_FillColors(rb.outColorArray, numColors, RB_PackColor(r, g, b, 0), rgbMask);
 		break;
 
 	case RGB_GEN_ENTITY:
-		for (i=0 ; i<numColors ; i++, bArray+=4)
-			*(colorb *)bArray = rb.curEntity->color;
+		RB_FillColors(rb.outColorArray, numColors, RB_PackColor(rb.curEntity->color[0], rb.curEntity->color[1], rb.curEntity->color[2], 0), rgbMask);
 		break;
 
 	case RGB_GEN_ONE_MINUS_ENTITY:
-		for (i=0 ; i<numColors ; i++, bArray+=4)
-		{
-			bArray[0] = 255 - rb.curEntity->color[0];
-			bArray[1] = 255 - rb.curEntity->color[1];
-			bArray[2] = 255 - rb.curEntity->color[2];
-		}
+		RB_FillColors(rb.outColorArray, numColors, RB_PackColor(255 - rb.curEntity->color[0], 255 - rb.curEntity->color[1], 255 - rb.curEntity->color[2], 0), rgbMask);
 		break;
 
 	case RGB_GEN_VERTEX:
-		if (intensity->intVal > 0)
-		{
-			for (i=0 ; i<numColors ; i++, bArray+=4, inArray+=4)
-			{
-				bArray[0] = inArray[0] >> (intensity->intVal / 2);
-				bArray[1] = inArray[1] >> (intensity->intVal / 2);
-				bArray[2] = inArray[2] >> (intensity->intVal / 2);
-			}
-			break;
-		}
+		RB_CopyColors(rb.outColorArray, rb.inColors, numColors, intensityShift, 0, rgbMask);
+		break;
 
-	// FALL THROUGH
 	case RGB_GEN_LIGHTING_DIFFUSE:
 	case RGB_GEN_EXACT_VERTEX:
-		for (i=0 ; i<numColors ; i++, bArray+=4, inArray+=4)
-		{
-			bArray[0] = inArray[0];
-			bArray[1] = inArray[1];
-			bArray[2] = inArray[2];
-		}
+		RB_CopyColors(rb.outColorArray, rb.inColors, numColors, 0, 0, rgbMask);
 		break;
 
 	case RGB_GEN_ONE_MINUS_VERTEX:
-		if (intensity->intVal > 0)
-		{
-			for (i=0 ; i<numColors ; i++, bArray+=4, inArray+=4)
-			{
-				bArray[0] = 255 - (inArray[0] >> (intensity->intVal / 2));
-				bArray[1] = 255 - (inArray[1] >> (intensity->intVal / 2));
-				bArray[2] = 255 - (inArray[2] >> (intensity->intVal / 2));
-			}
-			break;
-		}
+		RB_CopyColors(rb.outColorArray, rb.inColors, numColors, intensityShift, rgbMask, rgbMask);
+		break;
 
-	// FALL THROUGH
 	case RGB_GEN_ONE_MINUS_EXACT_VERTEX:
-		for (i=0 ; i<numColors ; i++, bArray+=4, inArray+=4)
-		{
-			bArray[0] = 255 - inArray[0];
-			bArray[1] = 255 - inArray[1];
-			bArray[2] = 255 - inArray[2];
-		}
+		RB_CopyColors(rb.outColorArray, rb.inColors, numColors, 0, rgbMask, rgbMask);
 		break;
 
 	case RGB_GEN_FOG:
-		for (i=0 ; i<numColors ; i++, bArray+=4)
-		{
-			bArray[0] = rb.curTexFog->mat->fogColor[0];
-			bArray[1] = rb.curTexFog->mat->fogColor[1];
-			bArray[2] = rb.curTexFog->mat->fogColor[2];
-		}
+		RB_FillColors(rb.outColorArray, numColors, RB_PackColor(rb.curTexFog->mat->fogColor[0], rb.curTexFog->mat->fogColor[1], rb.curTexFog->mat->fogColor[2], 0), rgbMask);
 		break;
 
 	default:
@@ -488,21 +960,16 @@ static void RB_SetupColor(const matPass_t *pass)
 
 	// Alpha generation
 	bArray = rb.outColorArray[0];
-	inArray = rb.inColors[0];
 	switch (pass->alphaGen.type)
 	{
 	case ALPHA_GEN_UNKNOWN:
 	case ALPHA_GEN_IDENTITY:
-		for (i=0 ; i<numColors ; i++, bArray+=4)
-		{
-			bArray[3] = 255;
-		}
+		RB_FillColors(rb.outColorArray, numColors, alphaMask, alphaMask);
 		break;
 
 	case ALPHA_GEN_CONST:
 		b = FloatToByte (pass->alphaGen.args[0]);
-		for (i=0 ; i<numColors ; i++, bArray+=4)
-			bArray[3] = b;
+		RB_FillColors(rb.outColorArray, numColors, RB_PackColor(0, 0, 0, b), alphaMask);
 		break;
 
 	case ALPHA_GEN_WAVE:
@@ -510,8 +977,7 @@ static void RB_SetupColor(const matPass_t *pass)
 		a = alphaGenFunc->args[2] + rb_matTime * alphaGenFunc->args[3];
 		a = FTABLE_EVALUATE(table, a) * alphaGenFunc->args[1] + alphaGenFunc->args[0];
 		b = FloatToByte (bound (0.0f, a, 1.0f));
-		for (i=0 ; i<numColors ; i++, bArray+=4)
-			bArray[3] = b;
+		RB_FillColors(rb.outColorArray, numColors, RB_PackColor(0, 0, 0, b), alphaMask);
 		break;
 
 	case ALPHA_GEN_PORTAL:
@@ -519,23 +985,19 @@ static void RB_SetupColor(const matPass_t *pass)
 		Vec3Subtract (ri.def.viewOrigin, v, t);
 		a = Vec3Length (t) * pass->alphaGen.args[0];
 		b = FloatToByte (clamp (a, 0.0f, 1.0f));
-
-		for (i=0 ; i<numColors ; i++, bArray+=4)
-			bArray[3] = b;
+		RB_FillColors(rb.outColorArray, numColors, RB_PackColor(0, 0, 0, b), alphaMask);
 		break;
 
 	case ALPHA_GEN_VERTEX:
-		for (i=0 ; i<numColors ; i++, bArray+=4, inArray+=4)
-			bArray[3] = inArray[3];
+		RB_CopyColors(rb.outColorArray, rb.inColors, numColors, 0, 0, alphaMask);
 		break;
 
 	case ALPHA_GEN_ONE_MINUS_VERTEX:
-		for (i=0 ; i<numColors ; i++, bArray+=4, inArray+=4)
-			bArray[3] = 255 - inArray[3];
+		RB_CopyColors(rb.outColorArray, rb.inColors, numColors, 0, alphaMask, alphaMask);
+		break;
 
 	case ALPHA_GEN_ENTITY:
-		for (i=0 ; i<numColors ; i++, bArray+=4)
-			bArray[3] = rb.curEntity->color[3];
+		RB_FillColors(rb.outColorArray, numColors, RB_PackColor(0, 0, 0, rb.curEntity->color[3]), alphaMask);
 		break;
 
 	case ALPHA_GEN_SPECULAR:
@@ -586,8 +1048,7 @@ static void RB_SetupColor(const matPass_t *pass)
 		break;
 
 	case ALPHA_GEN_FOG:
-		for (i=0 ; i<numColors ; i++, bArray+=4)
-			bArray[3] = rb.curTexFog->mat->fogColor[3];
+		RB_FillColors(rb.outColorArray, numColors, RB_PackColor(0, 0, 0, rb.curTexFog->mat->fogColor[3]), alphaMask);
 		break;
 
 	default:
@@ -597,47 +1058,22 @@ static void RB_SetupColor(const matPass_t *pass)
 
 	// Colored fog
 	if (rb.curColorFog)
+	{
 		RB_SetupColorFog(pass, numColors);
+		rb_colorCache.meshSerial = 0;
+	}
+	else
+	{
+		rb_colorCache.meshSerial = rb_meshSerial;
+		rb_colorCache.numColors = numColors;
+		rb_colorCache.rgbGen = pass->rgbGen;
+		rb_colorCache.alphaGen = pass->alphaGen;
+	}
 
 	// Set color
 	RB_SetColor(rb.outColorArray, numColors);
 }
 
-static const float r_warpSinTable[] =
-{
-	0.000000f,	0.098165f,	0.196270f,	0.294259f,	0.392069f,	0.489643f,	0.586920f,	0.683850f,
-	0.780360f,	0.876405f,	0.971920f,	1.066850f,	1.161140f,	1.254725f,	1.347560f,	1.439580f,
-	1.530735f,	1.620965f,	1.710220f,	1.798445f,	1.885585f,	1.971595f,	2.056410f,	2.139990f,
-	2.222280f,	2.303235f,	2.382795f,	2.460925f,	2.537575f,	2.612690f,	2.686235f,	2.758160f,
-	2.828425f,	2.896990f,	2.963805f,	3.028835f,	3.092040f,	3.153385f,	3.212830f,	3.270340f,
-	3.325880f,	3.379415f,	3.430915f,	3.480350f,	3.527685f,	3.572895f,	3.615955f,	3.656840f,
-	3.695520f,	3.731970f,	3.766175f,	3.798115f,	3.827760f,	3.855105f,	3.880125f,	3.902810f,
-	3.923140f,	3.941110f,	3.956705f,	3.969920f,	3.980740f,	3.989160f,	3.995180f,	3.998795f,
-	4.000000f,	3.998795f,	3.995180f,	3.989160f,	3.980740f,	3.969920f,	3.956705f,	3.941110f,
-	3.923140f,	3.902810f,	3.880125f,	3.855105f,	3.827760f,	3.798115f,	3.766175f,	3.731970f,
-	3.695520f,	3.656840f,	3.615955f,	3.572895f,	3.527685f,	3.480350f,	3.430915f,	3.379415f,
-	3.325880f,	3.270340f,	3.212830f,	3.153385f,	3.092040f,	3.028835f,	2.963805f,	2.896990f,
-	2.828425f,	2.758160f,	2.686235f,	2.612690f,	2.537575f,	2.460925f,	2.382795f,	2.303235f,
-	2.222280f,	2.139990f,	2.056410f,	1.971595f,	1.885585f,	1.798445f,	1.710220f,	1.620965f,
-	1.530735f,	1.439580f,	1.347560f,	1.254725f,	1.161140f,	1.066850f,	0.971920f,	0.876405f,
-	0.780360f,	0.683850f,	0.586920f,	0.489643f,	0.392069f,	0.294259f,	0.196270f,	0.098165f,
-	0.000000f,	-0.098165f,	-0.196270f,	-0.294259f,	-0.392069f,	-0.489643f,	-0.586920f,	-0.683850f,
-	-0.780360f,	-0.876405f,	-0.971920f,	-1.066850f,	-1.161140f,	-1.254725f,	-1.347560f,	-1.439580f,
-	-1.530735f,	-1.620965f,	-1.710220f,	-1.798445f,	-1.885585f,	-1.971595f,	-2.056410f,	-2.139990f,
-	-2.222280f,	-2.303235f,	-2.382795f,	-2.460925f,	-2.537575f,	-2.612690f,	-2.686235f,	-2.758160f,
-	-2.828425f,	-2.896990f,	-2.963805f,	-3.028835f,	-3.092040f,	-3.153385f,	-3.212830f,	-3.270340f,
-	-3.325880f,	-3.379415f,	-3.430915f,	-3.480350f,	-3.527685f,	-3.572895f,	-3.615955f,	 -3.656840f,
-	-3.695520f,	-3.731970f,	-3.766175f,	-3.798115f,	-3.827760f,	-3.855105f,	-3.880125f,	-3.902810f,
-	-3.923140f,	-3.941110f,	-3.956705f,	-3.969920f,	-3.980740f,	-3.989160f,	-3.995180f,	-3.998795f,
-	-4.000000f,	-3.998795f,	-3.995180f,	-3.989160f,	-3.980740f,	-3.969920f,	-3.956705f,	-3.941110f,
-	-3.923140f,	-3.902810f,	-3.880125f,	-3.855105f,	-3.827760f,	-3.798115f,	-3.766175f,	-3.731970f,
-	-3.695520f,	-3.656840f,	-3.615955f,	-3.572895f,	-3.527685f,	-3.480350f,	-3.430915f,	-3.379415f,
-	-3.325880f,	-3.270340f,	-3.212830f,	-3.153385f,	-3.092040f,	-3.028835f,	-2.963805f,	-2.896990f,
-	-2.828425f,	-2.758160f,	-2.686235f,	-2.612690f,	-2.537575f,	-2.460925f,	-2.382795f,	-2.303235f,
-	-2.222280f,	-2.139990f,	-2.056410f,	-1.971595f,	-1.885585f,	-1.798445f,	-1.710220f,	-1.620965f,
-	-1.530735f,	-1.439580f,	-1.347560f,	-1.254725f,	-1.161140f,	-1.066850f,	-0.971920f,	-0.876405f,
-	-0.780360f,	-0.683850f,	-0.586920f,	-0.489643f,	-0.392069f,	 -0.294259f,-0.196270f,	-0.098165f
-};
 
 /*
 =============
@@ -704,6 +1140,34 @@ static void RB_ApplyTCMods(matPass_t *pass, mat4x4_t result)
 		}
 	}
 }
+/*
+=============
+RB_TCGenCached
+
+True if the texcoord array on this unit already holds this tcGen for the
+current mesh buffer, otherwise claims it for the caller to fill.
+=============
+*/
+static bool RB_TCGenCached(const ETextureUnit texUnit, const EMatPass_TCGen tcGen)
+{
+	rbTCGenCache_t &cache = rb_tcGenCache[texUnit];
+	if (cache.meshSerial == rb_meshSerial && cache.tcGen == tcGen)
+	{
+		ri.pc.tcGenCacheHits++;
+		return true;
+	}
+
+	cache.meshSerial = rb_meshSerial;
+	cache.tcGen = tcGen;
+	return false;
+}
+
+
+/*
+=============
+RB_VertexTCBase
+=============
+*/
 static bool RB_VertexTCBase(matPass_t *pass, ETextureUnit texUnit, mat4x4_t matrix)
 {
 	Matrix4_Identity(matrix);
@@ -755,19 +1219,12 @@ static bool RB_VertexTCBase(matPass_t *pass, ETextureUnit texUnit, mat4x4_t matr
 			vec3_t transform;
 			vec3_t projection;
 
-			Vec3Subtract(ri.def.viewOrigin, rb.curEntity->origin, projection);
-			Matrix3_TransformVector(rb.curEntity->axis, projection, transform);
-
-			for (int i=0 ; i<rb.numVerts ; i++)
+			if (!RB_TCGenCached(texUnit, TC_GEN_ENVIRONMENT))
 			{
-				Vec3Subtract(transform, rb.inVertices[i], projection);
-				VectorNormalizeFastf(projection);
-
-				float depth = DotProduct(rb.inNormals[i], projection);
-				depth += depth;
+				Vec3Subtract(ri.def.viewOrigin, rb.curEntity->origin, projection);
+				Matrix3_TransformVector(rb.curEntity->axis, projection, transform);
 
-				rb.outCoordArray[texUnit][i][0] = 0.5 + (rb.inNormals[i][1] * depth - projection[1]) * 0.5;
-				rb.outCoordArray[texUnit][i][1] = 0.5 - (rb.inNormals[i][2] * depth - projection[2]) * 0.5;
+				RB_TCGenEnvironment(rb.outCoordArray[texUnit], rb.inVertices, rb.inNormals, rb.numVerts, transform);
 			}
 
 			glTexCoordPointer(2, GL_FLOAT, 0, rb.outCoordArray[texUnit][0]);
@@ -806,11 +1263,8 @@ static bool RB_VertexTCBase(matPass_t *pass, ETextureUnit texUnit, mat4x4_t matr
 		return true;
 
 	case TC_GEN_WARP:
-		for (int i=0 ; i<rb.numVerts ; i++)
-		{
-			rb.outCoordArray[texUnit][i][0] = rb.inCoords[i][0] + (r_warpSinTable[Q_ftol (((rb.inCoords[i][1]*8.0f + rb_matTime) * (256.0f / (M_PI * 2.0f)))) & 255] * (1.0/64));
-			rb.outCoordArray[texUnit][i][1] = rb.inCoords[i][1] + (r_warpSinTable[Q_ftol (((rb.inCoords[i][0]*8.0f + rb_matTime) * (256.0f / (M_PI * 2.0f)))) & 255] * (1.0/64));
-		}
+		if (!RB_TCGenCached(texUnit, TC_GEN_WARP))
+			RB_TCGenWarp(rb.outCoordArray[texUnit], rb.inCoords, rb.numVerts, rb_matTime);
 
 		glTexCoordPointer(2, GL_FLOAT, 0, rb.outCoordArray[texUnit][0]);
 		return true;
@@ -862,6 +1316,9 @@ static bool RB_VertexTCBase(matPass_t *pass, ETextureUnit texUnit, mat4x4_t matr
 						+ (ri.def.viewOrigin[1] - viewToFog[1]) * ri.def.viewAxis[0][1]
 						+ (ri.def.viewOrigin[2] - viewToFog[2]) * ri.def.viewAxis[0][2]);
 
+			// Fog coords aren't kept, but they replace whatever was on this unit
+			rb_tcGenCache[texUnit].meshSerial = 0;
+
 			float *outCoords = rb.outCoordArray[texUnit][0];
 			if (dist < 0)
 			{
@@ -965,32 +1422,12 @@ static void RB_DeformVertices()
 				float *table = RB_TableForFunc(vertDeform->func.type);
 				float now = vertDeform->func.args[2] + vertDeform->func.args[3] * rb_matTime;
 
-				for (int j=0 ; j<rb.numVerts ; j++)
-				{
-					float deflect = (rb.inVertices[j][0] + rb.inVertices[j][1] + rb.inVertices[j][2]) * vertDeform->args[0] + now;
-					deflect = FTABLE_EVALUATE (table, deflect) * vertDeform->func.args[1] + vertDeform->func.args[0];
-
-					// Deflect vertex along its normal by wave amount
-					Vec3MA (rb.inVertices[j], deflect, rb.inNormals[j], rb.inVertices[j]);
-				}
+				RB_DeformWave(rb.inVertices, rb.inNormals, rb.numVerts, table, vertDeform->args[0], now, vertDeform->func.args[1], vertDeform->func.args[0]);
 			}
 			break;
 
 		case DEFORMV_NORMAL:
-			{
-				vec2_t args;
-				args[0] = vertDeform->args[1] * rb_matTime;
-
-				for (int j=0 ; j<rb.numVerts ; j++)
-				{
-					args[1] = rb.inNormals[j][2] * args[0];
-
-					rb.inNormals[j][0] *= vertDeform->args[0] * RB_FastSin(args[1]);
-					rb.inNormals[j][1] *= vertDeform->args[0] * RB_FastSin(args[1] + 0.25);
-
-					VectorNormalizeFastf(rb.inNormals[j]);
-				}
-			}
+			RB_DeformNormals(rb.inNormals, rb.numVerts, vertDeform->args[0], vertDeform->args[1] * rb_matTime);
 			break;
 
 		case DEFORMV_BULGE:
@@ -1000,11 +1437,10 @@ static void RB_DeformVertices()
 				args[1] = vertDeform->args[1];
 				args[2] = rb_matTime / (vertDeform->args[2] * rb.curPatchWidth);
 
-				for (uint32 l=0, p=0 ; l<rb.curPatchHeight ; l++)
+				for (uint32 l=0, p=0 ; l<rb.curPatchHeight ; l++, p+=rb.curPatchWidth)
 				{
 					float deflect = RB_FastSin ((float)l * args[0] + args[2]) * args[1];
-					for (uint32 m=0 ; m<rb.curPatchWidth ; m++, p++)
-						Vec3MA (rb.inVertices[p], deflect, rb.inNormals[p], rb.inVertices[p]);
+					RB_DeformAlongNormals(rb.inVertices + p, rb.inNormals + p, (int)rb.curPatchWidth, deflect);
 				}
 			}
 			break;
@@ -1015,8 +1451,9 @@ static void RB_DeformVertices()
 				float deflect = vertDeform->func.args[2] + rb_matTime * vertDeform->func.args[3];
 				deflect = FTABLE_EVALUATE(table, deflect) * vertDeform->func.args[1] + vertDeform->func.args[0];
 
-				for (int j=0 ; j<rb.numVerts ; j++)
-					Vec3MA (rb.inVertices[j], deflect, vertDeform->args, rb.inVertices[j]);
+				vec3_t move;
+				Vec3Scale (vertDeform->args, deflect, move);
+				RB_DeformMove(rb.inVertices, rb.numVerts, move);
 			}
 			break;
 
@@ -1376,6 +1813,11 @@ static void RB_DrawElements()
 		ri.pc.polyElements++;
 		ri.pc.polyPolys += rb.numIndexes/3;
 		break;
+
+	case MBT_PARTICLE:
+		ri.pc.particleElements++;
+		ri.pc.particlePolys += rb.numIndexes/3;
+		break;
 	}
 }
 
@@ -2049,6 +2491,7 @@ static inline void RB_SetOutlineColor()
 		break;
 
 	case MBT_POLY:
+	case MBT_PARTICLE:
 		glColor4ubv(Q_BColorGreen);
 		break;
 
@@ -2209,6 +2652,9 @@ void RB_RenderMeshBuffer(refMeshBuffer *mb)
 	const bool bAddDLights = (rb.curDLightBits != 0);
 	const bool bAddShadows = (rb.curShadowBits != 0);
 
+	if (!++rb_meshSerial)
+		rb_meshSerial = 1;
+
 	// Set time
 	if (RB_In2DMode())
 		rb_matTime = Sys_Milliseconds() * 0.001f;
@@ -2452,7 +2898,8 @@ void RB_BeginFrame()
 	prevUpdate = Sys_UMilliseconds() % interval;
 
 	// Setup the frame for rendering
-	GLimp_BeginFrame();
+	if (!ri.bNullBackend)
+		GLimp_BeginFrame();
 
 	// Go into 2D mode
 	RB_SetupGL2D();
@@ -2479,9 +2926,191 @@ void RB_EndFrame()
 	RF_Flush2D();
 
 	// Swap buffers
-	GLimp_EndFrame();
+	if (!ri.bNullBackend)
+		GLimp_EndFrame();
 }
 
+/*
+===============================================================================
+
+	KERNEL BENCH
+
+===============================================================================
+*/
+
+enum
+{
+	BENCH_WAVE,
+	BENCH_NORMALS,
+	BENCH_BULGE,
+	BENCH_MOVE,
+	BENCH_ENVIRONMENT,
+	BENCH_WARP,
+	BENCH_COLORS,
+
+	BENCH_MAX
+};
+
+static const char *rb_benchNames[BENCH_MAX] =
+{
+	"wave",
+	"normal",
+	"bulge",
+	"move",
+	"environment",
+	"warp",
+	"colors",
+};
+
+static conCmd_t	*cmd_deformBench;
+
+/*
+=============
+RB_DeformBench_f
+
+Runs the vertex kernels over random vertices, scalar and then SSE2, and
+prints the time for each and the largest difference between them. Anything
+but "yes" in the exact column means an SSE2 path has drifted from the scalar
+one, or the scalar maths is being done on the x87 at a higher precision.
+=============
+*/
+static void RB_DeformBench_f()
+{
+	// Not a multiple of four, so the scalar tails get checked too
+	const int numVerts = RB_MAX_VERTS - 3;
+	const int numRuns = (Cmd_Argc() > 1) ? max(atoi(Cmd_Argv(1)), 1) : 50;
+
+	const bool bHadSSE2 = ri.bSSE2;
+	if (!bHadSSE2)
+		Com_Printf(0, "SSE2 is not available, both columns are scalar\n");
+
+	vec3_t *srcVerts = (vec3_t*)Mem_PoolAlloc(sizeof(vec3_t) * numVerts, ri.genericPool, 0);
+	vec3_t *srcNormals = (vec3_t*)Mem_PoolAlloc(sizeof(vec3_t) * numVerts, ri.genericPool, 0);
+	vec2_t *srcCoords = (vec2_t*)Mem_PoolAlloc(sizeof(vec2_t) * numVerts, ri.genericPool, 0);
+	colorb *srcColors = (colorb*)Mem_PoolAlloc(sizeof(colorb) * numVerts, ri.genericPool, 0);
+
+	// Room for the largest output, one per path
+	byte *out[2];
+	out[0] = (byte*)Mem_PoolAlloc(sizeof(vec3_t) * numVerts, ri.genericPool, 0);
+	out[1] = (byte*)Mem_PoolAlloc(sizeof(vec3_t) * numVerts, ri.genericPool, 0);
+
+	uint32 seed = 0x3c6ef372;
+	for (int i=0 ; i<numVerts ; i++)
+	{
+		for (int axis=0 ; axis<3 ; axis++)
+		{
+			seed = seed * 1664525 + 1013904223;
+			srcVerts[i][axis] = ri.def.viewOrigin[axis] + (float)((seed >> 8) & 4095) - 2048.0f;
+			seed = seed * 1664525 + 1013904223;
+			srcNormals[i][axis] = (float)((seed >> 8) & 1023) / 511.5f - 1.0f;
+		}
+		VectorNormalizeFastf(srcNormals[i]);
+
+		seed = seed * 1664525 + 1013904223;
+		srcCoords[i][0] = (float)((seed >> 8) & 4095) / 512.0f - 4.0f;
+		seed = seed * 1664525 + 1013904223;
+		srcCoords[i][1] = (float)((seed >> 8) & 4095) / 512.0f - 4.0f;
+
+		seed = seed * 1664525 + 1013904223;
+		*(uint32 *)&srcColors[i][0] = seed;
+	}
+
+	const uint32 rgbMask = RB_PackColor(255, 255, 255, 0);
+	const uint32 alphaMask = RB_PackColor(0, 0, 0, 255);
+	const vec3_t move = { 1.5f, -3.25f, 0.125f };
+
+	Com_Printf(0, "Vertex kernels, %i runs over %i verts (ms per call, scalar/SSE2):\n", numRuns, numVerts);
+	Com_Printf(0, "%-12s %8s %8s %10s %6s\n", "kernel", "scalar", "sse2", "maxerror", "exact");
+
+	for (int bench=0 ; bench<BENCH_MAX ; bench++)
+	{
+		// What gets written, and what it starts out as
+		const void *source = NULL;
+		uint32 numBytes = sizeof(vec3_t) * numVerts;
+		switch(bench)
+		{
+		case BENCH_WAVE:
+		case BENCH_BULGE:
+		case BENCH_MOVE:
+			source = srcVerts;
+			break;
+		case BENCH_NORMALS:
+			source = srcNormals;
+			break;
+		case BENCH_ENVIRONMENT:
+		case BENCH_WARP:
+			numBytes = sizeof(vec2_t) * numVerts;
+			break;
+		case BENCH_COLORS:
+			numBytes = sizeof(colorb) * numVerts;
+			break;
+		}
+
+		double ms[2];
+		for (int sse=0 ; sse<2 ; sse++)
+		{
+			ri.bSSE2 = sse ? bHadSSE2 : false;
+			ms[sse] = 0;
+
+			for (int run=0 ; run<numRuns ; run++)
+			{
+				if (source)
+					memcpy(out[sse], source, numBytes);
+
+				const uint32 start = Sys_Cycles();
+				switch(bench)
+				{
+				case BENCH_WAVE:
+					RB_DeformWave((vec3_t *)out[sse], srcNormals, numVerts, rb_sinTable, 0.01f, 0.3f, 4.0f, 1.0f);
+					break;
+				case BENCH_NORMALS:
+					RB_DeformNormals((vec3_t *)out[sse], numVerts, 1.0f, 0.7f);
+					break;
+				case BENCH_BULGE:
+					RB_DeformAlongNormals((vec3_t *)out[sse], srcNormals, numVerts, 3.5f);
+					break;
+				case BENCH_MOVE:
+					RB_DeformMove((vec3_t *)out[sse], numVerts, move);
+					break;
+				case BENCH_ENVIRONMENT:
+					RB_TCGenEnvironment((vec2_t *)out[sse], srcVerts, srcNormals, numVerts, ri.def.viewOrigin);
+					break;
+				case BENCH_WARP:
+					RB_TCGenWarp((vec2_t *)out[sse], srcCoords, numVerts, 1.7f);
+					break;
+				case BENCH_COLORS:
+					RB_CopyColors((colorb *)out[sse], srcColors, numVerts, 1, rgbMask, rgbMask);
+					RB_FillColors((colorb *)out[sse], numVerts, RB_PackColor(0, 0, 0, 200), alphaMask);
+					break;
+				}
+				ms[sse] += (Sys_Cycles() - start) * Sys_MSPerCycle();
+			}
+		}
+		ri.bSSE2 = bHadSSE2;
+
+		float maxError = 0;
+		if (bench != BENCH_COLORS)
+		{
+			const float *a = (const float *)out[0];
+			const float *b = (const float *)out[1];
+			for (uint32 i=0 ; i<numBytes/sizeof(float) ; i++)
+				maxError = max(maxError, (float)fabs(a[i] - b[i]));
+		}
+
+		Com_Printf(0, "%-12s %8.4f %8.4f %10g %6s\n", rb_benchNames[bench],
+			ms[0] / numRuns, ms[1] / numRuns, maxError,
+			memcmp(out[0], out[1], numBytes) ? "NO" : "yes");
+	}
+
+	Mem_Free(srcVerts);
+	Mem_Free(srcNormals);
+	Mem_Free(srcCoords);
+	Mem_Free(srcColors);
+	Mem_Free(out[0]);
+	Mem_Free(out[1]);
+}
+
+
 /*
 ===============================================================================
 
@@ -2525,6 +3154,13 @@ bool RB_RenderInit()
 
 	RB_ResetPointers();
 
+	rb_meshSerial = 0;
+	rb_colorCache.meshSerial = 0;
+	for (int i=0 ; i<MAX_TEXUNITS ; i++)
+		rb_tcGenCache[i].meshSerial = 0;
+
+	cmd_deformBench = Cmd_AddCommand("r_deformbench", 0, RB_DeformBench_f, "Times the deform, tcGen and colour kernels and checks the SSE2 ones against scalar");
+
 	// Build lookup tables
 	for (int i=0 ; i<FTABLE_SIZE ; i++)
 	{
@@ -2592,5 +3228,7 @@ RB_RenderShutdown
 */
 void RB_RenderShutdown()
 {
+	Cmd_RemoveCommand(cmd_deformBench);
+
 	RB_BloomShutdown();
 }
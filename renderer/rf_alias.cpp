@@ -70,10 +70,41 @@ static void R_AliasModelBBox(refEntity_t *ent, vec3_t outMins, vec3_t outMaxs, f
 
 /*
 =============
-R_CullAliasModel
+R_AliasMeshMaterial
 =============
 */
-bool R_CullAliasModel(refEntity_t *ent, const uint32 clipFlags)
+static refMaterial_t *R_AliasMeshMaterial(const refEntity_t *ent, const mAliasMesh_t *aliasMesh)
+{
+	// Custom player skin
+	if (ent->skin)
+		return ent->skin;
+
+	// Server's only send MD2 skinNums anyways
+	if (ent->skinNum >= MD2_MAX_SKINS)
+		return aliasMesh->skins[0].material;
+
+	if (ent->skinNum >= 0 && ent->skinNum < aliasMesh->numSkins)
+	{
+		refMaterial_t *mat = aliasMesh->skins[ent->skinNum].material;
+		if (!mat)
+			mat = aliasMesh->skins[0].material;
+		return mat;
+	}
+
+	return aliasMesh->skins[0].material;
+}
+
+
+/*
+=============
+R_AliasCullBounds
+
+Sanity checks the frames and finds the world bounds R_CullEntityList batches
+for the frustum test. Returns false when the view alone decides, with
+bCulled saying which way.
+=============
+*/
+bool R_AliasCullBounds(refEntity_t *ent, vec3_t outMins, vec3_t outMaxs, bool &bCulled)
 {
 	// Sanity checks
 	// Since this function is called before we add to the list or render, catch it here
@@ -90,10 +121,23 @@ bool R_CullAliasModel(refEntity_t *ent, const uint32 clipFlags)
 		ent->oldFrame = 0;
 	}
 
+	for (int meshNum=0 ; meshNum<aliasModel->numMeshes ; meshNum++)
+	{
+		if (!R_AliasMeshMaterial(ent, &aliasModel->meshes[meshNum]))
+			Com_DevPrintf(PRNT_WARNING, "R_AddAliasModelToList: '%s' has a NULL material\n", ent->model->name);
+	}
+
+	bCulled = false;
 	if (ent->flags & RF_WEAPONMODEL)
-		return (ri.scn.viewType == RVT_MIRROR);
+	{
+		bCulled = (ri.scn.viewType == RVT_MIRROR);
+		return false;
+	}
 	if (ent->flags & RF_VIEWERMODEL)
-		return !(ri.scn.viewType == RVT_MIRROR || ri.scn.viewType == RVT_SHADOWMAP);
+	{
+		bCulled = !(ri.scn.viewType == RVT_MIRROR || ri.scn.viewType == RVT_SHADOWMAP);
+		return false;
+	}
 
 	if (r_noCull->intVal)
 		return false;
@@ -103,24 +147,33 @@ bool R_CullAliasModel(refEntity_t *ent, const uint32 clipFlags)
 	float Radius;
 	R_AliasModelBBox(ent, Mins, Maxs, Radius);
 
-	// Compute and rotate a full bounding box
+	// Rotate a full bounding box and take the box around that
 	vec3_t BBox[8];
 	R_TransformBoundsToBBox(ent->origin, ent->axis, Mins, Maxs, BBox);
-	if (R_CullTransformedBox(BBox, clipFlags))
-	{
-		if (!ri.scn.bDrawingMeshOutlines)
-			ri.pc.cullAlias[CULL_PASS]++;
-		return true;
-	}
-	else
-	{
-		if (!ri.scn.bDrawingMeshOutlines)
-			ri.pc.cullAlias[CULL_FAIL]++;
-	}
 
+	ClearBounds(outMins, outMaxs);
+	for (int i=0 ; i<8 ; i++)
+		AddPointToBounds(BBox[i], outMins, outMaxs);
+	return true;
+}
+
+
+/*
+=============
+R_CullAliasModel
+
+Tests left after the frustum batch, for models that survived it.
+=============
+*/
+bool R_CullAliasModel(refEntity_t *ent, const vec3_t mins, const vec3_t maxs)
+{
 	// Mirror/portal culling
 	if (ri.scn.viewType == RVT_MIRROR || ri.scn.viewType == RVT_PORTAL)
 	{
+		vec3_t Mins, Maxs;
+		float Radius;
+		R_AliasModelBBox(ent, Mins, Maxs, Radius);
+
 		if (PlaneDiff(ent->origin, &ri.scn.clipPlane) < -Radius)
 		{
 			if (!ri.scn.bDrawingMeshOutlines)
@@ -138,17 +191,22 @@ bool R_CullAliasModel(refEntity_t *ent, const uint32 clipFlags)
 		}
 	}
 
-	// Couldn't frustum cull
+	// Hidden behind world occluders
+	if (R_OccludedBox(mins, maxs))
+		return true;
+
 	return false;
 }
 
 
 /*
 =============
-R_AddAliasModelToList
+R_StageAliasModel
+
+Fills a slot per mesh, from a job.
 =============
 */
-void R_AddAliasModelToList(refEntity_t *ent)
+void R_StageAliasModel(refEntity_t *ent, refMeshSlot *slots)
 {
 	// Get our radius so fog can be applied
 	vec3_t Mins, Maxs;
@@ -158,53 +216,282 @@ void R_AddAliasModelToList(refEntity_t *ent)
 	// Fog
 	mQ3BspFog_t *Fog = R_FogForSphere(ent->origin, Radius);
 
-	// Add to list
+	// One slot per mesh
 	mAliasModel_t *model = ent->model->AliasData();
 	for (int meshNum=0 ; meshNum<model->numMeshes ; meshNum++)
 	{
 		mAliasMesh_t *aliasMesh = &model->meshes[meshNum];
 
-		// Find the skin for this mesh
-		refMaterial_t *mat;
-		if (ent->skin)
+		// Missing skins were reported by R_AliasCullBounds
+		refMaterial_t *mat = R_AliasMeshMaterial(ent, aliasMesh);
+		if (!mat)
+			mat = ri.media.noMaterial;
+
+		slots[meshNum].Setup(MBT_ALIAS, aliasMesh, mat, ent->matTime, ent, Fog, 0);
+	}
+}
+
+
+/*
+===============================================================================
+
+	POSE INTERPOLATION
+
+===============================================================================
+*/
+
+#define ALIAS_POSE_HASH_SIZE	256
+#define ALIAS_POSE_HASH_PROBES	8
+#define ALIAS_POSE_MAX_VERTS	65536
+
+struct aliasPose_t
+{
+	uint32					frameCount;
+
+	mAliasMesh_t			*mesh;
+	int						frame, oldFrame;
+	float					backLerp;
+	vec3_t					move;
+	float					scale;
+
+	bool					bNormals;
+	vec3_t					*vertices;
+	vec3_t					*normals;
+};
+
+// Every latLong pair decoded up front, padded to four floats for the SSE2 loads
+static float			r_aliasNormals[256*256][4];
+
+// Interpolated poses, reused by every pass and entity with the same key this frame
+static aliasPose_t		r_aliasPoses[ALIAS_POSE_HASH_SIZE];
+static vec3_t			r_aliasPoseVerts[ALIAS_POSE_MAX_VERTS];
+static vec3_t			r_aliasPoseNormals[ALIAS_POSE_MAX_VERTS];
+static uint32			r_aliasPoseFrame;
+static int				r_aliasPoseUsed;
+
+static inline const float *R_AliasNormal(const mAliasVertex_t *vert)
+{
+	return r_aliasNormals[vert->latLong[0] | (vert->latLong[1] << 8)];
+}
+
+/*
+=============
+R_LerpAliasVerts
+
+Scales and translates the quantized positions of a frame, blending in
+oldVerts when given.
+=============
+*/
+static void R_LerpAliasVerts(const mAliasVertex_t *verts, const mAliasVertex_t *oldVerts, const int numVerts, const vec3_t move, const vec3_t scale, const vec3_t oldScale, vec3_t *outVerts)
+{
+	int i = 0;
+
+#ifdef R_SSE2
+	if (ri.bSSE2)
+	{
+		const __m128 vMove = _mm_setr_ps(move[0], move[1], move[2], 0.0f);
+		const __m128 vScale = _mm_setr_ps(scale[0], scale[1], scale[2], 0.0f);
+
+		// Four float stores run into the next vertex, so the last one is done below
+		if (oldVerts)
 		{
-			// Custom player skin
-			mat = ent->skin;
+			const __m128 vOldScale = _mm_setr_ps(oldScale[0], oldScale[1], oldScale[2], 0.0f);
+			for ( ; i<numVerts-1 ; i++)
+			{
+				__m128i p = _mm_loadl_epi64((const __m128i *)&verts[i]);
+				__m128i op = _mm_loadl_epi64((const __m128i *)&oldVerts[i]);
+				__m128 v = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(p, p), 16));
+				__m128 ov = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(op, op), 16));
+
+				_mm_storeu_ps(outVerts[i], _mm_add_ps(_mm_add_ps(vMove, _mm_mul_ps(v, vScale)), _mm_mul_ps(ov, vOldScale)));
+			}
 		}
 		else
 		{
-			if (ent->skinNum >= MD2_MAX_SKINS)
+			for ( ; i<numVerts-1 ; i++)
 			{
-				// Server's only send MD2 skinNums anyways
-				mat = aliasMesh->skins[0].material;
-			}
-			else if (ent->skinNum >= 0 && ent->skinNum < aliasMesh->numSkins)
-			{
-				mat = aliasMesh->skins[ent->skinNum].material;
-				if (!mat)
-					mat = aliasMesh->skins[0].material;
-			}
-			else
-			{
-				mat = aliasMesh->skins[0].material;
+				__m128i p = _mm_loadl_epi64((const __m128i *)&verts[i]);
+				__m128 v = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(p, p), 16));
 
-				if (aliasMesh->skins[0].material == null)
-					mat = null;
+				_mm_storeu_ps(outVerts[i], _mm_add_ps(vMove, _mm_mul_ps(v, vScale)));
 			}
 		}
+	}
+#endif // R_SSE2
 
-		if (!mat)
+	if (oldVerts)
+	{
+		for ( ; i<numVerts ; i++)
 		{
-			Com_DevPrintf(PRNT_WARNING, "R_AddAliasModelToList: '%s' has a NULL material\n", ent->model->name);
-			mat = ri.media.noMaterial;
-			//return;
+			outVerts[i][0] = move[0] + verts[i].point[0]*scale[0] + oldVerts[i].point[0]*oldScale[0];
+			outVerts[i][1] = move[1] + verts[i].point[1]*scale[1] + oldVerts[i].point[1]*oldScale[1];
+			outVerts[i][2] = move[2] + verts[i].point[2]*scale[2] + oldVerts[i].point[2]*oldScale[2];
+		}
+	}
+	else
+	{
+		for ( ; i<numVerts ; i++)
+		{
+			outVerts[i][0] = move[0] + verts[i].point[0]*scale[0];
+			outVerts[i][1] = move[1] + verts[i].point[1]*scale[1];
+			outVerts[i][2] = move[2] + verts[i].point[2]*scale[2];
+		}
+	}
+}
+
+
+/*
+=============
+R_LerpAliasNormals
+
+Looks the normals up, blending and renormalizing them against oldVerts when
+given.
+=============
+*/
+static void R_LerpAliasNormals(const mAliasVertex_t *verts, const mAliasVertex_t *oldVerts, const int numVerts, const float backLerp, vec3_t *outNormals)
+{
+	int i = 0;
+
+	if (!oldVerts)
+	{
+		for ( ; i<numVerts ; i++)
+			Vec3Copy(R_AliasNormal(&verts[i]), outNormals[i]);
+		return;
+	}
+
+#ifdef R_SSE2
+	if (ri.bSSE2)
+	{
+		const __m128 vBackLerp = _mm_set1_ps(backLerp);
+		const __m128 vMinLength = _mm_set_ss(1e-12f);
+
+		for ( ; i<numVerts-1 ; i++)
+		{
+			__m128 n = _mm_loadu_ps(R_AliasNormal(&verts[i]));
+			__m128 on = _mm_loadu_ps(R_AliasNormal(&oldVerts[i]));
+			n = _mm_add_ps(n, _mm_mul_ps(_mm_sub_ps(on, n), vBackLerp));
+
+			// The fourth lane is zero, so it drops out of the dot product
+			__m128 dot = _mm_mul_ps(n, n);
+			dot = _mm_add_ps(dot, _mm_movehl_ps(dot, dot));
+			dot = _mm_add_ss(dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(1,1,1,1)));
+			__m128 invLength = _mm_rsqrt_ss(_mm_max_ss(dot, vMinLength));
+
+			_mm_storeu_ps(outNormals[i], _mm_mul_ps(n, _mm_shuffle_ps(invLength, invLength, 0)));
 		}
+	}
+#endif // R_SSE2
+
+	for ( ; i<numVerts ; i++)
+	{
+		const float *normal = R_AliasNormal(&verts[i]);
+		const float *oldNormal = R_AliasNormal(&oldVerts[i]);
 
-		ri.scn.currentList->AddToList(MBT_ALIAS, aliasMesh, mat, ent->matTime, ent, Fog, 0);
+		outNormals[i][0] = normal[0] + (oldNormal[0] - normal[0]) * backLerp;
+		outNormals[i][1] = normal[1] + (oldNormal[1] - normal[1]) * backLerp;
+		outNormals[i][2] = normal[2] + (oldNormal[2] - normal[2]) * backLerp;
+
+		VectorNormalizeFastf(outNormals[i]);
 	}
 }
 
 
+/*
+=============
+R_FindAliasPose
+
+Returns the pose cached under this key with bFound set, or a new slot with
+storage for the caller to fill in. NULL if the cache is off or full.
+=============
+*/
+static aliasPose_t *R_FindAliasPose(mAliasMesh_t *mesh, const int frame, const int oldFrame, const float backLerp, const vec3_t move, const float scale, const bool bNormals, bool &bFound)
+{
+	bFound = false;
+	if (!r_aliasPoseCache->intVal)
+		return NULL;
+
+	// New frame, drop everything
+	if (r_aliasPoseFrame != ri.frameCount)
+	{
+		r_aliasPoseFrame = ri.frameCount;
+		r_aliasPoseUsed = 0;
+	}
+
+	uint32 hash = (uint32)((size_t)mesh >> 4);
+	hash = hash * 31 + frame;
+	hash = hash * 31 + oldFrame;
+
+	aliasPose_t *freeSlot = NULL;
+	for (int probe=0 ; probe<ALIAS_POSE_HASH_PROBES ; probe++)
+	{
+		aliasPose_t *pose = &r_aliasPoses[(hash + probe) & (ALIAS_POSE_HASH_SIZE-1)];
+		if (pose->frameCount != ri.frameCount)
+		{
+			if (!freeSlot)
+				freeSlot = pose;
+			continue;
+		}
+
+		if (pose->mesh == mesh
+		&& pose->frame == frame
+		&& pose->oldFrame == oldFrame
+		&& pose->backLerp == backLerp
+		&& pose->scale == scale
+		&& Vec3Compare(pose->move, move)
+		&& (pose->bNormals || !bNormals))
+		{
+			bFound = true;
+			ri.pc.aliasPosesCached++;
+			return pose;
+		}
+	}
+
+	if (!freeSlot || r_aliasPoseUsed + mesh->numVerts > ALIAS_POSE_MAX_VERTS)
+		return NULL;
+
+	freeSlot->frameCount = ri.frameCount;
+	freeSlot->mesh = mesh;
+	freeSlot->frame = frame;
+	freeSlot->oldFrame = oldFrame;
+	freeSlot->backLerp = backLerp;
+	Vec3Copy(move, freeSlot->move);
+	freeSlot->scale = scale;
+	freeSlot->bNormals = bNormals;
+	freeSlot->vertices = r_aliasPoseVerts + r_aliasPoseUsed;
+	freeSlot->normals = r_aliasPoseNormals + r_aliasPoseUsed;
+	r_aliasPoseUsed += mesh->numVerts;
+
+	return freeSlot;
+}
+
+
+/*
+=============
+R_AliasInit
+=============
+*/
+void R_AliasInit()
+{
+	for (int i=0 ; i<256*256 ; i++)
+	{
+		const byte latLong[2] = { (byte)(i & 255), (byte)(i >> 8) };
+		LatLongToNorm(latLong, r_aliasNormals[i]);
+		r_aliasNormals[i][3] = 0.0f;
+	}
+
+	memset(r_aliasPoses, 0, sizeof(r_aliasPoses));
+	r_aliasPoseFrame = 0;
+	r_aliasPoseUsed = 0;
+}
+
+/*
+===============================================================================
+
+	ALIAS DRAWING
+
+===============================================================================
+*/
+
 /*
 =============
 R_DrawAliasModel
@@ -249,81 +536,47 @@ void R_DrawAliasModel(refMeshBuffer *mb, const meshFeatures_t features)
 	move[1] = frame->translate[1] + (move[1] - frame->translate[1]) * backLerp;
 	move[2] = frame->translate[2] + (move[2] - frame->translate[2]) * backLerp;
 
-	// Optimal route
-	if (ent->frame == ent->oldFrame)
-	{
-		vec3_t scale;
-		scale[0] = frame->scale[0] * ent->scale;
-		scale[1] = frame->scale[1] * ent->scale;
-		scale[2] = frame->scale[2] * ent->scale;
+	// Shadow and light passes, and entities in the same pose, share the result
+	const bool bNormals = (features & MF_NORMALS) != 0;
+	bool bCached;
+	aliasPose_t *pose = R_FindAliasPose(aliasMesh, ent->frame, ent->oldFrame, backLerp, move, ent->scale, bNormals, bCached);
 
-		// Store normals and vertices
-		if (features & MF_NORMALS)
-		{
-			mAliasVertex_t *verts = aliasMesh->vertexes + (ent->frame * aliasMesh->numVerts);
-			for (int i=0 ; i<aliasMesh->numVerts ; i++, verts++)
-			{
-				rb.batch.vertices[i][0] = move[0] + verts->point[0]*scale[0];
-				rb.batch.vertices[i][1] = move[1] + verts->point[1]*scale[1];
-				rb.batch.vertices[i][2] = move[2] + verts->point[2]*scale[2];
+	vec3_t *vertices = pose ? pose->vertices : rb.batch.vertices;
+	vec3_t *normals = pose ? pose->normals : rb.batch.normals;
 
-				LatLongToNorm(verts->latLong, rb.batch.normals[i]);
-			}
-		}
-		else
-		{
-			mAliasVertex_t *verts = aliasMesh->vertexes + (ent->frame * aliasMesh->numVerts);
-			for (int i=0 ; i<aliasMesh->numVerts ; i++, verts++)
-			{
-				rb.batch.vertices[i][0] = move[0] + verts->point[0]*scale[0];
-				rb.batch.vertices[i][1] = move[1] + verts->point[1]*scale[1];
-				rb.batch.vertices[i][2] = move[2] + verts->point[2]*scale[2];
-			}
-		}
-	}
-	else
+	if (!bCached)
 	{
 		mAliasVertex_t *verts = aliasMesh->vertexes + (ent->frame * aliasMesh->numVerts);
-		mAliasVertex_t *oldVerts = aliasMesh->vertexes + (ent->oldFrame * aliasMesh->numVerts);
-
-		vec3_t scale;
-		scale[0] = (frontLerp * frame->scale[0]) * ent->scale;
-		scale[1] = (frontLerp * frame->scale[1]) * ent->scale;
-		scale[2] = (frontLerp * frame->scale[2]) * ent->scale;
 
-		vec3_t oldScale;
-		oldScale[0] = (backLerp * oldFrame->scale[0]) * ent->scale;
-		oldScale[1] = (backLerp * oldFrame->scale[1]) * ent->scale;
-		oldScale[2] = (backLerp * oldFrame->scale[2]) * ent->scale;
-
-		// Interpolate normals and vertices
-		if (features & MF_NORMALS)
+		// Optimal route
+		if (ent->frame == ent->oldFrame)
 		{
-			for (int i=0 ; i<aliasMesh->numVerts ; i++, verts++, oldVerts++)
-			{
-				rb.batch.vertices[i][0] = move[0] + verts->point[0]*scale[0] + oldVerts->point[0]*oldScale[0];
-				rb.batch.vertices[i][1] = move[1] + verts->point[1]*scale[1] + oldVerts->point[1]*oldScale[1];
-				rb.batch.vertices[i][2] = move[2] + verts->point[2]*scale[2] + oldVerts->point[2]*oldScale[2];
-
-				vec3_t normal, oldNormal;
-				LatLongToNorm(verts->latLong, normal);
-				LatLongToNorm(oldVerts->latLong, oldNormal);
-
-				rb.batch.normals[i][0] = normal[0] + (oldNormal[0] - normal[0]) * backLerp;
-				rb.batch.normals[i][1] = normal[1] + (oldNormal[1] - normal[1]) * backLerp;
-				rb.batch.normals[i][2] = normal[2] + (oldNormal[2] - normal[2]) * backLerp;
-
-				VectorNormalizeFastf(rb.batch.normals[i]);
-			}
+			vec3_t scale;
+			scale[0] = frame->scale[0] * ent->scale;
+			scale[1] = frame->scale[1] * ent->scale;
+			scale[2] = frame->scale[2] * ent->scale;
+
+			R_LerpAliasVerts(verts, NULL, aliasMesh->numVerts, move, scale, NULL, vertices);
+			if (bNormals)
+				R_LerpAliasNormals(verts, NULL, aliasMesh->numVerts, 0.0f, normals);
 		}
 		else
 		{
-			for (int i=0 ; i<aliasMesh->numVerts ; i++, verts++, oldVerts++)
-			{
-				rb.batch.vertices[i][0] = move[0] + verts->point[0]*scale[0] + oldVerts->point[0]*oldScale[0];
-				rb.batch.vertices[i][1] = move[1] + verts->point[1]*scale[1] + oldVerts->point[1]*oldScale[1];
-				rb.batch.vertices[i][2] = move[2] + verts->point[2]*scale[2] + oldVerts->point[2]*oldScale[2];
-			}
+			mAliasVertex_t *oldVerts = aliasMesh->vertexes + (ent->oldFrame * aliasMesh->numVerts);
+
+			vec3_t scale;
+			scale[0] = (frontLerp * frame->scale[0]) * ent->scale;
+			scale[1] = (frontLerp * frame->scale[1]) * ent->scale;
+			scale[2] = (frontLerp * frame->scale[2]) * ent->scale;
+
+			vec3_t oldScale;
+			oldScale[0] = (backLerp * oldFrame->scale[0]) * ent->scale;
+			oldScale[1] = (backLerp * oldFrame->scale[1]) * ent->scale;
+			oldScale[2] = (backLerp * oldFrame->scale[2]) * ent->scale;
+
+			R_LerpAliasVerts(verts, oldVerts, aliasMesh->numVerts, move, scale, oldScale, vertices);
+			if (bNormals)
+				R_LerpAliasNormals(verts, oldVerts, aliasMesh->numVerts, backLerp, normals);
 		}
 	}
 
@@ -337,8 +590,8 @@ void R_DrawAliasModel(refMeshBuffer *mb, const meshFeatures_t features)
 	outMesh.coordArray = aliasMesh->coords;
 	outMesh.indexArray = aliasMesh->indexes;
 	outMesh.lmCoordArray = NULL;
-	outMesh.normalsArray = rb.batch.normals;
-	outMesh.vertexArray = rb.batch.vertices;
+	outMesh.normalsArray = normals;
+	outMesh.vertexArray = vertices;
 
 	// Calculate lighting if colors are needed
 	if (features & MF_NORMALS && features & MF_COLORS)
@@ -218,6 +218,200 @@ bool R_CullSphere(const vec3_t origin, const float radius, const uint32 clipFlag
 	return false;
 }
 
+/*
+=============================================================================
+
+	BATCH CULLING
+
+=============================================================================
+*/
+
+/*
+=================
+R_BatchPlanes
+
+Frustum planes a batch is tested against, none with r_noCull.
+=================
+*/
+static int R_BatchPlanes(const uint32 clipFlags, const plane_t **planes)
+{
+	if (r_noCull->intVal)
+		return 0;
+
+	int numPlanes = 0;
+	for (int i=0 ; i<FRP_MAX ; i++)
+	{
+		if (clipFlags & BIT(i))
+			planes[numPlanes++] = &ri.scn.viewFrustum[i];
+	}
+
+	return numPlanes;
+}
+
+
+/*
+=================
+R_CullBoxBatch
+
+R_CullBox over component arrays, four boxes to an SSE2 iteration. Writes the
+indexes of the boxes left inside the frustum, in order, and returns how many.
+Jobs pass bCount false and leave the cull counters to the render thread.
+=================
+*/
+uint32 R_CullBoxBatch(const float *const mins[3], const float *const maxs[3], const uint32 numBoxes, const uint32 clipFlags, uint16 *outVisible, const bool bCount)
+{
+	const plane_t *planes[FRP_MAX];
+	const int numPlanes = R_BatchPlanes(clipFlags, planes);
+
+	// Each plane only looks at the corner furthest along its normal
+	const float *corner[FRP_MAX][3];
+	for (int p=0 ; p<numPlanes ; p++)
+	{
+		for (int axis=0 ; axis<3 ; axis++)
+			corner[p][axis] = (planes[p]->signBits & BIT(axis)) ? mins[axis] : maxs[axis];
+	}
+
+	uint32 numVisible = 0;
+	uint32 i = 0;
+
+#ifdef R_SSE2
+	if (ri.bSSE2)
+	{
+		__m128 vNormal[FRP_MAX][3], vDist[FRP_MAX];
+		for (int p=0 ; p<numPlanes ; p++)
+		{
+			vNormal[p][0] = _mm_set1_ps(planes[p]->normal[0]);
+			vNormal[p][1] = _mm_set1_ps(planes[p]->normal[1]);
+			vNormal[p][2] = _mm_set1_ps(planes[p]->normal[2]);
+			vDist[p] = _mm_set1_ps(planes[p]->dist);
+		}
+
+		for ( ; i<numBoxes ; i+=4)
+		{
+			__m128 outside = _mm_setzero_ps();
+			for (int p=0 ; p<numPlanes ; p++)
+			{
+				__m128 d = _mm_mul_ps(vNormal[p][0], _mm_loadu_ps(corner[p][0] + i));
+				d = _mm_add_ps(d, _mm_mul_ps(vNormal[p][1], _mm_loadu_ps(corner[p][1] + i)));
+				d = _mm_add_ps(d, _mm_mul_ps(vNormal[p][2], _mm_loadu_ps(corner[p][2] + i)));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(d, vDist[p]));
+			}
+
+			// Lanes past the end are padding
+			int visibleBits = ~_mm_movemask_ps(outside) & 15;
+			if (numBoxes - i < 4)
+				visibleBits &= BIT(numBoxes - i) - 1;
+
+			for (uint32 lane=0 ; visibleBits ; lane++, visibleBits>>=1)
+			{
+				if (visibleBits & 1)
+					outVisible[numVisible++] = (uint16)(i + lane);
+			}
+		}
+	}
+#endif // R_SSE2
+
+	for ( ; i<numBoxes ; i++)
+	{
+		int p;
+		for (p=0 ; p<numPlanes ; p++)
+		{
+			const float *normal = planes[p]->normal;
+			if (normal[0]*corner[p][0][i] + normal[1]*corner[p][1][i] + normal[2]*corner[p][2][i] < planes[p]->dist)
+				break;
+		}
+
+		if (p == numPlanes)
+			outVisible[numVisible++] = (uint16)i;
+	}
+
+	if (bCount && !ri.scn.bDrawingMeshOutlines)
+	{
+		ri.pc.cullBounds[CULL_PASS] += numBoxes - numVisible;
+		ri.pc.cullBounds[CULL_FAIL] += numVisible;
+	}
+	return numVisible;
+}
+
+
+/*
+=================
+R_CullSphereBatch
+
+R_CullSphere over component arrays, same output as R_CullBoxBatch.
+=================
+*/
+uint32 R_CullSphereBatch(const float *const origin[3], const float *radius, const uint32 numSpheres, const uint32 clipFlags, uint16 *outVisible, const bool bCount)
+{
+	const plane_t *planes[FRP_MAX];
+	const int numPlanes = R_BatchPlanes(clipFlags, planes);
+
+	uint32 numVisible = 0;
+	uint32 i = 0;
+
+#ifdef R_SSE2
+	if (ri.bSSE2)
+	{
+		__m128 vNormal[FRP_MAX][3], vDist[FRP_MAX];
+		for (int p=0 ; p<numPlanes ; p++)
+		{
+			vNormal[p][0] = _mm_set1_ps(planes[p]->normal[0]);
+			vNormal[p][1] = _mm_set1_ps(planes[p]->normal[1]);
+			vNormal[p][2] = _mm_set1_ps(planes[p]->normal[2]);
+			vDist[p] = _mm_set1_ps(planes[p]->dist);
+		}
+
+		for ( ; i<numSpheres ; i+=4)
+		{
+			const __m128 x = _mm_loadu_ps(origin[0] + i);
+			const __m128 y = _mm_loadu_ps(origin[1] + i);
+			const __m128 z = _mm_loadu_ps(origin[2] + i);
+			const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+
+			__m128 outside = _mm_setzero_ps();
+			for (int p=0 ; p<numPlanes ; p++)
+			{
+				__m128 d = _mm_mul_ps(x, vNormal[p][0]);
+				d = _mm_add_ps(d, _mm_mul_ps(y, vNormal[p][1]));
+				d = _mm_add_ps(d, _mm_mul_ps(z, vNormal[p][2]));
+				outside = _mm_or_ps(outside, _mm_cmple_ps(_mm_sub_ps(d, vDist[p]), negRadius));
+			}
+
+			int visibleBits = ~_mm_movemask_ps(outside) & 15;
+			if (numSpheres - i < 4)
+				visibleBits &= BIT(numSpheres - i) - 1;
+
+			for (uint32 lane=0 ; visibleBits ; lane++, visibleBits>>=1)
+			{
+				if (visibleBits & 1)
+					outVisible[numVisible++] = (uint16)(i + lane);
+			}
+		}
+	}
+#endif // R_SSE2
+
+	for ( ; i<numSpheres ; i++)
+	{
+		int p;
+		for (p=0 ; p<numPlanes ; p++)
+		{
+			const float *normal = planes[p]->normal;
+			if (origin[0][i]*normal[0] + origin[1][i]*normal[1] + origin[2][i]*normal[2] - planes[p]->dist <= -radius[i])
+				break;
+		}
+
+		if (p == numPlanes)
+			outVisible[numVisible++] = (uint16)i;
+	}
+
+	if (bCount && !ri.scn.bDrawingMeshOutlines)
+	{
+		ri.pc.cullRadius[CULL_PASS] += numSpheres - numVisible;
+		ri.pc.cullRadius[CULL_FAIL] += numVisible;
+	}
+	return numVisible;
+}
+
 /*
 =============================================================================
 
@@ -344,3 +538,133 @@ bool R_CullTransformedBox(const vec3_t BBox[8], const uint32 clipFlags)
 		ri.pc.cullBounds[CULL_FAIL]++;
 	return false;
 }
+
+/*
+=============================================================================
+
+	BENCHMARK
+
+=============================================================================
+*/
+
+/*
+=============
+R_CullBench_f
+
+Times R_CullBox and R_CullSphere one call at a time against the batch
+versions, scalar and SSE2, over random bounds around the last view. Every
+path has to come up with the same visible list.
+=============
+*/
+void R_CullBench_f()
+{
+	static const uint32 benchSizes[] = { 256, 2048, 16384 };
+	const uint32 numSizes = sizeof(benchSizes) / sizeof(benchSizes[0]);
+	const uint32 maxSize = benchSizes[numSizes-1];
+	const int numRuns = (Cmd_Argc() > 1) ? max(atoi(Cmd_Argv(1)), 1) : 50;
+
+	const bool bHadSSE2 = ri.bSSE2;
+	if (!bHadSSE2)
+		Com_Printf(0, "SSE2 is not available, both batch columns are scalar\n");
+	if (!ri.scn.clipFlags)
+		Com_Printf(0, "No clip planes in the last view, everything will pass\n");
+
+	// Component arrays for the batches, and the same bounds as vectors
+	float *soa = (float*)Mem_PoolAlloc(sizeof(float) * maxSize * 10, ri.genericPool, 0);
+	const float *const boxMins[3] = { soa, soa + maxSize, soa + maxSize*2 };
+	const float *const boxMaxs[3] = { soa + maxSize*3, soa + maxSize*4, soa + maxSize*5 };
+	const float *const sphereOrigin[3] = { soa + maxSize*6, soa + maxSize*7, soa + maxSize*8 };
+	const float *sphereRadius = soa + maxSize*9;
+
+	vec3_t *aos = (vec3_t*)Mem_PoolAlloc(sizeof(vec3_t) * maxSize * 3, ri.genericPool, 0);
+	uint16 *visible = (uint16*)Mem_PoolAlloc(sizeof(uint16) * maxSize * 2, ri.genericPool, 0);
+
+	uint32 seed = 0x2545f491;
+	for (uint32 i=0 ; i<maxSize ; i++)
+	{
+		for (int axis=0 ; axis<3 ; axis++)
+		{
+			seed = seed * 1664525 + 1013904223;
+			const float centre = ri.def.viewOrigin[axis] + (float)((seed >> 8) & 4095) - 2048.0f;
+			seed = seed * 1664525 + 1013904223;
+			const float halfSize = 8.0f + (float)((seed >> 8) & 127);
+
+			soa[maxSize*axis + i] = aos[i][axis] = centre - halfSize;
+			soa[maxSize*(axis+3) + i] = aos[maxSize+i][axis] = centre + halfSize;
+			soa[maxSize*(axis+6) + i] = aos[maxSize*2+i][axis] = centre;
+		}
+		soa[maxSize*9 + i] = (aos[maxSize+i][0] - aos[i][0]) * 0.87f;
+	}
+
+	const refStats_t savedStats = ri.pc;
+
+	Com_Printf(0, "Frustum culling, %i runs (ms per pass, batch scalar/SSE2):\n", numRuns);
+	Com_Printf(0, "%6s %7s %15s %7s %15s %6s\n", "bounds", "box", "batch", "sphere", "batch", "exact");
+
+	for (uint32 s=0 ; s<numSizes ; s++)
+	{
+		const uint32 numBounds = benchSizes[s];
+		uint16 *reference = visible + maxSize;
+
+		double boxMS = 0, sphereMS = 0;
+		double boxBatchMS[2] = { 0, 0 }, sphereBatchMS[2] = { 0, 0 };
+		bool bExact = true;
+
+		for (int run=0 ; run<numRuns ; run++)
+		{
+			// One at a time
+			uint32 numReference = 0;
+			uint32 start = Sys_Cycles();
+			for (uint32 i=0 ; i<numBounds ; i++)
+			{
+				if (!R_CullBox(aos[i], aos[maxSize+i], ri.scn.clipFlags))
+					reference[numReference++] = (uint16)i;
+			}
+			boxMS += (Sys_Cycles() - start) * Sys_MSPerCycle();
+
+			for (int sse=0 ; sse<2 ; sse++)
+			{
+				ri.bSSE2 = sse ? bHadSSE2 : false;
+
+				start = Sys_Cycles();
+				const uint32 numVisible = R_CullBoxBatch(boxMins, boxMaxs, numBounds, ri.scn.clipFlags, visible);
+				boxBatchMS[sse] += (Sys_Cycles() - start) * Sys_MSPerCycle();
+
+				bExact &= (numVisible == numReference && !memcmp(visible, reference, sizeof(uint16) * numVisible));
+			}
+			ri.bSSE2 = bHadSSE2;
+
+			numReference = 0;
+			start = Sys_Cycles();
+			for (uint32 i=0 ; i<numBounds ; i++)
+			{
+				if (!R_CullSphere(aos[maxSize*2+i], sphereRadius[i], ri.scn.clipFlags))
+					reference[numReference++] = (uint16)i;
+			}
+			sphereMS += (Sys_Cycles() - start) * Sys_MSPerCycle();
+
+			for (int sse=0 ; sse<2 ; sse++)
+			{
+				ri.bSSE2 = sse ? bHadSSE2 : false;
+
+				start = Sys_Cycles();
+				const uint32 numVisible = R_CullSphereBatch(sphereOrigin, sphereRadius, numBounds, ri.scn.clipFlags, visible);
+				sphereBatchMS[sse] += (Sys_Cycles() - start) * Sys_MSPerCycle();
+
+				bExact &= (numVisible == numReference && !memcmp(visible, reference, sizeof(uint16) * numVisible));
+			}
+			ri.bSSE2 = bHadSSE2;
+		}
+
+		Com_Printf(0, "%6u %7.3f %7.3f/%-7.3f %7.3f %7.3f/%-7.3f %6s\n", numBounds,
+			boxMS / numRuns, boxBatchMS[0] / numRuns, boxBatchMS[1] / numRuns,
+			sphereMS / numRuns, sphereBatchMS[0] / numRuns, sphereBatchMS[1] / numRuns,
+			bExact ? "yes" : "NO");
+	}
+
+	ri.pc = savedStats;
+
+	Mem_Free(soa);
+	Mem_Free(aos);
+	Mem_Free(visible);
+}
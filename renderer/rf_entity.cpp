@@ -31,10 +31,26 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 =============================================================================
 */
 
-static byte r_entityCullBits[MAX_REF_ENTITIES/8];
-
 static TList<refEntity_t*> r_bmodelEntities;
 
+// Entities left after culling, as entity list offsets
+static uint16 r_visibleEntities[MAX_REF_ENTITIES];
+static uint32 r_numVisibleEntities;
+
+// Frustum batches, with the entity each entry came from
+static TCullBoxBatch<MAX_REF_ENTITIES> r_entityBoxBatch;
+static TCullSphereBatch<MAX_REF_ENTITIES> r_entitySphereBatch;
+static refEntity_t *r_entityBoxSource[MAX_REF_ENTITIES];
+static refEntity_t *r_entitySphereSource[MAX_REF_ENTITIES];
+
+// Mesh slots for the visible entities, filled by R_StageEntityChunk
+#define MAX_ENTITY_SLOTS	MAX_MESH_BUFFER
+#define ENTITY_CHUNK_SIZE	64
+
+static refMeshSlot r_entitySlots[MAX_ENTITY_SLOTS];
+static uint32 r_entityFirstSlot[MAX_REF_ENTITIES+1];
+static uint32 r_numStagedEntities;
+
 /*
 =============
 R_CategorizeEntityList
@@ -70,9 +86,39 @@ void R_CategorizeEntityList()
 }
 
 
+/*
+=============
+R_AddBModelToList
+=============
+*/
+static void R_AddBModelToList(refEntity_t *ent, const vec3_t mins, const vec3_t maxs)
+{
+	if (R_OccludedBox(mins, maxs))
+		return;
+
+	switch (ent->model->type)
+	{
+	case MODEL_Q2BSP:
+		R_AddQ2BrushModel(ent);
+		break;
+
+	case MODEL_Q3BSP:
+		R_AddQ3BrushModel(ent);
+		break;
+
+	default:
+		assert(0);
+		break;
+	}
+}
+
+
 /*
 =============
 R_AddBModelsToList
+
+Rotated brush models are culled by their radius, the rest by their bounds,
+each kind in one batch.
 =============
 */
 void R_AddBModelsToList()
@@ -80,26 +126,47 @@ void R_AddBModelsToList()
 	if (!r_drawEntities->intVal)
 		return;
 
+	r_entityBoxBatch.Clear();
+	r_entitySphereBatch.Clear();
 	for (uint32 i=0 ; i<r_bmodelEntities.Count() ; i++)
 	{
 		refEntity_t *ent = r_bmodelEntities[i];
-		if (!R_CullBrushModel(ent, ri.scn.clipFlags))
+		if (!ent->model->BSPData()->firstModelVisSurface)
+			continue;
+
+		if (!Matrix3_Compare(ent->axis, axisIdentity))
 		{
-			switch (ent->model->type)
-			{
-			case MODEL_Q2BSP:
-				R_AddQ2BrushModel(ent);
-				break;
+			r_entitySphereSource[r_entitySphereBatch.Add(ent->origin, ent->model->radius * ent->scale)] = ent;
+		}
+		else
+		{
+			vec3_t mins, maxs;
+			Vec3MA(ent->origin, ent->scale, ent->model->mins, mins);
+			Vec3MA(ent->origin, ent->scale, ent->model->maxs, maxs);
+			r_entityBoxSource[r_entityBoxBatch.Add(mins, maxs)] = ent;
+		}
+	}
 
-			case MODEL_Q3BSP:
-				R_AddQ3BrushModel(ent);
-				break;
+	uint16 visible[MAX_REF_ENTITIES];
+	uint32 numVisible = r_entityBoxBatch.Cull(ri.scn.clipFlags, visible);
+	for (uint32 i=0 ; i<numVisible ; i++)
+	{
+		const uint32 index = visible[i];
+		const vec3_t mins = { r_entityBoxBatch.mins[0][index], r_entityBoxBatch.mins[1][index], r_entityBoxBatch.mins[2][index] };
+		const vec3_t maxs = { r_entityBoxBatch.maxs[0][index], r_entityBoxBatch.maxs[1][index], r_entityBoxBatch.maxs[2][index] };
+		R_AddBModelToList(r_entityBoxSource[index], mins, maxs);
+	}
 
-			default:
-				assert(0);
-				break;
-			}
-		}
+	numVisible = r_entitySphereBatch.Cull(ri.scn.clipFlags, visible);
+	for (uint32 i=0 ; i<numVisible ; i++)
+	{
+		refEntity_t *ent = r_entitySphereSource[visible[i]];
+		const float radius = ent->model->radius * ent->scale;
+
+		vec3_t mins, maxs;
+		Vec3Set(mins, ent->origin[0] - radius, ent->origin[1] - radius, ent->origin[2] - radius);
+		Vec3Set(maxs, ent->origin[0] + radius, ent->origin[1] + radius, ent->origin[2] + radius);
+		R_AddBModelToList(ent, mins, maxs);
 	}
 }
 
@@ -107,89 +174,210 @@ void R_AddBModelsToList()
 /*
 =============
 R_CullEntityList
+
+Builds the visible entity list. Models that need a frustum test go through
+one box or sphere batch, everything else is decided here. Each visible
+entity then gets its range of mesh slots.
 =============
 */
 void R_CullEntityList()
 {
+	r_numVisibleEntities = 0;
+	r_numStagedEntities = 0;
 	if (!r_drawEntities->intVal)
 		return;
 
-	memset(r_entityCullBits, 0, sizeof(r_entityCullBits));
+	r_entityBoxBatch.Clear();
+	r_entitySphereBatch.Clear();
+	uint32 numAlias = 0;
 	for (uint32 i=0 ; i<ri.scn.numEntities ; i++)
 	{
 		refEntity_t *ent = &ri.scn.entityList[ENTLIST_OFFSET+i];
 
-		bool bCulled = false;
 		switch (ent->model->type)
 		{
 		case MODEL_INTERNAL:
+			{
+				vec3_t mins, maxs;
+				if (R_InternalModelBounds(ent, mins, maxs))
+					r_entityBoxSource[r_entityBoxBatch.Add(mins, maxs)] = ent;
+			}
 			break;
 
 		case MODEL_MD2:
 		case MODEL_MD3:
-			bCulled = R_CullAliasModel(ent, ri.scn.clipFlags);
+			{
+				vec3_t mins, maxs;
+				bool bCulled;
+				if (R_AliasCullBounds(ent, mins, maxs, bCulled))
+				{
+					r_entityBoxSource[r_entityBoxBatch.Add(mins, maxs)] = ent;
+					numAlias++;
+				}
+				else if (!bCulled)
+				{
+					r_visibleEntities[r_numVisibleEntities++] = (uint16)i;
+				}
+			}
 			break;
 			
 		case MODEL_Q2BSP:
 		case MODEL_Q3BSP:
+			// Handled in R_AddBModelsToList
 			break;
 
 		case MODEL_SP2:
+			{
+				float radius;
+				if (R_SP2ModelRadius(ent, radius))
+					r_entitySphereSource[r_entitySphereBatch.Add(ent->origin, radius)] = ent;
+			}
 			break;
 
 		case MODEL_BAD:
 		default:
-			bCulled = true;
 			assert(0);
 			break;
 		}
+	}
+
+	// Counted below, alias models as cullAlias and internal models as cullBounds
+	uint16 visible[MAX_REF_ENTITIES];
+	uint32 numVisible = r_entityBoxBatch.Cull(ri.scn.clipFlags, visible, false);
+
+	uint32 numAliasVisible = 0;
+	for (uint32 i=0 ; i<numVisible ; i++)
+	{
+		const uint32 index = visible[i];
+		refEntity_t *ent = r_entityBoxSource[index];
+
+		if (ent->model->type != MODEL_INTERNAL)
+		{
+			numAliasVisible++;
+
+			const vec3_t mins = { r_entityBoxBatch.mins[0][index], r_entityBoxBatch.mins[1][index], r_entityBoxBatch.mins[2][index] };
+			const vec3_t maxs = { r_entityBoxBatch.maxs[0][index], r_entityBoxBatch.maxs[1][index], r_entityBoxBatch.maxs[2][index] };
+			if (R_CullAliasModel(ent, mins, maxs))
+				continue;
+		}
+
+		r_visibleEntities[r_numVisibleEntities++] = (uint16)(ent - &ri.scn.entityList[ENTLIST_OFFSET]);
+	}
+
+	if (!ri.scn.bDrawingMeshOutlines)
+	{
+		const uint32 numInternal = r_entityBoxBatch.numBoxes - numAlias;
+		const uint32 numInternalVisible = numVisible - numAliasVisible;
+
+		ri.pc.cullAlias[CULL_PASS] += numAlias - numAliasVisible;
+		ri.pc.cullAlias[CULL_FAIL] += numAliasVisible;
+		ri.pc.cullBounds[CULL_PASS] += numInternal - numInternalVisible;
+		ri.pc.cullBounds[CULL_FAIL] += numInternalVisible;
+	}
+
+	numVisible = r_entitySphereBatch.Cull(ri.scn.clipFlags, visible);
+	for (uint32 i=0 ; i<numVisible ; i++)
+	{
+		refEntity_t *ent = r_entitySphereSource[visible[i]];
+		r_visibleEntities[r_numVisibleEntities++] = (uint16)(ent - &ri.scn.entityList[ENTLIST_OFFSET]);
+	}
+
+	// Give every visible entity its slots
+	uint32 numSlots = 0;
+	for ( ; r_numStagedEntities<r_numVisibleEntities ; r_numStagedEntities++)
+	{
+		refEntity_t *ent = &ri.scn.entityList[ENTLIST_OFFSET+r_visibleEntities[r_numStagedEntities]];
+
+		uint32 numMeshes = 1;
+		if (ent->model->type == MODEL_MD2 || ent->model->type == MODEL_MD3)
+			numMeshes = ent->model->AliasData()->numMeshes;
+
+		if (numSlots + numMeshes > MAX_ENTITY_SLOTS)
+		{
+			Com_DevPrintf(PRNT_WARNING, "R_CullEntityList: out of mesh slots, %u entities dropped\n", r_numVisibleEntities - r_numStagedEntities);
+			break;
+		}
 
-		if (bCulled)
-			r_entityCullBits[i>>3] |= BIT(i&7);
+		r_entityFirstSlot[r_numStagedEntities] = numSlots;
+		numSlots += numMeshes;
 	}
+	r_entityFirstSlot[r_numStagedEntities] = numSlots;
 }
 
 
 /*
 =============
-R_AddEntitiesToList
+R_EntitySceneChunks
 =============
 */
-void R_AddEntitiesToList()
+uint32 R_EntitySceneChunks()
 {
-	if (!r_drawEntities->intVal)
-		return;
+	return (r_numStagedEntities + ENTITY_CHUNK_SIZE - 1) / ENTITY_CHUNK_SIZE;
+}
 
-	// Add all entities to the list
-	for (uint32 i=0 ; i<ri.scn.numEntities ; i++)
+
+/*
+=============
+R_StageEntityChunk
+
+Fills the mesh slots for one chunk of the visible entities, from any thread.
+=============
+*/
+void R_StageEntityChunk(const uint32 chunk)
+{
+	const uint32 first = chunk * ENTITY_CHUNK_SIZE;
+	const uint32 last = min(first + ENTITY_CHUNK_SIZE, r_numStagedEntities);
+
+	for (uint32 i=first ; i<last ; i++)
 	{
-		refEntity_t *ent = &ri.scn.entityList[ENTLIST_OFFSET+i];
-		if (!(r_entityCullBits[i>>3] & BIT(i&7)))
+		refEntity_t *ent = &ri.scn.entityList[ENTLIST_OFFSET+r_visibleEntities[i]];
+		refMeshSlot *slots = &r_entitySlots[r_entityFirstSlot[i]];
+
+		switch (ent->model->type)
 		{
-			switch (ent->model->type)
-			{
-			case MODEL_INTERNAL:
-				R_AddInternalModelToList(ent);
-				break;
-
-			case MODEL_MD2:
-			case MODEL_MD3:
-				R_AddAliasModelToList(ent);
-				break;
-
-			case MODEL_Q2BSP:
-			case MODEL_Q3BSP:
-				break;
-
-			case MODEL_SP2:
-				R_AddSP2ModelToList(ent);
-				break;
-			}
+		case MODEL_INTERNAL:
+			R_StageInternalModel(ent, slots);
+			break;
+
+		case MODEL_MD2:
+		case MODEL_MD3:
+			R_StageAliasModel(ent, slots);
+			break;
+
+		case MODEL_SP2:
+			R_StageSP2Model(ent, slots);
+			break;
 		}
 	}
 }
 
 
+/*
+=============
+R_EntitySceneChecksum
+=============
+*/
+uint32 R_EntitySceneChecksum()
+{
+	return R_HashMeshSlots(r_entitySlots, r_entityFirstSlot[r_numStagedEntities], COM_FNV_SEED);
+}
+
+
+/*
+=============
+R_AddEntitiesToList
+
+Adds the slots R_StageEntityChunk filled, in entity order.
+=============
+*/
+void R_AddEntitiesToList()
+{
+	const uint32 numSlots = r_entityFirstSlot[r_numStagedEntities];
+	for (uint32 i=0 ; i<numSlots ; i++)
+		ri.scn.currentList->AddStaged(r_entitySlots[i]);
+}
+
+
 /*
 =============
 R_EntityInit
@@ -243,6 +243,7 @@ enum ETexBuffer
 	TEXBUF_LOADING_5,
 	TEXBUF_PAL,
 	TEXBUF_RESAMPLE,
+	TEXBUF_MIP,
 	TEXBUF_SCRATCH,
 
 	TEXBUF_MAX
@@ -293,6 +294,40 @@ void R_ReleaseTexBuffers()
 	}
 }
 
+/*
+==============================================================================
+
+	IMAGE FILES
+
+	Each format is read in two steps. The header step checks the file and
+	fills in the output sizes, and may print. The decode step writes the
+	pixels into the buffers it's handed and must not touch anything else,
+	so that R_PrefetchImages can run it on the job threads.
+==============================================================================
+*/
+
+#define MAX_IMAGE_DIMENSION		16384
+
+struct imgFile_t
+{
+	const char		*name;
+	byte			*buffer;
+	int				fileLen;
+
+	int				width;
+	int				height;
+	int				samples;
+	size_t			outSize;		// Bytes the decode step writes, at most
+	size_t			scratchSize;	// Extra working space the decode step needs
+};
+
+struct imgFormat_t
+{
+	const char		*ext;
+	bool			(*header) (imgFile_t *file);
+	bool			(*decode) (imgFile_t *file, byte *out, byte *scratch);
+};
+
 /*
 ==============================================================================
  
@@ -301,27 +336,36 @@ void R_ReleaseTexBuffers()
 ==============================================================================
 */
 
+struct jpgError_t
+{
+	struct jpeg_error_mgr	pub;
+	jmp_buf					jump;
+};
+
 static void jpg_noop(j_decompress_ptr cinfo)
 {
 }
 
 static void jpeg_d_error_exit(j_common_ptr cinfo)
 {
-	char msg[1024];
-
-	(cinfo->err->format_message)(cinfo, msg);
-	Com_Error(ERR_FATAL, "R_LoadJPG: JPEG Lib Error: '%s'", msg);
+	longjmp(((jpgError_t *)cinfo->err)->jump, 1);
 }
 
 static boolean jpg_fill_input_buffer(j_decompress_ptr cinfo)
 {
-    Com_DevPrintf(PRNT_WARNING, "R_LoadJPG: Premeture end of jpeg file\n");
+	// Premature end of file, hand it an EOI marker so it finishes what it has
+	static const JOCTET eoi[2] = { 0xFF, JPEG_EOI };
 
-    return 1;
+	cinfo->src->next_input_byte = eoi;
+	cinfo->src->bytes_in_buffer = 2;
+	return TRUE;
 }
 
 static void jpg_skip_input_data(j_decompress_ptr cinfo, long num_bytes)
 {
+	if ((size_t)num_bytes > cinfo->src->bytes_in_buffer)
+		num_bytes = (long)cinfo->src->bytes_in_buffer;
+
     cinfo->src->next_input_byte += (size_t) num_bytes;
     cinfo->src->bytes_in_buffer -= (size_t) num_bytes;
 }
@@ -343,72 +387,98 @@ static void jpeg_mem_src(j_decompress_ptr cinfo, byte *mem, int len)
 
 /*
 =============
-R_LoadJPG
+R_JPGHeader
 
 ala Vic
 =============
 */
-static void R_LoadJPG(const char *name, byte **outData, int *outWidth, int *outHeight, const int Side = 0)
+static bool R_JPGHeader(imgFile_t *file)
 {
-	if (outData)
-		*outData = NULL;
+	jpgError_t jerr;
+	struct jpeg_decompress_struct cinfo;
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = jpeg_d_error_exit;
 
-	// Load the file
-	byte *buffer;
-	const int fileLen = FS_LoadFile(name, (void **)&buffer, false);
-	if (!buffer || fileLen <= 0)
-		return;
+	if (setjmp(jerr.jump))
+	{
+		char msg[JMSG_LENGTH_MAX];
+		(cinfo.err->format_message)((j_common_ptr)&cinfo, msg);
+		Com_Printf(PRNT_WARNING, "R_LoadJPG: JPEG Lib Error on '%s': '%s'\n", file->name, msg);
 
-	// Parse the file
-    struct jpeg_error_mgr jerr;
-    struct jpeg_decompress_struct cinfo;
-	cinfo.err = jpeg_std_error(&jerr);
-	jerr.error_exit = jpeg_d_error_exit;
+		jpeg_destroy_decompress(&cinfo);
+		return false;
+	}
 
 	jpeg_create_decompress(&cinfo);
-
-	jpeg_mem_src(&cinfo, buffer, fileLen);
+	jpeg_mem_src(&cinfo, file->buffer, file->fileLen);
 	jpeg_read_header(&cinfo, TRUE);
-
-	jpeg_start_decompress(&cinfo);
+	jpeg_calc_output_dimensions(&cinfo);
 
 	const int components = cinfo.output_components;
+	const int width = cinfo.output_width;
+	const int height = cinfo.output_height;
+	jpeg_destroy_decompress(&cinfo);
+
     if (components != 3 && components != 1)
 	{
-		Com_DevPrintf(PRNT_WARNING, "R_LoadJPG: Bad jpeg components '%s' (%d)\n", name, components);
-		jpeg_destroy_decompress(&cinfo);
-		FS_FreeFile(buffer);
-		return;
+		Com_DevPrintf(PRNT_WARNING, "R_LoadJPG: Bad jpeg components '%s' (%d)\n", file->name, components);
+		return false;
 	}
 
-	if (cinfo.output_width <= 0 || cinfo.output_height <= 0)
+	if (width <= 0 || height <= 0 || width > MAX_IMAGE_DIMENSION || height > MAX_IMAGE_DIMENSION)
 	{
-		Com_DevPrintf(PRNT_WARNING, "R_LoadJPG: Bad jpeg dimensions on '%s' (%d x %d)\n", name, cinfo.output_width, cinfo.output_height);
-		jpeg_destroy_decompress(&cinfo);
-		FS_FreeFile(buffer);
-		return;
+		Com_DevPrintf(PRNT_WARNING, "R_LoadJPG: Bad jpeg dimensions on '%s' (%d x %d)\n", file->name, width, height);
+		return false;
 	}
 
-	if (outWidth)
-		*outWidth = cinfo.output_width;
-	if (outHeight)
-		*outHeight = cinfo.output_height;
+	file->width = width;
+	file->height = height;
+	file->samples = 3;
+	file->outSize = width * height * 4;
+	file->scratchSize = width * components;
+	return true;
+}
 
-	byte *img = R_AllocateTexBuffer((ETexBuffer)(TEXBUF_LOADING_0+Side), cinfo.output_width * cinfo.output_height * 4);
-	byte *dummy = R_AllocateTexBuffer(TEXBUF_SCRATCH, cinfo.output_width * components);
 
-	if (outData)
-		*outData = img;
+/*
+=============
+R_JPGDecode
+=============
+*/
+static bool R_JPGDecode(imgFile_t *file, byte *out, byte *scratch)
+{
+	jpgError_t jerr;
+	struct jpeg_decompress_struct cinfo;
+	cinfo.err = jpeg_std_error(&jerr.pub);
+	jerr.pub.error_exit = jpeg_d_error_exit;
+
+	if (setjmp(jerr.jump))
+	{
+		jpeg_destroy_decompress(&cinfo);
+		return false;
+	}
+
+	jpeg_create_decompress(&cinfo);
+	jpeg_mem_src(&cinfo, file->buffer, file->fileLen);
+	jpeg_read_header(&cinfo, TRUE);
+	jpeg_start_decompress(&cinfo);
 
+	// Has to agree with what the header step sized the buffers for
+	const int components = cinfo.output_components;
+	if ((int)cinfo.output_width != file->width || (int)cinfo.output_height != file->height || (size_t)(file->width * components) > file->scratchSize)
+	{
+		jpeg_destroy_decompress(&cinfo);
+		return false;
+	}
+
+	byte *img = out;
 	while (cinfo.output_scanline < cinfo.output_height)
 	{
-		byte *scan = dummy;
+		byte *scan = scratch;
 		if (!jpeg_read_scanlines(&cinfo, &scan, 1))
 		{
-			Com_Printf(PRNT_WARNING, "Bad jpeg file %s\n", name);
 			jpeg_destroy_decompress(&cinfo);
-			FS_FreeFile(buffer);
-			return;
+			return false;
 		}
 
 		if (components == 1)
@@ -425,8 +495,7 @@ static void R_LoadJPG(const char *name, byte **outData, int *outWidth, int *outH
 
     jpeg_finish_decompress(&cinfo);
     jpeg_destroy_decompress(&cinfo);
-
-	FS_FreeFile(buffer);
+	return true;
 }
 
 
@@ -592,65 +661,82 @@ struct pngBuf_t
 {
 	byte	*buffer;
 	int		pos;
+	int		length;
 };
 
 void __cdecl PngReadFunc (png_struct *Png, png_bytep buf, png_size_t size)
 {
 	pngBuf_t *PngFileBuffer = (pngBuf_t*)png_get_io_ptr(Png);
+	if (size > (png_size_t)(PngFileBuffer->length - PngFileBuffer->pos))
+		png_error(Png, "read past end of file");
+
 	memcpy (buf, PngFileBuffer->buffer + PngFileBuffer->pos, size);
 	PngFileBuffer->pos += size;
 }
 
 /*
 =============
-R_LoadPNG
+R_PNGHeader
 =============
 */
-static void R_LoadPNG(const char *name, byte **outData, int *outWidth, int *outHeight, int *outSamples, const int Side = 0)
+static bool R_PNGHeader(imgFile_t *file)
 {
-	if (outData)
-		*outData = NULL;
-
-	// Load the file
-	pngBuf_t PngFileBuffer = { NULL, 0 };
-	int fileLen = FS_LoadFile(name, (void **)&PngFileBuffer.buffer, false);
-	if (!PngFileBuffer.buffer || fileLen <= 0)
-		return;
+	if (file->fileLen < 24 || (png_check_sig(file->buffer, 8)) == 0)
+	{
+		Com_Printf(PRNT_WARNING, "R_LoadPNG: Not a PNG file: %s\n", file->name);
+		return false;
+	}
 
-	// Parse the PNG file
-	if ((png_check_sig(PngFileBuffer.buffer, 8)) == 0)
+	// IHDR always comes first
+	const byte *ihdr = file->buffer + 16;
+	const int width = (ihdr[0]<<24) | (ihdr[1]<<16) | (ihdr[2]<<8) | ihdr[3];
+	const int height = (ihdr[4]<<24) | (ihdr[5]<<16) | (ihdr[6]<<8) | ihdr[7];
+	if (width <= 0 || height <= 0 || width > MAX_IMAGE_DIMENSION || height > MAX_IMAGE_DIMENSION)
 	{
-		Com_Printf(PRNT_WARNING, "R_LoadPNG: Not a PNG file: %s\n", name);
-		FS_FreeFile(PngFileBuffer.buffer);
-		return;
+		Com_Printf(PRNT_WARNING, "R_LoadPNG: Bad PNG file: %s\n", file->name);
+		return false;
 	}
 
-	PngFileBuffer.pos = 0;
+	// Every format is expanded to at most 8 bit RGBA
+	file->width = width;
+	file->height = height;
+	file->outSize = width * height * 4;
+	file->scratchSize = sizeof(png_bytep) * height;
+	return true;
+}
+
+
+/*
+=============
+R_PNGDecode
+=============
+*/
+static bool R_PNGDecode(imgFile_t *file, byte *out, byte *scratch)
+{
+	pngBuf_t PngFileBuffer = { file->buffer, 0, file->fileLen };
 
 	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL,  NULL, NULL);
 	if (!png_ptr)
-	{
-		Com_Printf (PRNT_WARNING, "R_LoadPNG: Bad PNG file: %s\n", name);
-		FS_FreeFile (PngFileBuffer.buffer);
-		return;
-	}
+		return false;
 
 	png_infop info_ptr = png_create_info_struct(png_ptr);
 	if (!info_ptr)
 	{
 		png_destroy_read_struct(&png_ptr, (png_infopp)NULL, (png_infopp)NULL);
-		Com_Printf(PRNT_WARNING, "R_LoadPNG: Bad PNG file: %s\n", name);
-		FS_FreeFile(PngFileBuffer.buffer);
-		return;
+		return false;
 	}
 
 	png_infop end_info = png_create_info_struct(png_ptr);
 	if (!end_info)
 	{
 		png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)NULL);
-		Com_Printf(PRNT_WARNING, "R_LoadPNG: Bad PNG file: %s\n", name);
-		FS_FreeFile(PngFileBuffer.buffer);
-		return;
+		return false;
+	}
+
+	if (setjmp(png_jmpbuf(png_ptr)))
+	{
+		png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
+		return false;
 	}
 
 	png_set_read_fn(png_ptr, (png_voidp)&PngFileBuffer, (png_rw_ptr)PngReadFunc);
@@ -697,37 +783,27 @@ static void R_LoadPNG(const char *name, byte **outData, int *outWidth, int *outH
 
 	png_read_update_info(png_ptr, info_ptr);
 
+	// Has to agree with what the header step sized the buffers for
 	const uint32 rowbytes = png_get_rowbytes(png_ptr, info_ptr);
-
-	if (!info_ptr->channels)
+	if (!info_ptr->channels
+	|| (int)info_ptr->width != file->width || (int)info_ptr->height != file->height
+	|| rowbytes > (uint32)file->width * 4)
 	{
-		png_destroy_read_struct(&png_ptr, &info_ptr, (png_infopp)NULL);
-		Com_Printf(PRNT_WARNING, "R_LoadPNG: Bad PNG file: %s\n", name);
-		FS_FreeFile(PngFileBuffer.buffer);
+		png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
+		return false;
 	}
 
-	png_bytep pic_ptr = (png_bytep)R_AllocateTexBuffer((ETexBuffer)(TEXBUF_LOADING_0+Side), info_ptr->height * rowbytes);
-	if (outData)
-		*outData = (byte*)pic_ptr;
-
-	png_bytepp row_pointers = (png_bytepp)R_AllocateTexBuffer(TEXBUF_SCRATCH, sizeof(png_bytep) * info_ptr->height);
-
+	png_bytepp row_pointers = (png_bytepp)scratch;
 	for (png_uint_32 i=0 ; i<info_ptr->height ; i++)
-		row_pointers[i] = pic_ptr + i*rowbytes;
+		row_pointers[i] = out + i*rowbytes;
 
 	png_read_image(png_ptr, row_pointers);
 
-	if (outWidth)
-		*outWidth = info_ptr->width;
-	if (outHeight)
-		*outHeight = info_ptr->height;
-	if (outSamples)
-		*outSamples = info_ptr->channels;
+	file->samples = info_ptr->channels;
 
 	png_read_end(png_ptr, end_info);
 	png_destroy_read_struct(&png_ptr, &info_ptr, &end_info);
-
-	FS_FreeFile(PngFileBuffer.buffer);
+	return true;
 }
 
 
@@ -785,25 +861,18 @@ static void R_WritePNG(FILE *f, byte *buffer, int width, int height)
 
 /*
 =============
-R_LoadTGA
+R_TGAParseHeader
 
-Loads type 1, 2, 3, 9, 10, 11 TARGA images.
-Type 32 and 33 are unsupported.
+Returns the start of the data after the image comment, or NULL if the file is
+too short for the header.
 =============
 */
-static void R_LoadTGA(const char *name, byte **outData, int *outWidth, int *outHeight, int *outSamples, const int Side = 0)
+static byte *R_TGAParseHeader(imgFile_t *file, tgaHeader_t &tga)
 {
-	*outData = NULL;
-
-	// Load the file
-	byte *buffer;
-	int fileLen = FS_LoadFile(name, (void **)&buffer, false);
-	if (!buffer || fileLen <= 0)
-		return;
+	if (file->fileLen < 18)
+		return NULL;
 
-	// Parse the header
-	byte *buf_p = buffer;
-	tgaHeader_t tga;
+	byte *buf_p = file->buffer;
 	tga.idLength = *buf_p++;
 	tga.colorMapType = *buf_p++;
 	tga.imageType = *buf_p++;
@@ -818,44 +887,123 @@ static void R_LoadTGA(const char *name, byte **outData, int *outWidth, int *outH
 	tga.pixelSize = *buf_p++;
 	tga.attributes = *buf_p++;
 
+	// Skip TARGA image comment
+	if (tga.idLength)
+		buf_p += tga.idLength;
+
+	return buf_p;
+}
+
+
+/*
+=============
+R_TGAHeader
+
+Loads type 1, 2, 3, 9, 10, 11 TARGA images.
+Type 32 and 33 are unsupported.
+=============
+*/
+static bool R_TGAHeader(imgFile_t *file)
+{
+	// Parse the header
+	tgaHeader_t tga;
+	if (!R_TGAParseHeader(file, tga))
+	{
+		Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: Bad TGA file (truncated)\n", file->name);
+		return false;
+	}
+
 	// Check header values
 	if (tga.width == 0 || tga.height == 0 || tga.width > 4096 || tga.height > 4096)
 	{
-		Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: Bad TGA file (%i x %i)\n", name, tga.width, tga.height);
-		FS_FreeFile(buffer);
-		return;
+		Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: Bad TGA file (%i x %i)\n", file->name, tga.width, tga.height);
+		return false;
 	}
 
-	// Skip TARGA image comment
-	if (tga.idLength)
-		buf_p += tga.idLength;
-
-	bool bCompressed = false;
-	byte palette[256][4];
 	switch (tga.imageType)
 	{
 	case 9:
-		bCompressed = true;
 	case 1:
 		// Uncompressed colormapped image
 		if (tga.pixelSize != 8)
 		{
-			Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: Only 8 bit images supported for type 1 and 9\n", name);
-			FS_FreeFile(buffer);
-			return;
+			Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: Only 8 bit images supported for type 1 and 9\n", file->name);
+			return false;
 		}
 		if (tga.colorMapLength != 256)
 		{
-			Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: Only 8 bit colormaps are supported for type 1 and 9\n", name);
-			FS_FreeFile(buffer);
-			return;
+			Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: Only 8 bit colormaps are supported for type 1 and 9\n", file->name);
+			return false;
 		}
 		if (tga.colorMapIndex)
 		{
-			Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: colorMapIndex is not supported for type 1 and 9\n", name);
-			FS_FreeFile(buffer);
-			return;
+			Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: colorMapIndex is not supported for type 1 and 9\n", file->name);
+			return false;
+		}
+		if (tga.colorMapSize != 32 && tga.colorMapSize != 24)
+		{
+			Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: Only 24 and 32 bit colormaps are supported for type 1 and 9\n", file->name);
+			return false;
+		}
+		break;
+
+	case 10:
+	case 2:
+		// Uncompressed or RLE compressed RGB
+		if (tga.pixelSize != 32 && tga.pixelSize != 24)
+		{
+			Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: Only 32 or 24 bit images supported for type 2 and 10\n", file->name);
+			return false;
+		}
+		break;
+
+	case 11:
+	case 3:
+		// Uncompressed greyscale
+		if (tga.pixelSize != 8)
+		{
+			Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: Only 8 bit images supported for type 3 and 11", file->name);
+			return false;
 		}
+		break;
+
+	default:
+		Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: Only type 1, 2, 3, 9, 10, and 11 TGA images are supported (%i)", file->name, tga.imageType);
+		return false;
+	}
+
+	file->width = tga.width;
+	file->height = tga.height;
+	file->outSize = tga.width * tga.height * 4;
+	file->scratchSize = 0;
+	return true;
+}
+
+
+/*
+=============
+R_TGADecode
+=============
+*/
+static bool R_TGADecode(imgFile_t *file, byte *out, byte *scratch)
+{
+	tgaHeader_t tga;
+	byte *buf_p = R_TGAParseHeader(file, tga);
+	if (!buf_p)
+		return false;
+
+	const byte *bufEnd = file->buffer + file->fileLen;
+	const int bytesPerPixel = tga.pixelSize / 8;
+
+	bool bCompressed = false;
+	byte palette[256][4];
+	switch (tga.imageType)
+	{
+	case 9:
+		bCompressed = true;
+	case 1:
+		if (buf_p + tga.colorMapLength * (tga.colorMapSize / 8) > bufEnd)
+			return false;
 
 		switch (tga.colorMapSize)
 		{
@@ -878,54 +1026,18 @@ static void R_LoadTGA(const char *name, byte **outData, int *outWidth, int *outH
 				palette[i][3] = 255;
 			}
 			break;
-
-		default:
-			Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: Only 24 and 32 bit colormaps are supported for type 1 and 9\n", name);
-			FS_FreeFile(buffer);
-			return;
 		}
 		break;
 
 	case 10:
-		bCompressed = true;
-	case 2:
-		// Uncompressed or RLE compressed RGB
-		if (tga.pixelSize != 32 && tga.pixelSize != 24)
-		{
-			Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: Only 32 or 24 bit images supported for type 2 and 10\n", name);
-			FS_FreeFile(buffer);
-			return;
-		}
-		break;
-
 	case 11:
 		bCompressed = true;
-	case 3:
-		// Uncompressed greyscale
-		if (tga.pixelSize != 8)
-		{
-			Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: Only 8 bit images supported for type 3 and 11", name);
-			FS_FreeFile(buffer);
-			return;
-		}
 		break;
-
-	default:
-		Com_DevPrintf(PRNT_WARNING, "R_LoadTGA: %s: Only type 1, 2, 3, 9, 10, and 11 TGA images are supported (%i)", name, tga.imageType);
-		FS_FreeFile(buffer);
-		return;
 	}
 
-	int columns = tga.width;
-	if (outWidth)
-		*outWidth = columns;
-
-	int rows = tga.height;
-	if (outHeight)
-		*outHeight = rows;
-
-	byte *targaRGBA = R_AllocateTexBuffer((ETexBuffer)(TEXBUF_LOADING_0+Side), columns * rows * 4);
-	*outData = targaRGBA;
+	const int columns = tga.width;
+	const int rows = tga.height;
+	byte *targaRGBA = out;
 
 	// If bit 5 of attributes isn't set, the image has been stored from bottom to top
 	byte *pixbuf;
@@ -949,6 +1061,9 @@ static void R_LoadTGA(const char *name, byte **outData, int *outWidth, int *outH
 
 		if (bCompressed)
 		{
+			if (buf_p >= bufEnd)
+				return false;
+
 			pixelCount = *buf_p++;
 			if (pixelCount & 0x80)
 				readPixelCount = 1; // Run-length packet
@@ -960,6 +1075,9 @@ static void R_LoadTGA(const char *name, byte **outData, int *outWidth, int *outH
 			byte red, green, blue, alpha;
 			if (readPixelCount-- > 0)
 			{
+				if (buf_p + bytesPerPixel > bufEnd)
+					return false;
+
 				switch (tga.imageType)
 				{
 				case 1:
@@ -1011,10 +1129,8 @@ static void R_LoadTGA(const char *name, byte **outData, int *outWidth, int *outH
 		}
 	}
 
-	FS_FreeFile(buffer);
-
-	if (outSamples)
-		*outSamples = components;
+	file->samples = components;
+	return true;
 }
 
 
@@ -1056,6 +1172,92 @@ static void R_WriteTGA(FILE *f, byte *buffer, const int width, const int height,
 	Mem_Free(out);
 }
 
+/*
+==============================================================================
+
+	IMAGE FILE LOADING
+
+==============================================================================
+*/
+
+enum
+{
+	IMGFMT_PNG,
+	IMGFMT_TGA,
+	IMGFMT_JPG,
+
+	IMGFMT_MAX
+};
+
+static const imgFormat_t r_imageFormats[IMGFMT_MAX] =
+{
+	{ "png",	R_PNGHeader,	R_PNGDecode },
+	{ "tga",	R_TGAHeader,	R_TGADecode },
+	{ "jpg",	R_JPGHeader,	R_JPGDecode },
+};
+
+/*
+=============
+R_LoadImageFile
+
+Loads and decodes an image into the loading buffer for the given cubemap side
+=============
+*/
+static void R_LoadImageFile(const char *name, const imgFormat_t *format, byte **outData, int *outWidth, int *outHeight, int *outSamples, const int Side)
+{
+	*outData = NULL;
+
+	// Load the file
+	imgFile_t file;
+	memset(&file, 0, sizeof(file));
+	file.name = name;
+	file.fileLen = FS_LoadFile(name, (void **)&file.buffer, false);
+	if (!file.buffer || file.fileLen <= 0)
+		return;
+
+	// Check the header
+	if (!format->header(&file))
+	{
+		FS_FreeFile(file.buffer);
+		return;
+	}
+
+	// Decode
+	byte *pic = R_AllocateTexBuffer((ETexBuffer)(TEXBUF_LOADING_0+Side), file.outSize);
+	byte *scratch = file.scratchSize ? R_AllocateTexBuffer(TEXBUF_SCRATCH, file.scratchSize) : NULL;
+	if (format->decode(&file, pic, scratch))
+	{
+		*outData = pic;
+		if (outWidth)
+			*outWidth = file.width;
+		if (outHeight)
+			*outHeight = file.height;
+		if (outSamples)
+			*outSamples = file.samples;
+	}
+	else
+	{
+		Com_Printf(PRNT_WARNING, "R_LoadImageFile: Bad %s file: %s\n", format->ext, name);
+	}
+
+	FS_FreeFile(file.buffer);
+}
+
+static inline void R_LoadPNG(const char *name, byte **outData, int *outWidth, int *outHeight, int *outSamples, const int Side = 0)
+{
+	R_LoadImageFile(name, &r_imageFormats[IMGFMT_PNG], outData, outWidth, outHeight, outSamples, Side);
+}
+
+static inline void R_LoadTGA(const char *name, byte **outData, int *outWidth, int *outHeight, int *outSamples, const int Side = 0)
+{
+	R_LoadImageFile(name, &r_imageFormats[IMGFMT_TGA], outData, outWidth, outHeight, outSamples, Side);
+}
+
+static inline void R_LoadJPG(const char *name, byte **outData, int *outWidth, int *outHeight, const int Side = 0)
+{
+	R_LoadImageFile(name, &r_imageFormats[IMGFMT_JPG], outData, outWidth, outHeight, NULL, Side);
+}
+
 /*
 ==============================================================================
 
@@ -1067,9 +1269,11 @@ static void R_WriteTGA(FILE *f, byte *buffer, const int width, const int height,
 /*
 ================
 R_LoadWal
+
+The source length and hash are only worked out when they're asked for
 ================
 */
-static void R_LoadWal(const char *name, byte **outData, int *outWidth, int *outHeight)
+static void R_LoadWal(const char *name, byte **outData, int *outWidth, int *outHeight, uint32 *outSourceLen = NULL, uint32 *outSourceHash = NULL)
 {
 	// Load the file
 	byte *buffer;
@@ -1077,6 +1281,12 @@ static void R_LoadWal(const char *name, byte **outData, int *outWidth, int *outH
 	if (!buffer || fileLen <= 0)
 		return;
 
+	if (outSourceLen && outSourceHash)
+	{
+		*outSourceLen = fileLen;
+		*outSourceHash = Com_HashBlock(buffer, fileLen);
+	}
+
 	// Parse the WAL file
 	walTex_t *mt = (walTex_t *)buffer;
 
@@ -1119,6 +1329,8 @@ static void R_LoadWal(const char *name, byte **outData, int *outWidth, int *outH
 /*
 ===============
 R_ColorMipLevel
+
+Tints each mip level red, green or blue by halving the other two channels
 ===============
 */
 static void R_ColorMipLevel(byte *image, const int size, const int level)
@@ -1126,38 +1338,31 @@ static void R_ColorMipLevel(byte *image, const int size, const int level)
 	if (level == 0)
 		return;
 
-	switch ((level+2) % 3)
-	{
-	case 0:
-		for (int i=0 ; i<size ; i++, image+=4)
-		{
-			image[0] = 255;
-			image[1] *= 0.5f;
-			image[2] *= 0.5f;
-		}
-		break;
+	const int keep = (level+2) % 3;
+	int i = 0;
 
-	case 1:
-		for (int i=0 ; i<size ; i++, image+=4)
+#ifdef R_SSE2
+	if (ri.bSSE2)
+	{
+		const __m128i halfMask = _mm_set1_epi8(0x7f);
+		const __m128i alphaBits = _mm_set1_epi32((int)0xff000000);
+		const __m128i keepBits = _mm_set1_epi32(0xff << (keep*8));
+		for ( ; i+4<=size ; i+=4, image+=16)
 		{
-			image[0] *= 0.5f;
-			image[1] = 255;
-			image[2] *= 0.5f;
+			const __m128i p = _mm_loadu_si128((const __m128i *)image);
+			const __m128i half = _mm_and_si128(_mm_srli_epi16(p, 1), halfMask);
 
-			image += 4;
+			__m128i r = _mm_or_si128(_mm_and_si128(p, alphaBits), _mm_andnot_si128(alphaBits, half));
+			_mm_storeu_si128((__m128i *)image, _mm_or_si128(r, keepBits));
 		}
-		break;
-
-	case 2:
-		for (int i=0 ; i<size ; i++, image+=4)
-		{
-			image[0] *= 0.5f;
-			image[1] *= 0.5f;
-			image[2] = 255;
+	}
+#endif // R_SSE2
 
-			image += 4;
-		}
-		break;
+	for ( ; i<size ; i++, image+=4)
+	{
+		image[0] = (keep == 0) ? 255 : image[0] >> 1;
+		image[1] = (keep == 1) ? 255 : image[1] >> 1;
+		image[2] = (keep == 2) ? 255 : image[2] >> 1;
 	}
 }
 
@@ -1239,44 +1444,119 @@ static inline GLenum R_ImageUploadType(const texFlags_t flags)
 
 /*
 ================
-R_LightScaleImage
+R_LightScalePixels
 
-Scale up the pixel values in a texture to increase the lighting range
+Gamma and intensity are folded into one table, the lookups themselves don't
+vectorize without a gather
 ================
 */
-static void R_LightScaleImage(uint32 *in, const int inWidth, const int inHeight, const bool useGamma, const bool useIntensity)
+static void R_LightScalePixels(byte *out, const int c, const bool useGamma, const bool useIntensity)
+{
+	if (!useGamma && !useIntensity)
+		return;
+
+	byte table[256];
+	for (int i=0 ; i<256 ; i++)
+	{
+		const byte v = useIntensity ? r_intensityTable[i] : i;
+		table[i] = useGamma ? r_gammaTable[v] : v;
+	}
+
+	for (int i=0 ; i<c ; i++, out+=4)
+	{
+		out[0] = table[out[0]];
+		out[1] = table[out[1]];
+		out[2] = table[out[2]];
+	}
+}
+
+
+/*
+================
+R_MipmapRows
+
+Fills output rows [firstRow, lastRow) of the next mip level down
+================
+*/
+static void R_MipmapRows(const byte *in, byte *out, int inWidth, const int firstRow, const int lastRow)
 {
-	byte *out = (byte *)in;
-	int c = inWidth * inHeight;
+	const int outRowBytes = ((inWidth + 1) >> 1) * 4;
+	inWidth <<= 2;
 
-	if (useGamma)
+	in += firstRow * (outRowBytes * 2 + inWidth);
+	out += firstRow * outRowBytes;
+	for (int i=firstRow ; i<lastRow ; i++, in+=inWidth)
 	{
-		if (useIntensity)
+		int j = 0;
+
+#ifdef R_SSE2
+		if (ri.bSSE2)
 		{
-			for (int i=0 ; i<c ; i++, out+=4)
+			// Eight source pixels from each row make four output pixels
+			const __m128i zero = _mm_setzero_si128();
+			for ( ; j+32<=inWidth ; j+=32, out+=16, in+=32)
 			{
-				out[0] = r_gammaTable[r_intensityTable[out[0]]];
-				out[1] = r_gammaTable[r_intensityTable[out[1]]];
-				out[2] = r_gammaTable[r_intensityTable[out[2]]];
+				const __m128i a0 = _mm_loadu_si128((const __m128i *)in);
+				const __m128i a1 = _mm_loadu_si128((const __m128i *)(in+16));
+				const __m128i b0 = _mm_loadu_si128((const __m128i *)(in+inWidth));
+				const __m128i b1 = _mm_loadu_si128((const __m128i *)(in+inWidth+16));
+
+				// Add the rows together, two pixels to a register
+				__m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+				__m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+				__m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+				__m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+				// Then each pixel with its neighbour
+				s0 = _mm_add_epi16(s0, _mm_srli_si128(s0, 8));
+				s1 = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+				s2 = _mm_add_epi16(s2, _mm_srli_si128(s2, 8));
+				s3 = _mm_add_epi16(s3, _mm_srli_si128(s3, 8));
+
+				const __m128i lo = _mm_srli_epi16(_mm_unpacklo_epi64(s0, s1), 2);
+				const __m128i hi = _mm_srli_epi16(_mm_unpacklo_epi64(s2, s3), 2);
+				_mm_storeu_si128((__m128i *)out, _mm_packus_epi16(lo, hi));
 			}
 		}
-		else
+#endif // R_SSE2
+
+		for ( ; j<inWidth ; j+=8, out+=4, in+=8)
 		{
-			for (int i=0 ; i<c ; i++, out+=4)
-			{
-				out[0] = r_gammaTable[out[0]];
-				out[1] = r_gammaTable[out[1]];
-				out[2] = r_gammaTable[out[2]];
-			}
+			out[0] = (in[0] + in[4] + in[inWidth+0] + in[inWidth+4])>>2;
+			out[1] = (in[1] + in[5] + in[inWidth+1] + in[inWidth+5])>>2;
+			out[2] = (in[2] + in[6] + in[inWidth+2] + in[inWidth+6])>>2;
+			out[3] = (in[3] + in[7] + in[inWidth+3] + in[inWidth+7])>>2;
 		}
 	}
-	else if (useIntensity)
+}
+
+
+/*
+================
+R_MipmapRowsLinear
+
+Same as R_MipmapRows, but averages the color in linear light so that mip
+levels don't darken. Alpha is averaged as is.
+================
+*/
+static uint16 r_srgbToLinear[256];
+static byte r_linearToSRGB[4096];
+
+static void R_MipmapRowsLinear(const byte *in, byte *out, int inWidth, const int firstRow, const int lastRow)
+{
+	const int outRowBytes = ((inWidth + 1) >> 1) * 4;
+	inWidth <<= 2;
+
+	in += firstRow * (outRowBytes * 2 + inWidth);
+	out += firstRow * outRowBytes;
+	for (int i=firstRow ; i<lastRow ; i++, in+=inWidth)
 	{
-		for (int i=0 ; i<c ; i++, out+=4)
+		for (int j=0 ; j<inWidth ; j+=8, out+=4, in+=8)
 		{
-			out[0] = r_intensityTable[out[0]];
-			out[1] = r_intensityTable[out[1]];
-			out[2] = r_intensityTable[out[2]];
+			out[0] = r_linearToSRGB[(r_srgbToLinear[in[0]] + r_srgbToLinear[in[4]] + r_srgbToLinear[in[inWidth+0]] + r_srgbToLinear[in[inWidth+4]])>>6];
+			out[1] = r_linearToSRGB[(r_srgbToLinear[in[1]] + r_srgbToLinear[in[5]] + r_srgbToLinear[in[inWidth+1]] + r_srgbToLinear[in[inWidth+5]])>>6];
+			out[2] = r_linearToSRGB[(r_srgbToLinear[in[2]] + r_srgbToLinear[in[6]] + r_srgbToLinear[in[inWidth+2]] + r_srgbToLinear[in[inWidth+6]])>>6];
+			out[3] = (in[3] + in[7] + in[inWidth+3] + in[inWidth+7])>>2;
 		}
 	}
 }
@@ -1284,84 +1564,396 @@ static void R_LightScaleImage(uint32 *in, const int inWidth, const int inHeight,
 
 /*
 ================
-R_MipmapImage
+R_InitLinearTables
 
-Operates in place, quartering the size of the texture
+sRGB to 16 bit linear, and 12 bit linear back to sRGB
 ================
 */
-static void R_MipmapImage(byte *in, int inWidth, int inHeight)
+static void R_InitLinearTables()
 {
-	inWidth <<= 2;
-	inHeight >>= 1;
+	for (int i=0 ; i<256 ; i++)
+	{
+		const double c = i / 255.0;
+		const double l = (c <= 0.04045) ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+		r_srgbToLinear[i] = (uint16)(l * 65535.0 + 0.5);
+	}
 
-	byte *out = in;
-	for (int i=0 ; i<inHeight ; i++, in+=inWidth)
+	for (int i=0 ; i<4096 ; i++)
 	{
-		for (int j=0 ; j<inWidth ; j+=8, out+=4, in+=8)
+		const double l = (i + 0.5) / 4096.0;
+		const double c = (l <= 0.0031308) ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+		r_linearToSRGB[i] = (byte)clamp((int)(c * 255.0 + 0.5), 0, 255);
+	}
+}
+
+
+/*
+================
+R_ResampleColumns
+
+Byte offsets of the two source columns sampled for each output column
+================
+*/
+static void R_ResampleColumns(const int inWidth, const int outWidth, uint32 *p1, uint32 *p2)
+{
+	const uint32 fracstep = inWidth * 0x10000 / outWidth;
+	uint32 frac = fracstep >> 2;
+	for (int i=0 ; i<outWidth ; i++)
+	{
+		p1[i] = 4 * (frac >> 16);
+		frac += fracstep;
+	}
+
+	frac = 3 * (fracstep >> 2);
+	for (int i=0 ; i<outWidth ; i++)
+	{
+		p2[i] = 4 * (frac >> 16);
+		frac += fracstep;
+	}
+}
+
+
+/*
+================
+R_ResampleRows
+
+Fills output rows [firstRow, lastRow), p1 and p2 come from R_ResampleColumns
+================
+*/
+static void R_ResampleRows(const uint32 *inData, const int inWidth, const int inHeight, uint32 *outData, const int outWidth, const int outHeight,
+						   const uint32 *p1, const uint32 *p2, const int firstRow, const int lastRow)
+{
+	outData += firstRow * outWidth;
+	for (int i=firstRow ; i<lastRow ; i++, outData+=outWidth)
+	{
+		const uint32 *inrow = inData + inWidth * (int)((i + 0.25f) * inHeight / outHeight);
+		const uint32 *inrow2 = inData + inWidth * (int)((i + 0.75f) * inHeight / outHeight);
+		int j = 0;
+
+#ifdef R_SSE2
+		if (ri.bSSE2)
 		{
-			out[0] = (in[0] + in[4] + in[inWidth+0] + in[inWidth+4])>>2;
-			out[1] = (in[1] + in[5] + in[inWidth+1] + in[inWidth+5])>>2;
-			out[2] = (in[2] + in[6] + in[inWidth+2] + in[inWidth+6])>>2;
-			out[3] = (in[3] + in[7] + in[inWidth+3] + in[inWidth+7])>>2;
+			// Four output pixels at a time, the taps are fetched one by one
+			const __m128i zero = _mm_setzero_si128();
+			for ( ; j+4<=outWidth ; j+=4)
+			{
+				const __m128i t1 = _mm_setr_epi32(inrow[p1[j]>>2], inrow[p1[j+1]>>2], inrow[p1[j+2]>>2], inrow[p1[j+3]>>2]);
+				const __m128i t2 = _mm_setr_epi32(inrow[p2[j]>>2], inrow[p2[j+1]>>2], inrow[p2[j+2]>>2], inrow[p2[j+3]>>2]);
+				const __m128i t3 = _mm_setr_epi32(inrow2[p1[j]>>2], inrow2[p1[j+1]>>2], inrow2[p1[j+2]>>2], inrow2[p1[j+3]>>2]);
+				const __m128i t4 = _mm_setr_epi32(inrow2[p2[j]>>2], inrow2[p2[j+1]>>2], inrow2[p2[j+2]>>2], inrow2[p2[j+3]>>2]);
+
+				__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(t1, zero), _mm_unpacklo_epi8(t2, zero));
+				lo = _mm_add_epi16(lo, _mm_add_epi16(_mm_unpacklo_epi8(t3, zero), _mm_unpacklo_epi8(t4, zero)));
+				__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(t1, zero), _mm_unpackhi_epi8(t2, zero));
+				hi = _mm_add_epi16(hi, _mm_add_epi16(_mm_unpackhi_epi8(t3, zero), _mm_unpackhi_epi8(t4, zero)));
+
+				_mm_storeu_si128((__m128i *)(outData + j), _mm_packus_epi16(_mm_srli_epi16(lo, 2), _mm_srli_epi16(hi, 2)));
+			}
+		}
+#endif // R_SSE2
+
+		for ( ; j<outWidth ; j++)
+		{
+			const byte *pix1 = (const byte *)inrow + p1[j];
+			const byte *pix2 = (const byte *)inrow + p2[j];
+			const byte *pix3 = (const byte *)inrow2 + p1[j];
+			const byte *pix4 = (const byte *)inrow2 + p2[j];
+
+			((byte *)(outData + j))[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0]) >> 2;
+			((byte *)(outData + j))[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1]) >> 2;
+			((byte *)(outData + j))[2] = (pix1[2] + pix2[2] + pix3[2] + pix4[2]) >> 2;
+			((byte *)(outData + j))[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3]) >> 2;
 		}
 	}
 }
 
+/*
+==============================================================================
+
+	PRE-UPLOAD JOBS
+
+	Large uploads split the resample, light scale and mipmap passes into
+	bands of rows on the job threads. A band only writes its own rows, so
+	the result is the same as doing it in one go.
+==============================================================================
+*/
+
+#define IMAGE_JOB_MIN_PIXELS	(256*256)
+
+struct imgBandJob_t
+{
+	const byte		*in;
+	byte			*out;
+	int				inWidth, inHeight;
+	int				outWidth, outHeight;
+
+	const uint32	*p1, *p2;
+	bool			bGamma, bIntensity;
+	bool			bLinear;
+
+	int				numRows;
+	int				bandRows;
+};
+
+/*
+================
+R_ImageBands
+
+Number of jobs to split numRows of output into, 1 if it's not worth it
+================
+*/
+static int R_ImageBands(imgBandJob_t &job, const int numRows, const int numPixels)
+{
+	job.numRows = numRows;
+	job.bandRows = numRows;
+	if (!r_imageJobs->intVal || numPixels < IMAGE_JOB_MIN_PIXELS || Job_NumThreads() < 2)
+		return 1;
+
+	const int numBands = min(numRows, Job_NumThreads() * 2);
+	job.bandRows = (numRows + numBands - 1) / numBands;
+	return (numRows + job.bandRows - 1) / job.bandRows;
+}
+
+static inline void R_BandRows(const imgBandJob_t *job, const int jobNum, int &firstRow, int &lastRow)
+{
+	firstRow = jobNum * job->bandRows;
+	lastRow = min(firstRow + job->bandRows, job->numRows);
+}
+
+static void R_ResampleJob(void *arg, int jobNum)
+{
+	const imgBandJob_t *job = (const imgBandJob_t *)arg;
+	int firstRow, lastRow;
+	R_BandRows(job, jobNum, firstRow, lastRow);
+
+	R_ResampleRows((const uint32 *)job->in, job->inWidth, job->inHeight, (uint32 *)job->out, job->outWidth, job->outHeight, job->p1, job->p2, firstRow, lastRow);
+}
+
+static void R_LightScaleJob(void *arg, int jobNum)
+{
+	const imgBandJob_t *job = (const imgBandJob_t *)arg;
+	int firstRow, lastRow;
+	R_BandRows(job, jobNum, firstRow, lastRow);
+
+	R_LightScalePixels(job->out + firstRow * job->outWidth * 4, (lastRow - firstRow) * job->outWidth, job->bGamma, job->bIntensity);
+}
+
+static void R_MipmapJob(void *arg, int jobNum)
+{
+	const imgBandJob_t *job = (const imgBandJob_t *)arg;
+	int firstRow, lastRow;
+	R_BandRows(job, jobNum, firstRow, lastRow);
+
+	if (job->bLinear)
+		R_MipmapRowsLinear(job->in, job->out, job->inWidth, firstRow, lastRow);
+	else
+		R_MipmapRows(job->in, job->out, job->inWidth, firstRow, lastRow);
+}
+
+
+/*
+================
+R_LightScaleImage
+
+Scale up the pixel values in a texture to increase the lighting range
+================
+*/
+static void R_LightScaleImage(uint32 *in, const int inWidth, const int inHeight, const bool useGamma, const bool useIntensity)
+{
+	if (!useGamma && !useIntensity)
+		return;
+
+	imgBandJob_t job;
+	const int numBands = R_ImageBands(job, inHeight, inWidth * inHeight);
+	if (numBands == 1)
+	{
+		R_LightScalePixels((byte *)in, inWidth * inHeight, useGamma, useIntensity);
+		return;
+	}
+
+	job.out = (byte *)in;
+	job.outWidth = inWidth;
+	job.bGamma = useGamma;
+	job.bIntensity = useIntensity;
+	Job_Run(R_LightScaleJob, &job, numBands);
+}
+
+
+/*
+================
+R_MipmapImage
+
+Quarters the size of the texture from in into out
+================
+*/
+static void R_MipmapImage(const byte *in, byte *out, const int inWidth, const int inHeight)
+{
+	imgBandJob_t job;
+	const int numBands = R_ImageBands(job, inHeight >> 1, inWidth * inHeight);
+
+	assert(in != out);
+	job.in = in;
+	job.out = out;
+	job.inWidth = inWidth;
+	job.bLinear = (r_linearMipmaps->intVal != 0);
+	if (numBands == 1)
+		R_MipmapJob(&job, 0);
+	else
+		Job_Run(R_MipmapJob, &job, numBands);
+}
+
 
 /*
 ================
 R_ResampleImage
 ================
 */
-static void R_ResampleImage(uint32 *inData, const int inWidth, const int inHeight, uint32 *outData, const int outWidth, const int outHeight)
+static void R_ResampleImage(uint32 *inData, const int inWidth, const int inHeight, uint32 *outData, const int outWidth, const int outHeight)
+{
+	if (inWidth == outWidth && inHeight == outHeight)
+	{
+		memcpy(outData, inData, inWidth*inHeight*sizeof(uint32));
+		return;
+	}
+
+	uint32 *resampleBuffer = (uint32*)R_AllocateTexBuffer(TEXBUF_SCRATCH, outWidth*2*sizeof(uint32));
+	uint32 *p1 = resampleBuffer;
+	uint32 *p2 = resampleBuffer + outWidth;
+	R_ResampleColumns(inWidth, outWidth, p1, p2);
+
+	// Resample
+	imgBandJob_t job;
+	const int numBands = R_ImageBands(job, outHeight, outWidth * outHeight);
+	if (numBands == 1)
+	{
+		R_ResampleRows(inData, inWidth, inHeight, outData, outWidth, outHeight, p1, p2, 0, outHeight);
+	}
+	else
+	{
+		job.in = (const byte *)inData;
+		job.out = (byte *)outData;
+		job.inWidth = inWidth;
+		job.inHeight = inHeight;
+		job.outWidth = outWidth;
+		job.outHeight = outHeight;
+		job.p1 = p1;
+		job.p2 = p2;
+		Job_Run(R_ResampleJob, &job, numBands);
+	}
+
+	ri.reg.imagesResampled++;
+}
+
+/*
+==============================================================================
+
+	IMAGE CACHE
+
+==============================================================================
+*/
+
+// Payload stored in the image cache for a 2D image:
+// [imgCacheChain_t]
+// [byte] RGBA levels, upWidth x upHeight halving down to 1x1, numLevels levels
+struct imgCacheChain_t
+{
+	int					width;				// Source size
+	int					height;
+	int					samples;
+	int					upWidth;
+	int					upHeight;
+	int					numLevels;
+};
+
+// Set around R_CreateImage to tie the 2D upload to the image cache
+struct imgCacheUpload_t
+{
+	const char			*name;
+	uint32				key;
+	uint32				sourceLen;
+	uint32				sourceHash;
+
+	bool				bStore;				// Store the processed chain
+	const imgCacheChain_t	*chain;			// Upload this chain instead of processing the data
+};
+
+static imgCacheUpload_t r_cacheUpload;
+
+/*
+===============
+R_ImageCacheActive
+
+Colored mip levels are a debugging aid and never cached
+===============
+*/
+static inline bool R_ImageCacheActive()
+{
+	return (r_imageCache->intVal && !r_colorMipLevels->intVal);
+}
+
+
+/*
+===============
+R_ImageCacheKey
+
+Hashes everything besides the source that goes into a processed chain
+===============
+*/
+static uint32 R_ImageCacheKey(const texFlags_t flags)
 {
-	if (inWidth == outWidth && inHeight == outHeight)
+	struct
 	{
-		memcpy(outData, inData, inWidth*inHeight*sizeof(uint32));
-		return;
-	}
+		uint32			flags;
+		int				picmip;
+		int				roundDown;
+		int				maxTexSize;
+		int				linearMips;
+		int				hwGamma;
+		byte			gammaTable[256];
+		byte			intensityTable[256];
+		uint32			paletteTable[256];
+	} key;
+
+	memset(&key, 0, sizeof(key));
+	key.flags = flags;
+	key.picmip = gl_picmip->intVal;
+	key.roundDown = r_roundImagesDown->intVal;
+	key.maxTexSize = ri.config.maxTexSize;
+	key.linearMips = r_linearMipmaps->intVal;
+	key.hwGamma = ri.config.bHWGammaInUse;
+	memcpy(key.gammaTable, r_gammaTable, sizeof(key.gammaTable));
+	memcpy(key.intensityTable, r_intensityTable, sizeof(key.intensityTable));
+	memcpy(key.paletteTable, r_paletteTable, sizeof(key.paletteTable));
+
+	return Com_HashBlock((byte *)&key, sizeof(key));
+}
 
-	uint32 *resampleBuffer = (uint32*)R_AllocateTexBuffer(TEXBUF_SCRATCH, outWidth*outHeight*4);
-	uint32 *p1 = resampleBuffer;
-	uint32 *p2 = resampleBuffer + outWidth;
 
-	// Resample
-	const uint32 fracstep = inWidth * 0x10000 / outWidth;
-	uint32 frac = fracstep >> 2;
-	for (int i=0 ; i<outWidth ; i++)
-	{
-		p1[i] = 4 * (frac >> 16);
-		frac += fracstep;
-	}
+/*
+===============
+R_ImageChainSize
 
-	frac = 3 * (fracstep >> 2);
-	for (int i=0 ; i<outWidth ; i++)
-	{
-		p2[i] = 4 * (frac >> 16);
-		frac += fracstep;
-	}
+Bytes in the RGBA levels of an upWidth x upHeight upload
+===============
+*/
+static uint32 R_ImageChainSize(int width, int height, const bool bMipMap, int &numLevels)
+{
+	uint32 size = width * height * 4;
+	numLevels = 1;
 
-	for (int i=0 ; i<outHeight ; i++, outData+=outWidth)
+	if (bMipMap)
 	{
-		uint32 *inrow = inData + inWidth * (int)((i + 0.25f) * inHeight / outHeight);
-		uint32 *inrow2 = inData + inWidth * (int)((i + 0.75f) * inHeight / outHeight);
-		frac = fracstep >> 1;
-
-		for (int j=0 ; j<outWidth ; j++)
+		while (width > 1 || height > 1)
 		{
-			byte *pix1 = (byte *)inrow + p1[j];
-			byte *pix2 = (byte *)inrow + p2[j];
-			byte *pix3 = (byte *)inrow2 + p1[j];
-			byte *pix4 = (byte *)inrow2 + p2[j];
+			width = max(width>>1, 1);
+			height = max(height>>1, 1);
 
-			((byte *)(outData + j))[0] = (pix1[0] + pix2[0] + pix3[0] + pix4[0]) >> 2;
-			((byte *)(outData + j))[1] = (pix1[1] + pix2[1] + pix3[1] + pix4[1]) >> 2;
-			((byte *)(outData + j))[2] = (pix1[2] + pix2[2] + pix3[2] + pix4[2]) >> 2;
-			((byte *)(outData + j))[3] = (pix1[3] + pix2[3] + pix3[3] + pix4[3]) >> 2;
+			size += width * height * 4;
+			numLevels++;
 		}
 	}
 
-	ri.reg.imagesResampled++;
+	return size;
 }
 
 /*
@@ -1460,8 +2052,9 @@ static void R_UploadCMImage(const char *name, byte **data, const int width, cons
 		glTexParameterf(GL_TEXTURE_CUBE_MAP_ARB, GL_TEXTURE_WRAP_R, GL_CLAMP);
 	}
 
-	// Allocate a buffer
+	// Allocate buffers
 	uint32 *scaledData = (uint32*)R_AllocateTexBuffer(TEXBUF_RESAMPLE, scaledWidth*scaledHeight*4);
+	byte *mipBuffer = bMipMap ? R_AllocateTexBuffer(TEXBUF_MIP, max(scaledWidth>>1, 1)*max(scaledHeight>>1, 1)*4) : NULL;
 
 	// Upload
 	for (int i=0 ; i<6 ; i++)
@@ -1500,9 +2093,12 @@ static void R_UploadCMImage(const char *name, byte **data, const int width, cons
 			int mipLevel = 0;
 			int mipWidth = scaledWidth;
 			int mipHeight = scaledHeight;
+			byte *mipData = (byte *)scaledData;
 			while (mipWidth > 1 || mipHeight > 1)
 			{
-				R_MipmapImage((byte *)scaledData, mipWidth, mipHeight);
+				byte *mipSource = mipData;
+				mipData = (mipSource == mipBuffer) ? (byte *)scaledData : mipBuffer;
+				R_MipmapImage(mipSource, mipData, mipWidth, mipHeight);
 
 				mipWidth >>= 1;
 				if (mipWidth < 1)
@@ -1513,11 +2109,11 @@ static void R_UploadCMImage(const char *name, byte **data, const int width, cons
 					mipHeight = 1;
 
 				if (r_colorMipLevels->intVal)
-					R_ColorMipLevel((byte *)scaledData, mipWidth * mipHeight, mipLevel);
+					R_ColorMipLevel(mipData, mipWidth * mipHeight, mipLevel);
 
 				mipLevel++;
 
-				glTexImage2D(r_cubeTargets[i], mipLevel, internalFormat, mipWidth, mipHeight, 0, sourceFormat, uploadType, scaledData);
+				glTexImage2D(r_cubeTargets[i], mipLevel, internalFormat, mipWidth, mipHeight, 0, sourceFormat, uploadType, mipData);
 			}
 		}
 	}
@@ -1558,6 +2154,14 @@ static void R_Upload2DImage(const char *name, byte *data, const int width, const
 	scaledWidth = clamp(scaledWidth, 1, ri.config.maxTexSize);
 	scaledHeight = clamp(scaledHeight, 1, ri.config.maxTexSize);
 
+	// A cached chain was keyed on the same settings, but go by what it holds
+	const imgCacheChain_t *chain = r_cacheUpload.chain;
+	if (chain)
+	{
+		scaledWidth = chain->upWidth;
+		scaledHeight = chain->upHeight;
+	}
+
 	// Get the image format
 	const GLint internalFormat = R_ImageInternalFormat(name, flags, &samples);
 	const GLint sourceFormat = R_ImageSourceFormat(flags);
@@ -1629,6 +2233,20 @@ static void R_Upload2DImage(const char *name, byte *data, const int width, const
 		// No data passed, so we're simply initializing the texture
 		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, scaledWidth, scaledHeight, 0, sourceFormat, uploadType, NULL);
 	}
+	else if (chain)
+	{
+		// Already processed, upload each level as is
+		int mipWidth = scaledWidth;
+		int mipHeight = scaledHeight;
+		for (int mipLevel=0 ; mipLevel<chain->numLevels ; mipLevel++)
+		{
+			glTexImage2D(GL_TEXTURE_2D, mipLevel, internalFormat, mipWidth, mipHeight, 0, sourceFormat, uploadType, data);
+			data += mipWidth * mipHeight * 4;
+
+			mipWidth = max(mipWidth>>1, 1);
+			mipHeight = max(mipHeight>>1, 1);
+		}
+	}
 	else
 	{
 		// Allocate a buffer
@@ -1660,16 +2278,41 @@ static void R_Upload2DImage(const char *name, byte *data, const int width, const
 		// Upload the base image
 		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, scaledWidth, scaledHeight, 0, sourceFormat, uploadType, scaledData);
 
+		// Keep each level for the image cache as it's uploaded
+		byte *cacheData = NULL;
+		byte *cacheOut = NULL;
+		uint32 cacheLen = 0;
+		if (r_cacheUpload.bStore)
+		{
+			imgCacheChain_t header;
+			header.width = width;
+			header.height = height;
+			header.samples = samples;
+			header.upWidth = scaledWidth;
+			header.upHeight = scaledHeight;
+			cacheLen = sizeof(header) + R_ImageChainSize(scaledWidth, scaledHeight, bMipMap, header.numLevels);
+
+			cacheData = (byte*)Mem_PoolAlloc(cacheLen, ri.imageSysPool, 0);
+			memcpy(cacheData, &header, sizeof(header));
+			memcpy(cacheData + sizeof(header), scaledData, scaledWidth*scaledHeight*4);
+			cacheOut = cacheData + sizeof(header) + scaledWidth*scaledHeight*4;
+		}
+
 		// Upload mipmap levels
 		if (bMipMap)
 		{
+			byte *mipBuffer = R_AllocateTexBuffer(TEXBUF_MIP, max(scaledWidth>>1, 1)*max(scaledHeight>>1, 1)*4);
+
 			int mipLevel = 0;
 			int mipWidth = scaledWidth;
 			int mipHeight = scaledHeight;
+			byte *mipData = (byte *)scaledData;
 
 			while (mipWidth > 1 || mipHeight > 1)
 			{
-				R_MipmapImage((byte *)scaledData, mipWidth, mipHeight);
+				byte *mipSource = mipData;
+				mipData = (mipSource == mipBuffer) ? (byte *)scaledData : mipBuffer;
+				R_MipmapImage(mipSource, mipData, mipWidth, mipHeight);
 
 				mipWidth >>= 1;
 				if (mipWidth < 1)
@@ -1680,13 +2323,25 @@ static void R_Upload2DImage(const char *name, byte *data, const int width, const
 					mipHeight = 1;
 
 				if (r_colorMipLevels->intVal)
-					R_ColorMipLevel((byte *)scaledData, mipWidth * mipHeight, mipLevel);
+					R_ColorMipLevel(mipData, mipWidth * mipHeight, mipLevel);
 
 				mipLevel++;
 
-				glTexImage2D(GL_TEXTURE_2D, mipLevel, internalFormat, mipWidth, mipHeight, 0, sourceFormat, uploadType, scaledData);
+				glTexImage2D(GL_TEXTURE_2D, mipLevel, internalFormat, mipWidth, mipHeight, 0, sourceFormat, uploadType, mipData);
+
+				if (cacheOut)
+				{
+					memcpy(cacheOut, mipData, mipWidth*mipHeight*4);
+					cacheOut += mipWidth*mipHeight*4;
+				}
 			}
 		}
+
+		if (cacheData)
+		{
+			assert(cacheOut == cacheData + cacheLen);
+			R_StoreImageCache(r_cacheUpload.name, r_cacheUpload.key, r_cacheUpload.sourceLen, r_cacheUpload.sourceHash, cacheData, cacheLen);
+		}
 	}
 }
 
@@ -2035,6 +2690,225 @@ static refImage_t *R_FindImage(const char *bareName, const texFlags_t flags)
 	return NULL;
 }
 
+
+#define MAX_PREFETCH_BATCH		64
+#define MAX_PREFETCH_BYTES		(64<<20)
+
+struct imgPrefetch_t
+{
+	char			loadName[MAX_QPATH];
+	byte			*pic;				// NULL if the source is in the image cache
+	size_t			picSize;
+	int				width;
+	int				height;
+	int				samples;
+
+	uint32			sourceLen;			// 0 if the image cache was off
+	uint32			sourceHash;
+};
+
+typedef std::tr1::unordered_map<std::string, imgPrefetch_t*> TPrefetchList;
+static TPrefetchList r_prefetchList;
+static size_t r_prefetchBytes;
+
+struct imgDecodeJob_t
+{
+	imgFile_t			file;
+	const imgFormat_t	*format;
+	imgPrefetch_t		*prefetch;
+	byte				*scratch;
+	bool				bCheckCache;
+	bool				bCached;
+	bool				bDecoded;
+};
+
+static void R_DecodeImageJob(void *arg, int jobNum)
+{
+	imgDecodeJob_t *job = &((imgDecodeJob_t *)arg)[jobNum];
+	imgPrefetch_t *prefetch = job->prefetch;
+
+	// Nothing to decode if the image cache has it
+	if (job->bCheckCache)
+	{
+		prefetch->sourceLen = job->file.fileLen;
+		prefetch->sourceHash = Com_HashBlock(job->file.buffer, job->file.fileLen);
+
+		job->bCached = R_ImageCacheHasSource(prefetch->loadName, prefetch->sourceLen, prefetch->sourceHash);
+		if (job->bCached)
+		{
+			job->bDecoded = false;
+			return;
+		}
+	}
+
+	job->bDecoded = job->format->decode(&job->file, prefetch->pic, job->scratch);
+}
+
+
+/*
+================
+R_FreePrefetch
+================
+*/
+static void R_FreePrefetch(TPrefetchList::iterator it)
+{
+	imgPrefetch_t *prefetch = it->second;
+
+	r_prefetchBytes -= prefetch->picSize;
+	if (prefetch->pic)
+		Mem_Free(prefetch->pic);
+	delete prefetch;
+
+	r_prefetchList.erase(it);
+}
+
+
+/*
+================
+R_ReleasePrefetched
+
+Drops anything that was prefetched but never registered
+================
+*/
+static void R_ReleasePrefetched()
+{
+	while (!r_prefetchList.empty())
+		R_FreePrefetch(r_prefetchList.begin());
+}
+
+
+/*
+================
+R_OpenImageFile
+
+Finds the first of the true color formats R_RegisterImage would load, and
+loads the file and checks its header. Pass the format that failed to decode
+as 'after' to carry on with the next one. The caller frees file->buffer.
+================
+*/
+static const imgFormat_t *R_OpenImageFile(const char *bareName, imgFile_t *file, char *loadName, const imgFormat_t *after = NULL)
+{
+	for (int i=after ? (int)(after - r_imageFormats) + 1 : 0 ; i<IMGFMT_MAX ; i++)
+	{
+		Q_snprintfz(loadName, MAX_QPATH, "%s.%s", bareName, r_imageFormats[i].ext);
+
+		memset(file, 0, sizeof(imgFile_t));
+		file->fileLen = FS_LoadFile(loadName, (void **)&file->buffer, false);
+		if (!file->buffer || file->fileLen <= 0)
+			continue;
+
+		file->name = loadName;
+		if (r_imageFormats[i].header(file))
+			return &r_imageFormats[i];
+
+		FS_FreeFile(file->buffer);
+	}
+
+	return NULL;
+}
+
+
+/*
+================
+R_PrefetchImages
+
+Takes the names that are about to be registered. The files are read and
+checked here, then decoded together on the job threads and held until
+R_RegisterImage asks for them. Anything that can't be prefetched is loaded the
+usual way when it's registered.
+
+Returns how many of the names were taken, which is at least one. The rest
+should be handed back once the ones taken have been registered.
+================
+*/
+int R_PrefetchImages(const char **names, const int numNames)
+{
+	if (numNames <= 0)
+		return 0;
+	if (!r_imageJobs->intVal || Job_NumThreads() < 2)
+		return numNames;
+
+	imgDecodeJob_t jobs[MAX_PREFETCH_BATCH];
+	int numJobs = 0;
+
+	int numTaken;
+	for (numTaken=0 ; numTaken<numNames && numJobs<MAX_PREFETCH_BATCH ; numTaken++)
+	{
+		if (numTaken && r_prefetchBytes >= MAX_PREFETCH_BYTES)
+			break;
+
+		const char *name = names[numTaken];
+		if (!name || !name[0] || strlen(name)+1 >= MAX_QPATH)
+			continue;
+
+		// Skip anything already loaded or on its way
+		const char *bareName = R_BareImageName(name);
+		TImageList::iterator it = imageList.find(bareName);
+		if (it != imageList.end() && it->second->touchFrame)
+			continue;
+		if (r_prefetchList.find(bareName) != r_prefetchList.end())
+			continue;
+
+		imgDecodeJob_t *job = &jobs[numJobs];
+		imgPrefetch_t *prefetch = new imgPrefetch_t;
+		job->format = R_OpenImageFile(bareName, &job->file, prefetch->loadName);
+		if (!job->format)
+		{
+			delete prefetch;
+			continue;
+		}
+
+		job->bCheckCache = R_ImageCacheActive();
+		job->bCached = false;
+		prefetch->sourceLen = 0;
+		prefetch->sourceHash = 0;
+		prefetch->picSize = job->file.outSize;
+		prefetch->pic = (byte*)Mem_PoolAlloc(job->file.outSize, ri.imageSysPool, 0);
+		job->scratch = job->file.scratchSize ? (byte*)Mem_PoolAlloc(job->file.scratchSize, ri.imageSysPool, 0) : NULL;
+		job->prefetch = prefetch;
+
+		r_prefetchList[bareName] = prefetch;
+		r_prefetchBytes += prefetch->picSize;
+		numJobs++;
+	}
+
+	// Decode
+	Job_Run(R_DecodeImageJob, jobs, numJobs);
+
+	for (int i=0 ; i<numJobs ; i++)
+	{
+		imgDecodeJob_t *job = &jobs[i];
+		imgPrefetch_t *prefetch = job->prefetch;
+
+		FS_FreeFile(job->file.buffer);
+		if (job->scratch)
+			Mem_Free(job->scratch);
+
+		if (job->bCached)
+		{
+			// R_RegisterImage takes it from the image cache instead
+			r_prefetchBytes -= prefetch->picSize;
+			Mem_Free(prefetch->pic);
+			prefetch->pic = NULL;
+			prefetch->picSize = 0;
+		}
+		else if (job->bDecoded)
+		{
+			prefetch->width = job->file.width;
+			prefetch->height = job->file.height;
+			prefetch->samples = job->file.samples;
+			ri.reg.imagesPrefetched++;
+		}
+		else
+		{
+			// Left for R_RegisterImage to complain about
+			R_FreePrefetch(r_prefetchList.find(R_BareImageName(prefetch->loadName)));
+		}
+	}
+
+	return numTaken;
+}
+
 int _lastTexNum = 0;
 
 /*
@@ -2196,6 +3070,80 @@ refImage_t *R_CreateImage(const char *name, const char *bareName,
 }
 
 
+/*
+===============
+R_CreateCachedImage
+
+Creates the image from the mip chain in the image cache, if there's one for
+this exact source file and set of flags. sourceLen is 0 when the source wasn't
+hashed.
+===============
+*/
+static refImage_t *R_CreateCachedImage(const char *loadName, const char *bareName, const texFlags_t flags, const uint32 sourceLen, const uint32 sourceHash)
+{
+	if (!sourceLen || !R_ImageCacheActive())
+		return NULL;
+
+	uint32 length;
+	byte *data = R_FindImageCache(loadName, R_ImageCacheKey(flags), sourceLen, sourceHash, length);
+	if (!data)
+		return NULL;
+
+	imgCacheChain_t chain;
+	int numLevels = 0;
+	if (length >= sizeof(chain))
+		memcpy(&chain, data, sizeof(chain));
+	if (length < sizeof(chain)
+	|| chain.width <= 0 || chain.width > MAX_IMAGE_DIMENSION
+	|| chain.height <= 0 || chain.height > MAX_IMAGE_DIMENSION
+	|| chain.upWidth <= 0 || chain.upWidth > ri.config.maxTexSize
+	|| chain.upHeight <= 0 || chain.upHeight > ri.config.maxTexSize
+	|| length != sizeof(chain) + R_ImageChainSize(chain.upWidth, chain.upHeight, !(flags & IF_NOMIPMAP_MASK), numLevels)
+	|| chain.numLevels != numLevels)
+	{
+		Mem_Free(data);
+		return NULL;
+	}
+
+	byte *pic = data + sizeof(chain);
+	r_cacheUpload.chain = &chain;
+	refImage_t *image = R_CreateImage(loadName, bareName, &pic, chain.width, chain.height, 1, flags, chain.samples);
+	r_cacheUpload.chain = NULL;
+
+	Mem_Free(data);
+	ri.reg.imagesCached++;
+	return image;
+}
+
+
+/*
+===============
+R_CreateAndCacheImage
+
+R_CreateImage for a 2D image loaded from disk, storing the processed mip chain
+in the image cache on the way.
+===============
+*/
+static refImage_t *R_CreateAndCacheImage(const char *loadName, const char *bareName, byte **pic, const int width, const int height,
+										const texFlags_t flags, const int samples, const uint32 sourceLen, const uint32 sourceHash,
+										const bool bUpload8 = false)
+{
+	if (sourceLen && R_ImageCacheActive())
+	{
+		r_cacheUpload.name = loadName;
+		r_cacheUpload.key = R_ImageCacheKey(flags);
+		r_cacheUpload.sourceLen = sourceLen;
+		r_cacheUpload.sourceHash = sourceHash;
+		r_cacheUpload.bStore = true;
+	}
+
+	refImage_t *image = R_CreateImage(loadName, bareName, pic, width, height, 1, flags, samples, bUpload8);
+	r_cacheUpload.bStore = false;
+
+	return image;
+}
+
+
 /*
 ===============
 R_RegisterCubeMap
@@ -2347,57 +3295,85 @@ refImage_t *R_RegisterImage(const char *name, texFlags_t flags)
 		return image;
 	}
 
+	// See if it was decoded ahead of time
+	TPrefetchList::iterator prefetched = r_prefetchList.find(bareName);
+	if (prefetched != r_prefetchList.end())
+	{
+		imgPrefetch_t *prefetch = prefetched->second;
+		byte *pic = prefetch->pic;
+
+		if (pic)
+		{
+			image = R_CreateAndCacheImage(prefetch->loadName, bareName, &pic, prefetch->width, prefetch->height, flags, prefetch->samples, prefetch->sourceLen, prefetch->sourceHash);
+			R_FreePrefetch(prefetched);
+			ri.reg.imagesPrefetchUsed++;
+			return image;
+		}
+
+		// The source is in the image cache, this only misses if it was cached with other flags
+		image = R_CreateCachedImage(prefetch->loadName, bareName, flags, prefetch->sourceLen, prefetch->sourceHash);
+		R_FreePrefetch(prefetched);
+		if (image)
+			return image;
+	}
+
 	// Not found -- load the pic from disk
 	char loadName[MAX_QPATH];
-	Q_snprintfz(loadName, sizeof(loadName), "%s.png", bareName);
+	const bool bHashSource = R_ImageCacheActive();
+
+	// PNG, TGA or JPG, falling through to the next one if a file won't decode
+	imgFile_t file;
+	for (const imgFormat_t *format=R_OpenImageFile(bareName, &file, loadName) ; format ; format=R_OpenImageFile(bareName, &file, loadName, format))
+	{
+		const uint32 sourceLen = bHashSource ? file.fileLen : 0;
+		const uint32 sourceHash = bHashSource ? Com_HashBlock(file.buffer, file.fileLen) : 0;
+
+		image = R_CreateCachedImage(loadName, bareName, flags, sourceLen, sourceHash);
+		if (!image)
+		{
+			byte *pic = R_AllocateTexBuffer(TEXBUF_LOADING_0, file.outSize);
+			byte *scratch = file.scratchSize ? R_AllocateTexBuffer(TEXBUF_SCRATCH, file.scratchSize) : NULL;
+			if (format->decode(&file, pic, scratch))
+				image = R_CreateAndCacheImage(loadName, bareName, &pic, file.width, file.height, flags, file.samples, sourceLen, sourceHash);
+			else
+				Com_Printf(PRNT_WARNING, "R_RegisterImage: Bad %s file: %s\n", format->ext, loadName);
+		}
+
+		FS_FreeFile(file.buffer);
+		if (image)
+			return image;
+	}
+
+	Q_snprintfz(loadName, sizeof(loadName), "%s.wal", bareName);
 	const size_t len = strlen(loadName);
 
-	byte *pic;
-	int width, height, samples;
+	byte *pic = NULL;
+	int width, height;
 
-	// PNG
-	R_LoadPNG(loadName, &pic, &width, &height, &samples);
-	if (!pic)
+	// WAL
+	if (!(strcmp (name+len-4, ".wal")))
 	{
-		// TGA
-		loadName[len-3] = 't'; loadName[len-2] = 'g'; loadName[len-1] = 'a';
-		R_LoadTGA(loadName, &pic, &width, &height, &samples);
-		if (!pic)
+		uint32 sourceLen = 0, sourceHash = 0;
+		R_LoadWal(loadName, &pic, &width, &height, bHashSource ? &sourceLen : NULL, bHashSource ? &sourceHash : NULL);
+		if (pic)
 		{
-			// JPG
-			samples = 3;
-			loadName[len-3] = 'j'; loadName[len-2] = 'p'; loadName[len-1] = 'g';
-			R_LoadJPG(loadName, &pic, &width, &height);
-			if (!pic)
-			{
-				// WAL
-				if (!(strcmp (name+len-4, ".wal")))
-				{
-					loadName[len-3] = 'w'; loadName[len-2] = 'a'; loadName[len-1] = 'l';
-					R_LoadWal(loadName, &pic, &width, &height);
-					if (pic)
-					{
-						image = R_CreateImage(loadName, bareName, &pic, width, height, 1, flags, samples, true);
-						return image;
-					}
-					return NULL;
-				}
-
-				// PCX
-				loadName[len-3] = 'p'; loadName[len-2] = 'c'; loadName[len-1] = 'x';
-				R_LoadPCX(loadName, &pic, NULL, &width, &height);
-				if (pic)
-				{
-					image = R_CreateImage(loadName, bareName, &pic, width, height, 1, flags, samples, true, true);
-					return image;
-				}
-				return NULL;
-			}
+			image = R_CreateCachedImage(loadName, bareName, flags, sourceLen, sourceHash);
+			if (!image)
+				image = R_CreateAndCacheImage(loadName, bareName, &pic, width, height, flags, 3, sourceLen, sourceHash, true);
+			return image;
 		}
+		return NULL;
 	}
 
-	// Found it, upload it
-	return R_CreateImage(loadName, bareName, &pic, width, height, 1, flags, samples);
+	// PCX
+	loadName[len-3] = 'p'; loadName[len-2] = 'c'; loadName[len-1] = 'x';
+	R_LoadPCX(loadName, &pic, NULL, &width, &height);
+	if (pic)
+	{
+		image = R_CreateImage(loadName, bareName, &pic, width, height, 1, flags, 3, true, true);
+		return image;
+	}
+	return NULL;
 }
 
 
@@ -2469,7 +3445,13 @@ void R_EndImageRegistration()
 		it = R_FreeImage(it, image);
 	}
 
-	Com_DevPrintf(PRNT_CONSOLE, "Completing image system registration:\n-Released: %i\n-Resampled: %i\n-Touched: %i\n-Seaked: %i\n", ri.reg.imagesReleased, ri.reg.imagesResampled, ri.reg.imagesSeaked, ri.reg.imagesTouched);
+	// Free prefetched images that were never registered
+	R_ReleasePrefetched();
+
+	// Save new mip chains
+	R_ImageCacheFlush();
+
+	Com_DevPrintf(PRNT_CONSOLE, "Completing image system registration:\n-Released: %i\n-Resampled: %i\n-Touched: %i\n-Seaked: %i\n-Prefetched: %i (%i used)\n-Cached: %i\n", ri.reg.imagesReleased, ri.reg.imagesResampled, ri.reg.imagesSeaked, ri.reg.imagesTouched, ri.reg.imagesPrefetched, ri.reg.imagesPrefetchUsed, ri.reg.imagesCached);
 }
 
 
@@ -2869,6 +3851,121 @@ static void R_ScreenShot_f ()
 	Com_Printf (0, "Wrote egl%.3d.%s\n", shotNum, ext);
 }
 
+
+/*
+===============
+R_ImageBench_f
+
+Times the image kernels over synthetic images with and without SSE2, and
+checks that both paths give the same result.
+===============
+*/
+static double R_BenchMS(const uint32 startCycles)
+{
+	return (Sys_Cycles() - startCycles) * Sys_MSPerCycle();
+}
+
+static void R_ImageBench_f()
+{
+	static const int benchSizes[] = { 256, 512, 1024, 2048, 4096 };
+	const int numSizes = sizeof(benchSizes) / sizeof(benchSizes[0]);
+	const int numRuns = (Cmd_Argc() > 1) ? max(atoi(Cmd_Argv(1)), 1) : 5;
+	const int maxSize = (Cmd_Argc() > 2) ? atoi(Cmd_Argv(2)) : 4096;
+
+	const bool bHadSSE2 = ri.bSSE2;
+	if (!bHadSSE2)
+		Com_Printf(0, "SSE2 is not available, both columns are scalar\n");
+
+	Com_Printf(0, "Image kernels, %i runs (ms per image, scalar/SSE2):\n", numRuns);
+	Com_Printf(0, "%5s %15s %15s %15s %7s %7s %6s\n", "size", "resample", "mipmap", "colormip", "linear", "scale", "exact");
+
+	for (int s=0 ; s<numSizes && benchSizes[s]<=maxSize ; s++)
+	{
+		const int size = benchSizes[s];
+		const int numBytes = size * size * 4;
+
+		// Noise, and an upscale from 3/4 size for the resample
+		byte *source = (byte*)Mem_PoolAlloc(numBytes, ri.imageSysPool, 0);
+		byte *out[2];
+		out[0] = (byte*)Mem_PoolAlloc(numBytes, ri.imageSysPool, 0);
+		out[1] = (byte*)Mem_PoolAlloc(numBytes, ri.imageSysPool, 0);
+		uint32 *columns = (uint32*)Mem_PoolAlloc(size * 2 * sizeof(uint32), ri.imageSysPool, 0);
+
+		uint32 seed = 0x1234567 + size;
+		for (int i=0 ; i<numBytes ; i++)
+		{
+			seed = seed * 1664525 + 1013904223;
+			source[i] = (byte)(seed >> 24);
+		}
+
+		const int resampleSize = size * 3 / 4;
+		R_ResampleColumns(resampleSize, size, columns, columns + size);
+
+		double resampleMS[2], mipmapMS[2], colorMS[2];
+		bool bExact = true;
+		for (int sse=0 ; sse<2 ; sse++)
+		{
+			ri.bSSE2 = sse ? bHadSSE2 : false;
+			resampleMS[sse] = mipmapMS[sse] = colorMS[sse] = 0;
+
+			for (int run=0 ; run<numRuns ; run++)
+			{
+				uint32 start = Sys_Cycles();
+				R_ResampleRows((uint32 *)source, resampleSize, resampleSize, (uint32 *)out[sse], size, size, columns, columns + size, 0, size);
+				resampleMS[sse] += R_BenchMS(start);
+			}
+			if (sse)
+				bExact &= !memcmp(out[0], out[1], numBytes);
+
+			for (int run=0 ; run<numRuns ; run++)
+			{
+				uint32 start = Sys_Cycles();
+				R_MipmapRows(source, out[sse], size, 0, size >> 1);
+				mipmapMS[sse] += R_BenchMS(start);
+			}
+			if (sse)
+				bExact &= !memcmp(out[0], out[1], numBytes >> 2);
+
+			for (int run=0 ; run<numRuns ; run++)
+			{
+				memcpy(out[sse], source, numBytes);
+				uint32 start = Sys_Cycles();
+				R_ColorMipLevel(out[sse], size * size, 2);
+				colorMS[sse] += R_BenchMS(start);
+			}
+			if (sse)
+				bExact &= !memcmp(out[0], out[1], numBytes);
+		}
+		ri.bSSE2 = bHadSSE2;
+
+		// Table driven, so scalar only
+		double linearMS = 0, scaleMS = 0;
+		for (int run=0 ; run<numRuns ; run++)
+		{
+			uint32 start = Sys_Cycles();
+			R_MipmapRowsLinear(source, out[0], size, 0, size >> 1);
+			linearMS += R_BenchMS(start);
+
+			memcpy(out[0], source, numBytes);
+			start = Sys_Cycles();
+			R_LightScalePixels(out[0], size * size, true, true);
+			scaleMS += R_BenchMS(start);
+		}
+
+		Com_Printf(0, "%5i %7.2f/%-7.2f %7.2f/%-7.2f %7.2f/%-7.2f %7.2f %7.2f %6s\n", size,
+			resampleMS[0] / numRuns, resampleMS[1] / numRuns,
+			mipmapMS[0] / numRuns, mipmapMS[1] / numRuns,
+			colorMS[0] / numRuns, colorMS[1] / numRuns,
+			linearMS / numRuns, scaleMS / numRuns,
+			bExact ? "yes" : "NO");
+
+		Mem_Free(columns);
+		Mem_Free(out[1]);
+		Mem_Free(out[0]);
+		Mem_Free(source);
+	}
+}
+
 /*
 ==============================================================================
 
@@ -2879,6 +3976,7 @@ static void R_ScreenShot_f ()
 
 static conCmd_t	*cmd_imageList;
 static conCmd_t	*cmd_screenShot;
+static conCmd_t	*cmd_imageBench;
 
 /*
 ==================
@@ -3110,6 +4208,7 @@ void R_ImageInit()
 	// Registration
 	cmd_imageList	= Cmd_AddCommand("imagelist",	0, R_ImageList_f,			"Prints out a list of the currently loaded textures");
 	cmd_screenShot	= Cmd_AddCommand("screenshot",	0, R_ScreenShot_f,			"Takes a screenshot");
+	cmd_imageBench	= Cmd_AddCommand("r_imagebench",	0, R_ImageBench_f,		"Times the image processing kernels and checks the SSE2 ones against scalar");
 
 	// Set the initial state
 	GL_TextureMode(true, false);
@@ -3141,6 +4240,7 @@ void R_ImageInit()
 
 	// Set up the gamma and intensity ramps
 	Com_DevPrintf(0, "Creating software gamma and intensity ramps\n");
+	R_InitLinearTables();
 	if (intensity->floatVal < 1)
 		Cvar_VariableSetValue(intensity, 1, true);
 	ri.inverseIntensity = 1.0f / intensity->floatVal;
@@ -3183,7 +4283,7 @@ void R_ImageInit()
 
 	// Get gamma ramp
 	Com_DevPrintf(0, "Downloading desktop gamma ramp\n");
-	ri.bRampDownloaded = GLimp_GetGammaRamp(ri.originalRamp);
+	ri.bRampDownloaded = !ri.bNullBackend && GLimp_GetGammaRamp(ri.originalRamp);
 	if (ri.bRampDownloaded)
 	{
 		Com_DevPrintf(0, "...GLimp_GetGammaRamp succeeded\n");
@@ -3205,6 +4305,9 @@ void R_ImageInit()
 	else
 		Com_Printf(0, "...using software gamma\n");
 
+	// Open the processed mip chain cache
+	R_ImageCacheInit();
+
 	// Load up special textures
 	Com_DevPrintf(0, "Generating internal textures\n");
 	R_InitSpecialTextures();
@@ -3236,6 +4339,7 @@ void R_ImageShutdown()
 	// Unregister commands
 	Cmd_RemoveCommand(cmd_imageList);
 	Cmd_RemoveCommand(cmd_screenShot);
+	Cmd_RemoveCommand(cmd_imageBench);
 
 	// Free loaded textures
 	for (auto it = imageList.begin(); it != imageList.end(); ++it)
@@ -3271,6 +4375,8 @@ void R_ImageShutdown()
 	memset(ri.media.shadowTextures, 0, sizeof(refImage_t*) * MAX_SHADOW_GROUPS);
 
 	// Free memory
+	R_ReleasePrefetched();
+	R_ImageCacheShutdown();
 	R_ReleaseTexBuffers();
 
 	uint32 size = Mem_FreePool(ri.imageSysPool);
@@ -122,6 +122,7 @@ refImage_t *R_CreateImage(const char *name, const char *bareName,
 
 #define R_TouchImage(img) ((img)->touchFrame = ri.reg.registerFrame, ri.reg.imagesTouched++)
 
+int R_PrefetchImages(const char **names, const int numNames);
 refImage_t *R_RegisterImage(const char *name, texFlags_t flags);
 
 void R_InitScreenTexture(refImage_t **Image, const char *Name, const int ID, const int ScreenWidth, const int ScreenHeight, const texFlags_t TexFlags, const int Samples);
@@ -134,3 +135,15 @@ void R_UpdateGammaRamp();
 
 void R_ImageInit();
 void R_ImageShutdown();
+
+//
+// rf_imageCache.cpp
+//
+
+bool R_ImageCacheHasSource(const char *name, const uint32 sourceLen, const uint32 sourceHash);
+byte *R_FindImageCache(const char *name, const uint32 key, const uint32 sourceLen, const uint32 sourceHash, uint32 &outLength);
+void R_StoreImageCache(const char *name, const uint32 key, const uint32 sourceLen, const uint32 sourceHash, byte *data, const uint32 length);
+
+void R_ImageCacheInit();
+void R_ImageCacheFlush();
+void R_ImageCacheShutdown();
@@ -0,0 +1,207 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+//
+// rf_imageCache.cpp
+// Processed texture mip chains kept between runs
+//
+
+#include "rf_local.h"
+
+// A disk cache (see common.h), which can run to hundreds of megabytes. It's
+// the one cache with a budget, r_imageCacheSize, and with deflated payloads,
+// r_imageCacheCompress.
+
+#define IMAGECACHE_FILE			"imagecache.pca"
+#define IMAGECACHE_TEMP			"imagecache.tmp"
+#define IMAGECACHE_MAGIC		(('C'<<24)+('G'<<16)+('M'<<8)+'I')
+#define IMAGECACHE_VERSION		2
+
+#define MAX_IMGCACHE_ENTRIES	8192
+#define MAX_IMGCACHE_PAYLOAD	(64<<20)		// Largest single entry
+#define MAX_IMGCACHE_PENDING	(32<<20)		// Held in memory before being written out early
+
+static diskCache_t		r_imgCache;
+
+static conCmd_t			*cmd_imageCacheStats;
+static conCmd_t			*cmd_imageCacheCompact;
+
+/*
+=================
+R_ImageCacheSettings
+
+Picks up r_imageCacheSize and r_imageCacheCompress before anything is written.
+=================
+*/
+static void R_ImageCacheSettings()
+{
+	r_imgCache.budget = (uint32)clamp(r_imageCacheSize->intVal, 16, 1024) << 20;
+	r_imgCache.bCompress = (r_imageCacheCompress->intVal != 0);
+}
+
+
+/*
+=================
+R_ImageCacheHasSource
+
+True if any entry was made from this exact source file, whatever its key.
+Safe to call from a job.
+=================
+*/
+bool R_ImageCacheHasSource(const char *name, const uint32 sourceLen, const uint32 sourceHash)
+{
+	return DiskCache_HasSource(&r_imgCache, name, sourceLen, sourceHash);
+}
+
+
+/*
+=================
+R_FindImageCache
+
+Returns a copy of the payload stored for this image file and key, allocated
+from ri.imageSysPool, or NULL if there isn't one or the file has changed since.
+=================
+*/
+byte *R_FindImageCache(const char *name, const uint32 key, const uint32 sourceLen, const uint32 sourceHash, uint32 &outLength)
+{
+	diskCacheEntry_t *entry = DiskCache_Find(&r_imgCache, name, key, sourceLen, sourceHash);
+	if (!entry)
+		return NULL;
+
+	byte *data = (byte *)Mem_PoolAlloc(entry->rawLen, ri.imageSysPool, 0);
+	if (!DiskCache_Read(&r_imgCache, entry, data))
+	{
+		Mem_Free(data);
+		return NULL;
+	}
+
+	outLength = entry->rawLen;
+	return data;
+}
+
+
+/*
+=================
+R_StoreImageCache
+
+Takes ownership of data, which must be allocated from ri.imageSysPool.
+=================
+*/
+void R_StoreImageCache(const char *name, const uint32 key, const uint32 sourceLen, const uint32 sourceHash, byte *data, const uint32 length)
+{
+	R_ImageCacheSettings();
+	DiskCache_Store(&r_imgCache, name, key, sourceLen, sourceHash, data, length);
+}
+
+/*
+=============================================================================
+
+	CONSOLE COMMANDS
+
+=============================================================================
+*/
+
+/*
+=================
+R_ImageCacheStats_f
+=================
+*/
+static void R_ImageCacheStats_f()
+{
+	DiskCache_PrintStats(&r_imgCache, "Image cache");
+}
+
+
+/*
+=================
+R_ImageCacheCompact_f
+
+Drops entries for images that no longer exist, evicts down to the budget and
+rewrites the file.
+=================
+*/
+static void R_ImageCacheCompact_f()
+{
+	R_ImageCacheSettings();
+
+	uint32 numEvicted, numMissing;
+	DiskCache_Compact(&r_imgCache, true, numEvicted, numMissing);
+
+	Com_Printf(0, "Image cache compacted, removed %u missing and evicted %u, %u left\n", numMissing, numEvicted, r_imgCache.numEntries);
+}
+
+/*
+=============================================================================
+
+	INIT / SHUTDOWN
+
+=============================================================================
+*/
+
+/*
+=================
+R_ImageCacheInit
+=================
+*/
+void R_ImageCacheInit()
+{
+	r_imgCache.fileName = IMAGECACHE_FILE;
+	r_imgCache.tempName = IMAGECACHE_TEMP;
+	r_imgCache.magic = IMAGECACHE_MAGIC;
+	r_imgCache.version = IMAGECACHE_VERSION;
+	r_imgCache.setupKey = 0;
+	r_imgCache.maxEntries = MAX_IMGCACHE_ENTRIES;
+	r_imgCache.maxPayload = MAX_IMGCACHE_PAYLOAD;
+	r_imgCache.maxPending = MAX_IMGCACHE_PENDING;
+	r_imgCache.pool = ri.imageSysPool;
+	R_ImageCacheSettings();
+	DiskCache_Open(&r_imgCache);
+
+	cmd_imageCacheStats = Cmd_AddCommand("imagecache_stats", 0, R_ImageCacheStats_f, "Prints image cache usage and hit rate");
+	cmd_imageCacheCompact = Cmd_AddCommand("imagecache_compact", 0, R_ImageCacheCompact_f, "Removes stale entries from the image cache file");
+}
+
+
+/*
+=================
+R_ImageCacheFlush
+
+Saves anything new, called at the end of registration.
+=================
+*/
+void R_ImageCacheFlush()
+{
+	R_ImageCacheSettings();
+	DiskCache_Write(&r_imgCache);
+}
+
+
+/*
+=================
+R_ImageCacheShutdown
+=================
+*/
+void R_ImageCacheShutdown()
+{
+	Cmd_RemoveCommand(cmd_imageCacheStats);
+	Cmd_RemoveCommand(cmd_imageCacheCompact);
+
+	R_ImageCacheSettings();
+	DiskCache_Close(&r_imgCache);
+}
@@ -48,6 +48,26 @@ void R_MediaInit()
 }
 
 
+/*
+===============
+R_DetectCPU
+===============
+*/
+static void R_DetectCPU()
+{
+#ifdef R_SSE2
+	ri.bSSE2 = Sys_HasSSE2();
+#else
+	ri.bSSE2 = false;
+#endif
+
+	if (ri.bSSE2)
+		Com_Printf(0, "...using SSE2 kernels\n");
+	else
+		Com_Printf(0, "...SSE2 not available\n");
+}
+
+
 /*
 ===============
 R_InitRefresh
@@ -84,6 +104,8 @@ bool R_InitRefresh()
 
 	Com_Printf (0, "\n=========== Refresh Frontend ===========\n");
 
+	R_DetectCPU();
+
 	// Map overbrights
 	ri.pow2MapOvrbr = r_lmModulate->intVal;
 	if (ri.pow2MapOvrbr > 0)
@@ -99,6 +121,7 @@ bool R_InitRefresh()
 	R_FontInit();
 	R_MediaInit();
 	R_ModelInit();
+	R_AliasInit();
 	R_EntityInit();
 	R_WorldInit();
 	R_PolyInit();
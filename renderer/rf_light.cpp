@@ -481,15 +481,94 @@ static byte		*r_q2_lmBuffer;
 static bool		r_q2_lmBufferDirty;
 static int		r_q2_lmNumUploaded;
 static int		*r_q2_lmAllocated;
+static bool		r_q2_lmKeepBlocks;
+static byte		*r_q2_lmKept;			// Copy of every uploaded block, for the map's surface cache
 int				r_q2_lmBlockSize;
 
+/*
+===============
+R_Q2BSP_LightRowScale
+
+Falloff of one light along a row of lightmap texels, for columns firstS to
+lastS. The SSE2 path writes up to three floats past lastS.
+===============
+*/
+static void R_Q2BSP_LightRowScale(const float sl, const float td, const float fRad, const int firstS, const int lastS, float *out)
+{
+	int s = firstS;
+
+#ifdef R_SSE2
+	if (ri.bSSE2)
+	{
+		const __m128 vSl = _mm_set1_ps(sl);
+		const __m128 vTd = _mm_set1_ps(td);
+		const __m128 vRad = _mm_set1_ps(fRad);
+		const __m128 vHalf = _mm_set1_ps(0.5f);
+		const __m128 vZero = _mm_setzero_ps();
+		const __m128 vAbs = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+		const __m128 vStep = _mm_set1_ps(64.0f);
+
+		__m128 vS = _mm_setr_ps(s*16.0f, s*16.0f + 16.0f, s*16.0f + 32.0f, s*16.0f + 48.0f);
+		for ( ; s<=lastS ; s+=4, out+=4)
+		{
+			const __m128 sd = _mm_and_ps(_mm_sub_ps(vSl, vS), vAbs);
+			const __m128 hi = _mm_max_ps(sd, vTd);
+			const __m128 lo = _mm_min_ps(sd, vTd);
+
+			// Same as below, the center term is only non-zero where the outer one is
+			const __m128 vOuter = _mm_max_ps(_mm_sub_ps(vRad, _mm_add_ps(hi, _mm_mul_ps(lo, vHalf))), vZero);
+			const __m128 vCenter = _mm_max_ps(_mm_sub_ps(vRad, _mm_add_ps(hi, _mm_add_ps(lo, lo))), vZero);
+			_mm_storeu_ps(out, _mm_add_ps(vOuter, _mm_mul_ps(vCenter, vHalf)));
+
+			vS = _mm_add_ps(vS, vStep);
+		}
+		return;
+	}
+#endif // R_SSE2
+
+	for ( ; s<=lastS ; s++)
+	{
+		const float sd = fabsf(sl - s*16);
+
+		float fDist, fDist2;
+		if (sd > td)
+		{
+			fDist = sd + (td * 0.5f);
+			fDist2 = sd + (td * 2.0f);
+		}
+		else
+		{
+			fDist = td + (sd * 0.5f);
+			fDist2 = td + (sd * 2.0f);
+		}
+
+		float scale = 0.0f;
+		if (fDist < fRad)
+		{
+			scale = fRad - fDist;
+
+			// Amplify the center a little
+			if (fDist2 < fRad)
+				scale += (fRad - fDist2) * 0.5f;
+		}
+
+		*out++ = scale;
+	}
+}
+
+
 /*
 ===============
 R_Q2BSP_AddDynamicLights
+
+Only called from R_Q2BSP_BuildLightMap, which can run on the job threads.
 ===============
 */
 static void R_Q2BSP_AddDynamicLights(refEntity_t *ent, mBspSurface_t *surf, float *blockLights)
 {
+	float rowScale[Q2LMBLOCKSIZE+4];
+
+	const bool bRotated = !Matrix3_Compare(ent->axis, axisIdentity);
 	for (uint32 num=0 ; num<ri.scn.numDLights ; num++)
 	{
 		if (ri.scn.dLightCullBits & BIT(num))
@@ -500,7 +579,7 @@ static void R_Q2BSP_AddDynamicLights(refEntity_t *ent, mBspSurface_t *surf, floa
 			continue;	// Not lit by this light
 
 		vec3_t origin;
-		if (!Matrix3_Compare(ent->axis, axisIdentity))
+		if (bRotated)
 		{
 			vec3_t tmp;
 			Vec3Subtract(lt->origin, ent->origin, tmp);
@@ -511,7 +590,7 @@ static void R_Q2BSP_AddDynamicLights(refEntity_t *ent, mBspSurface_t *surf, floa
 			Vec3Subtract(lt->origin, ent->origin, origin);
 		}
 
-		float fDist = PlaneDiff(origin, surf->q2_plane);
+		const float fDist = PlaneDiff(origin, surf->q2_plane);
 		const float fRad = lt->intensity - fabsf(fDist); // fRad is now the highest intensity on the plane
 		if (fRad < 0)
 			continue;
@@ -521,59 +600,29 @@ static void R_Q2BSP_AddDynamicLights(refEntity_t *ent, mBspSurface_t *surf, floa
 		impact[1] = origin[1] - (surf->q2_plane->normal[1] * fDist);
 		impact[2] = origin[2] - (surf->q2_plane->normal[2] * fDist);
 
-		float sl = DotProduct(impact, surf->q2_texInfo->vecs[0]) + surf->q2_texInfo->vecs[0][3] - surf->q2_textureMins[0];
-		float st = DotProduct(impact, surf->q2_texInfo->vecs[1]) + surf->q2_texInfo->vecs[1][3] - surf->q2_textureMins[1];
+		const float sl = DotProduct(impact, surf->q2_texInfo->vecs[0]) + surf->q2_texInfo->vecs[0][3] - surf->q2_textureMins[0];
+		const float st = DotProduct(impact, surf->q2_texInfo->vecs[1]) + surf->q2_texInfo->vecs[1][3] - surf->q2_textureMins[1];
 
-		float *bl = blockLights;
-		float ftacc = 0.0f;
-		for (int t=0 ; t<surf->q2_lmHeight ; t++)
+		// Texels further than fRad from the impact on either axis get nothing
+		const int firstS = max(0, (int)ceilf((sl - fRad) / 16));
+		const int lastS = min(surf->q2_lmWidth-1, (int)floorf((sl + fRad) / 16));
+		const int firstT = max(0, (int)ceilf((st - fRad) / 16));
+		const int lastT = min(surf->q2_lmHeight-1, (int)floorf((st + fRad) / 16));
+		if (firstS > lastS || firstT > lastT)
+			continue;
+
+		for (int t=firstT ; t<=lastT ; t++)
 		{
-			float td = st - ftacc;
-			if (td < 0)
-				td = -td;
+			R_Q2BSP_LightRowScale(sl, fabsf(st - t*16), fRad, firstS, lastS, rowScale);
 
-			float fsacc = 0.0f;
-			for (int s=0 ; s<surf->q2_lmWidth ; s++)
+			float *bl = blockLights + (t*surf->q2_lmWidth + firstS)*3;
+			for (int s=0 ; s<=lastS-firstS ; s++, bl+=3)
 			{
-				float sd = sl - fsacc;
-				if (sd < 0)
-					sd = -sd;
-
-				float fDist2;
-				if (sd > td)
-				{
-					fDist = sd + (td * 0.5f);
-					fDist2 = sd + (td * 2.0f);
-				}
-				else
-				{
-					fDist = td + (sd * 0.5f);
-					fDist2 = td + (sd * 2.0f);
-				}
-
-				if (fDist < fRad)
-				{
-					float scale = fRad - fDist;
-
-					bl[0] += lt->color[0] * scale;
-					bl[1] += lt->color[1] * scale;
-					bl[2] += lt->color[2] * scale;
-
-					// Amplify the center a little
-					if (fDist2 < fRad)
-					{
-						scale = fRad - fDist2;
-						bl[0] += lt->color[0] * scale * 0.5f;
-						bl[1] += lt->color[1] * scale * 0.5f;
-						bl[2] += lt->color[2] * scale * 0.5f;
-					}
-				}
-
-				fsacc += 16;
-				bl += 3;
+				const float scale = rowScale[s];
+				bl[0] += lt->color[0] * scale;
+				bl[1] += lt->color[1] * scale;
+				bl[2] += lt->color[2] * scale;
 			}
-
-			ftacc += 16;
 		}
 	}
 }
@@ -714,24 +763,27 @@ static void R_Q2BSP_SetLMCacheState (mBspSurface_t *surf)
 
 /*
 =======================
-R_Q2BSP_UpdateLightmap
+R_Q2BSP_LightmapNeedsUpdate
+
+Decides if a surface's lightmap has to be rebuilt this frame, and marks it
+so it's only looked at once.
 =======================
 */
-void R_Q2BSP_UpdateLightmap(refEntity_t *ent, mBspSurface_t *surf)
+static bool R_Q2BSP_LightmapNeedsUpdate(mBspSurface_t *surf, bool &bUpdateCache)
 {
 	// Don't update twice a frame
 	if (surf->q2_dLightUpdateFrame == ri.frameCount)
-		return;
+		return false;
 	surf->q2_dLightUpdateFrame = ri.frameCount;
 
 	// Is this surface allowed to have a lightmap?
 	if (surf->q2_texInfo->flags & (SURF_TEXINFO_SKY|SURF_TEXINFO_WARP))
-		return;
+		return false;
 	if (surf->lmTexNum == BAD_LMTEXNUM)
-		return;
+		return false;
 
 	bool bDynamic = false;
-	bool bUpdateCache = false;
+	bUpdateCache = false;
 
 	// Dynamic this frame or dynamic previously
 	if (gl_dynamic->intVal)
@@ -763,28 +815,195 @@ void R_Q2BSP_UpdateLightmap(refEntity_t *ent, mBspSurface_t *surf)
 		bDynamic = true;
 	}
 
-	if (bDynamic)
+	return bDynamic;
+}
+
+
+/*
+=======================
+R_Q2BSP_UploadSurfaceLightmap
+
+Replaces just the surface's rectangle of its lightmap block.
+=======================
+*/
+static void R_Q2BSP_UploadSurfaceLightmap(mBspSurface_t *surf, const uint32 *texels)
+{
+	RB_BindTexture(ri.media.lmTextures[surf->lmTexNum]);
+
+	glTexSubImage2D(GL_TEXTURE_2D, 0,
+					surf->q2_lmCoords[0], surf->q2_lmCoords[1],
+					surf->q2_lmWidth, surf->q2_lmHeight,
+					GL_RGBA,
+					GL_UNSIGNED_BYTE,
+					texels);
+}
+
+
+/*
+=======================
+R_Q2BSP_UpdateLightmap
+
+Surfaces are normally rebuilt up front by R_Q2BSP_UpdateLightmaps, this
+catches anything that didn't fit in that pass.
+=======================
+*/
+void R_Q2BSP_UpdateLightmap(refEntity_t *ent, mBspSurface_t *surf)
+{
+	bool bUpdateCache;
+	if (!R_Q2BSP_LightmapNeedsUpdate(surf, bUpdateCache))
+		return;
+
+	static uint32 scratch[Q2LMBLOCKSIZE*Q2LMBLOCKSIZE];
+
+	// Update texture
+	R_Q2BSP_BuildLightMap(ent, surf, (byte *)scratch, surf->q2_lmWidth*4);
+	if (bUpdateCache)
+		R_Q2BSP_SetLMCacheState(surf);
+
+	R_Q2BSP_UploadSurfaceLightmap(surf, scratch);
+
+	RB_CheckForError("R_Q2BSP_UpdateLightmap");
+}
+
+// ============================================================================
+
+#define MAX_LM_UPDATES			1024
+#define MAX_LM_UPDATE_TEXELS	(256*1024)
+
+struct q2LMUpdate_t
+{
+	refEntity_t			*ent;
+	mBspSurface_t		*surf;
+	uint32				texelOfs;
+	bool				bUpdateCache;
+};
+
+struct q2LMUpdateJob_t
+{
+	int					numUpdates;
+	int					numJobs;
+};
+
+static q2LMUpdate_t		r_q2_lmUpdates[MAX_LM_UPDATES];
+static uint32			r_q2_lmUpdateTexels[MAX_LM_UPDATE_TEXELS];
+
+/*
+=======================
+R_Q2BSP_GatherLightmapUpdates
+
+Returns false once there's no more room, the rest are left for
+R_Q2BSP_UpdateLightmap to pick up as they're drawn.
+=======================
+*/
+static bool R_Q2BSP_GatherLightmapUpdates(TList<refMeshBuffer> &meshes, int &numUpdates, uint32 &numTexels)
+{
+	for (uint32 i=0 ; i<meshes.Count() ; i++)
 	{
-		static uint32 scratch[Q2LMBLOCKSIZE*Q2LMBLOCKSIZE];
+		refMeshBuffer *mb = &meshes[i];
+		if (mb->DecodeMeshType() != MBT_Q2BSP)
+			continue;
 
-		// Update texture
-		R_Q2BSP_BuildLightMap(ent, surf, (byte *)scratch, surf->q2_lmWidth*4);
-		if (bUpdateCache)
-		{
-			R_Q2BSP_SetLMCacheState(surf);
-		}
+		mBspSurface_t *surf = (mBspSurface_t *)mb->mesh;
+		if (surf->q2_dLightUpdateFrame == ri.frameCount)
+			continue;
+
+		const uint32 size = surf->q2_lmWidth * surf->q2_lmHeight;
+		if (numUpdates == MAX_LM_UPDATES || numTexels + size > MAX_LM_UPDATE_TEXELS)
+			return false;
 
-		RB_BindTexture(ri.media.lmTextures[surf->lmTexNum]);
+		bool bUpdateCache;
+		if (!R_Q2BSP_LightmapNeedsUpdate(surf, bUpdateCache))
+			continue;
 
-		glTexSubImage2D(GL_TEXTURE_2D, 0,
-						surf->q2_lmCoords[0], surf->q2_lmCoords[1],
-						surf->q2_lmWidth, surf->q2_lmHeight,
-						GL_RGBA,
-						GL_UNSIGNED_BYTE,
-						scratch);
+		q2LMUpdate_t *update = &r_q2_lmUpdates[numUpdates++];
+		update->ent = mb->DecodeEntity();
+		update->surf = surf;
+		update->texelOfs = numTexels;
+		update->bUpdateCache = bUpdateCache;
+
+		numTexels += size;
 	}
 
-	RB_CheckForError("R_Q2BSP_UpdateLightmap");
+	return true;
+}
+
+
+/*
+=======================
+R_Q2BSP_LightmapJob
+=======================
+*/
+static void R_Q2BSP_LightmapJob(void *arg, const int jobNum)
+{
+	const q2LMUpdateJob_t *job = (const q2LMUpdateJob_t *)arg;
+
+	// Interleaved so lots of lights on one wall still get split up
+	for (int i=jobNum ; i<job->numUpdates ; i+=job->numJobs)
+	{
+		const q2LMUpdate_t *update = &r_q2_lmUpdates[i];
+		R_Q2BSP_BuildLightMap(update->ent, update->surf, (byte *)(r_q2_lmUpdateTexels + update->texelOfs), update->surf->q2_lmWidth*4);
+	}
+}
+
+
+/*
+=======================
+R_Q2BSP_LMUpdateSortCmp
+=======================
+*/
+static int R_Q2BSP_LMUpdateSortCmp(const void *a, const void *b)
+{
+	return ((const q2LMUpdate_t *)a)->surf->lmTexNum - ((const q2LMUpdate_t *)b)->surf->lmTexNum;
+}
+
+
+/*
+=======================
+R_Q2BSP_UpdateLightmaps
+
+Rebuilds every dynamic lightmap in the list before it's drawn. The texels are
+built on the job threads, then uploaded a block at a time so each block is
+only bound once.
+=======================
+*/
+void R_Q2BSP_UpdateLightmaps(refMeshList *list)
+{
+	if (!ri.scn.worldModel || ri.scn.worldModel->type != MODEL_Q2BSP)
+		return;
+
+	qStatCycle_Scope Stat(r_times, ri.pc.timeLightmaps);
+
+	int numUpdates = 0;
+	uint32 numTexels = 0;
+	if (R_Q2BSP_GatherLightmapUpdates(list->meshBufferOpaque, numUpdates, numTexels)
+	&& R_Q2BSP_GatherLightmapUpdates(list->meshBufferAdditive, numUpdates, numTexels))
+		R_Q2BSP_GatherLightmapUpdates(list->meshBufferPostProcess, numUpdates, numTexels);
+	if (!numUpdates)
+		return;
+
+	q2LMUpdateJob_t job;
+	job.numUpdates = numUpdates;
+	job.numJobs = 1;
+	if (r_lightmapJobs->intVal && numUpdates > 1)
+		job.numJobs = min(numUpdates, Job_NumThreads());
+
+	if (job.numJobs > 1)
+		Job_Run(R_Q2BSP_LightmapJob, &job, job.numJobs);
+	else
+		R_Q2BSP_LightmapJob(&job, 0);
+
+	qsort(r_q2_lmUpdates, numUpdates, sizeof(q2LMUpdate_t), R_Q2BSP_LMUpdateSortCmp);
+	for (int i=0 ; i<numUpdates ; i++)
+	{
+		const q2LMUpdate_t *update = &r_q2_lmUpdates[i];
+		if (update->bUpdateCache)
+			R_Q2BSP_SetLMCacheState(update->surf);
+
+		R_Q2BSP_UploadSurfaceLightmap(update->surf, r_q2_lmUpdateTexels + update->texelOfs);
+	}
+
+	ri.pc.lightmapUpdates += numUpdates;
+	RB_CheckForError("R_Q2BSP_UpdateLightmaps");
 }
 
 
@@ -804,6 +1023,19 @@ static void R_Q2BSP_UploadLMBlock()
 		return;
 	}
 
+	if (r_q2_lmKeepBlocks)
+	{
+		const int blockBytes = r_q2_lmBlockSize*r_q2_lmBlockSize*4;
+		byte *kept = (byte*)Mem_PoolAlloc(blockBytes * (r_q2_lmNumUploaded+1), ri.lightSysPool, 0);
+		if (r_q2_lmKept)
+		{
+			memcpy (kept, r_q2_lmKept, blockBytes * r_q2_lmNumUploaded);
+			Mem_Free(r_q2_lmKept);
+		}
+		memcpy (kept + blockBytes * r_q2_lmNumUploaded, r_q2_lmBuffer, blockBytes);
+		r_q2_lmKept = kept;
+	}
+
 	ri.media.lmTextures[r_q2_lmNumUploaded++] = R_Create2DImage(Q_VarArgs ("*lm%i", r_q2_lmNumUploaded), (byte **)(&r_q2_lmBuffer),
 		r_q2_lmBlockSize, r_q2_lmBlockSize, IF_NOPICMIP|IF_NOMIPMAP_LINEAR|IF_NOGAMMA|IF_NOINTENS|IF_NOCOMPRESS|IT_LIGHTMAP, 3);
 
@@ -855,32 +1087,59 @@ static bool R_Q2BSP_AllocLMBlock(const int Width, const int Height, int *x, int
 }
 
 
+/*
+==================
+R_Q2BSP_ResetLightStyles
+==================
+*/
+static void R_Q2BSP_ResetLightStyles()
+{
+	for (int i=0 ; i<MAX_CS_LIGHTSTYLES ; i++)
+	{
+		Vec3Set (ri.scn.lightStyles[i].rgb, 1, 1, 1);
+		ri.scn.lightStyles[i].white = 3;
+	}
+}
+
+
+/*
+==================
+R_Q2BSP_LightmapBlockSize
+==================
+*/
+int R_Q2BSP_LightmapBlockSize()
+{
+	int size;
+	for (size=1 ; size<Q2LMBLOCKSIZE && size<ri.config.maxTexSize ; size<<=1);
+	return size;
+}
+
+
 /*
 ==================
 R_Q2BSP_BeginBuildingLightmaps
+
+With bKeepBlocks, R_Q2BSP_EndBuildingLightmaps hands back a copy of every
+block so they can be cached.
 ==================
 */
-void R_Q2BSP_BeginBuildingLightmaps()
+void R_Q2BSP_BeginBuildingLightmaps(const bool bKeepBlocks)
 {
 	// Should be no lightmaps at this point
 	r_q2_lmNumUploaded = 0;
 
 	// Find the maximum size
-	int size;
-	for (size=1 ; size<Q2LMBLOCKSIZE && size<ri.config.maxTexSize ; size<<=1);
-	r_q2_lmBlockSize = size;
+	r_q2_lmBlockSize = R_Q2BSP_LightmapBlockSize();
 
 	// Allocate buffers and clear values
 	r_q2_lmAllocated = (int*)Mem_PoolAlloc(sizeof(int) * r_q2_lmBlockSize, ri.lightSysPool, 0);
 	r_q2_lmBuffer = (byte*)Mem_PoolAlloc(r_q2_lmBlockSize*r_q2_lmBlockSize*4, ri.lightSysPool, 0);
 	memset (r_q2_lmBuffer, 255, r_q2_lmBlockSize*r_q2_lmBlockSize*4);
+	r_q2_lmKeepBlocks = bKeepBlocks;
+	r_q2_lmKept = NULL;
 
 	// Setup the base light styles
-	for (int i=0 ; i<MAX_CS_LIGHTSTYLES ; i++)
-	{
-		Vec3Set (ri.scn.lightStyles[i].rgb, 1, 1, 1);
-		ri.scn.lightStyles[i].white = 3;
-	}
+	R_Q2BSP_ResetLightStyles();
 }
 
 
@@ -919,9 +1178,12 @@ void R_Q2BSP_CreateSurfaceLightmap(mBspSurface_t *surf)
 /*
 =======================
 R_Q2BSP_EndBuildingLightmaps
+
+Returns the number of blocks uploaded. If they were kept, outBlocks gets them
+back to back, and the caller frees them.
 =======================
 */
-void R_Q2BSP_EndBuildingLightmaps()
+int R_Q2BSP_EndBuildingLightmaps(byte **outBlocks)
 {
 	// Upload the final block
 	if (r_q2_lmBufferDirty)
@@ -930,6 +1192,56 @@ void R_Q2BSP_EndBuildingLightmaps()
 	// Release allocated memory
 	Mem_Free(r_q2_lmAllocated);
 	Mem_Free(r_q2_lmBuffer);
+
+	if (outBlocks)
+		*outBlocks = r_q2_lmKept;
+	else if (r_q2_lmKept)
+		Mem_Free(r_q2_lmKept);
+	r_q2_lmKeepBlocks = false;
+	r_q2_lmKept = NULL;
+
+	return r_q2_lmNumUploaded;
+}
+
+
+/*
+=======================
+R_Q2BSP_LoadLightmaps
+
+Uploads blocks kept by an earlier R_Q2BSP_EndBuildingLightmaps, in place of
+building them. Surfaces are then pointed at them with
+R_Q2BSP_SetSurfaceLightmap.
+=======================
+*/
+void R_Q2BSP_LoadLightmaps(const int blockSize, const int numBlocks, const byte *blocks)
+{
+	if (numBlocks >= MAX_LIGHTMAP_IMAGES)
+		Com_Error (ERR_DROP, "R_Q2BSP_LoadLightmaps: - MAX_LIGHTMAP_IMAGES exceeded\n");
+
+	r_q2_lmBlockSize = blockSize;
+	for (r_q2_lmNumUploaded=0 ; r_q2_lmNumUploaded<numBlocks ; )
+	{
+		byte *block = (byte *)blocks + r_q2_lmNumUploaded*blockSize*blockSize*4;
+		ri.media.lmTextures[r_q2_lmNumUploaded++] = R_Create2DImage(Q_VarArgs ("*lm%i", r_q2_lmNumUploaded), &block,
+			blockSize, blockSize, IF_NOPICMIP|IF_NOMIPMAP_LINEAR|IF_NOGAMMA|IF_NOINTENS|IF_NOCOMPRESS|IT_LIGHTMAP, 3);
+	}
+
+	R_Q2BSP_ResetLightStyles();
+}
+
+
+/*
+=======================
+R_Q2BSP_SetSurfaceLightmap
+=======================
+*/
+void R_Q2BSP_SetSurfaceLightmap(mBspSurface_t *surf, const int texNum, const int x, const int y)
+{
+	surf->lmTexNum = texNum;
+	surf->q2_lmCoords[0] = x;
+	surf->q2_lmCoords[1] = y;
+
+	R_Q2BSP_SetLMCacheState(surf);
 }
 
 
@@ -1472,21 +1784,24 @@ R_CullDynamicLightList
 */
 void R_CullDynamicLightList()
 {
-	ri.scn.dLightCullBits = 0;
+	static TCullBoxBatch<MAX_REF_DLIGHTS> dLightBatch;
+
+	dLightBatch.Clear();
 	for (uint32 num=0 ; num<ri.scn.numDLights ; num++)
+		dLightBatch.Add(ri.scn.dLightList[num].mins, ri.scn.dLightList[num].maxs);
+
+	uint16 visible[MAX_REF_DLIGHTS];
+	const uint32 numVisible = dLightBatch.Cull(ri.scn.clipFlags, visible, false);
+
+	// Everything starts culled, the survivors are cleared
+	ri.scn.dLightCullBits = ri.scn.numDLights ? (uint32)(((uint64)1 << ri.scn.numDLights) - 1) : 0;
+	for (uint32 i=0 ; i<numVisible ; i++)
+		ri.scn.dLightCullBits &= ~BIT(visible[i]);
+
+	if (!ri.scn.bDrawingMeshOutlines)
 	{
-		refDLight_t *dl = &ri.scn.dLightList[num];
-		if (R_CullBox(dl->mins, dl->maxs, ri.scn.clipFlags))
-		{
-			ri.scn.dLightCullBits |= BIT(num);
-			if (!ri.scn.bDrawingMeshOutlines)
-				ri.pc.cullDLight[CULL_PASS]++;
-		}
-		else
-		{
-			if (!ri.scn.bDrawingMeshOutlines)
-				ri.pc.cullDLight[CULL_FAIL]++;
-		}
+		ri.pc.cullDLight[CULL_PASS] += ri.scn.numDLights - numVisible;
+		ri.pc.cullDLight[CULL_FAIL] += numVisible;
 	}
 }
 
@@ -60,6 +60,77 @@ static inline bool R_CullTransformedBounds(const vec3_t Origin, const mat3x3_t A
 	return R_CullTransformedBox(BBox, clipFlags);
 }
 
+uint32 R_CullBoxBatch(const float *const mins[3], const float *const maxs[3], const uint32 numBoxes, const uint32 clipFlags, uint16 *outVisible, const bool bCount = true);
+uint32 R_CullSphereBatch(const float *const origin[3], const float *radius, const uint32 numSpheres, const uint32 clipFlags, uint16 *outVisible, const bool bCount = true);
+
+void R_CullBench_f();
+
+// Bounds kept one component per array for the batch culls, which write the
+// indexes that survive to outVisible. Capacity has to be a multiple of four,
+// the SSE2 path reads the padding past the last entry.
+template<uint32 Capacity>
+class TCullBoxBatch
+{
+public:
+	uint32					numBoxes;
+	float					mins[3][Capacity];
+	float					maxs[3][Capacity];
+
+	TCullBoxBatch() : numBoxes(0) {}
+
+	inline void Clear() { numBoxes = 0; }
+	inline bool IsFull() const { return (numBoxes == Capacity); }
+
+	inline uint32 Add(const vec3_t inMins, const vec3_t inMaxs)
+	{
+		assert(numBoxes < Capacity);
+		mins[0][numBoxes] = inMins[0];
+		mins[1][numBoxes] = inMins[1];
+		mins[2][numBoxes] = inMins[2];
+		maxs[0][numBoxes] = inMaxs[0];
+		maxs[1][numBoxes] = inMaxs[1];
+		maxs[2][numBoxes] = inMaxs[2];
+		return numBoxes++;
+	}
+
+	inline uint32 Cull(const uint32 clipFlags, uint16 *outVisible, const bool bCount = true) const
+	{
+		const float *const boxMins[3] = { mins[0], mins[1], mins[2] };
+		const float *const boxMaxs[3] = { maxs[0], maxs[1], maxs[2] };
+		return R_CullBoxBatch(boxMins, boxMaxs, numBoxes, clipFlags, outVisible, bCount);
+	}
+};
+
+template<uint32 Capacity>
+class TCullSphereBatch
+{
+public:
+	uint32					numSpheres;
+	float					origin[3][Capacity];
+	float					radius[Capacity];
+
+	TCullSphereBatch() : numSpheres(0) {}
+
+	inline void Clear() { numSpheres = 0; }
+	inline bool IsFull() const { return (numSpheres == Capacity); }
+
+	inline uint32 Add(const vec3_t inOrigin, const float inRadius)
+	{
+		assert(numSpheres < Capacity);
+		origin[0][numSpheres] = inOrigin[0];
+		origin[1][numSpheres] = inOrigin[1];
+		origin[2][numSpheres] = inOrigin[2];
+		radius[numSpheres] = inRadius;
+		return numSpheres++;
+	}
+
+	inline uint32 Cull(const uint32 clipFlags, uint16 *outVisible, const bool bCount = true) const
+	{
+		const float *const sphereOrigin[3] = { origin[0], origin[1], origin[2] };
+		return R_CullSphereBatch(sphereOrigin, radius, numSpheres, clipFlags, outVisible, bCount);
+	}
+};
+
 //
 // rf_decal.cpp
 //
@@ -79,6 +150,10 @@ void R_CullEntityList();
 void R_AddBModelsToList();
 void R_AddEntitiesToList();
 
+uint32 R_EntitySceneChunks();
+void R_StageEntityChunk(const uint32 chunk);
+uint32 R_EntitySceneChecksum();
+
 void R_EntityInit();
 
 //
@@ -98,9 +173,13 @@ void R_FontShutdown();
 
 void R_Q2BSP_MarkWorldLights();
 void R_Q2BSP_UpdateLightmap(refEntity_t *ent, mBspSurface_t *surf);
-void R_Q2BSP_BeginBuildingLightmaps();
+void R_Q2BSP_UpdateLightmaps(refMeshList *list);
+int R_Q2BSP_LightmapBlockSize();
+void R_Q2BSP_BeginBuildingLightmaps(const bool bKeepBlocks);
 void R_Q2BSP_CreateSurfaceLightmap(mBspSurface_t *surf);
-void R_Q2BSP_EndBuildingLightmaps();
+int R_Q2BSP_EndBuildingLightmaps(byte **outBlocks);
+void R_Q2BSP_LoadLightmaps(const int blockSize, const int numBlocks, const byte *blocks);
+void R_Q2BSP_SetSurfaceLightmap(mBspSurface_t *surf, const int texNum, const int x, const int y);
 
 void R_Q3BSP_MarkWorldLights();
 
@@ -119,6 +198,26 @@ void R_TouchLightmaps();
 
 void R_TransformToScreen_Vec3(vec3_t in, vec3_t out);
 
+//
+// rf_meshbuffer.cpp
+//
+
+uint32 R_HashMeshSlots(const refMeshSlot *slots, const uint32 numSlots, uint32 hash);
+
+void R_SortBench_f();
+
+//
+// rf_occlusion.cpp
+//
+
+void R_ClearOcclusion();
+bool R_BeginOcclusion();
+bool R_OccluderInRange(const vec3_t mins, const vec3_t maxs);
+void R_AddOccluder(mBspSurface_t *surf, const refMaterial_t *mat);
+void R_EndOcclusion();
+
+bool R_OccludedBox(const vec3_t mins, const vec3_t maxs);
+
 //
 // rf_poly.cpp
 //
@@ -127,6 +226,10 @@ void R_PushPoly(refMeshBuffer *mb, const meshFeatures_t features);
 bool R_PolyOverflow(refMeshBuffer *mb);
 void R_PolyInit();
 
+void R_AddParticlesToList();
+void R_PushParticles(refMeshBuffer *mb, const meshFeatures_t features);
+bool R_ParticleOverflow(refMeshBuffer *mb);
+
 //
 // rf_sky.cpp
 //
@@ -148,9 +251,13 @@ void R_SkyShutdown();
 
 void R_AddQ2BrushModel(refEntity_t *ent);
 void R_AddQ3BrushModel(refEntity_t *ent);
-bool R_CullBrushModel(refEntity_t *ent, const uint32 clipFlags);
 void R_AddWorldToList();
 
+uint32 R_WorldSceneChunks();
+void R_StageWorldChunk(const uint32 chunk);
+uint32 R_WorldSceneChecksum();
+void R_AddWorldSurfacesToList();
+
 void R_WorldInit();
 void R_WorldShutdown();
 
@@ -89,7 +89,7 @@ void R_DrawStats()
 			Position[1] += CharSize[1];
 			R_DrawPic(ri.media.whiteMaterial, 0, QuadVertices().SetVertices(Position[0], Position[1], CharSize[0]*64, CharSize[1]), BGColors[(Color++)&1]);
 			R_DrawString(NULL, Position[0], Position[1], 0, 0, FS_SHADOW,
-				Q_VarArgs("AliasElems: %4u AliasPolys: %5u", ri.pc.aliasElements, ri.pc.aliasPolys),
+				Q_VarArgs("AliasElems: %4u AliasPolys: %5u AliasCached: %4u", ri.pc.aliasElements, ri.pc.aliasPolys, ri.pc.aliasPosesCached),
 				Q_BColorWhite);
 
 			Position[1] += CharSize[1];
@@ -98,6 +98,12 @@ void R_DrawStats()
 				Q_VarArgs("PolyEnt: %5u   PolyEntElems: %5u PolyEntPolys: %6u", ri.scn.polyList.Count(), ri.pc.polyElements, ri.pc.polyPolys),
 				Q_BColorWhite);
 
+			Position[1] += CharSize[1];
+			R_DrawPic(ri.media.whiteMaterial, 0, QuadVertices().SetVertices(Position[0], Position[1], CharSize[0]*64, CharSize[1]), BGColors[(Color++)&1]);
+			R_DrawString(NULL, Position[0], Position[1], 0, 0, FS_SHADOW,
+				Q_VarArgs("Particles: %5u PartElems: %5u PartPolys: %6u", ri.scn.numParticles, ri.pc.particleElements, ri.pc.particlePolys),
+				Q_BColorWhite);
+
 			// World
 			if (ri.scn.worldModel != ri.scn.defaultModel  && !(ri.def.rdFlags & RDF_NOWORLDMODEL))
 			{
@@ -165,7 +171,7 @@ void R_DrawStats()
 			Position[1] += CharSize[1];
 			R_DrawPic(ri.media.whiteMaterial, 0, QuadVertices().SetVertices(Position[0], Position[1], CharSize[0]*64, CharSize[1]), BGColors[(Color++)&1]);
 			R_DrawString(NULL, Position[0], Position[1], 0, 0, FS_SHADOW,
-				Q_VarArgs("StateChanges: %3u", ri.pc.stateChanges),
+				Q_VarArgs("StateChanges: %3u ColorsReused: %3u TexCoordsReused: %3u", ri.pc.stateChanges, ri.pc.colorCacheHits, ri.pc.tcGenCacheHits),
 				Q_BColorWhite);
 
 			float batchEfficiency;
@@ -202,6 +208,15 @@ void R_DrawStats()
 					ri.pc.timeSortList * Sys_MSPerCycle()),
 				Q_BColorWhite);
 
+			Position[1] += CharSize[1];
+			R_DrawPic(ri.media.whiteMaterial, 0, QuadVertices().SetVertices(Position[0], Position[1], CharSize[0]*64, CharSize[1]), BGColors[(Color++)&1]);
+			R_DrawString(NULL, Position[0], Position[1], 0, 0, FS_SHADOW,
+				Q_VarArgs("SceneJobs: %4.2fms    (%u chunks, %u mismatched)",
+					ri.pc.timeSceneJobs * Sys_MSPerCycle(),
+					ri.pc.sceneChunks,
+					ri.pc.sceneMismatches),
+				Q_BColorWhite);
+
 			Position[1] += CharSize[1];
 			R_DrawPic(ri.media.whiteMaterial, 0, QuadVertices().SetVertices(Position[0], Position[1], CharSize[0]*64, CharSize[1]), BGColors[(Color++)&1]);
 			R_DrawString(NULL, Position[0], Position[1], 0, 0, FS_SHADOW,
@@ -224,6 +239,15 @@ void R_DrawStats()
 						ri.pc.timeMarkLights * Sys_MSPerCycle()),
 					Q_BColorWhite);
 
+				Position[1] += CharSize[1];
+				R_DrawPic(ri.media.whiteMaterial, 0, QuadVertices().SetVertices(Position[0], Position[1], CharSize[0]*64, CharSize[1]), BGColors[(Color++)&1]);
+				R_DrawString(NULL, Position[0], Position[1], 0, 0, FS_SHADOW,
+					Q_VarArgs("PVS marked: %u clusters %u leafs %u nodes",
+						ri.pc.markClusters,
+						ri.pc.markLeafs,
+						ri.pc.markNodes),
+					Q_BColorWhite);
+
 				Position[1] += CharSize[1];
 				R_DrawPic(ri.media.whiteMaterial, 0, QuadVertices().SetVertices(Position[0], Position[1], CharSize[0]*64, CharSize[1]), BGColors[(Color++)&1]);
 				R_DrawString(NULL, Position[0], Position[1], 0, 0, FS_SHADOW,
@@ -231,6 +255,22 @@ void R_DrawStats()
 					ri.pc.timeRecurseWorld * Sys_MSPerCycle(),
 					ri.pc.timeShadowRecurseWorld * Sys_MSPerCycle()),
 					Q_BColorWhite);
+
+				Position[1] += CharSize[1];
+				R_DrawPic(ri.media.whiteMaterial, 0, QuadVertices().SetVertices(Position[0], Position[1], CharSize[0]*64, CharSize[1]), BGColors[(Color++)&1]);
+				R_DrawString(NULL, Position[0], Position[1], 0, 0, FS_SHADOW,
+					Q_VarArgs("Lightmaps:  %4.2fms (%u surfaces)",
+					ri.pc.timeLightmaps * Sys_MSPerCycle(),
+					ri.pc.lightmapUpdates),
+					Q_BColorWhite);
+
+				Position[1] += CharSize[1];
+				R_DrawPic(ri.media.whiteMaterial, 0, QuadVertices().SetVertices(Position[0], Position[1], CharSize[0]*64, CharSize[1]), BGColors[(Color++)&1]);
+				R_DrawString(NULL, Position[0], Position[1], 0, 0, FS_SHADOW,
+					Q_VarArgs("Occlusion:  %4.2fms (%u occluders)",
+					ri.pc.timeOcclusion * Sys_MSPerCycle(),
+					ri.pc.occluders),
+					Q_BColorWhite);
 			}
 
 			Position[1] += CharSize[1] * 2;
@@ -278,6 +318,14 @@ void R_DrawStats()
 						ri.pc.cullVis[CULL_PASS], ri.pc.cullVis[CULL_FAIL],
 						ri.pc.cullSurf[CULL_PASS], ri.pc.cullSurf[CULL_FAIL]),
 					Q_BColorWhite);
+
+				Position[1] += CharSize[1];
+				R_DrawPic(ri.media.whiteMaterial, 0, QuadVertices().SetVertices(Position[0], Position[1], CharSize[0]*64, CharSize[1]), BGColors[(Color++)&1]);
+				R_DrawString(NULL, Position[0], Position[1], 0, 0, FS_SHADOW,
+					Q_VarArgs("Occlusion: %4u/%4u   Occluders: %4u",
+						ri.pc.cullOcclusion[CULL_PASS], ri.pc.cullOcclusion[CULL_FAIL],
+						ri.pc.occluders),
+					Q_BColorWhite);
 			}
 		}
 
@@ -426,6 +474,78 @@ public:
 
 glDebugDraw drawer;
 
+/*
+================
+R_SceneJob
+================
+*/
+static void R_SceneJob(void *arg, const int jobNum)
+{
+	const uint32 numWorldChunks = *(const uint32 *)arg;
+
+	if ((uint32)jobNum < numWorldChunks)
+		R_StageWorldChunk(jobNum);
+	else
+		R_StageEntityChunk(jobNum - numWorldChunks);
+}
+
+
+/*
+================
+R_RunSceneJobs
+
+Builds the mesh buffers for the queued world surfaces and the visible
+entities, a chunk per job. Chunks only write to their own slots, so the
+result is the same on any number of threads. r_sceneChecksum builds every
+chunk a second time on this thread and complains if the two differ.
+================
+*/
+static void R_RunSceneJobs()
+{
+	qStatCycle_Scope Stat(r_times, ri.pc.timeSceneJobs);
+	qProfile_Scope Prof("R_SceneJobs");
+
+	uint32 numWorldChunks = R_WorldSceneChunks();
+	const uint32 numChunks = numWorldChunks + R_EntitySceneChunks();
+	if (!numChunks)
+		return;
+	ri.pc.sceneChunks += numChunks;
+
+	if (r_sceneJobs->intVal && numChunks > 1 && Job_NumThreads() > 1)
+	{
+		Job_Run(R_SceneJob, &numWorldChunks, numChunks);
+	}
+	else
+	{
+		for (uint32 i=0 ; i<numChunks ; i++)
+			R_SceneJob(&numWorldChunks, i);
+	}
+
+	if (!r_sceneChecksum->intVal)
+		return;
+
+	const uint32 worldHash = R_WorldSceneChecksum();
+	const uint32 entityHash = R_EntitySceneChecksum();
+
+	for (uint32 i=0 ; i<numChunks ; i++)
+		R_SceneJob(&numWorldChunks, i);
+
+	const uint32 serialWorldHash = R_WorldSceneChecksum();
+	const uint32 serialEntityHash = R_EntitySceneChecksum();
+
+	if (worldHash != serialWorldHash || entityHash != serialEntityHash)
+	{
+		ri.pc.sceneMismatches++;
+		Com_Printf(PRNT_WARNING, "R_RunSceneJobs: scene differs from the serial build (world %08x/%08x, entities %08x/%08x)\n",
+			worldHash, serialWorldHash, entityHash, serialEntityHash);
+	}
+	else if (r_sceneChecksum->intVal > 1)
+	{
+		Com_Printf(0, "Scene checksum: world %08x entities %08x (%u chunks)\n", worldHash, entityHash, numChunks);
+	}
+}
+
+
 /*
 ================
 R_RenderRefDef
@@ -445,6 +565,7 @@ static void R_RenderRefDef(refDef_t *rd)
 	// Add items to the list
 	{
 		qStatCycle_Scope Stat(r_times, ri.pc.timeAddToList);
+		qProfile_Scope Prof("R_AddToList");
 
 		// Clear scene visibility dimensions
 		ClearBounds(ri.scn.visMins, ri.scn.visMaxs);
@@ -458,22 +579,28 @@ static void R_RenderRefDef(refDef_t *rd)
 		// Now that zFar is set, setup the frustum
 		R_SetupFrustum();
 
-		// Add world meshes, while building occluders
-
+		// Walk the world, while building occluders
 		R_AddWorldToList();
-		R_AddBModelsToList();
 
 		// Cache culling results for multiple renders
 		R_CullEntityList();
 		RB_CullShadowMaps();
 		R_CullDynamicLightList();
 
+		// Build world and entity meshes on the job threads
+		R_RunSceneJobs();
+
+		// Add world meshes
+		R_AddWorldSurfacesToList();
+		R_AddBModelsToList();
+
 		// Add scene items
 		if (ri.scn.viewType != RVT_SHADOWMAP)
 		{
 			RB_RenderShadowMaps();
 			R_AddDecalsToList();
 			R_AddPolysToList();
+			R_AddParticlesToList();
 		}
 		R_AddEntitiesToList();
 	}
@@ -481,6 +608,7 @@ static void R_RenderRefDef(refDef_t *rd)
 	// Sort the list
 	{
 		qStatCycle_Scope Stat(r_times, ri.pc.timeSortList);
+		qProfile_Scope Prof("R_SortList");
 		ri.scn.currentList->SortList();
 	}
 
@@ -493,6 +621,7 @@ static void R_RenderRefDef(refDef_t *rd)
 	// Render
 	{
 		qStatCycle_Scope Stat(r_times, ri.pc.timeDrawList);
+		qProfile_Scope Prof("R_DrawList");
 		glPushMatrix();
 		ri.scn.currentList->DrawList();
 		glPopMatrix();
@@ -528,6 +657,8 @@ void R_RenderScene(refDef_t *rd)
 	if (r_noRefresh->intVal)
 		return;
 
+	qProfile_Scope Prof("R_RenderScene");
+
 	if (ri.scn.worldModel == ri.scn.defaultModel && !(rd->rdFlags & RDF_NOWORLDMODEL))
 		Com_Error(ERR_DROP, "R_RenderScene: NULL worldmodel");
 
@@ -578,6 +709,8 @@ R_EndFrame
 */
 void R_EndFrame()
 {
+	qProfile_Scope Prof("R_EndFrame");
+
 	// Update the backend
 	RB_EndFrame();
 
@@ -611,6 +744,7 @@ void R_BeginTimeDemo()
 	r_timeDemoMS = 0.0;
 	r_timeDemoLastCycles = Sys_Cycles();
 	memset(&ri.pc, 0, sizeof(refStats_t));
+	memset(&qgl_nullStats, 0, sizeof(qgl_nullStats));
 }
 
 /*
@@ -648,15 +782,32 @@ void R_EndTimeDemo()
 
 	Com_Printf(0, "Mesh buffering times (total/average):\n");
 	Com_Printf(0, "...Add:  %7.2fms/%3.2fms\n", ri.pc.timeAddToList * Sys_MSPerCycle(), ri.pc.timeAddToList * Sys_MSPerCycle() * InvFrameCount);
+	Com_Printf(0, "...Jobs: %7.2fms/%3.2fms (%u chunks, %u mismatched)\n", ri.pc.timeSceneJobs * Sys_MSPerCycle(), ri.pc.timeSceneJobs * Sys_MSPerCycle() * InvFrameCount, ri.pc.sceneChunks, ri.pc.sceneMismatches);
 	Com_Printf(0, "...Sort: %7.2fms/%3.2fms\n", ri.pc.timeSortList * Sys_MSPerCycle(), ri.pc.timeSortList * Sys_MSPerCycle() * InvFrameCount);
 	Com_Printf(0, "...Push: %7.2fms/%3.2fms\n", ri.pc.timePushMesh * Sys_MSPerCycle(), ri.pc.timePushMesh * Sys_MSPerCycle() * InvFrameCount);
 	Com_Printf(0, "...Draw: %7.2fms/%3.2fms\n", ri.pc.timeDrawList * Sys_MSPerCycle(), ri.pc.timeDrawList * Sys_MSPerCycle() * InvFrameCount);
 
 	Com_Printf(0, "World rendering times (total/average):\n");
 	Com_Printf(0, "...MarkLeaves:      %7.2fms/%3.2fms\n", ri.pc.timeMarkLeaves * Sys_MSPerCycle(), ri.pc.timeMarkLeaves * Sys_MSPerCycle() * InvFrameCount);
+	Com_Printf(0, "...PVS changes:     %7u (%.3fms worst, %u clusters %u leafs %u nodes marked)\n", ri.pc.markRebuilds, ri.pc.timeMarkLeavesPeak * Sys_MSPerCycle(), ri.pc.markClusters, ri.pc.markLeafs, ri.pc.markNodes);
 	Com_Printf(0, "...MarkLights:      %7.2fms/%3.2fms\n", ri.pc.timeMarkLights * Sys_MSPerCycle(), ri.pc.timeMarkLights * Sys_MSPerCycle() * InvFrameCount);
+	Com_Printf(0, "...Lightmaps:       %7.2fms/%3.2fms\n", ri.pc.timeLightmaps * Sys_MSPerCycle(), ri.pc.timeLightmaps * Sys_MSPerCycle() * InvFrameCount);
+	Com_Printf(0, "...Occlusion:       %7.2fms/%3.2fms\n", ri.pc.timeOcclusion * Sys_MSPerCycle(), ri.pc.timeOcclusion * Sys_MSPerCycle() * InvFrameCount);
 	Com_Printf(0, "...Recursion:       %7.2fms/%3.2fms\n", ri.pc.timeRecurseWorld * Sys_MSPerCycle(), ri.pc.timeRecurseWorld * Sys_MSPerCycle() * InvFrameCount);
 	Com_Printf(0, "...ShadowRecursion: %7.2fms/%3.2fms\n", ri.pc.timeShadowRecurseWorld * Sys_MSPerCycle(), ri.pc.timeShadowRecurseWorld * Sys_MSPerCycle() * InvFrameCount);
+
+	Com_Printf(0, "Occlusion culling (total/average):\n");
+	Com_Printf(0, "...Occluders: %8u/%.1f\n", ri.pc.occluders, ri.pc.occluders * InvFrameCount);
+	Com_Printf(0, "...Occluded:  %8u/%.1f\n", ri.pc.cullOcclusion[CULL_PASS], ri.pc.cullOcclusion[CULL_PASS] * InvFrameCount);
+	Com_Printf(0, "...Visible:   %8u/%.1f\n", ri.pc.cullOcclusion[CULL_FAIL], ri.pc.cullOcclusion[CULL_FAIL] * InvFrameCount);
+
+	if (ri.bNullBackend)
+	{
+		Com_Printf(0, "Null backend calls (total/average):\n");
+		Com_Printf(0, "...Draw calls:    %8u/%.1f\n", qgl_nullStats.drawCalls, qgl_nullStats.drawCalls * InvFrameCount);
+		Com_Printf(0, "...State changes: %8u/%.1f\n", qgl_nullStats.stateChanges, qgl_nullStats.stateChanges * InvFrameCount);
+		Com_Printf(0, "...Tex uploads:   %8u/%.1f (%u bytes)\n", qgl_nullStats.texUploads, qgl_nullStats.texUploads * InvFrameCount, qgl_nullStats.uploadBytes);
+	}
 }
 
 // ==========================================================
@@ -672,6 +823,7 @@ void R_ClearScene()
 	ri.scn.numDLights = 0;
 	ri.scn.numEntities = 0;
 	ri.scn.polyList.Clear();
+	ri.scn.numParticles = 0;
 }
 
 
@@ -734,6 +886,25 @@ void R_AddPoly(refPoly_t *poly)
 }
 
 
+/*
+=====================
+R_AddParticles
+
+Copies a run of compact particles, they're sorted and expanded at render time.
+=====================
+*/
+void R_AddParticles(const refParticle_t *particles, const int numParticles)
+{
+	int num = min(numParticles, MAX_REF_PARTICLES - (int)ri.scn.numParticles);
+	if (num <= 0)
+		return;
+
+	memcpy(&ri.scn.particleList[ri.scn.numParticles], particles, sizeof(refParticle_t) * num);
+	ri.scn.numParticles += num;
+	ri.scn.bParticlesSorted = false;
+}
+
+
 /*
 =====================
 R_AddLight
@@ -53,6 +53,16 @@ struct matKey_t
 	bool		(*func)(refMaterial_t *mat, matPass_t *pass, parse_t *ps, const char *fileName);
 };
 
+#define MAX_MATKEY_HASH			128		// Power of two, well above the size of either key list
+#define MAX_MATKEY_WILDCARDS	8
+
+struct matKeyTable_t
+{
+	matKey_t	*hash[MAX_MATKEY_HASH];
+	matKey_t	*wildCards[MAX_MATKEY_WILDCARDS];
+	int			numWildCards;
+};
+
 /*
 =============================================================================
 
@@ -1973,6 +1983,58 @@ static matKey_t r_materialBaseKeys[] = {
 
 static const int r_numMaterialBaseKeys = sizeof(r_materialBaseKeys) / sizeof(r_materialBaseKeys[0]) - 1;
 
+static matKeyTable_t r_materialPassTable;
+static matKeyTable_t r_materialBaseTable;
+
+/*
+==================
+R_MaterialKeyHash
+==================
+*/
+static uint32 R_MaterialKeyHash(const char *keyName)
+{
+	uint32 hash = COM_FNV_SEED;
+	for ( ; *keyName ; keyName++)
+		hash = Com_FNVMix(hash, (byte)*keyName);
+
+	return hash & (MAX_MATKEY_HASH-1);
+}
+
+
+/*
+==================
+R_BuildKeyTable
+
+Hashes a key list for R_MaterialParseTok. Wildcard keys are only ever skipped,
+so they go in their own list and are tried when nothing matches exactly.
+==================
+*/
+static void R_BuildKeyTable(matKeyTable_t *table, matKey_t *keys)
+{
+	memset(table, 0, sizeof(matKeyTable_t));
+
+	for (matKey_t *key=keys ; key->keyWord ; key++)
+	{
+		if (strchr(key->keyWord, '*') && !key->func)
+		{
+			assert(table->numWildCards < MAX_MATKEY_WILDCARDS);
+			if (table->numWildCards < MAX_MATKEY_WILDCARDS)
+				table->wildCards[table->numWildCards++] = key;
+			continue;
+		}
+
+		// The first of any duplicates wins, as it did with the linear search
+		uint32 slot = R_MaterialKeyHash(key->keyWord);
+		for ( ; table->hash[slot] ; slot=(slot+1) & (MAX_MATKEY_HASH-1))
+		{
+			if (!strcmp(table->hash[slot]->keyWord, key->keyWord))
+				break;
+		}
+		if (!table->hash[slot])
+			table->hash[slot] = key;
+	}
+}
+
 /*
 =============================================================================
 
@@ -2499,33 +2561,401 @@ static void R_FinishPass(refMaterial_t *mat, matPass_t *pass)
 }
 
 
+/*
+=============================================================================
+
+	MATERIAL CACHE
+
+=============================================================================
+*/
+
+// A disk cache (see common.h) with the finished materials of every script
+// file, so a script that hasn't changed is copied back in rather than parsed.
+// The setup key covers the config values that change how scripts parse, and
+// the struct sizes.
+//
+// Entry payload:
+// [uint32]			material count
+// per material:
+// [refMaterial_t]	pointers cleared
+// [vertDeform_t]	numDeforms
+// [matPass_t]		numPasses, pointers cleared
+// [tcMod_t]		numTCMods for each pass
+// [names]			for each pass, a presence byte per anim name followed by the name
+
+#define MATCACHE_FILE		"materialcache.pca"
+#define MATCACHE_TEMP		"materialcache.tmp"
+#define MATCACHE_MAGIC		(('C'<<24)+('T'<<16)+('M'<<8)+'E')
+#define MATCACHE_VERSION	2
+
+#define MAX_MATCACHE_FILES	1024
+#define MAX_MATCACHE_PAYLOAD	(16<<20)
+
+static diskCache_t		r_matCache;
+
+/*
+==================
+R_MaterialConfigKey
+
+Everything the parser looks at that can change between runs.
+==================
+*/
+static uint32 R_MaterialConfigKey()
+{
+	uint32 key = 0;
+
+	if (ri.config.ext.bPrograms)
+		key |= BIT(0);
+	if (ri.config.ext.bShaders)
+		key |= BIT(1);
+	if (ri.config.ext.bTexCubeMap)
+		key |= BIT(2);
+	if (ri.config.ext.bARBMultitexture || ri.config.ext.bSGISMultiTexture)
+		key |= BIT(3);
+	key |= (ri.config.maxTexUnits & 0xff) << 8;
+	key |= (intensity->intVal & 0xff) << 16;
+
+	return key;
+}
+
+
+/*
+==================
+R_PackMaterials
+
+Serializes materials firstMat onward into a ri.genericPool allocation.
+==================
+*/
+static byte *R_PackMaterials(const int firstMat, uint32 &outLength)
+{
+	refMaterial_t	*mat;
+	matPass_t		*pass;
+	int				i, j, k;
+
+	// Size it up
+	uint32 size = sizeof(uint32);
+	for (i=firstMat ; i<r_numMaterials ; i++)
+	{
+		mat = &r_materialList[i];
+		size += sizeof(refMaterial_t) + mat->numDeforms * sizeof(vertDeform_t) + mat->numPasses * sizeof(matPass_t);
+
+		for (j=0, pass=mat->passes ; j<mat->numPasses ; pass++, j++)
+		{
+			size += pass->numTCMods * sizeof(tcMod_t) + pass->animNumNames;
+			for (k=0 ; k<pass->animNumNames ; k++)
+			{
+				if (pass->animNames[k])
+					size += strlen(pass->animNames[k]) + 1;
+			}
+		}
+	}
+
+	byte *data = (byte *)Mem_PoolAlloc(size, ri.genericPool, 0);
+	byte *out = data;
+
+	const uint32 numMats = r_numMaterials - firstMat;
+	memcpy(out, &numMats, sizeof(uint32));
+	out += sizeof(uint32);
+
+	for (i=firstMat ; i<r_numMaterials ; i++)
+	{
+		mat = &r_materialList[i];
+
+		refMaterial_t outMat;
+		memcpy(&outMat, mat, sizeof(refMaterial_t));
+		outMat.passes = NULL;
+		outMat.deforms = NULL;
+		outMat.hashNext = NULL;
+		memcpy(out, &outMat, sizeof(refMaterial_t));
+		out += sizeof(refMaterial_t);
+
+		memcpy(out, mat->deforms, mat->numDeforms * sizeof(vertDeform_t));
+		out += mat->numDeforms * sizeof(vertDeform_t);
+
+		for (j=0, pass=mat->passes ; j<mat->numPasses ; pass++, j++)
+		{
+			matPass_t outPass;
+			memcpy(&outPass, pass, sizeof(matPass_t));
+			memset(outPass.animImages, 0, sizeof(outPass.animImages));
+			memset(outPass.animNames, 0, sizeof(outPass.animNames));
+			outPass.vertProgPtr = NULL;
+			outPass.fragProgPtr = NULL;
+			outPass.shaderPtr = NULL;
+			outPass.tcMods = NULL;
+			memcpy(out, &outPass, sizeof(matPass_t));
+			out += sizeof(matPass_t);
+		}
+
+		for (j=0, pass=mat->passes ; j<mat->numPasses ; pass++, j++)
+		{
+			memcpy(out, pass->tcMods, pass->numTCMods * sizeof(tcMod_t));
+			out += pass->numTCMods * sizeof(tcMod_t);
+		}
+
+		for (j=0, pass=mat->passes ; j<mat->numPasses ; pass++, j++)
+		{
+			for (k=0 ; k<pass->animNumNames ; k++)
+			{
+				*out++ = (pass->animNames[k] != NULL);
+				if (!pass->animNames[k])
+					continue;
+
+				const size_t len = strlen(pass->animNames[k]) + 1;
+				memcpy(out, pass->animNames[k], len);
+				out += len;
+			}
+		}
+	}
+
+	assert(out == data + size);
+	outLength = size;
+	return data;
+}
+
+
+/*
+==================
+R_UnpackMaterials
+
+Walks a cache payload. With bCommit false this only checks that the payload is
+whole and in range, so when it's called again with bCommit true nothing can
+fail halfway through adding materials.
+==================
+*/
+static bool R_UnpackMaterials(const byte *data, const uint32 dataLen, const EMatPathType pathType, const bool bCommit)
+{
+	const byte		*end = data + dataLen;
+	refMaterial_t	header;
+	matPass_t		*pass;
+	uint32			numMats, i;
+	int				j, k;
+
+	if (dataLen < sizeof(uint32))
+		return false;
+	memcpy(&numMats, data, sizeof(uint32));
+	data += sizeof(uint32);
+
+	// Same limit R_NewMaterial has
+	if (numMats > (uint32)(MAX_MATERIALS - 1 - r_numMaterials))
+		return false;
+
+	for (i=0 ; i<numMats ; i++)
+	{
+		if ((uint32)(end - data) < sizeof(refMaterial_t))
+			return false;
+		memcpy(&header, data, sizeof(refMaterial_t));
+		data += sizeof(refMaterial_t);
+
+		if (!memchr(header.name, 0, sizeof(header.name))
+		|| header.numDeforms < 0 || header.numDeforms > MAX_MATERIAL_DEFORMVS
+		|| header.numPasses < 0 || header.numPasses > MAX_MATERIAL_PASSES)
+			return false;
+
+		const uint32 deformSize = header.numDeforms * sizeof(vertDeform_t);
+		const uint32 passSize = header.numPasses * sizeof(matPass_t);
+		if ((uint32)(end - data) < deformSize + passSize)
+			return false;
+		const byte *deforms = data;
+		data += deformSize;
+
+		// r_currPasses is free to use as scratch outside of parsing
+		memcpy(r_currPasses, data, passSize);
+		data += passSize;
+
+		uint32 tcModSize = 0;
+		for (j=0, pass=r_currPasses ; j<header.numPasses ; pass++, j++)
+		{
+			if (pass->numTCMods > MAX_MATERIAL_TCMODS || pass->animNumNames > MAX_MATERIAL_ANIM_FRAMES)
+				return false;
+			tcModSize += pass->numTCMods * sizeof(tcMod_t);
+		}
+		if ((uint32)(end - data) < tcModSize)
+			return false;
+		const byte *tcMods = data;
+		data += tcModSize;
+
+		// Link it in the same way R_NewMaterial and R_FinishMaterial would
+		refMaterial_t *mat = NULL;
+		if (bCommit)
+		{
+			mat = &r_materialList[r_numMaterials++];
+			memcpy(mat, &header, sizeof(refMaterial_t));
+			mat->pathType = pathType;
+
+			mat->hashValue = Com_HashGenericFast(mat->name, MAX_MATERIAL_HASH);
+			mat->hashNext = r_materialHashTree[mat->hashValue];
+			r_materialHashTree[mat->hashValue] = mat;
+
+			mat->deforms = NULL;
+			if (mat->numDeforms)
+			{
+				mat->deforms = (vertDeform_t*)Mem_PoolAlloc(deformSize, ri.matSysPool, 0);
+				memcpy(mat->deforms, deforms, deformSize);
+			}
+
+			mat->passes = NULL;
+			if (mat->numPasses)
+			{
+				byte *buffer = (byte*)Mem_PoolAlloc(passSize + tcModSize, ri.matSysPool, 0);
+
+				mat->passes = (matPass_t *)buffer;
+				memcpy(mat->passes, r_currPasses, passSize);
+				buffer += passSize;
+
+				for (j=0, pass=mat->passes ; j<mat->numPasses ; pass++, j++)
+				{
+					memset(pass->animImages, 0, sizeof(pass->animImages));
+					memset(pass->animNames, 0, sizeof(pass->animNames));
+					pass->vertProgPtr = NULL;
+					pass->fragProgPtr = NULL;
+					pass->shaderPtr = NULL;
+
+					pass->tcMods = NULL;
+					if (!pass->numTCMods)
+						continue;
+
+					pass->tcMods = (tcMod_t *)buffer;
+					memcpy(pass->tcMods, tcMods, pass->numTCMods * sizeof(tcMod_t));
+					tcMods += pass->numTCMods * sizeof(tcMod_t);
+					buffer += pass->numTCMods * sizeof(tcMod_t);
+				}
+			}
+		}
+
+		// Anim names
+		for (j=0 ; j<header.numPasses ; j++)
+		{
+			const byte numNames = bCommit ? mat->passes[j].animNumNames : r_currPasses[j].animNumNames;
+			for (k=0 ; k<numNames ; k++)
+			{
+				if (data >= end)
+					return false;
+				if (!*data++)
+					continue;
+
+				const byte *nameEnd = (const byte *)memchr(data, 0, end - data);
+				if (!nameEnd || nameEnd - data >= MAX_QPATH)
+					return false;
+
+				if (bCommit)
+					mat->passes[j].animNames[k] = Mem_PoolStrDup((const char *)data, ri.matSysPool, 0);
+				data = nameEnd + 1;
+			}
+		}
+	}
+
+	return (data == end);
+}
+
+
+/*
+==================
+R_LoadMaterialCache
+
+Adds the materials stored for this script if it hasn't changed since.
+==================
+*/
+static bool R_LoadMaterialCache(const char *name, const int fileLen, const uint32 sourceHash, const EMatPathType pathType)
+{
+	diskCacheEntry_t *entry = DiskCache_Find(&r_matCache, name, 0, fileLen, sourceHash);
+	if (!entry)
+		return false;
+
+	byte *data = (byte *)Mem_PoolAlloc(entry->rawLen, ri.genericPool, 0);
+	if (!DiskCache_Read(&r_matCache, entry, data))
+	{
+		Mem_Free(data);
+		return false;
+	}
+
+	// Make sure all of it unpacks before adding any of it
+	if (!R_UnpackMaterials(data, entry->rawLen, pathType, false))
+	{
+		r_matCache.hits--;
+		r_matCache.stale++;
+		Mem_Free(data);
+		return false;
+	}
+
+	R_UnpackMaterials(data, entry->rawLen, pathType, true);
+	Mem_Free(data);
+	return true;
+}
+
+
+/*
+==================
+R_StoreMaterialCache
+
+Packs the materials a script just added for the next write.
+==================
+*/
+static void R_StoreMaterialCache(const char *name, const int fileLen, const uint32 sourceHash, const int firstMat)
+{
+	if (!r_materialCache->intVal)
+		return;
+
+	uint32 dataLen;
+	byte *data = R_PackMaterials(firstMat, dataLen);
+	DiskCache_Store(&r_matCache, name, 0, fileLen, sourceHash, data, dataLen);
+}
+
+
+/*
+==================
+R_OpenMaterialCache
+==================
+*/
+static void R_OpenMaterialCache()
+{
+	if (!r_materialCache->intVal)
+	{
+		r_matCache.hits = r_matCache.misses = r_matCache.stale = 0;
+		return;
+	}
+
+	r_matCache.fileName = MATCACHE_FILE;
+	r_matCache.tempName = MATCACHE_TEMP;
+	r_matCache.magic = MATCACHE_MAGIC;
+	r_matCache.version = MATCACHE_VERSION;
+	r_matCache.setupKey = Com_FNVMix(Com_FNVMix(Com_FNVMix(COM_FNV_SEED, sizeof(refMaterial_t)), sizeof(matPass_t)), R_MaterialConfigKey());
+	r_matCache.maxEntries = MAX_MATCACHE_FILES;
+	r_matCache.maxPayload = MAX_MATCACHE_PAYLOAD;
+	r_matCache.maxPending = 0;
+	r_matCache.budget = 0;
+	r_matCache.bCompress = false;
+	r_matCache.pool = ri.genericPool;
+	DiskCache_Open(&r_matCache);
+}
+
+/*
+=============================================================================
+
+	MATERIAL SCRIPTS
+
+=============================================================================
+*/
+
 /*
 ==================
 R_ParseMaterialFile
 ==================
 */
-static bool R_MaterialParseTok (refMaterial_t *mat, matPass_t *pass, parse_t *ps, const char *fileName, matKey_t *keys, char *token)
+static bool R_MaterialParseTok (refMaterial_t *mat, matPass_t *pass, parse_t *ps, const char *fileName, matKeyTable_t *keys, char *token)
 {
 	matKey_t	*key;
 	char		keyName[MAX_PS_TOKCHARS];
 	char		*str;
+	uint32		slot;
+	int			i;
 
 	// Copy off a lower-case copy for faster comparisons
 	Q_strncpyz (keyName, token, sizeof(keyName));
 	Q_strlwr (keyName);
 
-	// Cycle through the key list looking for a match
-	for (key=keys ; key->keyWord ; key++) {
-		// If this is a wildcard keyword, work some magic
-		// (handy for compiler/editor keywords)
-		if (strchr (key->keyWord, '*') && !key->func) {
-			if (Q_WildcardMatch (key->keyWord, keyName, 1)) {
-				PS_SkipLine (ps);
-				return true;
-			}
-		}
-
-		// See if it matches the keyword
+	// Look for an exact match
+	for (slot=R_MaterialKeyHash (keyName) ; keys->hash[slot] ; slot=(slot+1) & (MAX_MATKEY_HASH-1)) {
+		key = keys->hash[slot];
 		if (strcmp (key->keyWord, keyName))
 			continue;
 
@@ -2553,6 +2983,15 @@ static bool R_MaterialParseTok (refMaterial_t *mat, matPass_t *pass, parse_t *ps
 		return true;
 	}
 
+	// If this is a wildcard keyword, work some magic
+	// (handy for compiler/editor keywords)
+	for (i=0 ; i<keys->numWildCards ; i++) {
+		if (Q_WildcardMatch (keys->wildCards[i]->keyWord, keyName, 1)) {
+			PS_SkipLine (ps);
+			return true;
+		}
+	}
+
 	// Not found
 	Mat_PrintPos (PRNT_ERROR, mat, r_numCurrPasses, ps, fileName);
 	Mat_Printf (PRNT_ERROR, "ERROR: unrecognized key: '%s'\n", keyName);
@@ -2592,6 +3031,14 @@ static void R_ParseMaterialFile (char *fixedName, EMatPathType pathType)
 		return;
 	}
 
+	// Use the compiled materials if the script hasn't changed
+	const uint32 sourceHash = Com_HashBlock (buf, fileLen);
+	if (R_LoadMaterialCache (fixedName, fileLen, sourceHash, pathType)) {
+		FS_FreeFile (buf);
+		return;
+	}
+	const int firstMat = r_numMaterials;
+
 	// Start parsing
 	inMaterial = false;
 	inPass = false;
@@ -2626,11 +3073,11 @@ static void R_ParseMaterialFile (char *fixedName, EMatPathType pathType)
 			default:
 				if (inPass) {
 					if (pass)
-						R_MaterialParseTok (mat, pass, ps, fixedName, r_materialPassKeys, token);
+						R_MaterialParseTok (mat, pass, ps, fixedName, &r_materialPassTable, token);
 					break;
 				}
 
-				R_MaterialParseTok (mat, NULL, ps, fixedName, r_materialBaseKeys, token);
+				R_MaterialParseTok (mat, NULL, ps, fixedName, &r_materialBaseTable, token);
 				break;
 			}
 		}
@@ -2656,6 +3103,8 @@ static void R_ParseMaterialFile (char *fixedName, EMatPathType pathType)
 	// Done
 	PS_AddErrorCount (ps, &r_numMaterialErrors, &r_numMaterialWarnings);
 	PS_EndSession (ps);
+
+	R_StoreMaterialCache (fixedName, fileLen, sourceHash, firstMat);
 	FS_FreeFile (buf);
 }
 
@@ -3231,6 +3680,90 @@ static refMaterial_t *R_RegisterMaterial(const char *name, EMatRegType matType,
 	return mat;
 }
 
+
+/*
+==================
+R_PrefetchMaterials
+
+Hands the images the given materials are going to register to
+R_PrefetchImages. surfParams may be NULL for materials registered without
+them. Returns how many of the materials were covered, which is at least one.
+==================
+*/
+#define MAX_PREFETCH_IMAGES		64
+int R_PrefetchMaterials(const char **names, const matSurfParams_t *surfParams, const int numNames)
+{
+	const char *imageNames[MAX_PREFETCH_IMAGES];
+	int imageEnds[MAX_PREFETCH_IMAGES];
+	int numImages = 0;
+
+	int numMats = 0;
+	while (numMats < numNames && numMats < MAX_PREFETCH_IMAGES)
+	{
+		const char *name = names[numMats];
+		int numMatImages = 0;
+		bool bFull = false;
+
+		if (name && name[0] && strlen(name)+1 < MAX_QPATH)
+		{
+			char fixedName[MAX_QPATH];
+			Com_NormalizePath(fixedName, sizeof(fixedName), name);
+
+			refMaterial_t *mat = R_FindMaterial(fixedName, surfParams ? surfParams[numMats] : -1);
+			if (!mat)
+			{
+				// A default material, named after its image
+				if (numImages < MAX_PREFETCH_IMAGES)
+					imageNames[numImages + numMatImages++] = name;
+				else
+					bFull = true;
+			}
+			else
+			{
+				// Everything R_ReadyMaterial would load from disk
+				for (int i=0 ; i<mat->numPasses && !bFull ; i++)
+				{
+					matPass_t *pass = &mat->passes[i];
+					if (pass->flags & (MAT_PASS_LIGHTMAP|MAT_PASS_NOTEXTURING))
+						continue;
+
+					for (int j=0 ; j<pass->animNumNames ; j++)
+					{
+						if (!pass->animNames[j] || pass->animNames[j][0] == '$' || pass->animImages[j])
+							continue;
+						if ((mat->addTexFlags|pass->passTexFlags|pass->animTexFlags[j]) & IT_CUBEMAP)
+							continue;
+
+						if (numImages + numMatImages == MAX_PREFETCH_IMAGES)
+						{
+							bFull = true;
+							break;
+						}
+						imageNames[numImages + numMatImages++] = pass->animNames[j];
+					}
+				}
+			}
+		}
+
+		// Leave it for the next batch, unless it's the first
+		if (bFull && numMats)
+			break;
+
+		numImages += numMatImages;
+		imageEnds[numMats++] = numImages;
+		if (bFull)
+			break;
+	}
+
+	// Count the materials whose images were all taken
+	const int numTaken = R_PrefetchImages(imageNames, numImages);
+	int numCovered = 1;
+	while (numCovered < numMats && imageEnds[numCovered] <= numTaken)
+		numCovered++;
+
+	return numCovered;
+}
+
 refMaterial_t *R_RegisterPic(const char *name)
 {
 	return R_RegisterMaterial(name, MAT_RT_PIC);
@@ -3390,6 +3923,9 @@ void R_MaterialInit()
 	// Load scripts
 	r_numMaterialErrors = 0;
 	r_numMaterialWarnings = 0;
+	R_BuildKeyTable (&r_materialPassTable, r_materialPassKeys);
+	R_BuildKeyTable (&r_materialBaseTable, r_materialBaseKeys);
+	R_OpenMaterialCache ();
 	var fileList = FS_FindFiles ("scripts", "*scripts/*.shd", "shd", true, false);
 	fileList.AddRange(FS_FindFiles ("scripts", "*scripts/*.shader", "shader", true, false));
 	for (uint32 i=0 ; i<fileList.Count(); i++) {
@@ -3411,6 +3947,9 @@ void R_MaterialInit()
 		R_ParseMaterialFile (name, pathType);
 	}
 
+	// Save what was parsed for next time
+	DiskCache_Close (&r_matCache);
+
 	// Material counterparts
 	ri.media.cinMaterial = R_RegisterMaterial(ri.media.cinTexture->name, MAT_RT_PIC, true);
 	ri.media.noMaterial = R_RegisterMaterial(ri.media.noTexture->name, MAT_RT_BSP, true);
@@ -3440,6 +3979,7 @@ void R_MaterialInit()
 
 	Com_Printf (0, "MATERIALS - %i error(s), %i warning(s)\n", r_numMaterialErrors, r_numMaterialWarnings);
 	Com_Printf (0, "%i materials loaded in %6.2fms\n", r_numMaterials, (Sys_Cycles()-startCycles) * Sys_MSPerCycle());
+	Com_Printf (0, "%i script(s) from %s, %i parsed\n", r_matCache.hits, MATCACHE_FILE, r_matCache.misses + r_matCache.stale);
 	Com_Printf (0, "----------------------------------------\n");
 }
 
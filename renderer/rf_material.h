@@ -372,6 +372,8 @@ extern refMaterial_t	r_materialList[MAX_MATERIALS];
 
 void R_EndMaterialRegistration();
 
+int R_PrefetchMaterials(const char **names, const matSurfParams_t *surfParams, const int numNames);
+
 refMaterial_t *R_RegisterFlare(const char *name);
 refMaterial_t *R_RegisterSky(const char *name);
 refMaterial_t *R_RegisterTexture(const char *name, const matSurfParams_t surfParams);
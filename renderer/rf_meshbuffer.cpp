@@ -161,23 +161,13 @@ refMaterial_t *refMeshBuffer::DecodeMaterial()
 
 /*
 =============
-refMeshList::AddToList
+refMeshList::NewBuffer
+
+Picks the buffer for the material and appends an entry, NULL if it's full.
 =============
 */
-refMeshBuffer *refMeshList::AddToList(EMeshBufferType meshType, void *mesh, refMaterial_t *mat, float matTime, refEntity_t *ent, struct mQ3BspFog_t *fog, const int infoKey)
+refMeshBuffer *refMeshList::NewBuffer(const refMaterial_t *mat)
 {
-	assert(meshType >= 0 && meshType < MBT_MAX);
-
-	// Check if it qualifies to be added to the list
-	if (!mat)
-		return NULL;
-	else if (!mat->numPasses)
-		return NULL;
-	if (!mesh)
-		return NULL;
-
-	// Choose the buffer to append to
-	refMeshBuffer *Result;
 	switch(mat->sortKey)
 	{
 	case MAT_SORT_SKY:
@@ -186,16 +176,14 @@ refMeshBuffer *refMeshList::AddToList(EMeshBufferType meshType, void *mesh, refM
 			return NULL;
 
 		meshBufferOpaque.Add(refMeshBuffer());
-		Result = &meshBufferOpaque[meshBufferOpaque.Count() - 1];
-		break;
+		return &meshBufferOpaque[meshBufferOpaque.Count() - 1];
 
 	case MAT_SORT_POSTPROCESS:
 		if (meshBufferPostProcess.Count() >= MAX_POSTPROC_BUFFER)
 			return NULL;
 
-		meshBufferOpaque.Add(refMeshBuffer());
-		Result = &meshBufferPostProcess[meshBufferPostProcess.Count() - 1];
-		break;
+		meshBufferPostProcess.Add(refMeshBuffer());
+		return &meshBufferPostProcess[meshBufferPostProcess.Count() - 1];
 
 	case MAT_SORT_PORTAL:
 		if (ri.scn.viewType == RVT_MIRROR || ri.scn.viewType == RVT_PORTAL)
@@ -207,9 +195,32 @@ refMeshBuffer *refMeshList::AddToList(EMeshBufferType meshType, void *mesh, refM
 			return NULL;
 
 		meshBufferAdditive.Add(refMeshBuffer());
-		Result = &meshBufferAdditive[meshBufferAdditive.Count() - 1];
-		break;
+		return &meshBufferAdditive[meshBufferAdditive.Count() - 1];
 	}
+}
+
+
+/*
+=============
+refMeshList::AddToList
+=============
+*/
+refMeshBuffer *refMeshList::AddToList(EMeshBufferType meshType, void *mesh, refMaterial_t *mat, float matTime, refEntity_t *ent, struct mQ3BspFog_t *fog, const int infoKey)
+{
+	assert(meshType >= 0 && meshType < MBT_MAX);
+
+	// Check if it qualifies to be added to the list
+	if (!mat)
+		return NULL;
+	else if (!mat->numPasses)
+		return NULL;
+	if (!mesh)
+		return NULL;
+
+	// Choose the buffer to append to
+	refMeshBuffer *Result = NewBuffer(mat);
+	if (!Result)
+		return NULL;
 
 	// Fill it in
 	Result->Setup(meshType, mesh, mat, matTime, ent, fog, infoKey);
@@ -217,6 +228,81 @@ refMeshBuffer *refMeshList::AddToList(EMeshBufferType meshType, void *mesh, refM
 }
 
 
+/*
+=============
+refMeshList::AddStaged
+
+AddToList for a slot filled by refMeshSlot::Setup.
+=============
+*/
+refMeshBuffer *refMeshList::AddStaged(const refMeshSlot &slot)
+{
+	if (!slot.mat)
+		return NULL;
+
+	refMeshBuffer *Result = NewBuffer(slot.mat);
+	if (!Result)
+		return NULL;
+
+	R_MBCopy(slot.mb, *Result);
+	return Result;
+}
+
+
+/*
+=============
+refMeshSlot::Setup
+
+Makes the same checks as AddToList up front, anything that depends on what's
+already in the list waits for AddStaged. Safe to call from a job.
+=============
+*/
+void refMeshSlot::Setup(const EMeshBufferType meshType, void *mesh, refMaterial_t *inMat, const float matTime, refEntity_t *ent, struct mQ3BspFog_t *fog, const int infoKey)
+{
+	assert(meshType >= 0 && meshType < MBT_MAX);
+
+	mat = NULL;
+	if (!inMat || !inMat->numPasses || !mesh)
+		return;
+
+	mat = inMat;
+	mb.Setup(meshType, mesh, inMat, matTime, ent, fog, infoKey);
+}
+
+
+/*
+=============
+R_HashMeshSlots
+
+FNV-1a over everything a slot would add, for checking staged scenes.
+=============
+*/
+uint32 R_HashMeshSlots(const refMeshSlot *slots, const uint32 numSlots, uint32 hash)
+{
+	for (uint32 i=0 ; i<numSlots ; i++)
+	{
+		const refMeshSlot &slot = slots[i];
+		if (!slot.mat)
+		{
+			hash = Com_FNVMix(hash, 0xffffffff);
+			continue;
+		}
+
+		uint32 words[4];
+		words[0] = (uint32)slot.mb.sortValue;
+		words[1] = (uint32)(slot.mb.sortValue >> 32);
+		memcpy(&words[2], &slot.mb.matTime, sizeof(float));
+		words[3] = (uint32)slot.mb.infoKey;
+
+		for (int w=0 ; w<4 ; w++)
+			hash = Com_FNVMix(hash, words[w]);
+		hash = Com_FNVMix(hash, (uint32)(size_t)slot.mb.mesh);
+	}
+
+	return hash;
+}
+
+
 /*
 ================
 R_QSortMeshBuffers
@@ -334,6 +420,212 @@ static void R_ISortMeshBuffers(TList<T> &meshes, int numMeshes)
 }
 
 
+/*
+=============================================================================
+
+	RADIX SORT
+
+=============================================================================
+*/
+
+struct meshSortPair_t
+{
+	uint64					key;
+	uint32					index;
+};
+
+struct meshSortCache_t
+{
+	uint32					hash;
+	uint32					numMeshes;
+	uint32					order[MAX_MESH_BUFFER];
+};
+
+static meshSortPair_t	r_sortPairs[2][MAX_MESH_BUFFER];
+static refMeshBuffer	r_sortScratch[MAX_MESH_BUFFER];
+
+// Last frame's order for the opaque and additive lists of every view type
+static meshSortCache_t	r_sortCache[RVT_MAX][2];
+
+/*
+================
+R_RadixSortPairs
+
+LSD radix sort on the key, a byte per pass. All eight histograms are built in
+one pass up front, and a byte that every key agrees on (mesh type, fog, sort
+key on most lists) gets no pass at all. Stable, so equal keys keep the order
+they were added in. Returns whichever of the two buffers holds the result.
+================
+*/
+static meshSortPair_t *R_RadixSortPairs(meshSortPair_t *pairs, meshSortPair_t *temp, const uint32 numPairs)
+{
+	static uint32 counts[8][256];
+	memset(counts, 0, sizeof(counts));
+
+	uint64 keyOr = 0, keyAnd = ~(uint64)0;
+	for (uint32 i=0 ; i<numPairs ; i++)
+	{
+		const uint64 key = pairs[i].key;
+		keyOr |= key;
+		keyAnd &= key;
+
+		for (int b=0 ; b<8 ; b++)
+			counts[b][(key >> (b*8)) & 0xff]++;
+	}
+
+	const uint64 diff = keyOr ^ keyAnd;
+	meshSortPair_t *src = pairs, *dst = temp;
+	for (int b=0 ; b<8 ; b++)
+	{
+		const int shift = b*8;
+		if (!((diff >> shift) & 0xff))
+			continue;
+
+		uint32 offset = 0;
+		for (int i=0 ; i<256 ; i++)
+		{
+			const uint32 count = counts[b][i];
+			counts[b][i] = offset;
+			offset += count;
+		}
+
+		for (uint32 i=0 ; i<numPairs ; i++)
+			dst[counts[b][(src[i].key >> shift) & 0xff]++] = src[i];
+
+		meshSortPair_t *swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	return src;
+}
+
+
+/*
+================
+R_HashSortKeys
+================
+*/
+static uint32 R_HashSortKeys(const refMeshBuffer *meshes, const uint32 numMeshes)
+{
+	uint32 hash = COM_FNV_SEED;
+	for (uint32 i=0 ; i<numMeshes ; i++)
+	{
+		hash = Com_FNVMix(hash, (uint32)meshes[i].sortValue);
+		hash = Com_FNVMix(hash, (uint32)(meshes[i].sortValue >> 32));
+	}
+
+	return hash;
+}
+
+
+/*
+================
+R_GatherMeshBuffers
+
+Reorders the list by order through the scratch buffer. Fails without touching
+the list if the result isn't sorted, which can only happen on a hash collision.
+================
+*/
+static bool R_GatherMeshBuffers(refMeshBuffer *meshes, const uint32 numMeshes, const uint32 *order, refMeshBuffer *scratch)
+{
+	uint64 lastKey = 0;
+	for (uint32 i=0 ; i<numMeshes ; i++)
+	{
+		const refMeshBuffer &mb = meshes[order[i]];
+		if (mb.sortValue < lastKey)
+			return false;
+		lastKey = mb.sortValue;
+
+		R_MBCopy(mb, scratch[i]);
+	}
+
+	memcpy(meshes, scratch, sizeof(refMeshBuffer) * numMeshes);
+	return true;
+}
+
+
+/*
+================
+R_RadixSortList
+
+Sorts numMeshes buffers in place, using pairs and scratch as work space.
+Returns the sorted pairs, so the caller can keep the order.
+================
+*/
+static const meshSortPair_t *R_RadixSortList(refMeshBuffer *list, const uint32 numMeshes, meshSortPair_t *pairs, meshSortPair_t *temp, refMeshBuffer *scratch)
+{
+	uint32 i;
+	for (i=0 ; i<numMeshes ; i++)
+	{
+		pairs[i].key = list[i].sortValue;
+		pairs[i].index = i;
+	}
+	const meshSortPair_t *sorted = R_RadixSortPairs(pairs, temp, numMeshes);
+
+	for (i=0 ; i<numMeshes ; i++)
+		R_MBCopy(list[sorted[i].index], scratch[i]);
+	memcpy(list, scratch, sizeof(refMeshBuffer) * numMeshes);
+
+	return sorted;
+}
+
+
+/*
+================
+R_IsSorted
+================
+*/
+static bool R_IsSorted(const refMeshBuffer *list, const uint32 numMeshes)
+{
+	for (uint32 i=1 ; i<numMeshes ; i++)
+	{
+		if (list[i].sortValue < list[i-1].sortValue)
+			return false;
+	}
+
+	return true;
+}
+
+
+/*
+================
+R_RadixSortMeshBuffers
+
+Most frames add the same meshes in the same order as the last one, so the key
+sequence is hashed and, if it matches, last frame's order is simply replayed.
+================
+*/
+static void R_RadixSortMeshBuffers(TList<refMeshBuffer> &meshes, meshSortCache_t *cache)
+{
+	const uint32 numMeshes = meshes.Count();
+	if (numMeshes < 2)
+		return;
+
+	refMeshBuffer *list = &meshes[0];
+	if (R_IsSorted(list, numMeshes))
+		return;
+
+	uint32 hash = 0;
+	if (cache)
+	{
+		hash = R_HashSortKeys(list, numMeshes);
+		if (cache->numMeshes == numMeshes && cache->hash == hash && R_GatherMeshBuffers(list, numMeshes, cache->order, r_sortScratch))
+			return;
+	}
+
+	const meshSortPair_t *sorted = R_RadixSortList(list, numMeshes, r_sortPairs[0], r_sortPairs[1], r_sortScratch);
+
+	if (cache)
+	{
+		cache->hash = hash;
+		cache->numMeshes = numMeshes;
+		for (uint32 i=0 ; i<numMeshes ; i++)
+			cache->order[i] = sorted[i].index;
+	}
+}
+
+
 /*
 =============
 refMeshList::SortList
@@ -344,6 +636,15 @@ void refMeshList::SortList()
 	if (r_debugSorting->intVal)
 		return;
 
+	if (r_radixSort->intVal)
+	{
+		meshSortCache_t *cache = r_sortCache[this - ri.scn.meshLists];
+		R_RadixSortMeshBuffers(meshBufferOpaque, &cache[0]);
+		R_RadixSortMeshBuffers(meshBufferAdditive, &cache[1]);
+		R_RadixSortMeshBuffers(meshBufferPostProcess, NULL);
+		return;
+	}
+
 	// Sort meshes
 	if (meshBufferOpaque.Count() != 0)
 		R_QSortMeshBuffers(meshBufferOpaque, 0, meshBufferOpaque.Count() - 1);
@@ -358,6 +659,113 @@ void refMeshList::SortList()
 }
 
 
+/*
+=============
+R_SortBench_f
+
+Times the mesh buffer sorts over the keys added in the last normal view, tiled
+out to 1k, 10k and 50k entries. Falls back to random keys with no map loaded.
+=============
+*/
+void R_SortBench_f()
+{
+	static const uint32 benchSizes[] = { 1000, 10000, 50000 };
+	const uint32 numSizes = sizeof(benchSizes) / sizeof(benchSizes[0]);
+	const uint32 maxSize = benchSizes[numSizes-1];
+	const int numRuns = (Cmd_Argc() > 1) ? max(atoi(Cmd_Argv(1)), 1) : 20;
+
+	// Capture the keys
+	TList<uint64> captured;
+	refMeshList *last = &ri.scn.meshLists[RVT_NORMAL];
+	for (uint32 i=0 ; i<last->meshBufferOpaque.Count() ; i++)
+		captured.Add(last->meshBufferOpaque[i].sortValue);
+	for (uint32 i=0 ; i<last->meshBufferAdditive.Count() ; i++)
+		captured.Add(last->meshBufferAdditive[i].sortValue);
+
+	if (!captured.Count())
+	{
+		Com_Printf(0, "No meshes in the last frame, using random keys\n");
+		for (uint32 i=0 ; i<1024 ; i++)
+		{
+			uint64 key = (uint64)(rand() & (MBT_MAX-1));
+			key |= (uint64)(rand() & 255) << 5;
+			key |= (uint64)(rand() & 1023) << 18;
+			key |= (uint64)(rand() & 15) << 32;
+			key |= (uint64)(MAT_SORT_OPAQUE+1) << 57;
+			captured.Add(key);
+		}
+	}
+
+	refMeshBuffer *source = new refMeshBuffer[maxSize];
+	refMeshBuffer *scratch = new refMeshBuffer[maxSize];
+	meshSortPair_t *pairs = new meshSortPair_t[maxSize*2];
+	uint32 *order = new uint32[maxSize];
+	TList<refMeshBuffer> meshes;
+
+	Com_Printf(0, "Sorting %i captured keys, %i runs (ms per sort):\n", captured.Count(), numRuns);
+	Com_Printf(0, "%8s %8s %8s %8s %8s\n", "meshes", "qsort", "radix", "replay", "sorted");
+
+	for (uint32 s=0 ; s<numSizes ; s++)
+	{
+		const uint32 numMeshes = benchSizes[s];
+		for (uint32 i=0 ; i<numMeshes ; i++)
+		{
+			source[i].sortValue = captured[i % captured.Count()];
+			source[i].matTime = 0;
+			source[i].mesh = NULL;
+			source[i].infoKey = i;
+		}
+
+		meshes.Clear();
+		for (uint32 i=0 ; i<numMeshes ; i++)
+			meshes.Add(source[i]);
+		refMeshBuffer *list = &meshes[0];
+
+		uint32 qsortCycles = 0, radixCycles = 0, replayCycles = 0, sortedCycles = 0;
+		bool bValid = true;
+		for (int run=0 ; run<numRuns ; run++)
+		{
+			// Old quick sort
+			memcpy(list, source, sizeof(refMeshBuffer) * numMeshes);
+			uint32 start = Sys_Cycles();
+			R_QSortMeshBuffers(meshes, 0, numMeshes-1);
+			qsortCycles += Sys_Cycles() - start;
+
+			// Full radix sort
+			memcpy(list, source, sizeof(refMeshBuffer) * numMeshes);
+			start = Sys_Cycles();
+			const meshSortPair_t *sorted = R_RadixSortList(list, numMeshes, pairs, pairs+maxSize, scratch);
+			radixCycles += Sys_Cycles() - start;
+
+			bValid &= R_IsSorted(list, numMeshes);
+			for (uint32 i=0 ; i<numMeshes ; i++)
+				order[i] = sorted[i].index;
+
+			// Same keys as last frame
+			memcpy(list, source, sizeof(refMeshBuffer) * numMeshes);
+			start = Sys_Cycles();
+			bValid &= R_GatherMeshBuffers(list, numMeshes, order, scratch);
+			replayCycles += Sys_Cycles() - start;
+
+			// Nothing to do
+			start = Sys_Cycles();
+			bValid &= R_IsSorted(list, numMeshes);
+			sortedCycles += Sys_Cycles() - start;
+		}
+
+		const double msPerRun = Sys_MSPerCycle() / numRuns;
+		Com_Printf(0, "%8i %8.3f %8.3f %8.3f %8.3f%s\n", numMeshes,
+			qsortCycles * msPerRun, radixCycles * msPerRun, replayCycles * msPerRun, sortedCycles * msPerRun,
+			bValid ? "" : " MISSORTED");
+	}
+
+	delete[] source;
+	delete[] scratch;
+	delete[] pairs;
+	delete[] order;
+}
+
+
 /*
 =============
 refMeshList::BatchMeshBuffer
@@ -475,6 +883,25 @@ void refMeshList::BatchMeshBuffer(refMeshBuffer *mb, refMeshBuffer *nextMB)
 		}
 		break;
 
+	case MBT_PARTICLE:
+		{
+			// Always batched, the quads are expanded straight into the batch
+			features &= ~MF_NONBATCHED;
+
+			// Push the quads
+			R_PushParticles(mb, features);
+
+			if (!nextMB
+			|| nextMB->sortValue != mb->sortValue
+			|| nextMB->matTime != mb->matTime
+			|| R_ParticleOverflow(nextMB))
+			{
+				RB_LoadModelIdentity();
+				RB_RenderMeshBuffer(mb);
+			}
+		}
+		break;
+
 	case MBT_Q2BSP:
 		{
 			if (!ri.scn.bDrawingMeshOutlines)
@@ -633,6 +1060,9 @@ refMeshList::DrawList
 */
 void refMeshList::DrawList()
 {
+	// Rebuild dynamic lightmaps for the whole list at once
+	R_Q2BSP_UpdateLightmaps(this);
+
 	// Start
 	RB_StartRendering();
 
@@ -521,7 +521,7 @@ struct bspFormat_t
 	const char	*headerStr;
 	int			headerLen;
 	int			version;
-	bool		(*loader) (refModel_t *model, byte *buffer);
+	bool		(*loader) (refModel_t *model, byte *buffer, const int fileLen);
 };
 
 static bspFormat_t r_bspFormats[] =
@@ -584,7 +584,7 @@ static refModel_t *R_LoadBSPModel(const char *name)
 	// Load
 	Q_strncpyz(model->bareName, bareName, sizeof(model->bareName));
 	Q_strncpyz(model->name, name, sizeof(model->name));
-	if (!descr->loader(model, buffer))
+	if (!descr->loader(model, buffer, fileLen))
 	{
 		Mem_FreeTag(ri.modelSysPool, model->memTag);
 		model->type = MODEL_BAD;
@@ -628,8 +628,10 @@ void R_RegisterMap(const char *mapName)
 	}
 
 	// Load the model
+	uint32 startCycles = Sys_Cycles();
 	ri.scn.worldModel = R_LoadBSPModel(mapName);
 	ri.scn.worldEntity->model = ri.scn.worldModel;
+	Com_Printf(0, "Map '%s' loaded in %6.2fms (%i images prefetched, %i from cache, %i resampled)\n", mapName, (Sys_Cycles()-startCycles) * Sys_MSPerCycle(), ri.reg.imagesPrefetched, ri.reg.imagesCached, ri.reg.imagesResampled);
 
 	// Force updates (markleaves, light marking, etc)
 	ri.scn.viewCluster = -1;
@@ -669,6 +671,9 @@ void R_EndModelRegistration()
 	}
 
 	Com_DevPrintf(PRNT_CONSOLE, "Completing model system registration:\n-Released: %i\n-Touched: %i\n-Seaked: %i\n", ri.reg.modelsReleased, ri.reg.modelsTouched, ri.reg.modelsSeaked);
+
+	// Save whatever this map added to the model cache
+	R_ModelCacheFlush();
 }
 
 refAliasAnimation_t blankAnimation;
@@ -1018,42 +1023,56 @@ static void R_ModelList_f()
 
 /*
 ===============
-R_AddInternalModelToList
+R_InternalModelBounds
+
+World bounds R_CullEntityList tests the model with, false if it isn't drawn
+in this view at all.
 ===============
 */
-void R_AddInternalModelToList(refEntity_t *ent)
+bool R_InternalModelBounds(refEntity_t *ent, vec3_t outMins, vec3_t outMaxs)
 {
 	if (ri.scn.viewType == RVT_MIRROR)
 	{
 		if (ent->flags & RF_WEAPONMODEL) 
-			return;
+			return false;
 	}
 	else
 	{
 		if (ent->flags & RF_VIEWERMODEL) 
-			return;
+			return false;
 		if (ent->flags & RF_WEAPONMODEL) 
-			return;
+			return false;
 	}
 
 	refModel_t *model = ent->model;
 
-	vec3_t outMins, outMaxs;
 	Vec3Add(ent->origin, model->mins, outMins);
 	Vec3Add(ent->origin, model->maxs, outMaxs);
-	float outRadius = model->radius;
 	if (ent->scale != 1.0f)
 	{
 		Vec3Scale(outMins, ent->scale, outMins);
 		Vec3Scale(outMaxs, ent->scale, outMaxs);
-		outRadius *= ent->scale;
 	}
 
-	if (R_CullBox(outMins, outMaxs, ri.scn.clipFlags))
-		return;
+	return true;
+}
+
+
+/*
+===============
+R_StageInternalModel
+===============
+*/
+void R_StageInternalModel(refEntity_t *ent, refMeshSlot *slot)
+{
+	refModel_t *model = ent->model;
+
+	float outRadius = model->radius;
+	if (ent->scale != 1.0f)
+		outRadius *= ent->scale;
 
 	mQ3BspFog_t *Fog = R_FogForSphere(ent->origin, outRadius);
-	ri.scn.currentList->AddToList(MBT_INTERNAL, model, ri.media.noMaterialAlias, 0.0f, ent, Fog, 0);
+	slot->Setup(MBT_INTERNAL, model, ri.media.noMaterialAlias, 0.0f, ent, Fog, 0);
 }
 
 /*
@@ -1252,6 +1271,7 @@ void R_ModelInit()
 	cmd_modelList = Cmd_AddCommand("modellist",	0, R_ModelList_f,		"Prints to the console a list of loaded models and their sizes");
 
 	R_ModelBSPInit();
+	R_ModelCacheInit();
 
 	memset(r_modelList, 0, sizeof(refModel_t) * MAX_REF_MODELS);
 	memset(r_modelHashTree, 0, sizeof(refModel_t *) * MAX_REF_MODEL_HASH);
@@ -1280,6 +1300,8 @@ void R_ModelShutdown ()
 	for (uint32 i=0 ; i<r_numModels ; i++)
 		R_FreeModel(&r_modelList[i]);
 
+	R_ModelCacheShutdown();
+
 	// Release pool memory
 	uint32 size = Mem_FreePool(ri.modelSysPool);
 	Com_Printf(0, "...releasing %u bytes...\n", size);
@@ -292,6 +292,7 @@ struct mBspSurface_t
 	refMesh_t				*mesh;
 
 	uint32					fragmentFrame;
+	uint32					occlusionFrame;
 
 	int						lmTexNum;
 	uint32					dLightFrame;
@@ -410,6 +411,11 @@ struct mBspModelBase_t : public mModelDataBase_t
 	int						numLeafs;		// number of visible leafs, not counting 0
 	mBspLeaf_t				*leafs;
 
+	// Leafs grouped by cluster, cluster c owns clusterLeafs[clusterFirstLeaf[c]] up to clusterFirstLeaf[c+1]
+	int						numClusters;
+	int						*clusterFirstLeaf;
+	mBspLeaf_t				**clusterLeafs;
+
 	int						numNodes;
 	mBspNode_t				*nodes;
 
@@ -504,9 +510,11 @@ struct refModel_t
 // rf_alias.c
 //
 
-bool R_CullAliasModel(refEntity_t *ent, const uint32 clipFlags);
-void R_AddAliasModelToList(refEntity_t *ent);
+bool R_AliasCullBounds(refEntity_t *ent, vec3_t outMins, vec3_t outMaxs, bool &bCulled);
+bool R_CullAliasModel(refEntity_t *ent, const vec3_t mins, const vec3_t maxs);
+void R_StageAliasModel(refEntity_t *ent, refMeshSlot *slots);
 void R_DrawAliasModel(refMeshBuffer *mb, const meshFeatures_t features);
+void R_AliasInit();
 
 //
 // rf_model.c
@@ -516,7 +524,8 @@ void R_BuildTangentVectors(const int numVertexes, const vec3_t *vertexArray, con
 
 void R_EndModelRegistration();
 
-void R_AddInternalModelToList(refEntity_t *ent);
+bool R_InternalModelBounds(refEntity_t *ent, vec3_t outMins, vec3_t outMaxs);
+void R_StageInternalModel(refEntity_t *ent, refMeshSlot *slot);
 void R_DrawInternalModel(refMeshBuffer *mb, const meshFeatures_t features);
 
 void R_ModelInit();
@@ -535,7 +544,8 @@ mQ3BspFog_t *R_FogForSphere(const vec3_t center, const float radius);
 // rf_sprite.c
 //
 
-void R_AddSP2ModelToList(refEntity_t *ent);
+bool R_SP2ModelRadius(refEntity_t *ent, float &outRadius);
+void R_StageSP2Model(refEntity_t *ent, refMeshSlot *slot);
 void R_DrawSP2Model(refMeshBuffer *mb, const meshFeatures_t features);
 
 bool R_FlareOverflow();
@@ -23,6 +23,103 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 #include "rf_modelLocal.h"
 
+/*
+===============================================================================
+
+	MODEL CACHE
+
+===============================================================================
+*/
+
+// Payload stored in the model cache for MD2/MD2E files:
+// [mAliasCache_t]
+// [int] indRemap, numIndexes
+// [index_t] outIndex, numIndexes
+// [byte] latLong pairs, numVerts per frame, numFrames frames
+struct mAliasCache_t
+{
+	uint32					numIndexes;
+	uint32					numVerts;
+	uint32					numFrames;		// Frames with stored normals, 0 for just the remap
+};
+
+int				indRemap[MD2_MAX_TRIANGLES*3];
+
+static inline uint32 R_AliasCacheSize(const int numIndexes, const int numVerts, const int numFrames)
+{
+	return sizeof(mAliasCache_t) + (sizeof(int) + sizeof(index_t)) * numIndexes + 2 * numVerts * numFrames;
+}
+
+/*
+=================
+R_FindAliasCache
+
+Fills indRemap and outIndex from the model cache and returns the stored
+normals, or the end of the payload with no normal frames. NULL on a miss, or
+if anything in the entry is out of range.
+=================
+*/
+static const byte *R_FindAliasCache(refModel_t *model, const byte *buffer, const int fileLen, const int numIndexes, const int numFrames, index_t *outIndex, int &numVerts)
+{
+	uint32 length;
+	const byte *data = R_FindModelCache(model->name, buffer, fileLen, length);
+	if (!data || length < sizeof(mAliasCache_t))
+		return NULL;
+
+	mAliasCache_t header;
+	memcpy(&header, data, sizeof(header));
+	if (header.numIndexes != (uint32)numIndexes
+	|| header.numFrames != (uint32)numFrames
+	|| header.numVerts == 0 || header.numVerts > (uint32)numIndexes
+	|| length != R_AliasCacheSize(numIndexes, header.numVerts, numFrames))
+		return NULL;
+
+	data += sizeof(header);
+	memcpy(indRemap, data, sizeof(int) * numIndexes);
+	data += sizeof(int) * numIndexes;
+	memcpy(outIndex, data, sizeof(index_t) * numIndexes);
+	data += sizeof(index_t) * numIndexes;
+
+	for (int i=0 ; i<numIndexes ; i++)
+	{
+		if (indRemap[i] < 0 || indRemap[i] >= numIndexes || outIndex[i] < 0 || outIndex[i] >= (index_t)header.numVerts)
+			return NULL;
+	}
+
+	numVerts = header.numVerts;
+	return data;
+}
+
+
+/*
+=================
+R_NewAliasCache
+
+Allocates a cache payload with the remap filled in. outNormals is where the
+caller writes the normals of each frame, in order.
+=================
+*/
+static byte *R_NewAliasCache(const int numIndexes, const int numVerts, const int numFrames, const index_t *outIndex, uint32 &outLength, byte *&outNormals)
+{
+	outLength = R_AliasCacheSize(numIndexes, numVerts, numFrames);
+	byte *data = (byte *)Mem_PoolAlloc(outLength, ri.genericPool, 0);
+
+	mAliasCache_t header;
+	header.numIndexes = numIndexes;
+	header.numVerts = numVerts;
+	header.numFrames = numFrames;
+	memcpy(data, &header, sizeof(header));
+
+	byte *out = data + sizeof(header);
+	memcpy(out, indRemap, sizeof(int) * numIndexes);
+	out += sizeof(int) * numIndexes;
+	memcpy(out, outIndex, sizeof(index_t) * numIndexes);
+	out += sizeof(index_t) * numIndexes;
+
+	outNormals = out;
+	return data;
+}
+
 /*
 ===============================================================================
 
@@ -101,442 +198,14 @@ static void R_CalcAliasNormals(const int numIndexes, index_t *indexArray, const
 		*(short *)vertexes[i].latLong = *(short *)latLongs[vertRemap[i]];
 }
 
-// File format:
-// [string] "EGLCACHE"
-// (loop until EOF)
-// [uint32] block hash value
-// [length-prefixed string] block unique name
-// [uint32] data length
-// [variable byte] data
-
-// Blocks are always added to the end.
-// Removing blocks from the cache is the most expensive operation.
-static const char *CacheHeader = "EGLCACHE";
-
-class CacheBlock;
-class CacheStorage;
-
-class CacheStorage
-{
-private:
-	fileHandle_t handle;
-	uint32 len;
-	String _fileName;
-
-	// re-seeks to data start and resets length
-	void Reset ()
-	{
-		FS_Seek (handle, 8, FS_SEEK_SET);
-		RecalculateLength();
-	}
-
-	void RecalculateLength()
-	{
-		len = FS_FileLength(handle);
-	}
-
-	friend class CacheBlock;
-
-	template<typename T>
-	T ReadSimpleType ()
-	{
-		T v;
-		FS_Read(&v, sizeof(v), handle);
-		return v;
-	}
-
-	void ReadBuffer (void *buffer, const uint32 length)
-	{
-		FS_Read(buffer, length, handle);
-	}
-
-	String ReadStringLength (uint32 length)
-	{
-		String str;
-
-		for (uint32 i = 0; i < length; ++i)
-			str += ReadSimpleType<char>();
-
-		return str;
-	}
-
-	template<typename T>
-	void WriteSimpleType (const T &value)
-	{
-		FS_Write((void*)&value, sizeof(value), handle);
-	}
-
-	template <typename T>
-	void WriteArray (const T *array, const uint32 length)
-	{
-		FS_Write((void*)array, sizeof(T) * length, handle);
-	}
-
-	void WriteStringLength (const String &string)
-	{
-		WriteSimpleType<uint32>(string.Count());
-		WriteArray<char>(string.CString(), string.Count());
-	}
-
-	void SkipBytes (uint32 bytes)
-	{
-		static byte skipBuf[512];
-
-		while (bytes > 0)
-		{
-			FS_Read(&skipBuf, (bytes > 512) ? 512 : bytes, handle);
-			
-			if (bytes < 512)
-				break;
-
-			bytes -= 512;
-		}
-	}
-
-public:
-	bool IsEOF ()
-	{
-		return FS_Tell(handle) == len;
-	}
-
-	CacheStorage (const String &fileName)
-	{
-		Open (fileName);
-	}
-
-	void Open (const String &fileName)
-	{
-		_fileName = fileName;
-
-		if (FS_FileExists(fileName.CString()) == -1)
-		{
-			FS_OpenFile(fileName.CString(), &handle, FS_MODE_WRITE_BINARY);
-			FS_CloseFile(handle);
-		}
-
-		len = FS_OpenFile(fileName.CString(), &handle, FS_MODE_READ_WRITE_BINARY);
-		
-		// check header
-		if (len == 0)
-		{
-			WriteArray<char>(CacheHeader, 8);
-			len = 8;
-		}
-		else
-		{
-			char header[8];
-			FS_Read(&header, 8, handle);
-
-			if (Q_strnicmp(header, CacheHeader, 8) != 0)
-				throw Exception();
-		}
-	}
-
-	void Close ()
-	{
-		FS_CloseFile(handle);
-	}
-
-	// returns block position in file, < 8 means no match.
-	uint32 FindBlock (const char *UID);
-
-	// deletes a block
-	// block is invalidated after this.
-	void DeleteBlock (CacheBlock &block);
-
-	// Get a block for reading.
-	// If offset is < 8, block is invalid;
-	CacheBlock GetBlock (uint32 offset);
-
-	// Returns a new block for writing.
-	CacheBlock NewBlock ();
-
-	// Create or find a new block.
-	CacheBlock FindOrCreateBlock (const char *UID, bool &created);
-
-	// Only create block (performance increase)
-	CacheBlock CreateBlock (const char *UID);
-};
-
-enum CacheType
-{
-	CACHE_READONLY	= 1,
-	CACHE_WRITEONLY	= 2,
-	CACHE_NEITHER
-};
-
-class ExceptionCacheOperationNotSupported : Exception
-{
-public:
-	ExceptionCacheOperationNotSupported() :
-	  Exception("The operation is not supported in the caches' current state.")
-	  {
-	  };
-};
-
-class CacheBlock
-{
-protected:
-	CacheStorage *_cache;
-	uint32 _position;
-
-	uint32 _idHash;
-	String _id;
-	uint32 _length;
-
-	// for writing
-	TList<byte> _memoryBuffer;
-
-	CacheType _type;
-
-	CacheBlock();
-	CacheBlock(CacheStorage *cache, bool newBlock);
-
-	friend class CacheStorage;
-
-	static CacheBlock _invalidBlock;
-
-public:
-	String &GetID() { return _id; }
-
-	inline bool IsWritable () { return !!(_type & CACHE_WRITEONLY); }
-	inline bool IsReadable () { return !!(_type & CACHE_READONLY); }
-
-	// get real block length, including id/string/hash
-	inline uint32 BlockLength ()
-	{
-		return sizeof(uint32) + sizeof(uint32) + _id.Count() + sizeof(uint32) + _length;
-	}
-
-	inline bool IsValid ()
-	{
-		return (this == &_invalidBlock);
-	}
-
-	template<typename T>
-	void Write (const T &value)
-	{
-		if (!IsWritable())
-			throw ExceptionCacheOperationNotSupported();
-
-		union
-		{
-			T value;
-			byte bytes[sizeof(T)];
-		} wv = {value};
-
-		_memoryBuffer.AddRange(wv.bytes, sizeof(T));
-	}
-
-	void WriteBuffer (const void *data, const uint32 length)
-	{
-		if (!IsWritable())
-			throw ExceptionCacheOperationNotSupported();
-
-		_memoryBuffer.AddRange((byte*)data, length);
-	}
-
-	template<typename T>
-	inline T ReadSimpleType ()
-	{
-		if (!IsReadable())
-			throw ExceptionCacheOperationNotSupported();
-
-		return _cache->ReadSimpleType<T>();
-	}
-
-	inline void ReadBuffer (void *buffer, const uint32 length)
-	{
-		if (!IsReadable())
-			throw ExceptionCacheOperationNotSupported();
-
-		_cache->ReadBuffer(buffer, length);
-	}
-
-	inline String ReadStringLength (uint32 length)
-	{
-		if (!IsReadable())
-			throw ExceptionCacheOperationNotSupported();
-
-		return _cache->ReadStringLength(length);
-	}
-
-	// Flush written data to handle
-	void Flush ();
-};
-
-/*static*/ CacheBlock CacheBlock::_invalidBlock;
-
-CacheBlock::CacheBlock () :
-  _type(CACHE_NEITHER)
-{
-};
-
-CacheBlock::CacheBlock (CacheStorage *cache, bool newBlock) :
-	_cache(cache),
-	_type(newBlock ? CACHE_WRITEONLY : CACHE_READONLY),
-	_position(FS_Tell(cache->handle)),
-	_memoryBuffer(128)
-{
-	if (!newBlock)
-	{
-		_idHash = _cache->ReadSimpleType<uint32>();
-		_id = _cache->ReadStringLength(_cache->ReadSimpleType<uint32>());
-		_length = _cache->ReadSimpleType<uint32>();
-	}
-	else
-		_id = String::Empty();
-};
-
-void CacheBlock::Flush()
-{
-	_cache->WriteSimpleType<uint32>(std::hash<std::string>()(_id.CString()));
-	_cache->WriteStringLength(_id);
-	_cache->WriteSimpleType<uint32>(_memoryBuffer.Count());
-	_cache->WriteArray(_memoryBuffer.Array(), _memoryBuffer.Count()); 
-	_memoryBuffer.Clear();
-
-	_cache->Reset();
-}
-
-// returns block position in file, < 8 means no match.
-uint32 CacheStorage::FindBlock (const char *UID)
-{
-	Reset();
-
-	uint32 realHash = std::hash<std::string>()(UID);
-	uint32 blockNum = 0;
-
-	while (!IsEOF())
-	{
-		CacheBlock block (this, false);
-
-		if (block._idHash == realHash)
-		{
-			if (block._id.Compare(UID) == 0)
-				return block._position;
-			else
-				SkipBytes(block._length);
-		}
-		else
-			SkipBytes(block._length);
-	}
-
-	return 0;
-}
-
-CacheBlock CacheStorage::FindOrCreateBlock (const char *UID, bool &created)
-{
-	uint32 pos = FindBlock(UID);
-	created = false;
-
-	if (!pos)
-	{
-		created = true;
-
-		CacheBlock block = NewBlock();
-		block.GetID() = UID;
-		return block;
-	}
-
-	return GetBlock(pos);
-}
-
-CacheBlock CacheStorage::CreateBlock (const char *UID)
-{
-	CacheBlock block = NewBlock();
-	block.GetID() = UID;
-	return block;
-}
-
-inline void CopyAppendBytes (const char *src, const char *dst, const uint32 position, const uint32 len)
-{
-	fileHandle_t srcHandle, dstHandle;
-
-	FS_OpenFile(src, &srcHandle, FS_MODE_READ_BINARY);
-	FS_OpenFile(dst, &dstHandle, FS_MODE_APPEND_BINARY);
-
-	if (!srcHandle || !dstHandle)
-	{
-		if (srcHandle)
-			FS_CloseFile(srcHandle);
-		
-		if (dstHandle)
-			FS_CloseFile(dstHandle);
-
-		throw Exception();
-	}
-
-	FS_Seek(srcHandle, position, FS_SEEK_SET);
-
-	byte buffer[4096];
-	uint32 realLen = len;
-
-	while (realLen)
-	{
-		int readLen = FS_Read (buffer, ((realLen > sizeof(buffer)) ? sizeof(buffer) : realLen), srcHandle);
-		FS_Write(buffer, readLen, dstHandle);
-
-		realLen -= readLen;
-	}
-
-	FS_CloseFile(srcHandle);
-	FS_CloseFile(dstHandle);
-}
-
-// deletes a block
-// all blocks are invalidated after this.
-// !FIXME: Find a way to make ALL blocks invalidate...
-void CacheStorage::DeleteBlock (CacheBlock &block)
-{
-	Close();
-
-	var backupName = (_fileName + ".bak");
-	FS_RenameFile((String(BASE_MODDIRNAME"/") + _fileName).CString(), (String(BASE_MODDIRNAME"/") + backupName).CString());
-
-	uint32 len = FS_FileLength(backupName.CString());
-	uint32 endOfBlock = block._position + block.BlockLength();
-	uint32 restLen = len - endOfBlock;
-
-	CopyAppendBytes (backupName.CString(), _fileName.CString(), 0, block._position);
-	CopyAppendBytes (backupName.CString(), _fileName.CString(), endOfBlock, restLen);
-
-	FS_DeleteFile(backupName.CString());
-
-	Open(_fileName);
-
-	block = CacheBlock::_invalidBlock;
-}
-
-// Get a block for reading.
-// If offset is < 8, block is invalid;
-CacheBlock CacheStorage::GetBlock (uint32 offset)
-{
-	if (offset < 8)
-		throw Exception();
-
-	FS_Seek(handle, offset, FS_SEEK_SET);
-	return CacheBlock(this, false);
-}
-
-// Returns a new block for writing.
-CacheBlock CacheStorage::NewBlock ()
-{
-	FS_Seek(handle, 0, FS_SEEK_END);
-	return CacheBlock(this, true);
-}
-
 /*
 =================
 R_LoadMD2Model
 =================
 */
-int				indRemap[MD2_MAX_TRIANGLES*3];
 index_t			tempIndex[MD2_MAX_TRIANGLES*3];
 index_t			tempSTIndex[MD2_MAX_TRIANGLES*3];
 
-#include "../shared/MD5.h"
-
 bool R_LoadMD2Model(refModel_t *model)
 {
 	int				i, j, k;
@@ -663,41 +332,6 @@ bool R_LoadMD2Model(refModel_t *model)
 	inTri = (dMd2Triangle_t *) ((byte *)inModel + LittleLong (inModel->ofsTris));
 	inCoord = (dMd2Coord_t *) ((byte *)inModel + LittleLong (inModel->ofsST));
 
-	CacheStorage cache ("_pglCache.pca");
-
-	var blockName = (String(model->name) + "__remap");
-	var blockMd5 = MD5::GenerateMD5(buffer, fileLen);
-
-	bool isNewBlock;
-	CacheBlock &cacheBlock = cache.FindOrCreateBlock(blockName.CString(), isNewBlock);
-
-	if (!isNewBlock)
-	{
-		byte md5Value[16];
-		cacheBlock.ReadBuffer(&md5Value, 16);
-
-		bool isDifferent = false;
-
-		for (int i = 0; i < 16; ++i)
-		{
-			if (md5Value[i] != blockMd5.ByteValues[i])
-			{
-				isDifferent = true;
-				break;
-			}
-		}
-
-		if (isDifferent)
-		{
-			cache.DeleteBlock(cacheBlock);
-			isNewBlock = true;
-			cacheBlock = cache.CreateBlock(blockName.CString());
-		}
-	}
-
-	if (isNewBlock)
-		cacheBlock.WriteBuffer(blockMd5.ByteValues, 16);
-
 	for (i=0, k=0 ; i <outMesh->numTris; i++, k+=3)
 	{
 		tempIndex[k+0] = (index_t)LittleShort (inTri[i].vertsIndex[0]);
@@ -709,7 +343,9 @@ bool R_LoadMD2Model(refModel_t *model)
 		tempSTIndex[k+2] = (index_t)LittleShort (inTri[i].stIndex[2]);
 	}
 
-	if (isNewBlock)
+	// Preprocessed remap and normals from the model cache
+	const byte *cachedNormals = R_FindAliasCache(model, buffer, fileLen, numIndexes, outModel->numFrames, outIndex, numVerts);
+	if (!cachedNormals)
 	{
 		//
 		// Build list of unique vertexes
@@ -752,15 +388,6 @@ bool R_LoadMD2Model(refModel_t *model)
 			outIndex[i] = outIndex[indRemap[i]];
 		}
 
-		cacheBlock.Write<uint32>(numVerts);
-		cacheBlock.WriteBuffer(indRemap, sizeof(int) * numIndexes);
-		cacheBlock.WriteBuffer(outIndex, sizeof(int) * numIndexes);
-	}
-	else
-	{
-		numVerts = cacheBlock.ReadSimpleType<uint32>();
-		cacheBlock.ReadBuffer(indRemap, sizeof(int) * numIndexes);
-		cacheBlock.ReadBuffer(outIndex, sizeof(int) * numIndexes);
 	}
 
 	if (RB_InvalidMesh(numVerts, numIndexes))
@@ -774,6 +401,11 @@ bool R_LoadMD2Model(refModel_t *model)
 							model->name, outMesh->numVerts, numVerts, outMesh->numTris);
 	outMesh->numVerts = numVerts;
 
+	// Start a new cache entry, the normals are filled in per frame below
+	uint32 cacheLength = 0;
+	byte *cacheNormals = NULL;
+	byte *cacheData = cachedNormals ? NULL : R_NewAliasCache(numIndexes, numVerts, outModel->numFrames, outIndex, cacheLength, cacheNormals);
+
 	//
 	// Load base s and t vertices
 	//
@@ -843,18 +475,18 @@ bool R_LoadMD2Model(refModel_t *model)
 			outVertex[outIndex[j]].point[2] = (sint16)inFrame->verts[tempIndex[indRemap[j]]].v[2];
 		}
 		
-		if (isNewBlock)
+		if (cachedNormals)
 		{
-			// Calculate normals
-			R_CalcAliasNormals(numIndexes, outIndex, numVerts, outVertex);
-		
-			for (int x=0 ; x<numVerts ; x++)
-				cacheBlock.Write<short>(*(short *)outVertex[x].latLong);	
+			for (int x=0 ; x<numVerts ; x++, cachedNormals+=2)
+				memcpy(outVertex[x].latLong, cachedNormals, 2);
 		}
 		else
 		{
-			for (int x=0 ; x<numVerts ; x++)
-				*(short *)outVertex[x].latLong = cacheBlock.ReadSimpleType<short>();	
+			// Calculate normals
+			R_CalcAliasNormals(numIndexes, outIndex, numVerts, outVertex);
+
+			for (int x=0 ; x<numVerts ; x++, cacheNormals+=2)
+				memcpy(cacheNormals, outVertex[x].latLong, 2);
 		}
 	}
 
@@ -879,9 +511,8 @@ bool R_LoadMD2Model(refModel_t *model)
 			Com_DevPrintf(PRNT_WARNING, "R_LoadMD2Model: '%s' could not load skin '%s'\n", model->name, outSkins->name);
 	}
 
-	if (isNewBlock)
-		cacheBlock.Flush();
-	cache.Close();
+	if (cacheData)
+		R_StoreModelCache(model->name, buffer, fileLen, cacheData, cacheLength);
 
 	// Done
 	FS_FreeFile (buffer);
@@ -1025,34 +656,50 @@ bool R_LoadMD2EModel(refModel_t *model)
 		tempSTIndex[k+2] = (index_t)LittleShort (inTri[i].stIndex[2]);
 	}
 
-	//
-	// Build list of unique vertexes
-	//
-	numVerts = 0;
-	for (i=0 ; i<numIndexes ; i++)
-		indRemap[i] = -1;
-
-	for (i=0 ; i<numIndexes ; i++)
+	// Preprocessed remap from the model cache
+	const bool bCached = (R_FindAliasCache(model, buffer, fileLen, numIndexes, 0, outIndex, numVerts) != NULL);
+	if (!bCached)
 	{
-		if (indRemap[i] != -1)
-			continue;
+		//
+		// Build list of unique vertexes
+		//
+		numVerts = 0;
+		for (i=0 ; i<numIndexes ; i++)
+			indRemap[i] = -1;
 
-		// Remap duplicates
-		for (j=i+1 ; j<numIndexes ; j++)
+		for (i=0 ; i<numIndexes ; i++)
 		{
-			if (tempIndex[j] != tempIndex[i])
-				continue;
-			if (inCoord[tempSTIndex[j]].s != inCoord[tempSTIndex[i]].s
-				|| inCoord[tempSTIndex[j]].t != inCoord[tempSTIndex[i]].t)
+			if (indRemap[i] != -1)
 				continue;
 
-			indRemap[j] = i;
-			outIndex[j] = numVerts;
+			// Remap duplicates
+			for (j=i+1 ; j<numIndexes ; j++)
+			{
+				if (tempIndex[j] != tempIndex[i])
+					continue;
+				if (inCoord[tempSTIndex[j]].s != inCoord[tempSTIndex[i]].s
+					|| inCoord[tempSTIndex[j]].t != inCoord[tempSTIndex[i]].t)
+					continue;
+
+				indRemap[j] = i;
+				outIndex[j] = numVerts;
+			}
+
+			// Add unique vertex
+			indRemap[i] = i;
+			outIndex[i] = numVerts++;
 		}
 
-		// Add unique vertex
-		indRemap[i] = i;
-		outIndex[i] = numVerts++;
+		//
+		// Remap remaining indexes
+		//
+		for (i=0 ; i<numIndexes; i++)
+		{
+			if (indRemap[i] == i)
+				continue;
+
+			outIndex[i] = outIndex[indRemap[i]];
+		}
 	}
 
 	if (RB_InvalidMesh(numVerts, numIndexes))
@@ -1066,15 +713,12 @@ bool R_LoadMD2EModel(refModel_t *model)
 		model->name, outMesh->numVerts, numVerts, outMesh->numTris);
 	outMesh->numVerts = numVerts;
 
-	//
-	// Remap remaining indexes
-	//
-	for (i=0 ; i<numIndexes; i++)
+	if (!bCached)
 	{
-		if (indRemap[i] == i)
-			continue;
-
-		outIndex[i] = outIndex[indRemap[i]];
+		uint32 cacheLength;
+		byte *cacheNormals;
+		byte *cacheData = R_NewAliasCache(numIndexes, numVerts, 0, outIndex, cacheLength, cacheNormals);
+		R_StoreModelCache(model->name, buffer, fileLen, cacheData, cacheLength);
 	}
 
 	//
@@ -33,6 +33,281 @@ static float		*r_q2_vertexes;
 
 extern int			r_q2_lmBlockSize;
 
+// Surface cache payload for the map being loaded, NULL when it's being built
+static const byte	*r_bspCacheData;
+static uint32		r_bspCacheLength;
+
+/*
+===============================================================================
+
+	SURFACE CACHE
+
+===============================================================================
+*/
+
+// Building surface meshes and packing Q2 lightmaps is most of a map load, and
+// the result only changes with the map or a few settings, so it's kept in a
+// sidecar file (see R_LoadBSPCache). Payload, native endian:
+// [mBspCacheData_t]
+// [mBspCacheSurf_t]	one per surface
+// [meshes]				verts, normals, indexes, coords, lmCoords, colors,
+//						the same layout R_BuildQ2BSPSurface allocates
+// [lightmaps]			Q2 only, numLightmaps blocks of lmBlockSize^2 RGBA
+
+#define BSPCACHE_DATA_VERSION	1
+
+struct mBspCacheData_t
+{
+	uint32					numSurfaces;
+	uint32					numLightmaps;
+	uint32					lmBlockSize;
+	uint32					lightmapOfs;
+};
+
+struct mBspCacheSurf_t
+{
+	uint32					dataOfs;			// 0 when the mesh isn't cached
+	sint32					numVerts;
+	sint32					numIndexes;
+	sint32					bLMCoords;
+
+	sint32					lmTexNum;
+	sint32					lmCoords[2];
+	uint32					patchSize[2];
+};
+
+static inline uint32 R_BSPCacheMeshSize(const int numVerts, const int numIndexes, const bool bLMCoords)
+{
+	return numVerts * (sizeof(vec3_t) * 2 + sizeof(vec2_t) + sizeof(colorb))
+		+ numIndexes * sizeof(index_t)
+		+ (bLMCoords ? numVerts * sizeof(vec2_t) : 0);
+}
+
+static inline const mBspCacheData_t *R_BSPCacheHeader()
+{
+	return (const mBspCacheData_t *)r_bspCacheData;
+}
+
+static inline const mBspCacheSurf_t *R_BSPCacheSurf(const int surfNum)
+{
+	return (const mBspCacheSurf_t *)(r_bspCacheData + sizeof(mBspCacheData_t)) + surfNum;
+}
+
+
+/*
+=================
+R_EndBSPCache
+=================
+*/
+static void R_EndBSPCache()
+{
+	R_FreeBSPCache();
+	r_bspCacheData = NULL;
+	r_bspCacheLength = 0;
+}
+
+
+/*
+=================
+R_BeginBSPCache
+
+Picks up the sidecar for this map if there's one that matches. Only the
+header and lightmap range are checked here, each mesh is checked as it's used.
+=================
+*/
+static bool R_BeginBSPCache(refModel_t *model, const int numSurfaces, const int fileLen, const uint32 sourceHash, const uint32 key)
+{
+	R_EndBSPCache();
+	if (!r_bspCache->intVal)
+		return false;
+
+	uint32 length;
+	const byte *data = R_LoadBSPCache(model->bareName, fileLen, sourceHash, key, length);
+	if (!data)
+		return false;
+
+	const mBspCacheData_t *header = (const mBspCacheData_t *)data;
+	if (length < sizeof(mBspCacheData_t)
+	|| header->numSurfaces != (uint32)numSurfaces
+	|| header->numSurfaces > (length - sizeof(mBspCacheData_t)) / sizeof(mBspCacheSurf_t)
+	|| header->numLightmaps >= MAX_LIGHTMAP_IMAGES
+	|| header->lmBlockSize > 2048
+	|| header->lightmapOfs > length
+	|| header->numLightmaps * header->lmBlockSize * header->lmBlockSize * 4 > length - header->lightmapOfs)
+	{
+		Com_DevPrintf(PRNT_WARNING, "R_BeginBSPCache: surface cache for %s is damaged, rebuilding\n", model->name);
+		R_EndBSPCache();
+		return false;
+	}
+
+	r_bspCacheData = data;
+	r_bspCacheLength = length;
+	return true;
+}
+
+
+/*
+=================
+R_CheckBSPCacheMesh
+
+Makes sure a cached mesh sits inside the payload and only indexes its own
+vertices.
+=================
+*/
+static bool R_CheckBSPCacheMesh(const mBspCacheSurf_t *cs)
+{
+	if (!cs->dataOfs)
+		return true;
+	if (RB_InvalidMesh(cs->numVerts, cs->numIndexes) || (cs->dataOfs & 3))
+		return false;
+
+	const uint32 size = R_BSPCacheMeshSize(cs->numVerts, cs->numIndexes, cs->bLMCoords != 0);
+	if (cs->dataOfs > r_bspCacheLength || size > r_bspCacheLength - cs->dataOfs)
+		return false;
+
+	const index_t *indexes = (const index_t *)(r_bspCacheData + cs->dataOfs + sizeof(vec3_t) * 2 * cs->numVerts);
+	for (int i=0 ; i<cs->numIndexes ; i++)
+	{
+		if (indexes[i] < 0 || indexes[i] >= cs->numVerts)
+			return false;
+	}
+
+	return true;
+}
+
+
+/*
+=================
+R_LoadBSPCacheMesh
+=================
+*/
+static refMesh_t *R_LoadBSPCacheMesh(refModel_t *model, const mBspCacheSurf_t *cs)
+{
+	const uint32 size = R_BSPCacheMeshSize(cs->numVerts, cs->numIndexes, cs->bLMCoords != 0);
+	byte *buffer = (byte*)R_ModAlloc(model, sizeof(refMesh_t) + size);
+
+	refMesh_t *mesh = (refMesh_t *)buffer;
+	buffer += sizeof(refMesh_t);
+	memcpy(buffer, r_bspCacheData + cs->dataOfs, size);
+
+	mesh->numVerts = cs->numVerts;
+	mesh->numIndexes = cs->numIndexes;
+
+	mesh->vertexArray = (vec3_t *)buffer;
+	buffer += sizeof(vec3_t) * cs->numVerts;
+	mesh->normalsArray = (vec3_t *)buffer;
+	buffer += sizeof(vec3_t) * cs->numVerts;
+	mesh->indexArray = (index_t *)buffer;
+	buffer += sizeof(index_t) * cs->numIndexes;
+	mesh->coordArray = (vec2_t *)buffer;
+	buffer += sizeof(vec2_t) * cs->numVerts;
+	if (cs->bLMCoords)
+	{
+		mesh->lmCoordArray = (vec2_t *)buffer;
+		buffer += sizeof(vec2_t) * cs->numVerts;
+	}
+	else
+	{
+		mesh->lmCoordArray = NULL;
+	}
+	mesh->colorArray = (colorb *)buffer;
+	mesh->sVectorsArray = NULL;
+	mesh->tVectorsArray = NULL;
+
+	return mesh;
+}
+
+
+/*
+=================
+R_StoreBSPCacheMesh
+=================
+*/
+static byte *R_StoreBSPCacheMesh(const refMesh_t *mesh, byte *out)
+{
+	memcpy(out, mesh->vertexArray, sizeof(vec3_t) * mesh->numVerts);
+	out += sizeof(vec3_t) * mesh->numVerts;
+	memcpy(out, mesh->normalsArray, sizeof(vec3_t) * mesh->numVerts);
+	out += sizeof(vec3_t) * mesh->numVerts;
+	memcpy(out, mesh->indexArray, sizeof(index_t) * mesh->numIndexes);
+	out += sizeof(index_t) * mesh->numIndexes;
+	memcpy(out, mesh->coordArray, sizeof(vec2_t) * mesh->numVerts);
+	out += sizeof(vec2_t) * mesh->numVerts;
+	if (mesh->lmCoordArray)
+	{
+		memcpy(out, mesh->lmCoordArray, sizeof(vec2_t) * mesh->numVerts);
+		out += sizeof(vec2_t) * mesh->numVerts;
+	}
+	memcpy(out, mesh->colorArray, sizeof(colorb) * mesh->numVerts);
+	out += sizeof(colorb) * mesh->numVerts;
+
+	return out;
+}
+
+
+/*
+=================
+R_WriteBSPSurfaceCache
+
+Saves the mesh of every surface storeMesh picks, and the lightmap placement
+of all of them, along with any Q2 lightmap blocks.
+=================
+*/
+static void R_WriteBSPSurfaceCache(refModel_t *model, const int fileLen, const uint32 sourceHash, const uint32 key, bool (*storeMesh)(const mBspSurface_t *surf),
+								   const int numLightmaps, const int lmBlockSize, const byte *lightmaps)
+{
+	mBspModelBase_t *bspModel = model->BSPData();
+	int i;
+
+	// Size it up
+	uint32 length = sizeof(mBspCacheData_t) + sizeof(mBspCacheSurf_t) * bspModel->numSurfaces;
+	for (i=0 ; i<bspModel->numSurfaces ; i++)
+	{
+		const mBspSurface_t *surf = &bspModel->surfaces[i];
+		if (surf->mesh && storeMesh(surf))
+			length += R_BSPCacheMeshSize(surf->mesh->numVerts, surf->mesh->numIndexes, surf->mesh->lmCoordArray != NULL);
+	}
+	const uint32 lightmapOfs = length;
+	length += numLightmaps * lmBlockSize * lmBlockSize * 4;
+
+	byte *data = (byte *)Mem_PoolAlloc(length, ri.genericPool, 0);
+
+	mBspCacheData_t *header = (mBspCacheData_t *)data;
+	header->numSurfaces = bspModel->numSurfaces;
+	header->numLightmaps = numLightmaps;
+	header->lmBlockSize = lmBlockSize;
+	header->lightmapOfs = lightmapOfs;
+
+	mBspCacheSurf_t *cs = (mBspCacheSurf_t *)(data + sizeof(mBspCacheData_t));
+	byte *out = (byte *)(cs + bspModel->numSurfaces);
+	for (i=0 ; i<bspModel->numSurfaces ; i++, cs++)
+	{
+		const mBspSurface_t *surf = &bspModel->surfaces[i];
+
+		memset(cs, 0, sizeof(mBspCacheSurf_t));
+		cs->lmTexNum = surf->lmTexNum;
+		cs->lmCoords[0] = surf->q2_lmCoords[0];
+		cs->lmCoords[1] = surf->q2_lmCoords[1];
+		cs->patchSize[0] = surf->q3_patchWidth;
+		cs->patchSize[1] = surf->q3_patchHeight;
+
+		if (surf->mesh && storeMesh(surf))
+		{
+			cs->dataOfs = out - data;
+			cs->numVerts = surf->mesh->numVerts;
+			cs->numIndexes = surf->mesh->numIndexes;
+			cs->bLMCoords = (surf->mesh->lmCoordArray != NULL);
+			out = R_StoreBSPCacheMesh(surf->mesh, out);
+		}
+	}
+
+	if (numLightmaps)
+		memcpy(data + lightmapOfs, lightmaps, numLightmaps * lmBlockSize * lmBlockSize * 4);
+
+	R_WriteBSPCache(model->bareName, fileLen, sourceHash, key, data, length);
+	Mem_Free(data);
+}
+
 /*
 ===============================================================================
 
@@ -1098,6 +1373,29 @@ static bool R_LoadQ2BSPPlanes(refModel_t *model, byte *byteBase, const dQ2BspLum
 }
 
 
+/*
+=================
+R_PrefetchQ2BSPTexInfo
+=================
+*/
+static int R_PrefetchQ2BSPTexInfo(mQ2BspModel_t *q2BspModel, const int first)
+{
+	const char *names[64];
+	matSurfParams_t surfParams[64];
+
+	const int numNames = min(q2BspModel->numTexInfo - first, 64);
+	for (int i=0 ; i<numNames ; i++)
+	{
+		mQ2BspTexInfo_t *texInfo = &q2BspModel->texInfo[first+i];
+
+		names[i] = (texInfo->flags & SURF_TEXINFO_SKY) ? NULL : texInfo->texName;
+		surfParams[i] = texInfo->surfParams;
+	}
+
+	return R_PrefetchMaterials(names, surfParams, numNames);
+}
+
+
 /*
 =================
 R_LoadQ2BSPTexInfo
@@ -1149,16 +1447,27 @@ static bool R_LoadQ2BSPTexInfo(refModel_t *model, mQ2BspModel_t *q2BspModel, byt
 		if (!(out->flags & SURF_TEXINFO_WARP))
 			out->surfParams |= MAT_SURF_LIGHTMAP;
 
-		//
-		// Register textures and materials
-		//
+		if (!(out->flags & SURF_TEXINFO_SKY))
+			Com_NormalizePath(out->texName, sizeof(out->texName), Q_VarArgs("textures/%s.wal", in->texture));
+	}
+
+	//
+	// Register textures and materials
+	//
+	for (int i=0, prefetchEnd=0 ; i<q2BspModel->numTexInfo ; i++)
+	{
+		mQ2BspTexInfo_t *out = &q2BspModel->texInfo[i];
+
+		// Decode the next batch of images ahead of time
+		if (i == prefetchEnd)
+			prefetchEnd = i + R_PrefetchQ2BSPTexInfo(q2BspModel, i);
+
 		if (out->flags & SURF_TEXINFO_SKY)
 		{
 			out->mat = ri.media.noMaterialSky;
 		}
 		else
 		{
-			Com_NormalizePath(out->texName, sizeof(out->texName), Q_VarArgs("textures/%s.wal", in->texture));
 			out->mat = R_RegisterTexture(out->texName, out->surfParams);
 			if (!out->mat)
 			{
@@ -1649,13 +1958,104 @@ static bool R_SetupQ2BSPSubModels(refModel_t *model, mQ2BspModel_t *q2BspModel)
 }
 
 
+/*
+=================
+R_Q2BSPCacheKey
+
+Everything besides the map itself that goes into the meshes and lightmaps.
+=================
+*/
+static uint32 R_Q2BSPCacheKey(refModel_t *model)
+{
+	mQ2BspModel_t *q2BspModel = model->Q2BSPData();
+
+	uint32 key = Com_FNVMix(COM_FNV_SEED, BSPCACHE_DATA_VERSION);
+	key = Com_FNVMix(key, R_Q2BSP_LightmapBlockSize());
+	key = Com_FNVMix(key, r_fullbright->intVal);
+	key = Com_FNVMix(key, r_coloredLighting->intVal);
+	key = Com_FNVMix(key, Q_rint(gl_modulate->floatVal * 256));
+
+	for (int i=0 ; i<q2BspModel->numTexInfo ; i++)
+	{
+		const mQ2BspTexInfo_t *texInfo = &q2BspModel->texInfo[i];
+		const refMaterial_t *mat = texInfo->mat;
+
+		key = Com_FNVMix(key, (mat->flags & MAT_SUBDIVIDE) ? mat->subdivide : 0);
+		key = Com_FNVMix(key, mat->numPasses ? 1 : 0);
+
+		// Texcoords are divided by the image size
+		key = Com_FNVMix(key, texInfo->width);
+		key = Com_FNVMix(key, texInfo->height);
+	}
+
+	return key;
+}
+
+
+/*
+=================
+R_CheckQ2BSPCache
+
+Every surface is checked before any of it is used, a bad one means the
+lightmap packing can't be trusted either.
+=================
+*/
+static bool R_CheckQ2BSPCache(refModel_t *model)
+{
+	const mBspCacheData_t *header = R_BSPCacheHeader();
+	if (header->lmBlockSize != (uint32)R_Q2BSP_LightmapBlockSize())
+		return false;
+
+	for (int i=0 ; i<model->BSPData()->numSurfaces ; i++)
+	{
+		mBspSurface_t *surf = &model->BSPData()->surfaces[i];
+		const mBspCacheSurf_t *cs = R_BSPCacheSurf(i);
+
+		if (!R_CheckBSPCacheMesh(cs))
+			return false;
+		if (cs->dataOfs && (cs->bLMCoords != 0) != !(surf->q2_texInfo->flags & (SURF_TEXINFO_SKY|SURF_TEXINFO_WARP)))
+			return false;
+
+		if (cs->lmTexNum == BAD_LMTEXNUM)
+			continue;
+		if (!cs->dataOfs || !cs->bLMCoords
+		|| cs->lmTexNum < 0 || cs->lmTexNum >= (int)header->numLightmaps
+		|| cs->lmCoords[0] < 0 || cs->lmCoords[0] + surf->q2_lmWidth > (int)header->lmBlockSize
+		|| cs->lmCoords[1] < 0 || cs->lmCoords[1] + surf->q2_lmHeight > (int)header->lmBlockSize)
+			return false;
+	}
+
+	return true;
+}
+
+
+/*
+=================
+R_Q2BSPCacheMesh
+=================
+*/
+static bool R_Q2BSPCacheMesh(const mBspSurface_t *surf)
+{
+	return true;
+}
+
+
 /*
 =================
 R_FinishQ2BSPModel
 =================
 */
-static bool R_FinishQ2BSPModel(refModel_t *model)
+static bool R_FinishQ2BSPModel(refModel_t *model, const int fileLen, const uint32 sourceHash)
 {
+	const uint32 cacheKey = R_Q2BSPCacheKey(model);
+	bool bCached = R_BeginBSPCache(model, model->BSPData()->numSurfaces, fileLen, sourceHash, cacheKey);
+	if (bCached && !R_CheckQ2BSPCache(model))
+	{
+		Com_DevPrintf(PRNT_WARNING, "R_FinishQ2BSPModel: surface cache for %s is damaged, rebuilding\n", model->name);
+		R_EndBSPCache();
+		bCached = false;
+	}
+
 	//
 	// Create surface meshes
 	//
@@ -1663,7 +2063,12 @@ static bool R_FinishQ2BSPModel(refModel_t *model)
 	{
 		mBspSurface_t *surf = &model->BSPData()->surfaces[i];
 
-		if (surf->q2_texInfo->mat->flags & MAT_SUBDIVIDE)
+		if (bCached)
+		{
+			const mBspCacheSurf_t *cs = R_BSPCacheSurf(i);
+			surf->mesh = cs->dataOfs ? R_LoadBSPCacheMesh(model, cs) : NULL;
+		}
+		else if (surf->q2_texInfo->mat->flags & MAT_SUBDIVIDE)
 		{
 			if (surf->q2_texInfo->flags & (SURF_TEXINFO_SKY|SURF_TEXINFO_WARP))
 			{
@@ -1752,7 +2157,10 @@ static bool R_FinishQ2BSPModel(refModel_t *model)
 	//
 	// Generate node surface lists
 	//
-	R_Q2BSP_BeginBuildingLightmaps();
+	if (bCached)
+		R_Q2BSP_LoadLightmaps(R_BSPCacheHeader()->lmBlockSize, R_BSPCacheHeader()->numLightmaps, r_bspCacheData + R_BSPCacheHeader()->lightmapOfs);
+	else
+		R_Q2BSP_BeginBuildingLightmaps(r_bspCache->intVal != 0);
 
 	int totalLitRemoved = 0;
 	int totalVisRemoved = 0;
@@ -1782,7 +2190,8 @@ static bool R_FinishQ2BSPModel(refModel_t *model)
 					numLitSurfs++;
 
 					// Build a lightmap
-					R_Q2BSP_CreateSurfaceLightmap(surf);
+					if (!bCached)
+						R_Q2BSP_CreateSurfaceLightmap(surf);
 				}
 			}
 		}
@@ -1828,10 +2237,28 @@ static bool R_FinishQ2BSPModel(refModel_t *model)
 		totalVisRemoved += node->q2_numSurfaces - numVisSurfs;
 	}
 
-	R_Q2BSP_EndBuildingLightmaps();
+	byte *lightmaps = NULL;
+	int numLightmaps = 0;
+	if (!bCached)
+		numLightmaps = R_Q2BSP_EndBuildingLightmaps(&lightmaps);
 
 	Com_DevPrintf(0, "R_FinishQ2BSPModel: %i non-visible %i non-lit surfaces skipped.\n", totalVisRemoved, totalVisRemoved+totalLitRemoved);
 
+	if (bCached)
+	{
+		// The lightmap coordinates came with the meshes
+		for (int i=0 ; i<model->BSPData()->numSurfaces ; i++)
+		{
+			const mBspCacheSurf_t *cs = R_BSPCacheSurf(i);
+			if (cs->lmTexNum != BAD_LMTEXNUM)
+				R_Q2BSP_SetSurfaceLightmap(&model->BSPData()->surfaces[i], cs->lmTexNum, cs->lmCoords[0], cs->lmCoords[1]);
+		}
+
+		R_EndBSPCache();
+		Com_DevPrintf(0, "R_FinishQ2BSPModel: surfaces and lightmaps loaded from cache.\n");
+		return true;
+	}
+
 	//
 	// Update surface lightmap coordinates
 	//
@@ -1864,6 +2291,13 @@ static bool R_FinishQ2BSPModel(refModel_t *model)
 		}
 	}
 
+	if (r_bspCache->intVal)
+	{
+		R_WriteBSPSurfaceCache(model, fileLen, sourceHash, cacheKey, R_Q2BSPCacheMesh, numLightmaps, r_q2_lmBlockSize, lightmaps);
+		if (lightmaps)
+			Mem_Free(lightmaps);
+	}
+
 	//
 	// Do this for each submodel too
 	//
@@ -1884,12 +2318,63 @@ static bool R_FinishQ2BSPModel(refModel_t *model)
 }
 
 
+/*
+=================
+R_SetupBSPClusterLeafs
+
+Buckets the leafs by cluster for R_MarkClusterLeaves. It's a counting sort
+over the leafs, so it's cheaper to redo on load than to read from the cache.
+=================
+*/
+static void R_SetupBSPClusterLeafs(refModel_t *model, const int numClusters)
+{
+	mBspModelBase_t *bspModel = model->BSPData();
+
+	bspModel->numClusters = numClusters;
+	if (numClusters <= 0)
+		return;
+
+	bspModel->clusterFirstLeaf = (int*)R_ModAlloc(model, sizeof(int) * (numClusters+1));
+
+	// Count, with each cluster's total one slot along
+	int numClustered = 0;
+	for (int i=0 ; i<bspModel->numLeafs ; i++)
+	{
+		const int cluster = bspModel->leafs[i].cluster;
+		if (cluster < 0 || cluster >= numClusters)
+			continue;
+
+		bspModel->clusterFirstLeaf[cluster+1]++;
+		numClustered++;
+	}
+
+	for (int i=0 ; i<numClusters ; i++)
+		bspModel->clusterFirstLeaf[i+1] += bspModel->clusterFirstLeaf[i];
+
+	// Fill from the back, walking the counts down to each cluster's start
+	bspModel->clusterLeafs = (mBspLeaf_t**)R_ModAlloc(model, sizeof(mBspLeaf_t*) * max(numClustered, 1));
+	int *fill = (int*)Mem_PoolAlloc(sizeof(int) * numClusters, ri.genericPool, 0);
+	memcpy(fill, bspModel->clusterFirstLeaf + 1, sizeof(int) * numClusters);
+
+	for (int i=bspModel->numLeafs-1 ; i>=0 ; i--)
+	{
+		const int cluster = bspModel->leafs[i].cluster;
+		if (cluster < 0 || cluster >= numClusters)
+			continue;
+
+		bspModel->clusterLeafs[--fill[cluster]] = &bspModel->leafs[i];
+	}
+
+	Mem_Free(fill);
+}
+
+
 /*
 =================
 R_LoadQ2BSPModel
 =================
 */
-bool R_LoadQ2BSPModel(refModel_t *model, byte *buffer)
+bool R_LoadQ2BSPModel(refModel_t *model, byte *buffer, const int fileLen)
 {
 	dQ2BspHeader_t	*header;
 	byte			*modBase;
@@ -1910,6 +2395,9 @@ bool R_LoadQ2BSPModel(refModel_t *model, byte *buffer)
 		return false;
 	}
 
+	// Identifies the file for the surface cache
+	const uint32 sourceHash = Com_HashBlock(buffer, fileLen);
+
 	//
 	// Swap all the lumps
 	//
@@ -1934,10 +2422,12 @@ bool R_LoadQ2BSPModel(refModel_t *model, byte *buffer)
 	|| !R_LoadQ2BSPSubModels	(model, modBase, &header->lumps[Q2BSP_LUMP_MODELS]))
 		return false;
 
+	R_SetupBSPClusterLeafs(model, model->Q2BSPData()->vis ? model->Q2BSPData()->vis->numClusters : 0);
+
 	//
 	// Finishing optimizations
 	//
-	if (!R_FinishQ2BSPModel(model))
+	if (!R_FinishQ2BSPModel(model, fileLen, sourceHash))
 		return false;
 
 	//
@@ -2386,6 +2876,18 @@ static refMesh_t *R_CreateQ3BSPMeshForSurface (refModel_t *model, dQ3BspFace_t *
 			if (!patch_cp[0] || !patch_cp[1])
 				break;
 
+			// Use the tessellation from last time if it's there
+			if (r_bspCacheData)
+			{
+				const mBspCacheSurf_t *cs = R_BSPCacheSurf(out - model->BSPData()->surfaces);
+				if (cs->dataOfs && cs->bLMCoords && R_CheckBSPCacheMesh(cs))
+				{
+					out->q3_patchWidth = cs->patchSize[0];
+					out->q3_patchHeight = cs->patchSize[1];
+					return R_LoadBSPCacheMesh(model, cs);
+				}
+			}
+
 			subdivLevel = bound (1, r_patchDivLevel->intVal, 32);
 
 			numVerts = LittleLong (in->numVerts);
@@ -2540,6 +3042,29 @@ static void R_FixAutosprites(mBspSurface_t *surf)
 		}
 	}
 }
+
+/*
+=================
+R_PrefetchQ3BSPMatRefs
+=================
+*/
+static int R_PrefetchQ3BSPMatRefs(mQ3BspModel_t *q3BspModel, const int *matOrder, const int numMatRefs)
+{
+	const char *names[64];
+
+	const int numNames = min(numMatRefs, 64);
+	for (int i=0 ; i<numNames ; i++)
+		names[i] = q3BspModel->matRefs[matOrder[i]].name;
+
+	return R_PrefetchMaterials(names, NULL, numNames);
+}
+
+
+/*
+=================
+R_LoadQ3BSPFaces
+=================
+*/
 static bool R_LoadQ3BSPFaces(refModel_t *model, byte *byteBase, const dQ3BspLump_t *lump)
 {
 	int					j;
@@ -2563,6 +3088,22 @@ static bool R_LoadQ3BSPFaces(refModel_t *model, byte *byteBase, const dQ3BspLump
 	model->BSPData()->numSurfaces = lump->fileLen / sizeof(*in);
 	model->BSPData()->surfaces = out = (mBspSurface_t*)R_ModAlloc(model, model->BSPData()->numSurfaces * sizeof(*out));
 
+	// Material references in the order the faces register them, for prefetching
+	int *matOrder = (int*)R_ModAlloc(model, q3BspModel->numMatRefs * (sizeof(int) + 1));
+	byte *matUsed = (byte*)(matOrder + q3BspModel->numMatRefs);
+	int numMatOrder = 0;
+	for (surfNum=0 ; surfNum<model->BSPData()->numSurfaces ; surfNum++)
+	{
+		matNum = LittleLong(in[surfNum].matNum);
+		if (matNum < 0 || matNum >= q3BspModel->numMatRefs || matUsed[matNum])
+			continue;
+
+		matUsed[matNum] = 1;
+		matOrder[numMatOrder++] = matNum;
+	}
+	int numRegistered = 0;
+	int prefetchEnd = 0;
+
 	// Fill it in
 	for (surfNum=0 ; surfNum<model->BSPData()->numSurfaces ; surfNum++, in++, out++)
 	{
@@ -2600,6 +3141,10 @@ static bool R_LoadQ3BSPFaces(refModel_t *model, byte *byteBase, const dQ3BspLump
 
 		if (!matRef->mat)
 		{
+			// Decode the next batch of images ahead of time
+			if (numRegistered++ == prefetchEnd)
+				prefetchEnd += R_PrefetchQ3BSPMatRefs(q3BspModel, matOrder + prefetchEnd, numMatOrder - prefetchEnd);
+
 			if (out->q3_faceType == FACETYPE_FLARE)
 			{
 				matRef->mat = R_RegisterFlare(matRef->name);
@@ -2665,6 +3210,8 @@ static bool R_LoadQ3BSPFaces(refModel_t *model, byte *byteBase, const dQ3BspLump
 		R_FixAutosprites(out);
 	}
 
+	Mem_Free(matOrder);
+
 	return true;
 }
 
@@ -3227,12 +3774,44 @@ static void R_SetupQ3LightGrid(refModel_t *model, mQ3BspModel_t *q3BspModel)
 }
 
 
+/*
+=================
+R_Q3BSPCacheKey
+
+Only patches are cached for Q3 maps, everything else already comes straight
+from the file. Patches are built from the loaded vertices, so their colors
+depend on the lighting cvars.
+=================
+*/
+static uint32 R_Q3BSPCacheKey()
+{
+	uint32 key = Com_FNVMix(COM_FNV_SEED, BSPCACHE_DATA_VERSION);
+	key = Com_FNVMix(key, bound(1, r_patchDivLevel->intVal, 32));
+	key = Com_FNVMix(key, r_lmModulate->intVal);
+	key = Com_FNVMix(key, r_fullbright->intVal);
+	key = Com_FNVMix(key, r_coloredLighting->intVal);
+
+	return key;
+}
+
+
+/*
+=================
+R_Q3BSPCacheMesh
+=================
+*/
+static bool R_Q3BSPCacheMesh(const mBspSurface_t *surf)
+{
+	return (surf->q3_faceType == FACETYPE_PATCH);
+}
+
+
 /*
 =================
 R_FinishQ3BSPModel
 =================
 */
-static void R_FinishQ3BSPModel(refModel_t *model, byte *byteBase, const dQ3BspLump_t *lightmaps)
+static void R_FinishQ3BSPModel(refModel_t *model, byte *byteBase, const dQ3BspLump_t *lightmaps, const int fileLen, const uint32 sourceHash, const uint32 cacheKey)
 {
 	refMesh_t				*mesh;
 	mBspSurface_t 			*surf;
@@ -3242,6 +3821,12 @@ static void R_FinishQ3BSPModel(refModel_t *model, byte *byteBase, const dQ3BspLu
 
 	mQ3BspModel_t *q3BspModel = model->Q3BSPData();
 
+	// Save the patches before their lightmap coords are moved into the packed blocks
+	if (r_bspCacheData)
+		R_EndBSPCache();
+	else if (r_bspCache->intVal)
+		R_WriteBSPSurfaceCache(model, fileLen, sourceHash, cacheKey, R_Q3BSPCacheMesh, 0, 0, NULL);
+
 	R_Q3BSP_BuildLightmaps (q3BspModel->numLightmaps, Q3LIGHTMAP_WIDTH, Q3LIGHTMAP_WIDTH, byteBase + lightmaps->fileOfs, q3BspModel->lightmapRects);
 
 	// Generate visibility planes for fogs that dont have them
@@ -3296,7 +3881,7 @@ static void R_FinishQ3BSPModel(refModel_t *model, byte *byteBase, const dQ3BspLu
 R_LoadQ3BSPModel
 =================
 */
-bool R_LoadQ3BSPModel(refModel_t *model, byte *buffer)
+bool R_LoadQ3BSPModel(refModel_t *model, byte *buffer, const int fileLen)
 {
 	//
 	// Load the world model
@@ -3314,6 +3899,9 @@ bool R_LoadQ3BSPModel(refModel_t *model, byte *buffer)
 		return false;
 	}
 
+	// Identifies the file for the surface cache
+	const uint32 sourceHash = Com_HashBlock(buffer, fileLen);
+
 	//
 	// Swap all the lumps
 	//
@@ -3321,6 +3909,9 @@ bool R_LoadQ3BSPModel(refModel_t *model, byte *buffer)
 	for (uint32 i=0 ; i<sizeof(dQ3BspHeader_t)/4 ; i++)
 		((int *)header)[i] = LittleLong (((int *)header)[i]);
 
+	const uint32 cacheKey = R_Q3BSPCacheKey();
+	R_BeginBSPCache(model, header->lumps[Q3BSP_LUMP_FACES].fileLen / sizeof(dQ3BspFace_t), fileLen, sourceHash, cacheKey);
+
 	//
 	// Load into heap
 	//
@@ -3336,10 +3927,15 @@ bool R_LoadQ3BSPModel(refModel_t *model, byte *buffer)
 	|| !R_LoadQ3BSPLeafs		(model, modBase, &header->lumps[Q3BSP_LUMP_LEAFS], &header->lumps[Q3BSP_LUMP_LEAFFACES])
 	|| !R_LoadQ3BSPNodes		(model, modBase, &header->lumps[Q3BSP_LUMP_NODES])
 	|| !R_LoadQ3BSPSubmodels	(model, modBase, &header->lumps[Q3BSP_LUMP_MODELS]))
+	{
+		R_EndBSPCache();
 		return false;
+	}
+
+	R_SetupBSPClusterLeafs(model, q3BspModel->vis ? q3BspModel->vis->numClusters : 0);
 
 	// Finishing touches
-	R_FinishQ3BSPModel(model, modBase, &header->lumps[Q3BSP_LUMP_LIGHTING]);
+	R_FinishQ3BSPModel(model, modBase, &header->lumps[Q3BSP_LUMP_LIGHTING], fileLen, sourceHash, cacheKey);
 
 	// Set up the submodels
 	R_SetupQ3BSPSubModels(model);
@@ -0,0 +1,341 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+//
+// rf_modelCache.cpp
+// Preprocessed model data kept between runs
+//
+
+#include "rf_modelLocal.h"
+
+// A disk cache (see common.h) keyed on the model name alone. Map surfaces
+// are too big for it and go in sidecars next to each map instead.
+
+#define MODELCACHE_FILE		"modelcache.pca"
+#define MODELCACHE_TEMP		"modelcache.tmp"
+#define MODELCACHE_MAGIC	(('C'<<24)+('D'<<16)+('M'<<8)+'E')
+#define MODELCACHE_VERSION	2
+
+#define MAX_CACHE_ENTRIES	4096
+#define MAX_CACHE_PAYLOAD	(16<<20)		// Largest single entry
+
+static diskCache_t		r_modelCache;
+static byte				*r_modelCachePayload;	// From the last R_FindModelCache
+
+// Map sidecars, see R_LoadBSPCache
+#define BSPCACHE_EXT		"bspc"
+#define BSPCACHE_MAGIC		(('C'<<24)+('P'<<16)+('S'<<8)+'B')
+#define BSPCACHE_VERSION	2
+
+struct mBspCacheHeader_t
+{
+	uint32					magic;
+	uint32					version;
+	uint32					sourceLen;
+	uint32					sourceHash;
+	uint32					key;
+	uint32					dataLen;
+};
+
+static byte				*r_bspCacheImage;
+
+static uint32			r_bspCacheHits;
+static uint32			r_bspCacheMisses;
+static uint32			r_bspCacheStale;
+
+static conCmd_t			*cmd_modelCacheStats;
+static conCmd_t			*cmd_modelCacheCompact;
+
+/*
+=============================================================================
+
+	LOOKUP
+
+=============================================================================
+*/
+
+/*
+=================
+R_FindModelCache
+
+Returns the payload stored for this model file, or NULL if there isn't one or
+the file has changed since. The payload stays valid until the next lookup.
+=================
+*/
+const byte *R_FindModelCache(const char *name, const byte *fileBuffer, const int fileLen, uint32 &outLength)
+{
+	if (r_modelCachePayload)
+	{
+		Mem_Free(r_modelCachePayload);
+		r_modelCachePayload = NULL;
+	}
+
+	diskCacheEntry_t *entry = DiskCache_Find(&r_modelCache, name, 0, fileLen, Com_HashBlock(fileBuffer, fileLen));
+	if (!entry)
+		return NULL;
+
+	r_modelCachePayload = (byte *)Mem_PoolAlloc(entry->rawLen, ri.genericPool, 0);
+	if (!DiskCache_Read(&r_modelCache, entry, r_modelCachePayload))
+	{
+		Mem_Free(r_modelCachePayload);
+		r_modelCachePayload = NULL;
+		return NULL;
+	}
+
+	outLength = entry->rawLen;
+	return r_modelCachePayload;
+}
+
+
+/*
+=================
+R_StoreModelCache
+
+Takes ownership of data, which must be allocated from ri.genericPool.
+=================
+*/
+void R_StoreModelCache(const char *name, const byte *fileBuffer, const int fileLen, byte *data, const uint32 dataLength)
+{
+	DiskCache_Store(&r_modelCache, name, 0, fileLen, Com_HashBlock(fileBuffer, fileLen), data, dataLength);
+}
+
+/*
+=============================================================================
+
+	MAP SIDECARS
+
+=============================================================================
+*/
+
+// Preprocessed map surfaces are too big to sit in the shared file, so each
+// map gets its own next to it in the game directory, read in one go when the
+// map loads. The key is a hash of whatever settings the loader baked into the
+// payload, anything different means a rebuild.
+
+/*
+=================
+R_BSPCachePath
+=================
+*/
+static void R_BSPCachePath(const char *name, char *path, const size_t pathSize)
+{
+	Q_snprintfz(path, pathSize, "%s.%s", name, BSPCACHE_EXT);
+}
+
+
+/*
+=================
+R_FreeBSPCache
+
+Releases the sidecar from the last R_LoadBSPCache.
+=================
+*/
+void R_FreeBSPCache()
+{
+	if (r_bspCacheImage)
+	{
+		FS_FreeFile(r_bspCacheImage);
+		r_bspCacheImage = NULL;
+	}
+}
+
+
+/*
+=================
+R_LoadBSPCache
+
+Returns the sidecar payload for a map, or NULL if there isn't one or it was
+built from a different file or with different settings. The payload stays
+valid until R_FreeBSPCache.
+=================
+*/
+const byte *R_LoadBSPCache(const char *name, const uint32 sourceLen, const uint32 sourceHash, const uint32 key, uint32 &outLength)
+{
+	char path[MAX_QPATH];
+	R_BSPCachePath(name, path, sizeof(path));
+
+	R_FreeBSPCache();
+	const int fileLen = FS_LoadFile(path, (void **)&r_bspCacheImage, false);
+	if (!r_bspCacheImage || fileLen <= 0)
+	{
+		r_bspCacheImage = NULL;
+		r_bspCacheMisses++;
+		return NULL;
+	}
+
+	const mBspCacheHeader_t *header = (const mBspCacheHeader_t *)r_bspCacheImage;
+	if ((uint32)fileLen < sizeof(mBspCacheHeader_t)
+	|| LittleLong(header->magic) != BSPCACHE_MAGIC
+	|| LittleLong(header->version) != BSPCACHE_VERSION
+	|| LittleLong(header->dataLen) != (uint32)fileLen - sizeof(mBspCacheHeader_t))
+	{
+		Com_DevPrintf(0, "R_LoadBSPCache: ignoring old or invalid %s\n", path);
+		R_FreeBSPCache();
+		r_bspCacheStale++;
+		return NULL;
+	}
+
+	if (LittleLong(header->sourceLen) != sourceLen
+	|| LittleLong(header->sourceHash) != sourceHash
+	|| LittleLong(header->key) != key)
+	{
+		R_FreeBSPCache();
+		r_bspCacheStale++;
+		return NULL;
+	}
+
+	r_bspCacheHits++;
+	outLength = LittleLong(header->dataLen);
+	return r_bspCacheImage + sizeof(mBspCacheHeader_t);
+}
+
+
+/*
+=================
+R_WriteBSPCache
+=================
+*/
+void R_WriteBSPCache(const char *name, const uint32 sourceLen, const uint32 sourceHash, const uint32 key, const byte *data, const uint32 dataLength)
+{
+	char			path[MAX_QPATH];
+	fileHandle_t	fileNum;
+	mBspCacheHeader_t header;
+
+	R_BSPCachePath(name, path, sizeof(path));
+	FS_OpenFile(path, &fileNum, FS_MODE_WRITE_BINARY);
+	if (!fileNum)
+	{
+		Com_Printf(PRNT_ERROR, "R_WriteBSPCache: unable to open %s for writing\n", path);
+		return;
+	}
+
+	header.magic = LittleLong(BSPCACHE_MAGIC);
+	header.version = LittleLong(BSPCACHE_VERSION);
+	header.sourceLen = LittleLong(sourceLen);
+	header.sourceHash = LittleLong(sourceHash);
+	header.key = LittleLong(key);
+	header.dataLen = LittleLong(dataLength);
+
+	FS_Write(&header, sizeof(header), fileNum);
+	FS_Write((void *)data, dataLength, fileNum);
+	FS_CloseFile(fileNum);
+}
+
+/*
+=============================================================================
+
+	CONSOLE COMMANDS
+
+=============================================================================
+*/
+
+/*
+=================
+R_ModelCacheStats_f
+=================
+*/
+static void R_ModelCacheStats_f()
+{
+	DiskCache_PrintStats(&r_modelCache, "Model cache");
+	Com_Printf(0, "...map sidecars: %u hits, %u misses, %u stale\n", r_bspCacheHits, r_bspCacheMisses, r_bspCacheStale);
+}
+
+
+/*
+=================
+R_ModelCacheCompact_f
+
+Drops entries for models that no longer exist and rewrites the file.
+=================
+*/
+static void R_ModelCacheCompact_f()
+{
+	uint32 numEvicted, numMissing;
+	DiskCache_Compact(&r_modelCache, true, numEvicted, numMissing);
+
+	Com_Printf(0, "Model cache compacted, removed %u entries, %u left\n", numMissing, r_modelCache.numEntries);
+}
+
+/*
+=============================================================================
+
+	INIT / SHUTDOWN
+
+=============================================================================
+*/
+
+/*
+=================
+R_ModelCacheInit
+=================
+*/
+void R_ModelCacheInit()
+{
+	r_bspCacheHits = r_bspCacheMisses = r_bspCacheStale = 0;
+
+	r_modelCache.fileName = MODELCACHE_FILE;
+	r_modelCache.tempName = MODELCACHE_TEMP;
+	r_modelCache.magic = MODELCACHE_MAGIC;
+	r_modelCache.version = MODELCACHE_VERSION;
+	r_modelCache.setupKey = 0;
+	r_modelCache.maxEntries = MAX_CACHE_ENTRIES;
+	r_modelCache.maxPayload = MAX_CACHE_PAYLOAD;
+	r_modelCache.maxPending = 0;
+	r_modelCache.budget = 0;
+	r_modelCache.bCompress = false;
+	r_modelCache.pool = ri.genericPool;
+	DiskCache_Open(&r_modelCache);
+
+	cmd_modelCacheStats = Cmd_AddCommand("modelcache_stats", 0, R_ModelCacheStats_f, "Prints model cache usage");
+	cmd_modelCacheCompact = Cmd_AddCommand("modelcache_compact", 0, R_ModelCacheCompact_f, "Removes stale entries from the model cache file");
+}
+
+
+/*
+=================
+R_ModelCacheFlush
+
+Saves anything new, called at the end of registration.
+=================
+*/
+void R_ModelCacheFlush()
+{
+	DiskCache_Write(&r_modelCache);
+}
+
+
+/*
+=================
+R_ModelCacheShutdown
+=================
+*/
+void R_ModelCacheShutdown()
+{
+	Cmd_RemoveCommand(cmd_modelCacheStats);
+	Cmd_RemoveCommand(cmd_modelCacheCompact);
+
+	if (r_modelCachePayload)
+	{
+		Mem_Free(r_modelCachePayload);
+		r_modelCachePayload = NULL;
+	}
+
+	DiskCache_Close(&r_modelCache);
+	R_FreeBSPCache();
+}
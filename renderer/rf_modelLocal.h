@@ -37,11 +37,26 @@ bool R_LoadMD2Model(refModel_t *model);
 bool R_LoadMD3Model(refModel_t *model);
 bool R_LoadMD2EModel(refModel_t *model);
 
+//
+// rf_modelCache.cpp
+//
+
+const byte *R_FindModelCache(const char *name, const byte *fileBuffer, const int fileLen, uint32 &outLength);
+void R_StoreModelCache(const char *name, const byte *fileBuffer, const int fileLen, byte *data, const uint32 dataLength);
+
+const byte *R_LoadBSPCache(const char *name, const uint32 sourceLen, const uint32 sourceHash, const uint32 key, uint32 &outLength);
+void R_FreeBSPCache();
+void R_WriteBSPCache(const char *name, const uint32 sourceLen, const uint32 sourceHash, const uint32 key, const byte *data, const uint32 dataLength);
+
+void R_ModelCacheInit();
+void R_ModelCacheFlush();
+void R_ModelCacheShutdown();
+
 //
 // rf_modelBSP.cpp
 //
 
-bool R_LoadQ2BSPModel(refModel_t *model, byte *buffer);
-bool R_LoadQ3BSPModel(refModel_t *model, byte *buffer);
+bool R_LoadQ2BSPModel(refModel_t *model, byte *buffer, const int fileLen);
+bool R_LoadQ3BSPModel(refModel_t *model, byte *buffer, const int fileLen);
 
 void R_ModelBSPInit();
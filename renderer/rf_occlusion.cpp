@@ -0,0 +1,606 @@
+/*
+Copyright (C) 1997-2001 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+*/
+
+//
+// rf_occlusion.cpp
+// Software occlusion culling against a low resolution depth buffer
+//
+
+#include "rf_local.h"
+
+// Each normal view picks the largest opaque world surfaces near the camera,
+// rasterizes them into a small buffer of 1/depth and reduces that into a
+// pyramid where every texel holds the farthest depth under it. Node and
+// entity bounds are then rejected when their nearest point is behind
+// everything in the texels they cover.
+//
+// Everything is conservative: occluders only cover pixels they fully
+// contain, and each pixel takes the farthest depth the triangle reaches in
+// it, so the buffer never claims more than the real scene would.
+
+#define OCC_WIDTH			256
+#define OCC_HEIGHT			128
+#define OCC_LEVELS			8			// Down to 2x1
+
+#define OCC_NEAR			4.0f		// Occluders are clipped here, bounds closer than this are never culled
+#define OCC_RANGE			2048.0f		// Surfaces farther than this aren't considered
+#define OCC_MIN_SCORE		0.01f		// Rough area over distance squared
+
+#define OCC_MAX_CANDIDATES	2048
+#define OCC_MAX_OCCLUDERS	256
+#define OCC_MAX_VERTS		1024
+
+struct occCandidate_t
+{
+	mBspSurface_t			*surf;
+	float					score;
+};
+
+struct occVert_t
+{
+	float					x, y;		// Buffer pixels
+	float					z;			// 1/depth
+};
+
+static float			r_occDepth[OCC_WIDTH*OCC_HEIGHT];
+static float			r_occPyramid[OCC_WIDTH*OCC_HEIGHT/2];
+static float			*r_occLevels[OCC_LEVELS];
+
+static occCandidate_t	r_occCandidates[OCC_MAX_CANDIDATES];
+static int				r_occNumCandidates;
+static uint32			r_occFrame;			// Stamps surfaces so shared ones are only scored once
+static bool				r_occActive;		// Buffer is valid for the current normal view
+
+static vec3_t			r_occAxis[3];
+static float			r_occScaleX, r_occScaleY;
+
+static vec3_t			r_occCamVerts[OCC_MAX_VERTS];
+static occVert_t		r_occScreenVerts[OCC_MAX_VERTS];
+
+/*
+=============================================================================
+
+	RASTERIZATION
+
+=============================================================================
+*/
+
+/*
+=================
+R_OccToCamera
+
+Depth, left and up distances from the view origin.
+=================
+*/
+static inline void R_OccToCamera(const vec3_t point, vec3_t out)
+{
+	vec3_t delta;
+	Vec3Subtract(point, ri.def.viewOrigin, delta);
+
+	out[0] = DotProduct(delta, r_occAxis[0]);
+	out[1] = DotProduct(delta, r_occAxis[1]);
+	out[2] = DotProduct(delta, r_occAxis[2]);
+}
+
+
+/*
+=================
+R_OccProject
+=================
+*/
+static inline void R_OccProject(const vec3_t cam, occVert_t &out)
+{
+	const float invDepth = 1.0f / cam[0];
+
+	out.x = OCC_WIDTH*0.5f - cam[1] * invDepth * r_occScaleX;
+	out.y = OCC_HEIGHT*0.5f - cam[2] * invDepth * r_occScaleY;
+	out.z = invDepth;
+}
+
+
+/*
+=================
+R_OccRasterTriangle
+
+Writes pixels that are entirely inside the triangle, at the farthest depth
+the triangle has inside each of them. Setup runs in doubles since clipped
+vertices can project far outside the buffer.
+=================
+*/
+static void R_OccRasterTriangle(const occVert_t &v0, const occVert_t &in1, const occVert_t &in2)
+{
+	double area = ((double)in1.x-v0.x)*((double)in2.y-v0.y) - ((double)in2.x-v0.x)*((double)in1.y-v0.y);
+	const occVert_t &v1 = (area < 0) ? in2 : in1;
+	const occVert_t &v2 = (area < 0) ? in1 : in2;
+	area = fabs(area);
+
+	// Twice the area, anything under one pixel can't cover one
+	if (area < 2.0)
+		return;
+
+	const int minX = (int)floorf(Max(min(min(v0.x, v1.x), v2.x), 0.0f)) & ~3;
+	const int minY = (int)floorf(Max(min(min(v0.y, v1.y), v2.y), 0.0f));
+	const int maxX = (int)Min(ceilf(max(max(v0.x, v1.x), v2.x)), (float)(OCC_WIDTH-1));
+	const int maxY = (int)Min(ceilf(max(max(v0.y, v1.y), v2.y)), (float)(OCC_HEIGHT-1));
+	if (minX > maxX || minY > maxY)
+		return;
+
+	// Edge functions, positive inside
+	const occVert_t *verts[3] = { &v0, &v1, &v2 };
+	double edgeA[3], edgeB[3], edgeC[3];
+	for (int i=0 ; i<3 ; i++)
+	{
+		const occVert_t *a = verts[i];
+		const occVert_t *b = verts[(i+1)%3];
+
+		edgeA[i] = (double)a->y - b->y;
+		edgeB[i] = (double)b->x - a->x;
+		edgeC[i] = (double)a->x*b->y - (double)b->x*a->y;
+	}
+
+	// 1/depth is linear in screen space
+	const double dzdx = (((double)v1.z-v0.z)*((double)v2.y-v0.y) - ((double)v2.z-v0.z)*((double)v1.y-v0.y)) / area;
+	const double dzdy = (((double)v2.z-v0.z)*((double)v1.x-v0.x) - ((double)v1.z-v0.z)*((double)v2.x-v0.x)) / area;
+
+	// Values at the first pixel centre, pulled in by half a pixel so only
+	// covered pixels pass and each one gets its farthest depth
+	const double px = minX + 0.5;
+	const double py = minY + 0.5;
+
+	float startE[3], stepX[3], stepY[3];
+	for (int i=0 ; i<3 ; i++)
+	{
+		startE[i] = (float)(edgeA[i]*px + edgeB[i]*py + edgeC[i] - 0.5*(fabs(edgeA[i]) + fabs(edgeB[i])));
+		stepX[i] = (float)edgeA[i];
+		stepY[i] = (float)edgeB[i];
+	}
+
+	const float startZ = (float)(v0.z + dzdx*(px - v0.x) + dzdy*(py - v0.y) - 0.5*(fabs(dzdx) + fabs(dzdy)));
+	const float stepZX = (float)dzdx;
+	const float stepZY = (float)dzdy;
+
+	for (int y=minY ; y<=maxY ; y++)
+	{
+		const float rowY = (float)(y - minY);
+		const float e0 = startE[0] + stepY[0]*rowY;
+		const float e1 = startE[1] + stepY[1]*rowY;
+		const float e2 = startE[2] + stepY[2]*rowY;
+		const float z = startZ + stepZY*rowY;
+
+		float *row = r_occDepth + y*OCC_WIDTH;
+		int x = minX;
+
+#ifdef R_SSE2
+		if (ri.bSSE2)
+		{
+			// minX is a multiple of four, as is the buffer width
+			const __m128 vRamp = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+			const __m128 vZero = _mm_setzero_ps();
+
+			__m128 vE0 = _mm_add_ps(_mm_set1_ps(e0), _mm_mul_ps(_mm_set1_ps(stepX[0]), vRamp));
+			__m128 vE1 = _mm_add_ps(_mm_set1_ps(e1), _mm_mul_ps(_mm_set1_ps(stepX[1]), vRamp));
+			__m128 vE2 = _mm_add_ps(_mm_set1_ps(e2), _mm_mul_ps(_mm_set1_ps(stepX[2]), vRamp));
+			__m128 vZ = _mm_add_ps(_mm_set1_ps(z), _mm_mul_ps(_mm_set1_ps(stepZX), vRamp));
+
+			const __m128 vStep0 = _mm_set1_ps(stepX[0] * 4.0f);
+			const __m128 vStep1 = _mm_set1_ps(stepX[1] * 4.0f);
+			const __m128 vStep2 = _mm_set1_ps(stepX[2] * 4.0f);
+			const __m128 vStepZ = _mm_set1_ps(stepZX * 4.0f);
+
+			for ( ; x<=maxX ; x+=4)
+			{
+				const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(vE0, vZero), _mm_cmpge_ps(vE1, vZero)), _mm_cmpge_ps(vE2, vZero));
+
+				// Outside lanes become zero, which never beats what's stored
+				_mm_storeu_ps(row + x, _mm_max_ps(_mm_loadu_ps(row + x), _mm_and_ps(inside, vZ)));
+
+				vE0 = _mm_add_ps(vE0, vStep0);
+				vE1 = _mm_add_ps(vE1, vStep1);
+				vE2 = _mm_add_ps(vE2, vStep2);
+				vZ = _mm_add_ps(vZ, vStepZ);
+			}
+		}
+#endif // R_SSE2
+
+		for ( ; x<=maxX ; x++)
+		{
+			const float dx = (float)(x - minX);
+			if (e0 + stepX[0]*dx < 0 || e1 + stepX[1]*dx < 0 || e2 + stepX[2]*dx < 0)
+				continue;
+
+			const float pz = z + stepZX*dx;
+			if (pz > row[x])
+				row[x] = pz;
+		}
+	}
+}
+
+
+/*
+=================
+R_OccClipTriangle
+
+Clips a camera space triangle to the occluder near plane and rasterizes
+what's left.
+=================
+*/
+static void R_OccClipTriangle(const float *a, const float *b, const float *c)
+{
+	const float *in[3] = { a, b, c };
+	vec3_t clipped[4];
+	int numClipped = 0;
+
+	for (int i=0 ; i<3 ; i++)
+	{
+		const float *p = in[i];
+		const float *q = in[(i+1)%3];
+		const bool bPIn = (p[0] >= OCC_NEAR);
+		const bool bQIn = (q[0] >= OCC_NEAR);
+
+		if (bPIn)
+			Vec3Copy(p, clipped[numClipped++]);
+		if (bPIn != bQIn)
+		{
+			const float frac = (OCC_NEAR - p[0]) / (q[0] - p[0]);
+			clipped[numClipped][0] = OCC_NEAR;
+			clipped[numClipped][1] = p[1] + (q[1] - p[1]) * frac;
+			clipped[numClipped][2] = p[2] + (q[2] - p[2]) * frac;
+			numClipped++;
+		}
+	}
+
+	if (numClipped < 3)
+		return;
+
+	occVert_t screen[4];
+	for (int i=0 ; i<numClipped ; i++)
+		R_OccProject(clipped[i], screen[i]);
+
+	for (int i=2 ; i<numClipped ; i++)
+		R_OccRasterTriangle(screen[0], screen[i-1], screen[i]);
+}
+
+
+/*
+=================
+R_OccRasterMesh
+=================
+*/
+static void R_OccRasterMesh(const refMesh_t *mesh)
+{
+	for (int i=0 ; i<mesh->numVerts ; i++)
+	{
+		R_OccToCamera(mesh->vertexArray[i], r_occCamVerts[i]);
+		if (r_occCamVerts[i][0] >= OCC_NEAR)
+			R_OccProject(r_occCamVerts[i], r_occScreenVerts[i]);
+	}
+
+	const index_t *index = mesh->indexArray;
+	for (int i=0 ; i<mesh->numIndexes-2 ; i+=3, index+=3)
+	{
+		const float *a = r_occCamVerts[index[0]];
+		const float *b = r_occCamVerts[index[1]];
+		const float *c = r_occCamVerts[index[2]];
+
+		if (a[0] < OCC_NEAR && b[0] < OCC_NEAR && c[0] < OCC_NEAR)
+			continue;
+		if (a[0] < OCC_NEAR || b[0] < OCC_NEAR || c[0] < OCC_NEAR)
+		{
+			R_OccClipTriangle(a, b, c);
+			continue;
+		}
+
+		R_OccRasterTriangle(r_occScreenVerts[index[0]], r_occScreenVerts[index[1]], r_occScreenVerts[index[2]]);
+	}
+}
+
+
+/*
+=================
+R_OccBuildPyramid
+
+Each level keeps the farthest of the 2x2 texels under it.
+=================
+*/
+static void R_OccBuildPyramid()
+{
+	for (int level=1 ; level<OCC_LEVELS ; level++)
+	{
+		const float *src = r_occLevels[level-1];
+		float *dst = r_occLevels[level];
+		const int width = OCC_WIDTH >> level;
+		const int height = OCC_HEIGHT >> level;
+		const int srcWidth = width * 2;
+
+		for (int y=0 ; y<height ; y++)
+		{
+			const float *row0 = src + y*2*srcWidth;
+			const float *row1 = row0 + srcWidth;
+			for (int x=0 ; x<width ; x++, row0+=2, row1+=2)
+				dst[y*width+x] = min(min(row0[0], row0[1]), min(row1[0], row1[1]));
+		}
+	}
+}
+
+/*
+=============================================================================
+
+	OCCLUDER SELECTION
+
+=============================================================================
+*/
+
+/*
+=================
+R_ClearOcclusion
+=================
+*/
+void R_ClearOcclusion()
+{
+	r_occActive = false;
+}
+
+
+/*
+=================
+R_BeginOcclusion
+
+Returns true if occluders should be gathered for this view.
+=================
+*/
+bool R_BeginOcclusion()
+{
+	r_occActive = false;
+	if (!r_occlusion->intVal || r_noCull->intVal || ri.scn.viewType != RVT_NORMAL)
+		return false;
+
+	r_occFrame++;
+	r_occNumCandidates = 0;
+
+	Vec3Copy(ri.def.viewAxis[0], r_occAxis[0]);
+	Vec3Copy(ri.def.viewAxis[1], r_occAxis[1]);
+	Vec3Copy(ri.def.viewAxis[2], r_occAxis[2]);
+	r_occScaleX = OCC_WIDTH*0.5f / (float)tan(ri.def.fovX * (M_PI / 360.0));
+	r_occScaleY = OCC_HEIGHT*0.5f / (float)tan(ri.def.fovY * (M_PI / 360.0));
+	return true;
+}
+
+
+/*
+=================
+R_OccluderInRange
+=================
+*/
+bool R_OccluderInRange(const vec3_t mins, const vec3_t maxs)
+{
+	float distSq = 0;
+	for (int i=0 ; i<3 ; i++)
+	{
+		float d = 0;
+		if (ri.def.viewOrigin[i] < mins[i])
+			d = mins[i] - ri.def.viewOrigin[i];
+		else if (ri.def.viewOrigin[i] > maxs[i])
+			d = ri.def.viewOrigin[i] - maxs[i];
+		distSq += d*d;
+	}
+
+	return (distSq < OCC_RANGE*OCC_RANGE);
+}
+
+
+/*
+=================
+R_AddOccluder
+
+The caller has already checked the surface faces the view. Anything that
+might not write depth over its whole area is skipped.
+=================
+*/
+void R_AddOccluder(mBspSurface_t *surf, const refMaterial_t *mat)
+{
+	if (surf->occlusionFrame == r_occFrame)
+		return;
+	surf->occlusionFrame = r_occFrame;
+
+	if (r_occNumCandidates == OCC_MAX_CANDIDATES)
+		return;
+
+	// Opaque, undeformed and not alpha tested
+	if (mat->sortKey != MAT_SORT_OPAQUE
+	|| mat->flags & (MAT_SKY|MAT_AUTOSPRITE|MAT_FLARE|MAT_POLYGONOFFSET)
+	|| mat->numDeforms
+	|| !mat->numPasses
+	|| mat->passes[0].stateBits & SB_ATEST_MASK)
+		return;
+
+	const refMesh_t *mesh = surf->mesh;
+	if (!mesh || !mesh->vertexArray || mesh->numIndexes < 3 || mesh->numVerts > OCC_MAX_VERTS)
+		return;
+	if (!R_OccluderInRange(surf->mins, surf->maxs))
+		return;
+
+	// Two largest extents stand in for the area
+	vec3_t size, centre;
+	Vec3Subtract(surf->maxs, surf->mins, size);
+	Vec3Add(surf->mins, surf->maxs, centre);
+	Vec3Scale(centre, 0.5f, centre);
+
+	const float largest = max(max(size[0], size[1]), size[2]);
+	const float smallest = min(min(size[0], size[1]), size[2]);
+	const float area = largest * (size[0] + size[1] + size[2] - largest - smallest);
+
+	const float score = area / (Vec3DistSquared(centre, ri.def.viewOrigin) + 1.0f);
+	if (score < OCC_MIN_SCORE)
+		return;
+
+	r_occCandidates[r_occNumCandidates].surf = surf;
+	r_occCandidates[r_occNumCandidates].score = score;
+	r_occNumCandidates++;
+}
+
+
+/*
+=================
+R_OccCandidateSortCmp
+=================
+*/
+static int R_OccCandidateSortCmp(const void *a, const void *b)
+{
+	const float sa = ((const occCandidate_t *)a)->score;
+	const float sb = ((const occCandidate_t *)b)->score;
+
+	return (sa > sb) ? -1 : (sa < sb) ? 1 : 0;
+}
+
+
+/*
+=================
+R_EndOcclusion
+
+Rasterizes the best candidates and builds the pyramid.
+=================
+*/
+void R_EndOcclusion()
+{
+	memset(r_occDepth, 0, sizeof(r_occDepth));
+
+	r_occLevels[0] = r_occDepth;
+	r_occLevels[1] = r_occPyramid;
+	for (int i=2 ; i<OCC_LEVELS ; i++)
+		r_occLevels[i] = r_occLevels[i-1] + (OCC_WIDTH >> (i-1)) * (OCC_HEIGHT >> (i-1));
+
+	if (!r_occNumCandidates)
+		return;
+
+	qsort(r_occCandidates, r_occNumCandidates, sizeof(occCandidate_t), R_OccCandidateSortCmp);
+
+	const int numOccluders = min(r_occNumCandidates, OCC_MAX_OCCLUDERS);
+	for (int i=0 ; i<numOccluders ; i++)
+		R_OccRasterMesh(r_occCandidates[i].surf->mesh);
+
+	R_OccBuildPyramid();
+
+	ri.pc.occluders += numOccluders;
+	r_occActive = true;
+}
+
+/*
+=============================================================================
+
+	OCCLUSION TESTS
+
+=============================================================================
+*/
+
+/*
+=================
+R_OccludedPoints
+
+True when every point is in front of the view and behind the occluders
+in the rectangle they project to.
+=================
+*/
+static bool R_OccludedPoints(const vec3_t *points, const int numPoints)
+{
+	float minX = OCC_WIDTH, minY = OCC_HEIGHT;
+	float maxX = 0, maxY = 0;
+	float nearest = 0;
+
+	for (int i=0 ; i<numPoints ; i++)
+	{
+		vec3_t cam;
+		R_OccToCamera(points[i], cam);
+		if (cam[0] < OCC_NEAR)
+			return false;
+
+		occVert_t screen;
+		R_OccProject(cam, screen);
+
+		minX = min(minX, screen.x);
+		minY = min(minY, screen.y);
+		maxX = max(maxX, screen.x);
+		maxY = max(maxY, screen.y);
+		nearest = max(nearest, screen.z);
+	}
+
+	// The buffer covers the view frustum exactly, so only the part inside matters
+	int x0 = (int)Max(minX, 0.0f);
+	int y0 = (int)Max(minY, 0.0f);
+	int x1 = (int)Min(maxX, (float)(OCC_WIDTH-1));
+	int y1 = (int)Min(maxY, (float)(OCC_HEIGHT-1));
+	if (x0 > x1 || y0 > y1)
+		return false;
+
+	// Drop down the pyramid until the rectangle is at most 4x4 texels
+	int level = 0;
+	while (level < OCC_LEVELS-1 && (x1 - x0 >= 4 || y1 - y0 >= 4))
+	{
+		level++;
+		x0 >>= 1;
+		y0 >>= 1;
+		x1 >>= 1;
+		y1 >>= 1;
+	}
+
+	const float *hiZ = r_occLevels[level];
+	const int width = OCC_WIDTH >> level;
+	for (int y=y0 ; y<=y1 ; y++)
+	{
+		for (int x=x0 ; x<=x1 ; x++)
+		{
+			if (hiZ[y*width+x] <= nearest)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+=================
+R_OccludedBox
+
+Returns true if the box is completely hidden behind the occluders
+=================
+*/
+bool R_OccludedBox(const vec3_t mins, const vec3_t maxs)
+{
+	if (!r_occActive || ri.scn.viewType != RVT_NORMAL)
+		return false;
+
+	vec3_t corners[8];
+	for (int i=0 ; i<8 ; i++)
+	{
+		corners[i][0] = (i & 1) ? mins[0] : maxs[0];
+		corners[i][1] = (i & 2) ? mins[1] : maxs[1];
+		corners[i][2] = (i & 4) ? mins[2] : maxs[2];
+	}
+
+	if (R_OccludedPoints(corners, 8))
+	{
+		if (!ri.scn.bDrawingMeshOutlines)
+			ri.pc.cullOcclusion[CULL_PASS]++;
+		return true;
+	}
+
+	if (!ri.scn.bDrawingMeshOutlines)
+		ri.pc.cullOcclusion[CULL_FAIL]++;
+	return false;
+}
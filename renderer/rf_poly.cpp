@@ -158,3 +158,137 @@ void R_PolyInit()
 	r_polyMesh.sVectorsArray = NULL;
 	r_polyMesh.tVectorsArray = NULL;
 }
+
+/*
+==============================================================================
+
+	PARTICLE FRONTEND
+
+	Compact view facing quads passed from CGAME in bulk. They're sorted by
+	material and fog once per frame so that every run goes out as a single
+	mesh buffer, and the backend expands them without a refMesh_t per quad.
+==============================================================================
+*/
+
+struct partSortKey_t
+{
+	refMaterial_t			*mat;
+	mQ3BspFog_t				*fog;
+	int						index;
+};
+
+static partSortKey_t	r_partSortKeys[MAX_REF_PARTICLES];
+static refParticle_t	r_partSorted[MAX_REF_PARTICLES];
+static mQ3BspFog_t		*r_partFogs[MAX_REF_PARTICLES];
+
+/*
+================
+R_ParticleSortCmp
+================
+*/
+static int R_ParticleSortCmp(const void *a, const void *b)
+{
+	const partSortKey_t *ka = (const partSortKey_t *)a;
+	const partSortKey_t *kb = (const partSortKey_t *)b;
+
+	if (ka->mat != kb->mat)
+		return (ka->mat < kb->mat) ? -1 : 1;
+	if (ka->fog != kb->fog)
+		return (ka->fog < kb->fog) ? -1 : 1;
+
+	// Keep submission order within a run
+	return ka->index - kb->index;
+}
+
+
+/*
+================
+R_SortParticles
+
+Done once per scene, portal and mirror views reuse the sorted copy.
+================
+*/
+static void R_SortParticles()
+{
+	const int numParticles = ri.scn.numParticles;
+
+	for (int i=0 ; i<numParticles ; i++)
+	{
+		refParticle_t *p = &ri.scn.particleList[i];
+		if (!p->mat)
+			p->mat = ri.media.noMaterial;
+
+		r_partSortKeys[i].mat = p->mat;
+		r_partSortKeys[i].fog = R_FogForSphere(p->origin, p->radius);
+		r_partSortKeys[i].index = i;
+	}
+
+	qsort(r_partSortKeys, numParticles, sizeof(partSortKey_t), R_ParticleSortCmp);
+
+	for (int i=0 ; i<numParticles ; i++)
+	{
+		r_partSorted[i] = ri.scn.particleList[r_partSortKeys[i].index];
+		r_partFogs[i] = r_partSortKeys[i].fog;
+	}
+
+	ri.scn.bParticlesSorted = true;
+}
+
+
+/*
+================
+R_AddParticlesToList
+================
+*/
+void R_AddParticlesToList()
+{
+	if (!r_drawPolys->intVal || !ri.scn.numParticles)
+		return;
+
+	if (!ri.scn.bParticlesSorted)
+		R_SortParticles();
+
+	const int maxRun = RB_MAX_VERTS / 4;
+	const int numParticles = ri.scn.numParticles;
+
+	for (int start=0 ; start<numParticles ; )
+	{
+		refMaterial_t *mat = r_partSorted[start].mat;
+		mQ3BspFog_t *fog = r_partFogs[start];
+
+		int end = start+1;
+		while (end < numParticles && end-start < maxRun && r_partSorted[end].mat == mat && r_partFogs[end] == fog)
+			end++;
+
+		// Encode our index in the sorted list as our mesh for later
+		refMeshBuffer *mb = ri.scn.currentList->AddToList(MBT_PARTICLE, (void*)(start+1), mat, 0, NULL, fog, 0);
+		if (mb)
+			mb->infoKey = end - start;
+
+		start = end;
+	}
+}
+
+
+/*
+================
+R_PushParticles
+================
+*/
+void R_PushParticles(refMeshBuffer *mb, const meshFeatures_t features)
+{
+	int start = ((int)mb->mesh)-1;
+
+	RB_PushParticles(&r_partSorted[start], mb->infoKey, features);
+}
+
+
+/*
+================
+R_ParticleOverflow
+================
+*/
+bool R_ParticleOverflow(refMeshBuffer *mb)
+{
+	return RB_BackendOverflow(mb->infoKey*4, mb->infoKey*6);
+}
@@ -65,6 +65,7 @@ enum EMeshBufferType
 	MBT_DECAL,
 	MBT_INTERNAL,
 	MBT_POLY,
+	MBT_PARTICLE,
 	MBT_Q2BSP,
 	MBT_Q3BSP,
 	MBT_Q3BSP_FLARE,
@@ -106,6 +107,22 @@ public:
 	inline EMeshBufferType DecodeMeshType() { return (EMeshBufferType)(sortValue & (MBT_MAX-1)); }
 };
 
+/*
+	A mesh buffer built off the render thread. Producers each own a fixed range
+	of slots, and refMeshList::AddStaged appends them afterwards in slot order,
+	so a staged scene sorts exactly like one added directly.
+*/
+class refMeshSlot
+{
+public:
+	refMeshBuffer			mb;
+	refMaterial_t			*mat;		// NULL if the slot is empty
+
+	inline void Clear() { mat = NULL; }
+
+	void Setup(const EMeshBufferType meshType, void *mesh, refMaterial_t *inMat, const float matTime, refEntity_t *ent, struct mQ3BspFog_t *fog, const int infoKey);
+};
+
 class refMeshList
 {
 public:
@@ -123,11 +140,13 @@ public:
 	}
 
 	refMeshBuffer *AddToList(const EMeshBufferType meshType, void *mesh, refMaterial_t *mat, const float matTime, refEntity_t *ent, struct mQ3BspFog_t *fog, const int infoKey);
+	refMeshBuffer *AddStaged(const refMeshSlot &slot);
 	void SortList();
 	void DrawList();
 	void DrawOutlines();
 
 private:
+	refMeshBuffer *NewBuffer(const refMaterial_t *mat);
 	void BatchMeshBuffer(refMeshBuffer *mb, refMeshBuffer *nextMB);
 };
 
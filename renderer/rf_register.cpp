@@ -75,6 +75,7 @@ cVar_t	*r_debugCulling;
 cVar_t	*r_debugLighting;
 cVar_t	*r_debugLightmapIndex;
 cVar_t	*r_debugSorting;
+cVar_t	*r_radixSort;
 cVar_t	*r_defaultFont;
 cVar_t	*r_detailTextures;
 cVar_t	*r_displayFreq;
@@ -90,11 +91,23 @@ cVar_t	*r_fontScale;
 cVar_t	*r_fullbright;
 cVar_t	*r_hwGamma;
 cVar_t	*r_lerpmodels;
+cVar_t	*r_aliasPoseCache;
 cVar_t	*r_lightlevel;
 cVar_t	*r_lmMaxBlockSize;
 cVar_t	*r_lmModulate;
 cVar_t	*r_lmPacking;
+cVar_t	*r_materialCache;
+cVar_t	*r_imageJobs;
+cVar_t	*r_linearMipmaps;
+cVar_t	*r_imageCache;
+cVar_t	*r_imageCacheSize;
+cVar_t	*r_imageCacheCompress;
+cVar_t	*r_bspCache;
+cVar_t	*r_lightmapJobs;
 cVar_t	*r_noCull;
+cVar_t	*r_occlusion;
+cVar_t	*r_sceneJobs;
+cVar_t	*r_sceneChecksum;
 cVar_t	*r_noRefresh;
 cVar_t	*r_debugServerPhysics;
 cVar_t	*r_noVis;
@@ -119,6 +132,7 @@ cVar_t	*r_multisamples;
 cVar_t	*r_stencilbits;
 cVar_t	*cl_stereo;
 cVar_t	*gl_allow_software;
+cVar_t	*r_nullBackend;
 cVar_t	*gl_stencilbuffer;
 
 cVar_t	*vid_gamma;
@@ -138,6 +152,8 @@ static conCmd_t	*cmd_gfxInfo;
 static conCmd_t	*cmd_rendererClass;
 static conCmd_t	*cmd_eglRenderer;
 static conCmd_t	*cmd_eglVersion;
+static conCmd_t	*cmd_sortBench;
+static conCmd_t	*cmd_cullBench;
 
 /*
 =============================================================================
@@ -383,6 +399,7 @@ void R_RegisterConfig()
 	r_debugLighting		= Cvar_Register("r_debugLighting",		"0",			CVAR_CHEAT);
 	r_debugLightmapIndex= Cvar_Register("r_debugLightmapIndex","-1",			CVAR_CHEAT);
 	r_debugSorting		= Cvar_Register("r_debugSorting",		"0",			CVAR_CHEAT);
+	r_radixSort			= Cvar_Register("r_radixSort",			"1",			0);
 	r_defaultFont		= Cvar_Register("r_defaultFont",		"default",		CVAR_ARCHIVE);
 	r_detailTextures	= Cvar_Register("r_detailTextures",		"1",			CVAR_ARCHIVE);
 	r_displayFreq		= Cvar_Register("r_displayfreq",		"0",			CVAR_ARCHIVE|CVAR_LATCH_VIDEO);
@@ -398,11 +415,23 @@ void R_RegisterConfig()
 	r_fullbright		= Cvar_Register("r_fullbright",			"0",			CVAR_CHEAT);
 	r_hwGamma			= Cvar_Register("r_hwGamma",			"0",			CVAR_ARCHIVE|CVAR_LATCH_VIDEO);
 	r_lerpmodels		= Cvar_Register("r_lerpmodels",			"1",			0);
+	r_aliasPoseCache	= Cvar_Register("r_aliasPoseCache",		"1",			0);
 	r_lightlevel		= Cvar_Register("r_lightlevel",			"0",			0);
 	r_lmMaxBlockSize	= Cvar_Register("r_lmMaxBlockSize",		"4096",			CVAR_ARCHIVE|CVAR_LATCH_VIDEO);
 	r_lmModulate		= Cvar_Register("r_lmModulate",			"2",			CVAR_ARCHIVE|CVAR_LATCH_VIDEO);
 	r_lmPacking			= Cvar_Register("r_lmPacking",			"1",			CVAR_ARCHIVE|CVAR_LATCH_VIDEO);
+	r_materialCache		= Cvar_Register("r_materialCache",		"1",			0);
+	r_imageJobs			= Cvar_Register("r_imageJobs",			"1",			CVAR_ARCHIVE);
+	r_linearMipmaps		= Cvar_Register("r_linearMipmaps",		"0",			CVAR_ARCHIVE|CVAR_LATCH_VIDEO);
+	r_imageCache		= Cvar_Register("r_imageCache",			"1",			CVAR_ARCHIVE);
+	r_imageCacheSize	= Cvar_Register("r_imageCacheSize",		"256",			CVAR_ARCHIVE);
+	r_imageCacheCompress= Cvar_Register("r_imageCacheCompress",	"1",			CVAR_ARCHIVE);
+	r_bspCache			= Cvar_Register("r_bspCache",			"1",			CVAR_ARCHIVE);
+	r_lightmapJobs		= Cvar_Register("r_lightmapJobs",		"1",			CVAR_ARCHIVE);
 	r_noCull			= Cvar_Register("r_noCull",				"0",			0);
+	r_occlusion			= Cvar_Register("r_occlusion",			"1",			CVAR_ARCHIVE);
+	r_sceneJobs			= Cvar_Register("r_sceneJobs",			"1",			CVAR_ARCHIVE);
+	r_sceneChecksum		= Cvar_Register("r_sceneChecksum",		"0",			0);
 	r_noRefresh			= Cvar_Register("r_noRefresh",			"0",			0);
 	r_debugServerPhysics= Cvar_Register("r_debugPhysics",		"0",			0);
 	r_noVis				= Cvar_Register("r_noVis",				"0",			0);
@@ -427,6 +456,7 @@ void R_RegisterConfig()
 	r_multisamples		= Cvar_Register("r_multisamples",		"0",			CVAR_LATCH_VIDEO);
 	cl_stereo			= Cvar_Register("cl_stereo",			"0",			CVAR_LATCH_VIDEO);
 	gl_allow_software	= Cvar_Register("gl_allow_software",	"0",			CVAR_LATCH_VIDEO);
+	r_nullBackend		= Cvar_Register("r_nullBackend",		"0",			CVAR_LATCH_VIDEO);
 	gl_stencilbuffer	= Cvar_Register("gl_stencilbuffer",		"1",			CVAR_ARCHIVE|CVAR_LATCH_VIDEO);
 
 	vid_gamma			= Cvar_Register("vid_gamma",			"1.0",						CVAR_ARCHIVE);
@@ -456,6 +486,8 @@ void R_RegisterConfig()
 	cmd_rendererClass	= Cmd_AddCommand("rendererclass",	0, R_RendererClass_f,		"Prints out the renderer class");
 	cmd_eglRenderer		= Cmd_AddCommand("egl_renderer",	0, R_RendererMsg_f,			"Spams to the server your renderer information");
 	cmd_eglVersion		= Cmd_AddCommand("egl_version",		0, R_VersionMsg_f,			"Spams to the server your client version");
+	cmd_sortBench		= Cmd_AddCommand("r_sortbench",		0, R_SortBench_f,			"Times mesh buffer sorting over the last frame's keys");
+	cmd_cullBench		= Cmd_AddCommand("r_cullbench",		0, R_CullBench_f,			"Times batch frustum culling against the per-bounds tests");
 }
 
 /*
@@ -469,6 +501,8 @@ void R_UnRegisterConfig()
 	Cmd_RemoveCommand(cmd_rendererClass);
 	Cmd_RemoveCommand(cmd_eglRenderer);
 	Cmd_RemoveCommand(cmd_eglVersion);
+	Cmd_RemoveCommand(cmd_sortBench);
+	Cmd_RemoveCommand(cmd_cullBench);
 }
 
 /*
@@ -499,6 +533,9 @@ void R_BeginRegistration()
 	ri.reg.imagesResampled = 0;
 	ri.reg.imagesSeaked = 0;
 	ri.reg.imagesTouched = 0;
+	ri.reg.imagesPrefetched = 0;
+	ri.reg.imagesPrefetchUsed = 0;
+	ri.reg.imagesCached = 0;
 	ri.reg.modelsReleased = 0;
 	ri.reg.modelsSeaked = 0;
 	ri.reg.modelsTouched = 0;
@@ -79,6 +79,7 @@ extern cVar_t	*r_debugCulling;
 extern cVar_t	*r_debugLighting;
 extern cVar_t	*r_debugLightmapIndex;
 extern cVar_t	*r_debugSorting;
+extern cVar_t	*r_radixSort;
 extern cVar_t	*r_defaultFont;
 extern cVar_t	*r_detailTextures;
 extern cVar_t	*r_displayFreq;
@@ -94,11 +95,23 @@ extern cVar_t	*r_fontScale;
 extern cVar_t	*r_fullbright;
 extern cVar_t	*r_hwGamma;
 extern cVar_t	*r_lerpmodels;
+extern cVar_t	*r_aliasPoseCache;
 extern cVar_t	*r_lightlevel;	// FIXME: This is a HACK to get the client's light level
 extern cVar_t	*r_lmMaxBlockSize;
 extern cVar_t	*r_lmModulate;
 extern cVar_t	*r_lmPacking;
+extern cVar_t	*r_materialCache;
+extern cVar_t	*r_imageJobs;
+extern cVar_t	*r_linearMipmaps;
+extern cVar_t	*r_imageCache;
+extern cVar_t	*r_imageCacheSize;
+extern cVar_t	*r_imageCacheCompress;
+extern cVar_t	*r_bspCache;
+extern cVar_t	*r_lightmapJobs;
 extern cVar_t	*r_noCull;
+extern cVar_t	*r_occlusion;
+extern cVar_t	*r_sceneJobs;
+extern cVar_t	*r_sceneChecksum;
 extern cVar_t	*r_noRefresh;
 extern cVar_t	*r_debugServerPhysics;
 extern cVar_t	*r_noVis;
@@ -123,6 +136,7 @@ extern cVar_t	*r_multisamples;
 extern cVar_t	*r_stencilbits;
 extern cVar_t	*cl_stereo;
 extern cVar_t	*gl_allow_software;
+extern cVar_t	*r_nullBackend;
 extern cVar_t	*gl_stencilbuffer;
 
 extern cVar_t	*vid_gammapics;
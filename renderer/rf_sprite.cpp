@@ -39,25 +39,38 @@ static vec3_t	r_spriteNormals[4];
 
 /*
 =================
-R_AddSP2ModelToList
+R_SP2ModelRadius
+
+Radius R_CullEntityList tests the sprite with, false if it can't be drawn.
 =================
 */
-void R_AddSP2ModelToList(refEntity_t *ent)
+bool R_SP2ModelRadius(refEntity_t *ent, float &outRadius)
 {
 	mSpriteModel_t *spriteModel = ent->model->SpriteData();
 	mSpriteFrame_t *spriteFrame = &spriteModel->frames[ent->frame % spriteModel->numFrames];
 
-	if (R_CullSphere(ent->origin, spriteFrame->radius, ri.scn.clipFlags))
-		return;
-
-	refMaterial_t *mat = spriteFrame->skin;
-	if (!mat)
+	if (!spriteFrame->skin)
 	{
 		Com_DevPrintf(PRNT_WARNING, "R_AddSP2ModelToList: '%s' has a NULL material\n", ent->model->name);
-		return;
+		return false;
 	}
 
-	ri.scn.currentList->AddToList(MBT_SP2, spriteModel, mat, ent->matTime, ent, R_FogForSphere(ent->origin, spriteFrame->radius), 0);
+	outRadius = spriteFrame->radius;
+	return true;
+}
+
+
+/*
+=================
+R_StageSP2Model
+=================
+*/
+void R_StageSP2Model(refEntity_t *ent, refMeshSlot *slot)
+{
+	mSpriteModel_t *spriteModel = ent->model->SpriteData();
+	mSpriteFrame_t *spriteFrame = &spriteModel->frames[ent->frame % spriteModel->numFrames];
+
+	slot->Setup(MBT_SP2, spriteModel, spriteFrame->skin, ent->matTime, ent, R_FogForSphere(ent->origin, spriteFrame->radius), 0);
 }
 
 
@@ -24,6 +24,226 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 
 #include "rf_local.h"
 
+/*
+=============================================================================
+
+	WORLD SURFACE STAGING
+
+	The world walk only queues the surfaces that pass the cheap tests. The
+	frustum batch and the mesh buffers for them are built a chunk at a time by
+	R_StageWorldChunk, usually on the job threads, and R_AddWorldSurfacesToList
+	adds the results in queue order on the render thread.
+=============================================================================
+*/
+
+#define MAX_WORLD_BATCH		8192
+#define WORLD_CHUNK_SIZE	512
+
+enum
+{
+	WS_CULLED,
+	WS_MESH,
+	WS_SKY
+};
+
+static TCullBoxBatch<MAX_WORLD_BATCH> r_worldBatch;
+static mBspSurface_t *r_worldBatchSurf[MAX_WORLD_BATCH];
+static mQ2BspTexInfo_t *r_worldBatchTexInfo[MAX_WORLD_BATCH];
+static byte r_worldBatchState[MAX_WORLD_BATCH];
+static refMeshSlot r_worldSlots[MAX_WORLD_BATCH*2];		// The surface, then its caustics
+static uint32 r_worldChunkVisible[MAX_WORLD_BATCH/WORLD_CHUNK_SIZE];
+
+/*
+================
+R_Q2SurfCaustics
+================
+*/
+static refMaterial_t *R_Q2SurfCaustics(const mBspSurface_t *surf, const mQ2BspTexInfo_t *texInfo)
+{
+	if (r_caustics->intVal && surf->q2_flags & SURF_UNDERWATER && texInfo->mat->sortKey == MAT_SORT_OPAQUE && surf->lmTexNum != BAD_LMTEXNUM)
+	{
+		if (surf->q2_flags & SURF_LAVA && ri.media.worldLavaCaustics)
+			return ri.media.worldLavaCaustics;
+		else if (surf->q2_flags & SURF_SLIME && ri.media.worldSlimeCaustics)
+			return ri.media.worldSlimeCaustics;
+		else if (ri.media.worldWaterCaustics)
+			return ri.media.worldWaterCaustics;
+	}
+
+	return NULL;
+}
+
+
+/*
+================
+R_WorldSceneChunks
+================
+*/
+uint32 R_WorldSceneChunks()
+{
+	return (r_worldBatch.numBoxes + WORLD_CHUNK_SIZE - 1) / WORLD_CHUNK_SIZE;
+}
+
+
+/*
+================
+R_StageWorldChunk
+
+Frustum culls one chunk of the queue and fills its mesh slots. Only writes
+to the chunk's own entries, so chunks can run on any thread.
+================
+*/
+void R_StageWorldChunk(const uint32 chunk)
+{
+	const uint32 first = chunk * WORLD_CHUNK_SIZE;
+	const uint32 numBoxes = min(r_worldBatch.numBoxes - first, (uint32)WORLD_CHUNK_SIZE);
+
+	const float *mins[3] = { r_worldBatch.mins[0] + first, r_worldBatch.mins[1] + first, r_worldBatch.mins[2] + first };
+	const float *maxs[3] = { r_worldBatch.maxs[0] + first, r_worldBatch.maxs[1] + first, r_worldBatch.maxs[2] + first };
+
+	uint16 visible[WORLD_CHUNK_SIZE];
+	const uint32 numVisible = R_CullBoxBatch(mins, maxs, numBoxes, ri.scn.clipFlags, visible, false);
+	r_worldChunkVisible[chunk] = numVisible;
+
+	memset(r_worldBatchState + first, WS_CULLED, numBoxes);
+
+	refEntity_t *ent = ri.scn.worldEntity;
+	const bool bQ3 = (ri.scn.worldModel->type == MODEL_Q3BSP);
+	for (uint32 i=0 ; i<numVisible ; i++)
+	{
+		const uint32 index = first + visible[i];
+		mBspSurface_t *surf = r_worldBatchSurf[index];
+		refMeshSlot *slots = &r_worldSlots[index*2];
+
+		if (bQ3)
+		{
+			if (surf->q3_matRef->mat->flags & MAT_SKY)
+			{
+				r_worldBatchState[index] = WS_SKY;
+				continue;
+			}
+
+			slots[0].Setup(MBT_Q3BSP, surf, surf->q3_matRef->mat, ent->matTime, ent, surf->q3_fog, 0);
+			slots[1].Clear();
+		}
+		else
+		{
+			mQ2BspTexInfo_t *texInfo = r_worldBatchTexInfo[index];
+			if (texInfo->flags & SURF_TEXINFO_SKY)
+			{
+				r_worldBatchState[index] = WS_SKY;
+				continue;
+			}
+
+			slots[0].Setup(MBT_Q2BSP, surf, texInfo->mat, ent->matTime, ent, NULL, 0);
+
+			refMaterial_t *caustics = R_Q2SurfCaustics(surf, texInfo);
+			if (caustics)
+				slots[1].Setup(MBT_Q2BSP, surf, caustics, ent->matTime, ent, NULL, 0);
+			else
+				slots[1].Clear();
+		}
+
+		r_worldBatchState[index] = WS_MESH;
+	}
+}
+
+
+/*
+================
+R_WorldSceneChecksum
+================
+*/
+uint32 R_WorldSceneChecksum()
+{
+	uint32 hash = COM_FNV_SEED;
+	for (uint32 i=0 ; i<r_worldBatch.numBoxes ; i++)
+	{
+		hash = Com_FNVMix(hash, r_worldBatchState[i]);
+		if (r_worldBatchState[i] == WS_MESH)
+			hash = R_HashMeshSlots(&r_worldSlots[i*2], 2, hash);
+	}
+
+	return hash;
+}
+
+
+/*
+================
+R_AddWorldSurfacesToList
+
+Adds the staged queue to the list, sky surfaces are clipped here since the
+sky isn't safe to touch from a job.
+================
+*/
+void R_AddWorldSurfacesToList()
+{
+	if (!r_worldBatch.numBoxes)
+		return;
+
+	if (!ri.scn.bDrawingMeshOutlines)
+	{
+		const uint32 numChunks = R_WorldSceneChunks();
+		for (uint32 chunk=0 ; chunk<numChunks ; chunk++)
+		{
+			const uint32 numBoxes = min(r_worldBatch.numBoxes - chunk*WORLD_CHUNK_SIZE, (uint32)WORLD_CHUNK_SIZE);
+			ri.pc.cullBounds[CULL_PASS] += numBoxes - r_worldChunkVisible[chunk];
+			ri.pc.cullBounds[CULL_FAIL] += r_worldChunkVisible[chunk];
+		}
+	}
+
+	const bool bQ3 = (ri.scn.worldModel->type == MODEL_Q3BSP);
+	for (uint32 i=0 ; i<r_worldBatch.numBoxes ; i++)
+	{
+		mBspSurface_t *surf = r_worldBatchSurf[i];
+
+		switch(r_worldBatchState[i])
+		{
+		case WS_SKY:
+			R_ClipSkySurface(surf);
+			break;
+
+		case WS_MESH:
+			if (bQ3)
+			{
+				if (ri.scn.currentList->AddStaged(r_worldSlots[i*2]))
+					surf->visFrame = ri.frameCount;
+			}
+			else
+			{
+				surf->visFrame = ri.frameCount;
+				if (ri.scn.currentList->AddStaged(r_worldSlots[i*2]))
+					ri.scn.currentList->AddStaged(r_worldSlots[i*2+1]);
+			}
+			break;
+		}
+	}
+
+	r_worldBatch.Clear();
+}
+
+
+/*
+================
+R_QueueWorldSurface
+================
+*/
+static void R_QueueWorldSurface(mBspSurface_t *surf, mQ2BspTexInfo_t *texInfo)
+{
+	// Flush on the render thread if the queue fills, order is kept either way
+	if (r_worldBatch.IsFull())
+	{
+		const uint32 numChunks = R_WorldSceneChunks();
+		for (uint32 chunk=0 ; chunk<numChunks ; chunk++)
+			R_StageWorldChunk(chunk);
+		R_AddWorldSurfacesToList();
+	}
+
+	const uint32 index = r_worldBatch.Add(surf->mins, surf->maxs);
+	r_worldBatchSurf[index] = surf;
+	r_worldBatchTexInfo[index] = texInfo;
+}
+
 /*
 =============================================================================
 
@@ -46,15 +266,9 @@ static void R_AddQ2Surface(mBspSurface_t *surf, mQ2BspTexInfo_t *texInfo, refEnt
 		return;
 
 	// Caustics
-	if (r_caustics->intVal && surf->q2_flags & SURF_UNDERWATER && texInfo->mat->sortKey == MAT_SORT_OPAQUE && surf->lmTexNum != BAD_LMTEXNUM)
-	{
-		if (surf->q2_flags & SURF_LAVA && ri.media.worldLavaCaustics)
-			ri.scn.currentList->AddToList(MBT_Q2BSP, surf, ri.media.worldLavaCaustics, entity->matTime, entity, NULL, 0);
-		else if (surf->q2_flags & SURF_SLIME && ri.media.worldSlimeCaustics)
-			ri.scn.currentList->AddToList(MBT_Q2BSP, surf, ri.media.worldSlimeCaustics, entity->matTime, entity, NULL, 0);
-		else if (ri.media.worldWaterCaustics)
-			ri.scn.currentList->AddToList(MBT_Q2BSP, surf, ri.media.worldWaterCaustics, entity->matTime, entity, NULL, 0);
-	}
+	refMaterial_t *caustics = R_Q2SurfCaustics(surf, texInfo);
+	if (caustics)
+		ri.scn.currentList->AddToList(MBT_Q2BSP, surf, caustics, entity->matTime, entity, NULL, 0);
 }
 
 
@@ -142,11 +356,58 @@ static bool R_CullQ2SurfacePlanar(const mBspSurface_t *surf, const refMaterial_t
 
 
 /*
-================
-R_CullQ2SurfaceBounds
-================
+===============
+R_MarkClusterLeaves
+
+Stamps the leafs of every cluster set in the vis row, and their parents up to
+the first one already stamped. Only the row and the leafs of visible clusters
+are touched, so crossing into a new cluster costs what it can see rather than
+the size of the map.
+===============
 */
-#define R_CullQ2SurfaceBounds(surf,clipFlags) R_CullBox((surf)->mins,(surf)->maxs,(clipFlags))
+static void R_MarkClusterLeaves(const byte *vis)
+{
+	const uint32 startCycles = Sys_Cycles();
+	const mBspModelBase_t *bspModel = ri.scn.worldModel->BSPData();
+	const uint32 visFrame = ri.scn.visFrameCount;
+	const int rowBytes = (bspModel->numClusters+7)>>3;
+
+	uint32 numLeafs = 0, numNodes = 0;
+	for (int i=0 ; i<rowBytes ; i++)
+	{
+		if (!vis[i])
+			continue;
+
+		for (int bit=0 ; bit<8 ; bit++)
+		{
+			const int cluster = (i<<3) + bit;
+			if (!(vis[i] & BIT(bit)) || cluster >= bspModel->numClusters)
+				continue;
+
+			ri.pc.markClusters++;
+
+			mBspLeaf_t **leaf = bspModel->clusterLeafs + bspModel->clusterFirstLeaf[cluster];
+			mBspLeaf_t **lastLeaf = bspModel->clusterLeafs + bspModel->clusterFirstLeaf[cluster+1];
+			for ( ; leaf<lastLeaf ; leaf++)
+			{
+				mBspNode_t *node = (mBspNode_t *)*leaf;
+				node->visFrame = visFrame;
+				numLeafs++;
+
+				for (node=node->parent ; node && node->visFrame != visFrame ; node=node->parent)
+				{
+					node->visFrame = visFrame;
+					numNodes++;
+				}
+			}
+		}
+	}
+
+	ri.pc.markLeafs += numLeafs;
+	ri.pc.markNodes += numNodes;
+	ri.pc.markRebuilds++;
+	ri.pc.timeMarkLeavesPeak = max(ri.pc.timeMarkLeavesPeak, Sys_Cycles() - startCycles);
+}
 
 
 /*
@@ -221,33 +482,19 @@ static void R_MarkQ2Leaves()
 	byte *vis = R_BSPClusterPVS(ri.scn.viewCluster, ri.scn.worldModel);
 
 	// May have to combine two clusters because of solid water boundaries
+	byte fatVis[Q2BSP_MAX_VIS];
 	if (viewCluster2 != ri.scn.viewCluster)
 	{
-		byte fatVis[Q2BSP_MAX_VIS];
-		memcpy(fatVis, vis, (ri.scn.worldModel->BSPData()->numLeafs+7)/8);
+		// The rows are cluster bits, so the union is only as long as the cluster count
+		const int c = (ri.scn.worldModel->BSPData()->numClusters+31)/32;
+		memcpy(fatVis, vis, c*4);
 		vis = R_BSPClusterPVS(viewCluster2, ri.scn.worldModel);
-		int c = (ri.scn.worldModel->BSPData()->numLeafs+31)/32;
 		for (int i=0 ; i<c ; i++)
 			((int*)fatVis)[i] |= ((int*)vis)[i];
 		vis = fatVis;
 	}
 
-	for (int i=0 ; i<ri.scn.worldModel->BSPData()->numLeafs ; i++)
-	{
-		leaf = &ri.scn.worldModel->BSPData()->leafs[i];
-		if (leaf->cluster != -1 && vis[leaf->cluster>>3] & BIT(leaf->cluster&7))
-		{
-			mBspNode_t *node = (mBspNode_t *)leaf;
-			do
-			{
-				if (node->visFrame == ri.scn.visFrameCount)
-					break;
-
-				node->visFrame = ri.scn.visFrameCount;
-				node = node->parent;
-			} while (node);
-		}
-	}
+	R_MarkClusterLeaves(vis);
 }
 
 
@@ -290,6 +537,10 @@ static void R_RecursiveQ2WorldNode(mBspNode_t *node, uint32 clipFlags)
 			ri.pc.cullBounds[CULL_FAIL]++;
 	}
 
+	// Hidden behind the occluders
+	if (!node->badBounds && R_OccludedBox(node->mins, node->maxs))
+		return;
+
 	// If this is a leaf node
 	if (node->q2_contents != -1)
 	{
@@ -351,18 +602,9 @@ static void R_RecursiveQ2WorldNode(mBspNode_t *node, uint32 clipFlags)
 			// Cull
 			if (R_CullQ2SurfacePlanar(surf, texInfo->mat, dist))
 				continue;
-			if (R_CullQ2SurfaceBounds(surf, clipFlags))
-				continue;
-
-			// Sky surface
-			if (texInfo->flags & SURF_TEXINFO_SKY)
-			{
-				R_ClipSkySurface(surf);
-				continue;
-			}
 
-			// World surface
-			R_AddQ2Surface(surf, texInfo, ri.scn.worldEntity);
+			// Frustum culled and added by R_AddWorldSurfacesToList
+			R_QueueWorldSurface(surf, texInfo);
 		} while (*mark);
 	}
 
@@ -370,6 +612,100 @@ static void R_RecursiveQ2WorldNode(mBspNode_t *node, uint32 clipFlags)
 	R_RecursiveQ2WorldNode(node->children[side^1], clipFlags);
 }
 
+
+/*
+================
+R_CullOccluderNode
+
+Frustum and range test for the occluder walks, kept off the cull counters
+================
+*/
+static bool R_CullOccluderNode(const mBspNode_t *node, uint32 &clipFlags)
+{
+	if (node->visFrame != ri.scn.visFrameCount)
+		return true;
+	if (node->badBounds)
+		return false;
+	if (!R_OccluderInRange(node->mins, node->maxs))
+		return true;
+
+	for (int num=0 ; num<FRP_MAX ; num++)
+	{
+		if (!(clipFlags & BIT(num)))
+			continue;
+
+		switch(BoxOnPlaneSide(node->mins, node->maxs, &ri.scn.viewFrustum[num]))
+		{
+		case 1:
+			clipFlags &= ~BIT(num);
+			break;
+
+		case 2:
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*
+================
+R_AddQ2Occluder
+================
+*/
+static void R_AddQ2Occluder(mBspSurface_t *surf)
+{
+	if (surf->q2_texInfo->flags & (SURF_TEXINFO_SKY|SURF_TEXINFO_WARP|SURF_TEXINFO_TRANS33|SURF_TEXINFO_TRANS66|SURF_TEXINFO_NODRAW))
+		return;
+
+	// Only faces that R_CullQ2SurfacePlanar keeps
+	const refMaterial_t *mat = R_Q2SurfMaterial(surf)->mat;
+	if (mat->stateBits & (SB_CULL_BACK|SB_CULL_FRONT))
+	{
+		float dist = PlaneDiff(ri.def.viewOrigin, surf->q2_plane);
+		if (surf->q2_flags & SURF_PLANEBACK)
+			dist = -dist;
+		if (mat->stateBits & SB_CULL_BACK)
+			dist = -dist;
+		if (dist <= SMALL_EPSILON)
+			return;
+	}
+
+	R_AddOccluder(surf, mat);
+}
+
+
+/*
+================
+R_RecursiveQ2Occluders
+================
+*/
+static void R_RecursiveQ2Occluders(mBspNode_t *node, uint32 clipFlags)
+{
+	if (node->q2_contents == CONTENTS_SOLID)
+		return;
+	if (R_CullOccluderNode(node, clipFlags))
+		return;
+
+	// Leaf, offer its surfaces
+	if (node->q2_contents != -1)
+	{
+		mBspLeaf_t *leaf = (mBspLeaf_t*)node;
+		if (ri.def.areaBits && !(ri.def.areaBits[leaf->area>>3] & BIT(leaf->area&7)))
+			return;
+
+		for (int i=0 ; i<leaf->q2_numMarkSurfaces ; i++)
+			R_AddQ2Occluder(leaf->q2_firstMarkSurface[i]);
+		return;
+	}
+
+	// Near side first, so a full candidate list keeps the closest surfaces
+	const int side = (PlaneDiff(ri.def.viewOrigin, node->plane) >= 0) ? 0 : 1;
+	R_RecursiveQ2Occluders(node->children[side], clipFlags);
+	R_RecursiveQ2Occluders(node->children[side^1], clipFlags);
+}
+
 /*
 =============================================================================
 
@@ -563,14 +899,6 @@ static bool R_CullQ3SurfacePlanar(mBspSurface_t *surf, refMaterial_t *mat, vec3_
 }
 
 
-/*
-=============
-R_CullQ3SurfaceBounds
-=============
-*/
-#define R_CullQ3SurfaceBounds(surf,clipFlags) R_CullBox((surf)->mins,(surf)->maxs,(clipFlags))
-
-
 /*
 =============
 R_RecursiveQ3WorldNode
@@ -609,6 +937,9 @@ static void R_RecursiveQ3WorldNode(mBspNode_t *node, uint32 clipFlags)
 				ri.pc.cullBounds[CULL_FAIL]++;
 		}
 
+		if (!node->badBounds && R_OccludedBox(node->mins, node->maxs))
+			return;
+
 		if (!node->plane)
 			break;
 
@@ -649,10 +980,8 @@ static void R_RecursiveQ3WorldNode(mBspNode_t *node, uint32 clipFlags)
 			{
 				if (R_CullQ3SurfacePlanar(surf, surf->q3_matRef->mat, ri.def.viewOrigin))
 					continue;
-				if (R_CullQ3SurfaceBounds(surf, clipFlags))
-					continue;
 
-				R_ClipSkySurface(surf);
+				R_QueueWorldSurface(surf, NULL);
 				continue;
 			}
 
@@ -670,10 +999,7 @@ static void R_RecursiveQ3WorldNode(mBspNode_t *node, uint32 clipFlags)
 					continue;
 				// FALL THROUGH
 			default:
-				if (R_CullQ3SurfaceBounds(surf, clipFlags))
-					continue;
-
-				R_AddQ3Surface(surf, ri.scn.worldEntity, MBT_Q3BSP);
+				R_QueueWorldSurface(surf, NULL);
 				break;
 			}
 		} while (*mark);
@@ -728,22 +1054,64 @@ static void R_MarkQ3Leaves()
 		return;
 	}
 
-	byte *vis = R_BSPClusterPVS(ri.scn.viewCluster, ri.scn.worldModel);
-	for (int i=0 ; i<ri.scn.worldModel->BSPData()->numLeafs ; i++)
+	R_MarkClusterLeaves(R_BSPClusterPVS(ri.scn.viewCluster, ri.scn.worldModel));
+}
+
+
+/*
+=============
+R_AddQ3Occluder
+=============
+*/
+static void R_AddQ3Occluder(mBspSurface_t *surf)
+{
+	if (surf->q3_faceType != FACETYPE_PLANAR || !surf->mesh)
+		return;
+
+	// Only faces that R_CullQ3SurfacePlanar keeps
+	const refMaterial_t *mat = surf->q3_matRef->mat;
+	if (mat->stateBits & SB_CULL_MASK)
 	{
-		mBspLeaf_t *leaf = &ri.scn.worldModel->BSPData()->leafs[i];
-		if (leaf->cluster != -1 && vis[leaf->cluster>>3] & BIT(leaf->cluster&7))
-		{
-			mBspNode_t *node = (mBspNode_t *)leaf;
-			do
-			{
-				if (node->visFrame == ri.scn.visFrameCount)
-					break;
-				node->visFrame = ri.scn.visFrameCount;
-				node = node->parent;
-			} while (node);
-		}
+		vec3_t delta;
+		Vec3Subtract(ri.def.viewOrigin, surf->mesh->vertexArray[0], delta);
+
+		float dot = DotProduct(delta, surf->q3_origin);
+		if (!(mat->stateBits & SB_CULL_FRONT))
+			dot = -dot;
+		if (dot <= SMALL_EPSILON)
+			return;
 	}
+
+	R_AddOccluder(surf, mat);
+}
+
+
+/*
+=============
+R_RecursiveQ3Occluders
+=============
+*/
+static void R_RecursiveQ3Occluders(mBspNode_t *node, uint32 clipFlags)
+{
+	if (R_CullOccluderNode(node, clipFlags))
+		return;
+
+	if (node->plane)
+	{
+		const int side = (PlaneDiff(ri.def.viewOrigin, node->plane) >= 0) ? 0 : 1;
+		R_RecursiveQ3Occluders(node->children[side], clipFlags);
+		R_RecursiveQ3Occluders(node->children[side^1], clipFlags);
+		return;
+	}
+
+	mBspLeaf_t *leaf = (mBspLeaf_t *)node;
+	if (!leaf->q3_firstVisSurface)
+		return;
+	if (ri.def.areaBits && !(ri.def.areaBits[leaf->area>>3] & BIT(leaf->area&7)))
+		return;
+
+	for (mBspSurface_t **mark=leaf->q3_firstVisSurface ; *mark ; mark++)
+		R_AddQ3Occluder(*mark);
 }
 
 /*
@@ -831,43 +1199,6 @@ void R_AddQ3BrushModel(refEntity_t *ent)
 =============================================================================
 */
 
-/*
-=================
-R_CullBrushModel
-=================
-*/
-bool R_CullBrushModel(refEntity_t *ent, const uint32 clipFlags)
-{
-	if (!ent->model->BSPData()->firstModelVisSurface)
-		return true;
-	if (r_noCull->intVal)
-		return false;
-
-	// Frustum cull
-	if (!Matrix3_Compare(ent->axis, axisIdentity))
-	{
-		if (R_CullSphere(ent->origin, ent->model->radius * ent->scale, clipFlags))
-			return true;
-	//	if (R_CullTransformedBounds(ent->origin, ent->axis, ent->model->mins, ent->model->maxs, clipFlags))
-	//		return true;
-	}
-	else
-	{
-		// Calculate bounds
-		vec3_t mins;
-		Vec3MA(ent->origin, ent->scale, ent->model->mins, mins);
-
-		vec3_t maxs;
-		Vec3MA(ent->origin, ent->scale, ent->model->maxs, maxs);
-
-		if (R_CullBox(mins, maxs, clipFlags))
-			return true;
-	}
-
-	return false;
-}
-
-
 /*
 =============
 R_AddWorldToList
@@ -878,6 +1209,13 @@ void R_AddWorldToList()
 	// Prepare the sky
 	R_AddSkyToList();
 
+	// Occluders are rebuilt below for normal views of the world
+	if (ri.scn.viewType == RVT_NORMAL)
+		R_ClearOcclusion();
+
+	// Surfaces queued by the walk are added in R_AddWorldSurfacesToList
+	r_worldBatch.Clear();
+
 	if (ri.def.rdFlags & RDF_NOWORLDMODEL)
 		return;
 
@@ -896,11 +1234,21 @@ void R_AddWorldToList()
 			// Mark leaves
 			{
 				qStatCycle_Scope Stat(r_times, ri.pc.timeMarkLeaves);
+				qProfile_Scope Prof("R_MarkLeaves");
 				R_MarkQ3Leaves();
 			}
 
 			if (r_drawworld->intVal)
 			{
+				// Build the occlusion buffer
+				if (R_BeginOcclusion())
+				{
+					qStatCycle_Scope Stat(r_times, ri.pc.timeOcclusion);
+					qProfile_Scope Prof("R_Occlusion");
+					R_RecursiveQ3Occluders(ri.scn.worldModel->BSPData()->nodes, ri.scn.clipFlags);
+					R_EndOcclusion();
+				}
+
 				// Mark lights
 				{
 					qStatCycle_Scope Stat(r_times, ri.pc.timeMarkLights);
@@ -910,6 +1258,7 @@ void R_AddWorldToList()
 				// Recurse the world
 				{
 					qStatCycle_Scope Stat(r_times, ri.pc.timeRecurseWorld);
+					qProfile_Scope Prof("R_RecurseWorld");
 					R_RecursiveQ3WorldNode(ri.scn.worldModel->BSPData()->nodes, ri.scn.clipFlags);
 				}
 			}
@@ -921,11 +1270,21 @@ void R_AddWorldToList()
 			// Mark leaves
 			{
 				qStatCycle_Scope Stat(r_times, ri.pc.timeMarkLeaves);
+				qProfile_Scope Prof("R_MarkLeaves");
 				R_MarkQ2Leaves();
 			}
 
 			if (r_drawworld->intVal)
 			{
+				// Build the occlusion buffer
+				if (R_BeginOcclusion())
+				{
+					qStatCycle_Scope Stat(r_times, ri.pc.timeOcclusion);
+					qProfile_Scope Prof("R_Occlusion");
+					R_RecursiveQ2Occluders(ri.scn.worldModel->BSPData()->nodes, ri.scn.clipFlags);
+					R_EndOcclusion();
+				}
+
 				// Mark lights
 				{
 					qStatCycle_Scope Stat(r_times, ri.pc.timeMarkLights);
@@ -935,6 +1294,7 @@ void R_AddWorldToList()
 				// Recurse the world
 				{
 					qStatCycle_Scope Stat(r_times, ri.pc.timeRecurseWorld);
+					qProfile_Scope Prof("R_RecurseWorld");
 					R_RecursiveQ2WorldNode(ri.scn.worldModel->BSPData()->nodes, ri.scn.clipFlags);
 				}
 			}
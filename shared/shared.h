@@ -324,6 +324,9 @@ enum EFSSeekOrigin
 	FS_SEEK_END
 };
 
+// used for Job_Run, called once per jobNum from any thread
+typedef void (*jobFunc_t) (void *arg, const int jobNum);
+
 //
 // this is only here so the functions in shared/ can link
 //
@@ -40,6 +40,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <errno.h>
 #include <dlfcn.h>
 #include <dirent.h>
+#include <pthread.h>
+#include <semaphore.h>
 
 #include "../common/common.h"
 #include "unix_local.h"
@@ -595,6 +597,173 @@ int Sys_FindFiles (char *path, char *pattern, char **fileList, int maxFiles, int
 	return maxFiles-f.max;
 }
 
+/*
+========================================================================
+
+	THREADS
+
+========================================================================
+*/
+
+struct sysThread_t {
+	pthread_t		handle;
+	void			(*func) (void *arg);
+	void			*arg;
+};
+
+struct sysSemaphore_t {
+	sem_t			handle;
+};
+
+/*
+================
+Sys_ThreadProc
+================
+*/
+static void *Sys_ThreadProc (void *param)
+{
+	sysThread_t *thread = (sysThread_t *)param;
+
+	thread->func (thread->arg);
+	return NULL;
+}
+
+
+/*
+================
+Sys_CreateThread
+================
+*/
+sysThread_t *Sys_CreateThread (void (*func) (void *arg), void *arg)
+{
+	sysThread_t *thread = new sysThread_t;
+
+	thread->func = func;
+	thread->arg = arg;
+	if (pthread_create (&thread->handle, NULL, Sys_ThreadProc, thread)) {
+		delete thread;
+		return NULL;
+	}
+
+	return thread;
+}
+
+
+/*
+================
+Sys_WaitForThread
+
+Blocks until the thread exits, then frees it.
+================
+*/
+void Sys_WaitForThread (sysThread_t *thread)
+{
+	pthread_join (thread->handle, NULL);
+	delete thread;
+}
+
+
+/*
+================
+Sys_CreateSemaphore
+================
+*/
+sysSemaphore_t *Sys_CreateSemaphore (void)
+{
+	sysSemaphore_t *sem = new sysSemaphore_t;
+
+	sem_init (&sem->handle, 0, 0);
+	return sem;
+}
+
+
+/*
+================
+Sys_DestroySemaphore
+================
+*/
+void Sys_DestroySemaphore (sysSemaphore_t *sem)
+{
+	sem_destroy (&sem->handle);
+	delete sem;
+}
+
+
+/*
+================
+Sys_SemaphorePost
+================
+*/
+void Sys_SemaphorePost (sysSemaphore_t *sem)
+{
+	sem_post (&sem->handle);
+}
+
+
+/*
+================
+Sys_SemaphoreWait
+================
+*/
+void Sys_SemaphoreWait (sysSemaphore_t *sem)
+{
+	while (sem_wait (&sem->handle) == -1 && errno == EINTR)
+		;
+}
+
+
+/*
+================
+Sys_AtomicAdd
+================
+*/
+long Sys_AtomicAdd (volatile long *value, const long amount)
+{
+	return __sync_add_and_fetch (value, amount);
+}
+
+
+/*
+================
+Sys_Sleep
+================
+*/
+void Sys_Sleep (const int msec)
+{
+	usleep (msec * 1000);
+}
+
+
+/*
+================
+Sys_NumProcessors
+================
+*/
+int Sys_NumProcessors (void)
+{
+	long	count;
+
+	count = sysconf (_SC_NPROCESSORS_ONLN);
+	return (count > 0) ? (int)count : 1;
+}
+
+
+/*
+================
+Sys_HasSSE2
+================
+*/
+bool Sys_HasSSE2 (void)
+{
+#if defined(__x86_64__) || defined(__SSE2__)
+	return true;
+#elif defined(__i386__) && defined(__GNUC__)
+	return (__builtin_cpu_supports ("sse2") != 0);
+#else
+	return false;
+#endif
+}
+
 /*
 ========================================================================
 
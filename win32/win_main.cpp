@@ -33,6 +33,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
 #include <conio.h>
 #include <process.h>
 #include <dbghelp.h>
+#include <intrin.h>
 
 #if USE_CURL
 #define CURL_STATICLIB
@@ -522,6 +523,186 @@ TList<String> Sys_FindFiles (char *path, char *pattern, int fileCount, bool recu
 	return files;
 }
 
+/*
+==============================================================================
+
+	THREADS
+
+==============================================================================
+*/
+
+struct sysThread_t
+{
+	HANDLE			handle;
+	void			(*func) (void *arg);
+	void			*arg;
+};
+
+struct sysSemaphore_t
+{
+	HANDLE			handle;
+};
+
+/*
+================
+Sys_ThreadProc
+================
+*/
+static DWORD WINAPI Sys_ThreadProc (LPVOID param)
+{
+	sysThread_t *thread = (sysThread_t *)param;
+
+	thread->func (thread->arg);
+	return 0;
+}
+
+
+/*
+================
+Sys_CreateThread
+================
+*/
+sysThread_t *Sys_CreateThread (void (*func) (void *arg), void *arg)
+{
+	sysThread_t *thread = new sysThread_t;
+
+	thread->func = func;
+	thread->arg = arg;
+	thread->handle = CreateThread (NULL, 0, Sys_ThreadProc, thread, 0, NULL);
+	if (!thread->handle) {
+		delete thread;
+		return NULL;
+	}
+
+	return thread;
+}
+
+
+/*
+================
+Sys_WaitForThread
+
+Blocks until the thread exits, then frees it.
+================
+*/
+void Sys_WaitForThread (sysThread_t *thread)
+{
+	WaitForSingleObject (thread->handle, INFINITE);
+	CloseHandle (thread->handle);
+	delete thread;
+}
+
+
+/*
+================
+Sys_CreateSemaphore
+================
+*/
+sysSemaphore_t *Sys_CreateSemaphore ()
+{
+	sysSemaphore_t *sem = new sysSemaphore_t;
+
+	sem->handle = CreateSemaphore (NULL, 0, LONG_MAX, NULL);
+	return sem;
+}
+
+
+/*
+================
+Sys_DestroySemaphore
+================
+*/
+void Sys_DestroySemaphore (sysSemaphore_t *sem)
+{
+	CloseHandle (sem->handle);
+	delete sem;
+}
+
+
+/*
+================
+Sys_SemaphorePost
+================
+*/
+void Sys_SemaphorePost (sysSemaphore_t *sem)
+{
+	ReleaseSemaphore (sem->handle, 1, NULL);
+}
+
+
+/*
+================
+Sys_SemaphoreWait
+================
+*/
+void Sys_SemaphoreWait (sysSemaphore_t *sem)
+{
+	WaitForSingleObject (sem->handle, INFINITE);
+}
+
+
+/*
+================
+Sys_AtomicAdd
+================
+*/
+long Sys_AtomicAdd (volatile long *value, const long amount)
+{
+	return InterlockedExchangeAdd (value, amount) + amount;
+}
+
+
+/*
+================
+Sys_Sleep
+
+Gives up the rest of the time slice for at least msec, at the 1ms timer
+resolution WinMain sets up.
+================
+*/
+void Sys_Sleep (const int msec)
+{
+	Sleep (msec);
+}
+
+
+/*
+================
+Sys_NumProcessors
+================
+*/
+int Sys_NumProcessors ()
+{
+	SYSTEM_INFO	info;
+
+	GetSystemInfo (&info);
+	return (int)info.dwNumberOfProcessors;
+}
+
+
+/*
+================
+Sys_HasSSE2
+================
+*/
+bool Sys_HasSSE2 ()
+{
+#if defined(_M_X64)
+	return true;
+#elif defined(_M_IX86)
+	static int	hasSSE2 = -1;
+
+	if (hasSSE2 < 0) {
+		int info[4];
+		__cpuid (info, 1);
+		hasSSE2 = (info[3] & (1<<26)) ? 1 : 0;
+	}
+	return (hasSSE2 != 0);
+#else
+	return false;
+#endif
+}
+
 /*
 ==============================================================================
 
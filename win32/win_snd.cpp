@@ -54,23 +54,6 @@ struct sndWin_t {
 
 static sndWin_t		snd_win;
 
-/*
-==============
-GetDirectSoundErrorString
-===============
-*/
-static const char *GetDirectSoundErrorString (int error)
-{
-	switch (error) {
-	case DSERR_BUFFERLOST:			return "DSERR_BUFFERLOST";
-	case DSERR_INVALIDCALL:			return "DSERR_INVALIDCALLS";
-	case DSERR_INVALIDPARAM:		return "DSERR_INVALIDPARAM";
-	case DSERR_PRIOLEVELNEEDED:		return "DSERR_PRIOLEVELNEEDED";
-	}
-
-	return "unknown";
-}
-
 /*
 ==============================================================================
 
@@ -439,7 +422,8 @@ int SndImp_GetDMAPos ()
 ==============
 SndImp_BeginPainting
 
-Makes sure snd_audioDMA.buffer is valid
+Makes sure snd_audioDMA.buffer is valid. Called from the audio thread, so
+failures leave the buffer NULL for the mixer to count instead of printing.
 ===============
 */
 void SndImp_BeginPainting ()
@@ -450,13 +434,14 @@ void SndImp_BeginPainting ()
 	HRESULT	hresult;
 	DWORD	dwStatus;
 
+	snd_audioDMA.buffer = NULL;
 	if (!snd_win.pDSBuf)
 		return;
 
 	// If the buffer was lost or stopped, restore it and/or restart it
 	if (snd_win.pDSBuf->GetStatus (&dwStatus) != DS_OK)
-		Com_Printf (PRNT_ERROR, "Couldn't get sound buffer status\n");
-	
+		return;
+
 	if (dwStatus & DSBSTATUS_BUFFERLOST)
 		snd_win.pDSBuf->Restore ();
 	
@@ -465,19 +450,14 @@ void SndImp_BeginPainting ()
 
 	// Lock the DirectSound buffer
 	reps = 0;
-	snd_audioDMA.buffer = NULL;
 	for ( ; ; ) {
 		hresult = snd_win.pDSBuf->Lock (0, snd_win.bufferSize, (LPVOID*)&pbuf, &snd_win.lockSize, (LPVOID*)&pbuf2, &dwSize2, 0);
 		if (hresult == DS_OK)
 			break;
-		if (hresult != DSERR_BUFFERLOST) {
-			Com_Printf (PRNT_ERROR, "SndImp_BeginPainting: Lock failed with error '%s'\n", GetDirectSoundErrorString (hresult));
-			Snd_Shutdown ();
+		if (hresult != DSERR_BUFFERLOST)
 			return;
-		}
-		else {
-			snd_win.pDSBuf->Restore ();
-		}
+
+		snd_win.pDSBuf->Restore ();
 
 		if (++reps > 2)
 			return;
@@ -517,8 +497,11 @@ void SndImp_Activate(const bool bActive)
 	if (!snd_win.pDS || !sys_winInfo.hWnd || !snd_win.initialized)
 		return;
 
+	// Keep the audio thread off the buffers while they change
+	DMASnd_LockDevice();
 	if (bActive)
 		DS_CreateBuffers(false);
 	else
 		DS_DestroyBuffers(false);
+	DMASnd_UnlockDevice();
 }